@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+#include <span>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "AnimationPose.h"
+
+namespace UniDx
+{
+
+class Skeleton;
+
+// --------------------
+// AnimationClip
+//
+// Skeleton の全ノードの姿勢を、一定の間隔（sampleRate）で並べたもの。
+// 読み込むときにキーフレームから作り直しておくので、どの時刻でも前後2つの姿勢を nlerp で混ぜるだけで取り出せる。
+// 1フレーム分は AnimationPose と同じ SoA の並びで、動かないノードには初期姿勢が入る。
+// --------------------
+class AnimationClip
+{
+public:
+    // キーフレームの並び。glTF の animation の channel 1つ分
+    struct Track
+    {
+        enum class Path { Translation, Rotation, Scale };
+        enum class Interpolation { Linear, Step, CubicSpline };
+
+        int32_t            node = -1;       // Skeleton のノードの番号
+        Path               path = Path::Translation;
+        Interpolation      interpolation = Interpolation::Linear;
+        std::vector<float> times;           // 秒。昇順
+        std::vector<float> values;          // 位置とスケールは3つ、回転は4つずつ。CubicSpline は入りの接線・値・出の接線の順
+    };
+
+    static constexpr float DefaultSampleRate = 30.0f;
+
+    // tracks から作る。tracks にないノードは skeleton の初期姿勢にする。キーがなければ false
+    bool build(const std::string& name, const Skeleton& skeleton, std::span<const Track> tracks,
+        float sampleRate = DefaultSampleRate);
+
+    const std::string& getName() const { return name_; }
+
+    // 秒
+    float getLength() const { return length_; }
+    float getSampleRate() const { return sampleRate_; }
+    size_t getFrameCount() const { return frameCount_; }
+    size_t getNodeCount() const { return nodeCount_; }
+
+    // 姿勢を並べたバイト数
+    size_t getMemorySize() const { return frames_.size() * sizeof(float); }
+
+    // time 秒の姿勢を out に書く。loop なら長さで繰り返し、そうでなければ最後の姿勢で止まる
+    void sample(float time, bool loop, AnimationPose& out) const;
+
+    // frame 番目の姿勢の先頭。AnimationPose と同じ並び
+    const float* getFrame(size_t frame) const { return frames_.data() + frame * stride_ * AnimationPose::ChannelCount; }
+
+private:
+    std::string        name_;
+    float              length_ = 0.0f;
+    float              sampleRate_ = DefaultSampleRate;
+    size_t             frameCount_ = 0;
+    size_t             nodeCount_ = 0;
+    size_t             stride_ = 0;
+    std::vector<float> frames_;
+};
+
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <SimpleMath.h>
+
+#include "UniDxDefine.h"
+
+namespace UniDx
+{
+
+// --------------------
+// AnimationPose
+//
+// ノードごとの位置・回転・スケールを SoA で持つ。
+// 並びは tx, ty, tz, qx, qy, qz, qw, sx, sy, sz の順のチャンネルに、それぞれ stride 個ずつ。
+// 4つずつ SIMD で計算できるよう、stride はノードの数を4の倍数に切り上げたもので、余りは単位の姿勢にしておく。
+// --------------------
+class AnimationPose
+{
+public:
+    enum Channel { TX, TY, TZ, QX, QY, QZ, QW, SX, SY, SZ, ChannelCount };
+
+    // count 個のノードを単位の姿勢で確保する
+    void resize(size_t count);
+
+    size_t size() const { return count_; }
+    size_t getStride() const { return stride_; }
+
+    float* data() { return data_.data(); }
+    const float* data() const { return data_.data(); }
+    float* channel(Channel c) { return data_.data() + c * stride_; }
+    const float* channel(Channel c) const { return data_.data() + c * stride_; }
+
+    void set(size_t i, const Vector3& position, const Quaternion& rotation, const Vector3& scale);
+    Vector3 getPosition(size_t i) const;
+    Quaternion getRotation(size_t i) const;
+    Vector3 getScale(size_t i) const;
+
+    // count 個のノードの stride
+    static size_t GetStride(size_t count) { return (count + 3) & ~size_t(3); }
+
+private:
+    std::vector<float> data_;
+    size_t count_ = 0;
+    size_t stride_ = 0;
+};
+
+
+// a と b を t の割合で混ぜて out に書く。a, b, out は stride 個ずつ ChannelCount 並んだもの（stride は4の倍数）
+// 位置とスケールは線形に、回転は b を a と同じ半球に揃えてから線形に混ぜて正規化する（nlerp）
+// SSE が使えれば4ノードずつ計算する。out は a か b と同じでもよい
+void BlendPoseChannels(const float* a, const float* b, float t, size_t stride, float* out);
+
+// スカラー版（比較・フォールバック用）
+void BlendPoseChannelsScalar(const float* a, const float* b, float t, size_t stride, float* out);
+
+// BlendPoseChannels を AnimationPose で呼ぶ。a と b は同じ大きさであること
+void BlendPoses(const AnimationPose& a, const AnimationPose& b, float t, AnimationPose& out);
+
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <span>
+
+#include "Component.h"
+#include "Skeleton.h"
+#include "AnimationClip.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// Animator
+//
+// Skeleton のポーズを AnimationClip から計算し、スキンのジョイントの行列を作る。
+// 時間は Update の後にメインスレッドで進め、ポーズの計算は AnimatorManager がワーカースレッドで並列に行う。
+// 計算した行列は SkinnedMeshRenderer が描画のときに定数バッファに送る。
+// クリップがなければ Skeleton の初期姿勢になる。
+// --------------------
+class Animator : public Component
+{
+public:
+    // 再生の速さ。1 で等倍
+    float speed = 1.0f;
+
+    // クリップの最後で最初に戻る
+    bool loop = true;
+
+    virtual ~Animator();
+
+    void setSkeleton(std::shared_ptr<const Skeleton> skeleton);
+    const Skeleton* getSkeleton() const { return skeleton_.get(); }
+
+    void addClip(std::shared_ptr<const AnimationClip> clip) { clips_.push_back(std::move(clip)); }
+    std::span<const std::shared_ptr<const AnimationClip>> getClips() const { return clips_; }
+
+    // 名前でクリップを探す。なければ nullptr
+    std::shared_ptr<const AnimationClip> findClip(const std::string& name) const;
+
+    // clip を最初から再生する。nullptr なら初期姿勢に戻す
+    void Play(std::shared_ptr<const AnimationClip> clip);
+    bool Play(const std::string& name);
+
+    // 今のポーズから fadeTime 秒かけて clip に移る
+    void CrossFade(std::shared_ptr<const AnimationClip> clip, float fadeTime);
+
+    const AnimationClip* getCurrentClip() const { return current_.get(); }
+
+    // 今のクリップの再生位置（秒）
+    float getTime() const { return time_; }
+    void setTime(float time) { time_ = time; }
+
+    // 最後に計算したスキンのジョイントの行列。1つにつき Skeleton::PaletteRowsPerJoint 個の float4
+    std::span<const Vector4> getSkinPalette(size_t skin) const;
+
+    // 最後に計算したノードのモデル空間の行列
+    std::span<const Matrix> getModelMatrices() const { return model_; }
+
+    // 最後に計算したポーズ
+    const AnimationPose& getPose() const { return pose_; }
+
+protected:
+    virtual void OnEnable() override;
+    virtual void OnDisable() override;
+
+private:
+    friend class AnimatorManager;
+
+    std::shared_ptr<const Skeleton> skeleton_;
+    std::vector< std::shared_ptr<const AnimationClip> > clips_;
+
+    std::shared_ptr<const AnimationClip> current_;
+    std::shared_ptr<const AnimationClip> previous_;     // クロスフェードで抜けていくクリップ
+    float time_ = 0.0f;
+    float previousTime_ = 0.0f;
+    float fadeTime_ = 0.0f;
+    float fadeElapsed_ = 0.0f;
+
+    AnimationPose        pose_;
+    AnimationPose        fadePose_;
+    std::vector<Matrix>  model_;
+    std::vector<Vector4> palette_;          // スキンの順に並べたジョイントの行列
+    std::vector<size_t>  paletteOffsets_;   // スキンごとの palette_ の先頭と、最後に全体の数
+
+    int32_t animatorIndex_ = -1;            // AnimatorManager 内の番号
+
+    // 時間を進める。メインスレッドで呼ぶ
+    void advance(float deltaTime);
+
+    // ポーズとジョイントの行列を計算する。ほかの Animator と並列に呼んでよい
+    void evaluate();
+};
+
+}
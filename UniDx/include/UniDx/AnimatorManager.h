@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+class Animator;
+
+// --------------------
+// AnimatorManager
+//
+// 有効な Animator を登録しておき、毎フレーム時間を進めてポーズとスキンのジョイントの行列を計算する。
+// 時間を進めるのはメインスレッドで、ポーズの計算は BatchSize 個ずつ JobSystem で並列に行う。
+// Engine が Update と LateUpdate の間に呼ぶので、LateUpdate では計算したポーズを読める。
+// --------------------
+class AnimatorManager : public Singleton<AnimatorManager>
+{
+public:
+    struct Stats
+    {
+        size_t animatorCount = 0;   // 前回計算した Animator の数
+        size_t nodeCount = 0;       // 前回計算したノードの合計
+        double evaluateTime = 0.0;  // 前回のポーズの計算にかかった秒数
+    };
+
+    // 1つの仕事で計算する Animator の数
+    static constexpr size_t BatchSize = 8;
+
+    void registerAnimator(Animator* animator);
+    void unregisterAnimator(Animator* animator);
+
+    // 時間を進めてポーズを計算する。毎フレーム、メインスレッドで呼ぶ
+    void update(float deltaTime);
+
+    // 複数のスレッドで計算するかどうか
+    void setParallel(bool enable) { parallel_ = enable; }
+    bool isParallel() const { return parallel_; }
+
+    size_t getAnimatorCount() const { return animators_.size(); }
+    const Stats& getStats() const { return stats_; }
+
+private:
+    std::vector<Animator*> animators_;
+    bool  parallel_ = true;
+    Stats stats_;
+};
+
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <map>
+#include <mutex>
+#include <future>
+#include <string>
+#include <memory>
+#include <functional>
+#include <typeindex>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// AssetCache
+//
+// テクスチャ・シェーダー・メッシュなどを、種類とパスと違い（頂点の形式やラップモード）で共有する。
+// 返すのは shared_ptr で、誰も持たなくなったら資源は破棄される。キャッシュは weak_ptr だけを持つ。
+// 同じものを別のスレッドが作っている最中なら、作り終わるのを待って同じものを返す。
+// 作るのに失敗したものは覚えておかず、次に頼まれたときにまた作る。
+// 作る関数が例外を投げたときも覚えておかず、待っていたスレッドにも同じ例外が投げられる。
+//
+// 使っているのはテクスチャ、シェーダー、キューブと球のサブメッシュ、
+// GltfModel の Load と LoadCached で読んだモデル。GltfModel の LoadAsync は共有しない。
+// --------------------
+class AssetCache : public Singleton<AssetCache>
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;        // 作ってあったものを返した
+        size_t misses = 0;      // 新しく作った
+        size_t waits = 0;       // 別のスレッドが作り終わるのを待って返した
+    };
+
+    // type の path を variant の違いで作ったものを返す。なければ load で作って覚えておく
+    // load が nullptr を返したら nullptr
+    template<typename T, typename F>
+    std::shared_ptr<T> get(const std::wstring& path, uint64_t variant, F&& load)
+    {
+        return std::static_pointer_cast<T>(get_(typeid(T), path, variant,
+            [&load]() -> std::shared_ptr<void> { return load(); }));
+    }
+
+    // AssetCache があれば共有し、なければ load で作る
+    template<typename T, typename F>
+    static std::shared_ptr<T> Share(const std::wstring& path, uint64_t variant, F&& load)
+    {
+        AssetCache* cache = getInstance();
+        return cache != nullptr ? cache->get<T>(path, variant, std::forward<F>(load)) : load();
+    }
+
+    Stats getStats() const;
+    void resetStats();
+
+    // 今だれかが持っているものの数
+    size_t getLiveCount() const;
+
+    // 誰も持たなくなったものを表から除く
+    void purge();
+
+private:
+    struct Key
+    {
+        std::type_index type;
+        std::wstring    path;
+        uint64_t        variant;
+
+        bool operator<(const Key& other) const
+        {
+            if (type != other.type) return type < other.type;
+            if (variant != other.variant) return variant < other.variant;
+            return path < other.path;
+        }
+    };
+    struct Entry
+    {
+        std::weak_ptr<void> asset;
+        std::shared_future< std::shared_ptr<void> > loading;    // 作っている最中だけ有効
+    };
+
+    mutable std::mutex mutex_;
+    std::map<Key, Entry> entries_;
+    Stats stats_;
+
+    std::shared_ptr<void> get_(std::type_index type, const std::wstring& path, uint64_t variant,
+        const std::function<std::shared_ptr<void>()>& load);
+};
+
+}
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// AssetLoadHandle
+//
+// 非同期の読み込み1つ分の進み具合。読み込みを始めた側と AssetLoader が共有する。
+// 状態はどのスレッドから読んでもよい。完了と失敗はメインスレッドで決まる。
+// --------------------
+class AssetLoadHandle
+{
+public:
+    enum class State
+    {
+        Loading,    // ワーカーでファイルの読み込みとデコード中
+        Uploading,  // メインスレッドで GPU のリソースを作成中
+        Completed,
+        Failed,
+        Cancelled,
+    };
+
+    AssetLoadHandle() : future_(promise_.get_future().share()) {}
+
+    State getState() const { return state_.load(std::memory_order_acquire); }
+    bool isDone() const { return getState() >= State::Completed; }
+    bool succeeded() const { return getState() == State::Completed; }
+    bool isCancelled() const { return getState() == State::Cancelled; }
+
+    // 完了で true、失敗か取り消しで false になる
+    // GPU の作成はメインスレッドの AssetLoader::update で進むので、メインスレッドで待ってはいけない
+    std::shared_future<bool> getFuture() const { return future_; }
+
+    // 読み込みをやめる。まだ済んでいない手順は何もせずに終わる
+    void cancel() { finish(State::Cancelled); }
+
+    // 計測。ワーカーでのデコード、メインスレッドでの作成、始めてから終わるまでの秒数
+    double getDecodeTime() const { return decodeTime_; }
+    double getUploadTime() const { return uploadTime_; }
+    double getTotalTime() const { return totalTime_; }
+
+    // 1フレームで作成にかかった最長の秒数
+    double getMaxSliceTime() const { return maxSliceTime_; }
+
+    // ---- 読み込む側から呼ぶ ----
+    // デコードが済んで作成に移る。取り消されていれば false
+    bool beginUpload();
+    // 終わった状態にする。2回目以降は何もしない
+    void finish(State state);
+    void addDecodeTime(double seconds) { decodeTime_ += seconds; }
+    void addUploadTime(double seconds, uint64_t frame);
+
+private:
+    std::atomic<State>       state_ = State::Loading;
+    std::promise<bool>       promise_;
+    std::shared_future<bool> future_;
+    std::atomic<bool>        finished_ = false;
+
+    std::chrono::steady_clock::time_point startTime_ = std::chrono::steady_clock::now();
+    double   decodeTime_ = 0.0;
+    double   uploadTime_ = 0.0;
+    double   totalTime_ = 0.0;
+    double   maxSliceTime_ = 0.0;
+    double   sliceTime_ = 0.0;
+    uint64_t sliceFrame_ = UINT64_MAX;
+};
+
+
+// --------------------
+// AssetLoader
+//
+// アセットの非同期読み込み。
+// ファイルの読み込みとデコードは専用のワーカースレッドで行い（JobSystem の parallelFor は待つので使わない）、
+// GPU のリソースの作成はメインスレッドの手順として積んでおく。
+// 手順は update で積んだ順に実行し、1フレームで使うバイト数と時間の予算を超えたら次のフレームに回す。
+// Engine が syncStructure の前に update を呼ぶので、手順の中で作った GameObject はそのフレームでシーンに入る。
+// --------------------
+class AssetLoader : public Singleton<AssetLoader>
+{
+public:
+    struct Budget
+    {
+        size_t bytesPerFrame = 16 * 1024 * 1024;   // 1フレームで GPU に送るバイト数
+        double secondsPerFrame = 0.002;             // 1フレームでメインスレッドの手順に使う時間
+    };
+
+    // メインスレッドの手順。GPU に送ったバイト数を返す
+    using MainThreadStep = std::function<size_t()>;
+
+    explicit AssetLoader(size_t workerCount = 2);
+    virtual ~AssetLoader();
+
+    // ワーカースレッドで job を実行する。どのスレッドから呼んでもよい
+    void enqueue(std::function<void()> job);
+
+    // メインスレッドの手順を積む。どのスレッドから呼んでもよい
+    void enqueueMainThread(MainThreadStep step);
+    void enqueueMainThread(std::vector<MainThreadStep> steps);
+
+    // 予算の範囲でメインスレッドの手順を実行する。毎フレーム、メインスレッドで呼ぶ
+    // 予算に関係なく、1フレームに少なくとも1つは実行する
+    void update();
+
+    // ワーカーの仕事とメインスレッドの手順が全部終わるまで、予算なしで実行し続ける。メインスレッドで呼ぶ
+    void finishAll();
+
+    // まだ終わっていない仕事と手順の数
+    size_t getPendingCount() const;
+
+    void setBudget(const Budget& budget) { budget_ = budget; }
+    const Budget& getBudget() const { return budget_; }
+
+    // update を呼んだ回数
+    uint64_t getFrameCount() const { return frame_; }
+
+private:
+    std::vector<std::thread>           workers_;
+    mutable std::mutex                 mutex_;
+    std::condition_variable            wakeCondition_;
+    std::condition_variable            idleCondition_;
+    std::deque<std::function<void()>>  jobs_;
+    std::deque<MainThreadStep>         steps_;
+    size_t                             runningJobs_ = 0;
+    bool                               quit_ = false;
+
+    Budget   budget_;
+    uint64_t frame_ = 0;
+
+    void workerMain();
+
+    // 手順を1つ取り出す。なければ false
+    bool popStep(MainThreadStep& step);
+};
+
+}
@@ -1,7 +1,7 @@
 ﻿#pragma once
 #include <string>
 
-#include "UniDxDefine.h"
+#include "UniDxMath.h"
 #include "Property.h"
 
 #ifdef min
@@ -12,7 +12,8 @@ namespace UniDx {
 class Camera : public Behaviour
 {
 public:
-    static Camera* main;
+    // メインカメラ。エンジンごとに RendererManager が持つ
+    static ReadOnlyProperty<Camera*> main;
 
     float fov = 60.0f;
     float nearClip = 0.1f;
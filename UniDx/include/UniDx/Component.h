@@ -48,6 +48,8 @@ public:
     virtual ~Component();
 
 protected:
+    friend class GameObject;
+
     virtual void Awake() {}
     virtual void Start() {}
     virtual void OnEnable() {}
@@ -59,6 +61,9 @@ protected:
     bool _enabled;
 
     Component();
+
+    // GameObject のアクティブ状態が変わったときに呼ばれる
+    void onActiveInHierarchyChanged(bool active);
 };
 
 
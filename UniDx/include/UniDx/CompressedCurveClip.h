@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "AnimationCurve.h"
+
+namespace UniDx
+{
+
+// --------------------
+// CompressedCurveClip
+//
+// 複数の AnimationCurve をまとめて小さくしたもの。
+// カーブは4本ずつのグループに分け、グループの中の4本（SIMD のレーン）でキーの時刻を共有する。
+// 作るときに sampleRate の間隔で評価し直し、前後のキーの線形補間でトラックごとの許容誤差に収まるフレームは捨てる。
+// 値はトラックごとの最小値と幅で 16bit に量子化し、キーの時刻はフレーム番号を 16bit で持つ。
+// 1つのキーは時刻と4レーンの値を並べた 10 バイトで、グループのキーは時刻の順に続けて並ぶ。
+// --------------------
+class CompressedCurveClip
+{
+public:
+    static constexpr size_t LaneCount = 4;
+    static constexpr float DefaultSampleRate = 30.0f;
+    static constexpr float DefaultMaxError = 0.001f;
+
+    // 1つのキーを捨てずに残す最長のフレーム数。作る時間を抑えるため
+    static constexpr uint32_t MaxKeyGap = 256;
+
+    // curves を圧縮する。maxErrors はトラックごとの許容誤差で、足りない分は DefaultMaxError
+    // 許容誤差はフレームの時刻で守る。フレームの間は元のカーブとの差が少し大きくなることがある
+    bool build(std::span<const AnimationCurve> curves, std::span<const float> maxErrors = {},
+        float sampleRate = DefaultSampleRate);
+
+    size_t getTrackCount() const { return trackCount_; }
+    size_t getGroupCount() const { return groups_.size(); }
+
+    // 最初と最後のキーの時刻（秒）
+    float getStartTime() const { return startTime_; }
+    float getEndTime() const { return startTime_ + float(frameCount_ - 1) / sampleRate_; }
+    float getSampleRate() const { return sampleRate_; }
+
+    // 残したキーの数の合計
+    size_t getKeyCount() const { return keys_.size(); }
+
+    // 持っているデータのバイト数
+    size_t getMemorySize() const;
+
+    // 作るときにフレームの間も含めて元のカーブと比べた、track の誤差の最大
+    float getMaxError(size_t track) const { return errors_[track]; }
+
+    // time 秒の track の値。1本だけ取り出す（確認用）
+    float evaluate(size_t track, float time) const;
+
+private:
+    friend class CompressedCurveSampler;
+
+    struct Key
+    {
+        uint16_t frame;                 // フレーム番号
+        uint16_t values[LaneCount];     // 量子化した値
+    };
+
+    struct Group
+    {
+        uint32_t firstKey;
+        uint32_t keyCount;
+    };
+
+    size_t             trackCount_ = 0;
+    size_t             frameCount_ = 0;
+    float              startTime_ = 0.0f;
+    float              sampleRate_ = DefaultSampleRate;
+    std::vector<Group> groups_;
+    std::vector<Key>   keys_;
+    std::vector<float> offsets_;    // グループ×レーンの順。量子化した値の 0 にあたる値
+    std::vector<float> scales_;     // グループ×レーンの順。量子化した値の 1 あたりの値
+    std::vector<float> errors_;     // トラックごと
+
+    // time をフレームの位置にする
+    float toFrame(float time) const;
+
+    // group の中で frame を含む区間の最初のキーを探す
+    uint32_t findKey(const Group& group, float frame) const;
+};
+
+
+// --------------------
+// CompressedCurveSampler
+//
+// CompressedCurveClip の全トラックを、グループごとに SIMD で4本ずつまとめて評価する。
+// グループごとに前回のキーを覚えておき、前回より後の時刻なら、そこから先に進めるだけで探す。
+// 再生中のように時刻が少しずつ進むときは、キーを探す手間がほぼなくなる。
+// --------------------
+class CompressedCurveSampler
+{
+public:
+    CompressedCurveSampler() = default;
+    explicit CompressedCurveSampler(const CompressedCurveClip& clip) { reset(clip); }
+
+    // clip を評価するようにして、覚えているキーを最初に戻す
+    void reset(const CompressedCurveClip& clip);
+
+    // time 秒の全トラックの値を out に書く。out は getTrackCount() 個以上
+    void sample(float time, std::span<float> out);
+
+private:
+    const CompressedCurveClip* clip_ = nullptr;
+    std::vector<uint32_t>      cursors_;    // グループごとの前回の区間の最初のキー
+};
+
+}
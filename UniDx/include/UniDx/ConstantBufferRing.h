@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "UniDxDefine.h"
+#include "RenderDevice.h"
+#include "RingAllocator.h"
+
+namespace UniDx
+{
+
+// --------------------
+// ConstantBufferRing
+//
+// 描画ごとの小さな定数を、1つの大きな動的定数バッファから切り出して書き込む。
+// 切り出した位置は VSSetConstantBuffers1 のオフセットで指定するので、
+// 描画ごとに定数バッファを作ったり UpdateSubresource したりしなくてよい。
+// デバイスが定数バッファのオフセット指定（D3D11.1）に対応していないときは isSupported() が false になる。
+// 1フレームで容量を超えて先頭に戻ったときは、次のフレームの始めに maxCapacity まで広げて作り直す。
+// --------------------
+class ConstantBufferRing
+{
+public:
+    // VSSetConstantBuffers1 のオフセットは 16 定数（256 バイト）単位
+    static constexpr UINT Alignment = 256;
+
+    // device に書き込む capacity バイトのバッファを作る。足りなければ maxCapacity バイトまで広げる
+    bool initialize(RenderDevice& device, UINT capacity, UINT maxCapacity);
+
+    bool isSupported() const { return device_ != nullptr; }
+
+    // フレームの始まり。前のフレームで足りなかったらバッファを広げる
+    void beginFrame();
+
+    // size バイトを書き込み、頂点シェーダーの slot にセットする
+    bool uploadVS(UINT slot, const void* data, UINT size);
+
+    const RingAllocator& getAllocator() const { return allocator_; }
+
+private:
+    bool createBuffer_(UINT capacity);
+
+    ComPtr<ID3D11Buffer>         buffer_;
+    RenderDevice*                device_ = nullptr;
+    UINT                         maxCapacity_ = 0;
+    RingAllocator                allocator_;
+};
+
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <d3d11_1.h>
+
+#include "UniDxDefine.h"
+#include "RenderDevice.h"
+
+namespace UniDx
+{
+
+// --------------------
+// D3D11RenderDevice
+//
+// RenderDevice を D3D11 のデバイスとデバイスコンテキストに送る実装。
+// コンテキストはイミディエイトでも遅延でもよい。
+// --------------------
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+    D3D11RenderDevice(ID3D11Device* device, ID3D11DeviceContext* context);
+
+    ID3D11DeviceContext* getContext() const { return context_.Get(); }
+
+    virtual bool isNull() const override { return false; }
+    virtual bool supportsConstantBufferOffsetting() const override { return constantBufferOffsetting_; }
+
+    virtual bool createBuffer(const BufferDesc& desc, const void* initialData, ID3D11Buffer** buffer) override;
+    virtual bool createTexture2D(const Texture2DDesc& desc, const SubresourceData* initialData, ID3D11Texture2D** texture) override;
+    virtual bool createShaderResourceView(ID3D11Resource* resource, const ShaderResourceViewDesc& desc, ID3D11ShaderResourceView** view) override;
+    virtual bool createDepthStencilState(const DepthStencilDesc& desc, ID3D11DepthStencilState** state) override;
+    virtual bool createSamplerState(const SamplerDesc& desc, ID3D11SamplerState** state) override;
+    virtual bool createVertexShader(const void* bytecode, size_t size, ID3D11VertexShader** shader) override;
+    virtual bool createPixelShader(const void* bytecode, size_t size, ID3D11PixelShader** shader) override;
+    virtual bool createInputLayout(const InputElementDesc* elements, uint32_t count, const void* bytecode, size_t size, ID3D11InputLayout** layout) override;
+
+    virtual void updateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+    virtual void* mapBuffer(ID3D11Buffer* buffer, uint32_t size, bool discard) override;
+    virtual void unmapBuffer(ID3D11Buffer* buffer, uint32_t bytesWritten) override;
+    virtual void* mapStagingBuffer(ID3D11Buffer* buffer, uint32_t size) override;
+    virtual void unmapStagingBuffer(ID3D11Buffer* buffer) override;
+    virtual void copyBuffer(ID3D11Buffer* dst, ID3D11Buffer* src, uint32_t size) override;
+    virtual void copySubresource(ID3D11Resource* dst, uint32_t dstSubresource, ID3D11Resource* src, uint32_t srcSubresource, uint32_t size) override;
+
+    virtual void setVertexShader(ID3D11VertexShader* shader) override;
+    virtual void setPixelShader(ID3D11PixelShader* shader) override;
+    virtual void setInputLayout(ID3D11InputLayout* layout) override;
+    virtual void setPrimitiveTopology(PrimitiveTopology topology) override;
+    virtual void setVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset) override;
+    virtual void setIndexBuffer(ID3D11Buffer* buffer, GpuFormat format, uint32_t offset) override;
+    virtual void setVSConstantBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers) override;
+    virtual void setVSConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t numConstants) override;
+    virtual void setPSShaderResource(uint32_t slot, ID3D11ShaderResourceView* srv) override;
+    virtual void setPSSampler(uint32_t slot, ID3D11SamplerState* sampler) override;
+    virtual void setDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef) override;
+
+    virtual void draw(uint32_t vertexCount) override;
+    virtual void drawIndexed(uint32_t indexCount) override;
+    virtual void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startInstance) override;
+    virtual void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance) override;
+
+private:
+    ComPtr<ID3D11Device>         device_;
+    ComPtr<ID3D11DeviceContext>  context_;
+    ComPtr<ID3D11DeviceContext1> context1_;     // 定数バッファのオフセット指定用
+    bool                         constantBufferOffsetting_ = false;
+};
+
+}
@@ -8,8 +8,13 @@
 
 #include "UniDxDefine.h"
 #include "Singleton.h"
+#include "RenderContext.h"
 
 
+constexpr UINT UNIDX_VS_SLOT_OBJECT = 0;  // b0 描画ごとの定数
+constexpr UINT UNIDX_VS_SLOT_CAMERA = 1;  // b1 カメラの定数
+constexpr UINT UNIDX_VS_SLOT_SKIN = 2;  // b2 スキンのジョイントの行列
+
 constexpr UINT UNIDX_PS_SLOT_LIGHTS = 0;  // t0
 constexpr UINT UNIDX_PS_SLOT_LIGHT_INDICES = 1;  // t1
 constexpr UINT UNIDX_PS_SLOT_ALBEDO = 4;  // t4
@@ -33,20 +38,50 @@ public:
 	//--------------------------------------------
 	bool Initialize(HWND hWnd, int width, int height);
 
+	//--------------------------------------------
+	// GPUを使わずに初期化する。描画の呼び出しは NullRenderDevice が数えるだけになる
+	// width	: 画面の幅
+	// height	: 画面の高さ
+	//--------------------------------------------
+	bool InitializeNull(int width, int height);
+
+	// GPUを使わずに初期化したか
+	bool IsNull() const { return m_device == nullptr; }
+
 	const ComPtr<ID3D11Device>&			GetDevice() const { return m_device; }
 	const ComPtr<ID3D11DeviceContext>&	GetContext() const { return m_context; }
 
+	// 同じ値の再設定を省略するためのキャッシュ。描画時の状態設定はこれを通す
+	// 遅延コンテキストに記録しているスレッドでは、そのコンテキストのキャッシュを返す
+	RenderStateCache&					GetStateCache() { return RenderContext::current().getStateCache(); }
+
+	// イミディエイトコンテキストの記録先
+	RenderContext&						GetRenderContext() { return m_immediate; }
+
+	// リソースの作成とイミディエイトコンテキストへの描画の呼び出しに使うデバイス
+	RenderDevice&						GetRenderDevice() { return m_immediate.getDevice(); }
+
+	// レンダーターゲット・ビューポート・深度ステンシルステートを context に設定
+	// 何も設定されていない遅延コンテキストに記録を始めるときに使う
+	void bindFrameTargets(ID3D11DeviceContext* context) const;
+
 	// バックバッファレンダーターゲットをクリア
 	void Clear(float r, float g, float b, float a);
 
 	// バックバッファの内容を画面に表示
 	void Present()
 	{
-		m_swapChain->Present(1, 0);
+		if (m_swapChain != nullptr)
+		{
+			m_swapChain->Present(1, 0);
+		}
 	}
 
 	const Vector2& getScreenSize() const { return screenSize; }
 
+	// 描画先のビューポートの横÷縦。カメラの投影行列に使う
+	float getAspectRatio() const { return m_viewport.Height > 0.0f ? m_viewport.Width / m_viewport.Height : 1.0f; }
+
 private:
 	Vector2                         screenSize;
 	ComPtr<ID3D11Device>			m_device; // Direct3Dデバイス
@@ -57,6 +92,9 @@ private:
 	ComPtr<ID3D11Texture2D> m_depthStencilBuffer; // デプス&ステンシルバッファ
 	ComPtr<ID3D11DepthStencilView> m_depthStencilView;
 	ComPtr<ID3D11DepthStencilState> m_depthStencilState;
+
+	D3D11_VIEWPORT					m_viewport{};
+	RenderContext					m_immediate; // イミディエイトコンテキストの記録先
 };
 
 } // UniDx
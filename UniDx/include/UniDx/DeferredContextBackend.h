@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "UniDxDefine.h"
+#include "ParallelRecorder.h"
+#include "RenderContext.h"
+
+namespace UniDx
+{
+
+// --------------------
+// DeferredContextBackend
+//
+// スロットごとに D3D11 の遅延コンテキストを持ち、記録したコマンドリストを
+// イミディエイトコンテキストで実行する記録先。
+// 記録の間、そのスレッドの RenderContext::current() はスロットの遅延コンテキストになる。
+// 遅延コンテキストは何も設定されていない状態から始まるので、
+// レンダーターゲットなどフレーム共通の設定は記録の始めに D3DManager が設定し直す。
+// --------------------
+class DeferredContextBackend : public RecordingBackend
+{
+public:
+    // slotCount 個の遅延コンテキストを作る。expectedDrawsPerSlot は 1 つの記録先で描画する見込みの数
+    bool initialize(size_t slotCount, size_t expectedDrawsPerSlot);
+
+    virtual size_t getSlotCount() const override { return slots_.size(); }
+    virtual void beginRecording(size_t slot) override;
+    virtual void endRecording(size_t slot) override;
+    virtual void execute(size_t slot) override;
+
+    RenderContext& getRenderContext(size_t slot) { return slots_[slot]->context; }
+
+private:
+    struct Slot
+    {
+        RenderContext                context;
+        ComPtr<ID3D11CommandList>    commandList;
+        std::unique_ptr<RenderContext::Scope> scope;
+    };
+    std::vector<std::unique_ptr<Slot>> slots_;
+};
+
+}
@@ -16,6 +16,7 @@ class Canvas;
 class Engine : public Singleton<Engine>
 {
 public:
+    // hWnd が nullptr なら GPU を使わずに初期化する
     virtual void Initialize(HWND hWnd);
     virtual int PlayerLoop();
 
@@ -28,11 +29,17 @@ public:
     void unregisterCanvas(Canvas* c);
 
 protected:
+    void createScene();
+
     virtual void fixedUpdate();
     virtual void physics();
     virtual void input();
     virtual void update();
+    virtual void animate();
     virtual void lateUpdate();
+    virtual void loadAssets();
+    virtual void syncStructure();
+    virtual void updateTransforms();
     virtual void render();
     virtual void finalize();
 
@@ -41,12 +48,9 @@ protected:
     void checkStart(GameObject* object);
     void update(GameObject* object);
     void lateUpdate(GameObject* object);
-    void render(GameObject* object, const Camera& camera);
 
 private:
     std::vector<Canvas*> canvas_;
-
-    void createScene();
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace UniDx
+{
+
+// --------------------
+// FrustumCulling
+//
+// ビュー×プロジェクション行列から視錐台の6平面を取り出し、
+// 連続した配列（SoA）に並べた AABB をまとめて判定する。
+// SimpleMath や D3D に依存しないので、GPUやウィンドウなしでも単体で動かせる。
+// --------------------
+
+// 視錐台の6平面。n・p + d >= 0 が内側
+struct FrustumPlanes
+{
+    float nx[6];
+    float ny[6];
+    float nz[6];
+    float d[6];
+};
+
+// ビュー×プロジェクション行列（DirectX と同じ行優先・行ベクトル、float 16個）から平面を作る
+// 深度は D3D と同じ 0～1
+FrustumPlanes ExtractFrustumPlanes(const float* viewProjection);
+
+
+// AABB の中心と半径（各軸の半分の長さ）を SoA で持つ配列
+struct BoundsArray
+{
+    std::vector<float> cx, cy, cz;
+    std::vector<float> ex, ey, ez;
+
+    size_t size() const { return cx.size(); }
+
+    void resize(size_t n)
+    {
+        cx.resize(n); cy.resize(n); cz.resize(n);
+        ex.resize(n); ey.resize(n); ez.resize(n);
+    }
+
+    void set(size_t i, const float* center, const float* extents)
+    {
+        cx[i] = center[0]; cy[i] = center[1]; cz[i] = center[2];
+        ex[i] = extents[0]; ey[i] = extents[1]; ez[i] = extents[2];
+    }
+
+    // 末尾の要素を i に移して1つ減らす
+    void removeSwapBack(size_t i)
+    {
+        const size_t last = size() - 1;
+        cx[i] = cx[last]; cy[i] = cy[last]; cz[i] = cz[last];
+        ex[i] = ex[last]; ey[i] = ey[last]; ez[i] = ez[last];
+        resize(last);
+    }
+};
+
+// 視錐台と交差する AABB のインデックスを visible に書き出し、その数を返す
+// visible には bounds.size() 個分の領域が必要
+size_t CullBounds(const FrustumPlanes& planes, const BoundsArray& bounds, uint32_t* visible);
+
+// スカラー版（比較用）
+size_t CullBoundsScalar(const FrustumPlanes& planes, const BoundsArray& bounds, uint32_t* visible);
+
+}
@@ -16,6 +16,7 @@ class Component;
 class Behaviour;
 class Transform;
 class Collider;
+class Prefab;
 
 
 // --------------------
@@ -33,6 +34,7 @@ public:
         // デフォルトでTransformを追加
         transform = AddComponent<Transform>();
     }
+    virtual ~GameObject();
     // 可変長引数でunique_ptr<Component>を受け取るコンストラクタ
     template<typename First, typename... ComponentPtrs>
         requires (!std::same_as<std::remove_cvref_t<First>, Vector3>)
@@ -85,6 +87,22 @@ public:
 
     void SetName(const wstring& n) { name_ = n; }
 
+    // 自身のアクティブ状態
+    bool activeSelf() const { return activeSelf_; }
+
+    // 親も含めてアクティブかどうか
+    bool activeInHierarchy() const { return activeInHierarchy_; }
+
+    // アクティブ状態の変更
+    // 親も含めたアクティブ状態が変わると、子孫のコンポーネントの OnEnable / OnDisable が呼ばれる
+    void SetActive(bool value);
+
+    // 親が変わったときなどに、親も含めたアクティブ状態を反映
+    void updateActiveInHierarchy();
+
+    // プールから作られた場合のプール
+    Prefab* getPrefab() const { return prefab_; }
+
     virtual void onTriggerEnter(Collider* other);
     virtual void onTriggerStay(Collider* other);
     virtual void onTriggerExit(Collider* other);
@@ -93,7 +111,16 @@ public:
     virtual void onCollisionExit(const Collision& collision);
 
 protected:
+    friend class Prefab;
+    friend class SceneCommandBuffer;
+
     wstring name_;
+    bool activeSelf_ = true;
+    bool activeInHierarchy_ = true;
+    Prefab* prefab_ = nullptr;
+    Prefab* poolRootOf_ = nullptr;  // このオブジェクトをルートにしているプール
+    bool inPool_ = false;       // プールの空きに入っている
+    int32_t delayedDestroyIndex_ = -1;  // SceneCommandBuffer の時刻待ちの破棄での位置。なければ -1
     std::vector<std::unique_ptr<Component>> components;
 };
 
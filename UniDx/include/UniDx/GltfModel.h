@@ -1,18 +1,54 @@
 ﻿#pragma once
 
+#include <span>
+#include <functional>
 #include <tiny_gltf.h>
 
 #include "Renderer.h"
+#include "SkinnedMeshRenderer.h"
+#include "Animator.h"
+#include "Skeleton.h"
+#include "AnimationClip.h"
+#include "LODGroup.h"
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "AssetCache.h"
 
 
 namespace UniDx {
 
+// .glb の読み込み方
+enum class GltfLoadMode
+{
+    Copy,       // ファイルを全部メモリに読み込み、属性ごとにコピーする
+    Mapped,     // ファイルをマップし、型と並びが合う属性はコピーせずに直接指す。頂点の並べ替えはしない
+};
+
 // --------------------
 // GltfModelクラス
+//
+// スキンを持つモデルは、スキンのジョイントを Skeleton に、animation を AnimationClip にして
+// このオブジェクトに Animator を付ける。スキンのあるノードは SkinnedMeshRenderer で描き、
+// その頂点は TVertex ではなく VertexPNTJW、シェーダーは UNIDX_SKINNING を定義した版になる。
+//
+// Load と LoadCached は、同じファイルを同じ頂点の形式と読み込み方で読んだものを AssetCache で共有し、
+// デコードと GPU のバッファの作成は1回だけ行う。LoadAsync は共有せず、毎回読み込む。
 // --------------------
 class GltfModel : public Component
 {
 public:
+    // glTF の skin と animation から作ったもの
+    struct SkinData
+    {
+        std::shared_ptr<const Skeleton> skeleton;
+        std::vector< std::shared_ptr<const AnimationClip> > clips;
+    };
+
+    virtual ~GltfModel();
+
+    // Load と LoadAsync で .glb をどう読むか
+    GltfLoadMode loadMode = GltfLoadMode::Copy;
+
     // glTF形式のモデルファイルを読み込む
     template<typename TVertex>
     bool Load(const std::wstring& modelPath, const std::wstring& shaderPath, const std::wstring& texturePath)
@@ -20,33 +56,83 @@ public:
         // モデル
         if (!Load<TVertex>(modelPath)) return false;
 
-        // マテリアルとシェーダー
-        auto material = std::make_shared<Material>();
-        if(! material->shader.compile<TVertex>(shaderPath)) return false;
+        // マテリアルとシェーダー、テクスチャ
+        return loadMaterial_<TVertex>(shaderPath, texturePath);
+    }
 
-        // テクスチャ
-        auto tex = std::make_unique<Texture>();
-        SetAddressModeUV(tex.get(), 0);     // モデルで指定されたラップモード
-        if(! tex->Load(texturePath)) return false;
-        material->AddTexture(move(tex));
+    // glTF形式のモデルファイルを読み込む
+    template<typename TVertex>
+    bool Load(const std::wstring& filePath)
+    {
+        return load_(filePath, MeshCache::LayoutKey<TVertex>(), &uploadSubMesh_<TVertex>);
+    }
 
-        AddMaterial(material);
+    // エンジンの形式に書き出したファイル（MeshCache）から読み込む
+    // なければ、または元のファイルが変わっていれば glTF から読み込んで書き出しておく
+    template<typename TVertex>
+    bool LoadCached(const std::wstring& modelPath)
+    {
+        const uint64_t layoutKey = MeshCache::LayoutKey<TVertex>();
+        const std::wstring cachePath = MeshCache::GetCachePath(modelPath, layoutKey);
+        if (loadCache_(cachePath, modelPath, layoutKey, sizeof(TVertex))) return true;
+
+        if (!Load<TVertex>(modelPath)) return false;
+        writeCache_<TVertex>(cachePath, modelPath, *model, submesh);
         return true;
     }
+    template<typename TVertex>
+    bool LoadCached(const std::wstring& modelPath, const std::wstring& shaderPath, const std::wstring& texturePath)
+    {
+        if (!LoadCached<TVertex>(modelPath)) return false;
+        return loadMaterial_<TVertex>(shaderPath, texturePath);
+    }
 
-    // glTF形式のモデルファイルを読み込む
+    // glTF を読み込んで、エンジンの形式のファイルに書き出すだけ行う。GameObject は作らない
+    // スキンのあるモデルは MeshCache に入れないので、何もしない
     template<typename TVertex>
-    bool Load(const std::wstring& filePath)
+    static bool Cook(const std::wstring& modelPath)
     {
-        if (load_(filePath))
-        {
-            for (auto& sub : submesh)
+        std::unique_ptr<tinygltf::Model> model;
+        std::vector< std::shared_ptr<SubMesh> > submesh;
+        if (!decode_(modelPath, GltfLoadMode::Copy, model, submesh)) return false;
+        const std::wstring cachePath = MeshCache::GetCachePath(modelPath, MeshCache::LayoutKey<TVertex>());
+        return writeCache_<TVertex>(cachePath, modelPath, *model, submesh);
+    }
+
+    // glTF形式のモデルファイルを非同期で読み込む
+    // ファイルの読み込みとデコードは AssetLoader のワーカーで行い、GPU のバッファは AssetLoader::update で
+    // 1フレームの予算ずつ作る。全部できたらノードの GameObject を子に作り、handle を完了にする
+    template<typename TVertex>
+    std::shared_ptr<AssetLoadHandle> LoadAsync(const std::wstring& modelPath)
+    {
+        return loadAsync_(modelPath, std::wstring(), &uploadSubMesh_<TVertex>, nullptr);
+    }
+    // テクスチャのデコードもワーカーで行う。シェーダーのコンパイルは完了の直前にメインスレッドで行う
+    template<typename TVertex>
+    std::shared_ptr<AssetLoadHandle> LoadAsync(const std::wstring& modelPath, const std::wstring& shaderPath, const std::wstring& texturePath)
+    {
+        return loadAsync_(modelPath, texturePath, &uploadSubMesh_<TVertex>,
+            [shaderPath](Material& material, bool skinned)
             {
-                sub->createBuffer<TVertex>();
-            }
-            return true;
+                return skinned ? compileSkinned_(material.shader, shaderPath) : material.shader.compile<TVertex>(shaderPath);
+            });
+    }
+
+    // 読み込んだメッシュを簡略化した LOD を作り、このオブジェクトの LODGroup で切り替える
+    // ratios は LOD1 から順に残す三角形の割合、screenHeights は LOD0 から順に切り替える画面上の大きさ
+    // Load の後に呼ぶ。作った Renderer には元の Renderer のマテリアルを共有する
+    // SkinnedMeshRenderer は簡略化せず、LOD に関係なく描く
+    template<typename TVertex>
+    bool GenerateLODs(std::span<const float> ratios, std::span<const float> screenHeights,
+        LODFadeMode fadeMode = LODFadeMode::CrossFade)
+    {
+        std::vector< std::shared_ptr<SubMesh> > created;
+        if (!generateLODs_(ratios, screenHeights, fadeMode, created)) return false;
+        for (auto& sub : created)
+        {
+            sub->createBuffer<TVertex>();
         }
-        return false;
+        return true;
     }
 
     // 生成した全ての Renderer にマテリアルを追加
@@ -58,15 +144,137 @@ public:
         }
     }
 
+    // スキンを持つモデルで付けた Animator。なければ nullptr
+    Animator* getAnimator() const { return animator_; }
+
+    // スキンのジョイントとその親をまとめた Skeleton。スキンがなければ nullptr
+    const std::shared_ptr<const Skeleton>& getSkeleton() const { return skin_.skeleton; }
+
+    // glTF の animation から作ったクリップ
+    std::span<const std::shared_ptr<const AnimationClip>> getClips() const { return skin_.clips; }
+
     // Textureのラップモードをこのモデルの指定インデクスのテクスチャ設定に合わせる
     void SetAddressModeUV(Texture* texture, int texIndex) const;
 
+    // このモデルの指定インデクスのテクスチャのラップモード
+    void GetAddressModeUV(int texIndex, D3D11_TEXTURE_ADDRESS_MODE& addressU, D3D11_TEXTURE_ADDRESS_MODE& addressV) const;
+
 protected:
+    // 読み込んでバッファまで作ったモデル。AssetCache で共有する
+    struct SharedMesh
+    {
+        std::shared_ptr<const tinygltf::Model> model;
+        std::vector< std::shared_ptr<SubMesh> > submesh;
+        SkinData skin;
+    };
+
     std::vector<MeshRenderer*> renderer;
-    std::unique_ptr< tinygltf::Model> model;
+    std::shared_ptr<const tinygltf::Model> model;
     std::vector< std::shared_ptr<SubMesh> > submesh;
+    std::shared_ptr<const SharedMesh> shared_;     // 共有しているもの。持っている間は共有が続く
+    std::shared_ptr<AssetLoadHandle> loading_;     // 非同期で読み込み中のもの
+    SkinData  skin_;
+    Animator* animator_ = nullptr;
+
+    // MeshCache から読んだときの 0番のテクスチャのラップモード
+    D3D11_TEXTURE_ADDRESS_MODE cachedAddressU_ = D3D11_TEXTURE_ADDRESS_WRAP;
+    D3D11_TEXTURE_ADDRESS_MODE cachedAddressV_ = D3D11_TEXTURE_ADDRESS_WRAP;
+
+    // filePath を読み込んで uploadSubMesh でバッファを作る。layoutKey が同じものは共有する
+    bool load_(const std::wstring& filePath, uint64_t layoutKey, size_t (*uploadSubMesh)(SubMesh&));
+
+    // ファイルを読み込んでサブメッシュを作る。GPU とシーンを触らないので、ワーカースレッドから呼んでよい
+    // outSkin を渡すと skin と animation も読む
+    static bool decode_(const std::wstring& filePath, GltfLoadMode mode,
+        std::unique_ptr<tinygltf::Model>& outModel, std::vector< std::shared_ptr<SubMesh> >& outSubmesh,
+        SkinData* outSkin = nullptr);
+
+    // model のシーンのノードから子の GameObject を作る。スキンがあれば Animator も付ける
+    void attach_();
+
+    // マテリアルとシェーダー、テクスチャを作って全ての Renderer に追加
+    // SkinnedMeshRenderer には、同じテクスチャでスキニングするシェーダーのマテリアルを追加
+    template<typename TVertex>
+    bool loadMaterial_(const std::wstring& shaderPath, const std::wstring& texturePath)
+    {
+        auto material = std::make_shared<Material>();
+        if(! material->shader.compile<TVertex>(shaderPath)) return false;
+
+        std::shared_ptr<Material> skinned;
+        if (hasSkinnedRenderer_())
+        {
+            skinned = std::make_shared<Material>();
+            if (!compileSkinned_(skinned->shader, shaderPath)) return false;
+        }
+
+        // テクスチャ。モデルで指定されたラップモードで、同じものは共有する
+        D3D11_TEXTURE_ADDRESS_MODE addressU, addressV;
+        GetAddressModeUV(0, addressU, addressV);
+        auto tex = Texture::LoadShared(texturePath, addressU, addressV);
+        if(tex == nullptr) return false;
+        if (skinned != nullptr) skinned->AddTexture(tex);
+        material->AddTexture(move(tex));
+
+        addMaterial_(material, skinned);
+        return true;
+    }
+
+    // スキニングするシェーダーを VertexPNTJW の頂点でコンパイル
+    static bool compileSkinned_(Shader& shader, const std::wstring& shaderPath);
+
+    bool hasSkinnedRenderer_() const;
+
+    // material を Renderer に、skinned を SkinnedMeshRenderer に追加。skinned が nullptr なら全てに material
+    void addMaterial_(const std::shared_ptr<Material>& material, const std::shared_ptr<Material>& skinned);
+
+    // MeshCache のファイルからサブメッシュとノードの GameObject を作る。使えなければ false
+    bool loadCache_(const std::wstring& cachePath, const std::wstring& sourcePath, uint64_t layoutKey, UINT stride);
+
+    // model と submesh を MeshCache のファイルに書き出す
+    template<typename TVertex>
+    static bool writeCache_(const std::wstring& cachePath, const std::wstring& sourcePath,
+        const tinygltf::Model& model, std::span<const std::shared_ptr<SubMesh>> submesh)
+    {
+        for (const auto& sub : submesh)
+        {
+            if (sub->isSkinned())
+            {
+                Debug::Log(L"MeshCache: スキンのあるモデルは書き出しません: " + sourcePath);
+                return true;
+            }
+        }
+
+        std::vector<MeshCache::Node> nodes;
+        D3D11_TEXTURE_ADDRESS_MODE addressU, addressV;
+        collectNodes_(model, submesh.size(), nodes, addressU, addressV);
+        return MeshCache::Write<TVertex>(cachePath, sourcePath, submesh, nodes, addressU, addressV);
+    }
+
+    // model のシーンのノードを、親が子より前になる順に並べる。0番のテクスチャのラップモードも返す
+    static void collectNodes_(const tinygltf::Model& model, size_t subMeshCount, std::vector<MeshCache::Node>& nodes,
+        D3D11_TEXTURE_ADDRESS_MODE& addressU, D3D11_TEXTURE_ADDRESS_MODE& addressV);
+
+    std::shared_ptr<AssetLoadHandle> loadAsync_(const std::wstring& modelPath, const std::wstring& texturePath,
+        size_t (*uploadSubMesh)(SubMesh&), std::function<bool(Material&, bool skinned)> compileShader);
+
+    // サブメッシュの GPU のバッファを作り、送ったバイト数を返す。スキンのあるものは VertexPNTJW で作る
+    template<typename TVertex>
+    static size_t uploadSubMesh_(SubMesh& sub)
+    {
+        if (sub.isSkinned())
+        {
+            sub.createBuffer<VertexPNTJW>();
+            return sub.positions.size() * sizeof(VertexPNTJW) + sub.indices.size_bytes();
+        }
+        sub.createBuffer<TVertex>();
+        return sub.positions.size() * sizeof(TVertex) + sub.indices.size_bytes();
+    }
 
-    bool load_(const std::wstring& filePath);
+    static void setAddressModeUV_(const tinygltf::Model& model, Texture* texture, int texIndex);
+    static void getAddressModeUV_(const tinygltf::Model& model, int texIndex,
+        D3D11_TEXTURE_ADDRESS_MODE& addressU, D3D11_TEXTURE_ADDRESS_MODE& addressV);
+    bool generateLODs_(std::span<const float> ratios, std::span<const float> screenHeights,
+        LODFadeMode fadeMode, std::vector< std::shared_ptr<SubMesh> >& created);
     void createNodeRecursive(const tinygltf::Model& model, int nodeIndex, GameObject* parentGO);
 };
 
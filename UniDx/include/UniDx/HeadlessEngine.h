@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "Engine.h"
+#include "Time.h"
+#include "Random.h"
+
+namespace UniDx
+{
+
+class D3DManager;
+class SceneManager;
+class Physics;
+class LightManager;
+class JobSystem;
+class SceneCommandBuffer;
+class RendererManager;
+class TransformHierarchy;
+class AssetLoader;
+class AssetCache;
+class AnimatorManager;
+
+// --------------------
+// HeadlessEngine
+//
+// ウィンドウ・GPU・入力を使わず、シーンを一定の間隔で更新し続けるエンジン。
+// サーバーでのシミュレーションに使う。
+// マネージャ・時刻・乱数は自分で持ち、Initialize と PlayerLoop を呼んだスレッドと、
+// 自分の JobSystem のワーカーだけがそれを使う。
+// そのため、スレッドごとに HeadlessEngine を作れば、1つのプロセスで独立したシーンを複数動かせる。
+// 描画の呼び出しは NullRenderDevice が数えるだけになる。
+// --------------------
+class HeadlessEngine : public Engine
+{
+public:
+    struct Settings
+    {
+        double   tickRate = 60.0;       // 1秒あたりの更新回数
+        size_t   workerCount = 0;       // このシーン用の JobSystem のワーカーの数
+        uint64_t maxTicks = 0;          // この回数更新したら終わる。0 なら requestStop() まで
+        double   spinTime = 0.001;      // 次の更新の直前はスリープせず、この秒数だけ待ち続ける
+        uint32_t maxCatchUpTicks = 5;   // 遅れを詰めて取り戻す最大の回数。超えたら予定を今に合わせ直す
+        size_t   loaderWorkerCount = 1; // 非同期読み込みのワーカーの数
+    };
+
+    struct Stats
+    {
+        uint64_t ticks = 0;         // 更新した回数
+        uint64_t overruns = 0;      // 更新が予定の時刻に間に合わなかった回数
+        uint64_t droppedTicks = 0;  // 遅れすぎて飛ばした更新の回数
+        double   busyTime = 0.0;    // 更新にかかった時間の合計（秒）
+        double   maxTickTime = 0.0; // 1回の更新にかかった最長の時間（秒）
+    };
+
+    explicit HeadlessEngine(const Settings& settings);
+    virtual ~HeadlessEngine();
+
+    // マネージャを作り、呼んだスレッドで使うようにする。hWnd は使わない
+    virtual void Initialize(HWND hWnd = nullptr) override;
+
+    // シーンを作り、止められるまで一定の間隔で更新する。Initialize と同じスレッドで呼ぶこと
+    virtual int PlayerLoop() override;
+
+    // 更新を止める。別のスレッドから呼んでよい
+    void requestStop() { stopRequested_.store(true, std::memory_order_relaxed); }
+
+    // 更新した回数。別のスレッドから読んでよい
+    uint64_t getTickCount() const { return tickCount_.load(std::memory_order_relaxed); }
+
+    // 統計。PlayerLoop から戻ってから読む
+    const Stats& getStats() const { return stats_; }
+
+    const Settings& getSettings() const { return settings_; }
+
+protected:
+    // 1回分の更新
+    virtual void tick();
+
+private:
+    Settings settings_;
+    Stats    stats_;
+    std::atomic<bool>     stopRequested_ = false;
+    std::atomic<uint64_t> tickCount_ = 0;
+
+    Time::Clock clock_;
+    Random      random_;
+
+    std::unique_ptr<D3DManager>         d3d_;
+    std::unique_ptr<SceneManager>       sceneManager_;
+    std::unique_ptr<Physics>            physics_;
+    std::unique_ptr<LightManager>       lightManager_;
+    std::unique_ptr<JobSystem>          jobSystem_;
+    std::unique_ptr<SceneCommandBuffer> commandBuffer_;
+    std::unique_ptr<RendererManager>    rendererManager_;
+    std::unique_ptr<TransformHierarchy> transformHierarchy_;
+    std::unique_ptr<AssetLoader>        assetLoader_;
+    std::unique_ptr<AssetCache>         assetCache_;
+    std::unique_ptr<AnimatorManager>    animatorManager_;
+
+    // 持っているマネージャを呼んだスレッドで使うようにする／やめる
+    void bindThread();
+    void unbindThread();
+
+    // JobSystem 以外を呼んだスレッドで使うようにする。JobSystem のワーカーの始めにも呼ぶ
+    void bindManagers();
+
+    // シーンとマネージャを破棄する
+    void shutdown();
+};
+
+}
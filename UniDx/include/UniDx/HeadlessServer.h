@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+
+#include "HeadlessEngine.h"
+
+namespace UniDx
+{
+
+// --------------------
+// HeadlessServer
+//
+// 独立したシーンを1つのプロセスで複数、それぞれ専用のスレッドで動かす。
+// スレッドごとに HeadlessEngine を作り、シーンは CreateDefaultScene() で作る。
+// --------------------
+class HeadlessServer
+{
+public:
+    HeadlessServer() = default;
+    ~HeadlessServer();
+    HeadlessServer(const HeadlessServer&) = delete;
+    HeadlessServer& operator=(const HeadlessServer&) = delete;
+
+    // count 個のシーンを動かし始める。動いているときは false
+    bool start(size_t count, const HeadlessEngine::Settings& settings);
+
+    // すべてのシーンに止めるように伝える
+    void requestStop();
+
+    // すべてのシーンが終わるまで待つ
+    void join();
+
+    size_t getInstanceCount() const { return engines_.size(); }
+
+    // index 番目のシーンのエンジン。統計は join() のあとに読む
+    const HeadlessEngine& getEngine(size_t index) const { return *engines_[index]; }
+
+private:
+    std::vector<std::unique_ptr<HeadlessEngine>> engines_;
+    std::vector<std::thread>                     threads_;
+};
+
+}
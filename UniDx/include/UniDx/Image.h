@@ -26,6 +26,7 @@ public:
 
 private:
 	ComPtr<ID3D11Buffer> constantBuffer0;
+	ComPtr<ID3D11Buffer> constantBuffer1;
 	std::unique_ptr<SubMesh> mesh;
 	std::vector<Color> colors;
 };
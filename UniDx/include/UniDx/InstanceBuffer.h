@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "UniDxDefine.h"
+#include "RenderDevice.h"
+#include "RingAllocator.h"
+
+namespace UniDx
+{
+
+// --------------------
+// InstanceBuffer
+//
+// インスタンス描画で使う、インスタンスごとのワールド行列を入れる動的な頂点バッファ。
+// 書き込む位置は RingAllocator で決める。
+// --------------------
+class InstanceBuffer
+{
+public:
+    static constexpr UINT Stride = sizeof(DirectX::SimpleMath::Matrix);
+
+    // 書き込み先のデバイス
+    void setDevice(RenderDevice* device) { device_ = device; }
+
+    // フレームの始まり。次の書き込みはバッファの先頭から
+    void beginFrame() { allocator_.beginFrame(); }
+
+    // count 個分の書き込み先を返す。startInstance にバッファ内の位置が入る
+    // 失敗したら nullptr。書き込んだら unmap() を呼ぶこと
+    DirectX::SimpleMath::Matrix* map(UINT count, UINT& startInstance);
+    void unmap();
+
+    ID3D11Buffer* getBuffer() const { return buffer_.Get(); }
+    UINT getCapacity() const { return allocator_.getCapacity() / Stride; }
+
+private:
+    ComPtr<ID3D11Buffer> buffer_;
+    RingAllocator        allocator_;
+    RenderDevice*        device_ = nullptr;
+    UINT                 mappedBytes_ = 0;
+
+    // count 個入るバッファを作り直す
+    bool reserve(UINT count);
+};
+
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// JobSystem
+//
+// 起動時に作ったワーカースレッドを使い回して、
+// 独立した仕事をまとめて並列に実行する。
+// parallelFor を呼んだスレッドも仕事を手伝い、全部終わるまで戻らない。
+// --------------------
+class JobSystem : public Singleton<JobSystem>
+{
+public:
+    // ワーカーの数をCPUのコア数に合わせる
+    static constexpr size_t AutoWorkerCount = SIZE_MAX;
+
+    // workerCount が AutoWorkerCount ならCPUのコア数 - 1 個のワーカーを作る
+    // 0 ならワーカーを作らず、parallelFor は呼び出し元スレッドだけで実行する
+    // workerInit は各ワーカースレッドの始めに、そのスレッドで1回呼ぶ（スレッドごとのインスタンスの設定などに使う）
+    // ワーカーのスレッドでは、getInstance() はこの JobSystem を返す
+    JobSystem(size_t workerCount = AutoWorkerCount, std::function<void()> workerInit = nullptr);
+    virtual ~JobSystem();
+
+    // workerCount を渡したときに作るワーカーの数。AutoWorkerCount をコア数に直す
+    static size_t ResolveWorkerCount(size_t workerCount);
+
+    // ワーカースレッドの数（呼び出し元スレッドは含まない）
+    size_t getWorkerCount() const { return workers_.size(); }
+
+    // 同時に仕事を実行するスレッドの数（呼び出し元スレッドを含む）
+    size_t getThreadCount() const { return workers_.size() + 1; }
+
+    // 現在のスレッドの番号。呼び出し元（メイン）スレッドは 0、ワーカーは 1 から
+    static size_t getCurrentThreadIndex() { return threadIndex_; }
+
+    // job(0) ～ job(count - 1) を並列に実行し、全部終わるまで待つ
+    void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+private:
+    std::vector<std::thread> workers_;
+    std::function<void()>    workerInit_;
+    std::mutex               mutex_;
+    std::condition_variable  wakeCondition_;
+    std::condition_variable  doneCondition_;
+
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t               jobCount_ = 0;
+    std::atomic<size_t>  nextIndex_ = 0;
+    size_t               pendingWorkers_ = 0;
+    uint64_t             generation_ = 0;
+    bool                 quit_ = false;
+
+    static thread_local size_t threadIndex_;
+
+    void workerMain(size_t index);
+    void runJobs();
+};
+
+}
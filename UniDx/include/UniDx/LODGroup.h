@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "Component.h"
+#include "Bounds.h"
+
+
+namespace UniDx
+{
+
+class Camera;
+class Renderer;
+
+// LOD の切り替え方
+enum class LODFadeMode
+{
+    None,       // すぐに切り替える
+    CrossFade,  // 2つの LOD を同時に描き、ディザで画素を分け合いながら切り替える
+};
+
+
+// --------------------
+// LOD
+// --------------------
+struct LOD
+{
+    // 画面の高さに対する大きさがこれ以上ならこの LOD を使う（0～1、大きい LOD から順に小さくする）
+    float screenRelativeTransitionHeight = 0.0f;
+
+    // 時間でフェードしないとき、この LOD の範囲の下側のこの割合でクロスフェードする（0～1）
+    float fadeTransitionWidth = 0.0f;
+
+    std::vector<Renderer*> renderers;
+};
+
+
+// --------------------
+// LODGroup
+//
+// 画面上の大きさに合わせて、登録した LOD の Renderer のどれを描くかを切り替える。
+// 大きさは LOD0 の Renderer の境界の一番長い辺が、画面の高さの何割を占めるかで測る。
+// 一番小さい LOD の値を下回ると何も描かない。
+// RendererManager が描画のたびにカメラを渡して選び直し、選ばれていない Renderer をカリングで除く。
+// 登録した Renderer は LODGroup より長く生きている必要がある。
+// --------------------
+class LODGroup : public Component
+{
+public:
+    LODFadeMode fadeMode = LODFadeMode::None;
+
+    // CrossFade のとき、大きさではなく時間でフェードする
+    bool animateCrossFading = false;
+
+    // 時間でフェードするときの長さ（秒）
+    static inline float crossFadeAnimationDuration = 0.5f;
+
+    virtual ~LODGroup();
+
+    // LOD を設定する。screenRelativeTransitionHeight の大きい順に並べる
+    void SetLODs(std::vector<LOD> lods);
+    const std::vector<LOD>& GetLODs() const { return lods_; }
+    int lodCount() const { return int(lods_.size()); }
+
+    // 今描いている LOD。何も描いていなければ -1
+    int getCurrentLOD() const { return currentLOD_; }
+
+    // camera から見たときの、画面の高さに対する大きさ
+    float GetScreenRelativeHeight(const Camera& camera) const;
+
+    // 画面上の大きさ height で使う LOD。どれにも入らなければ -1
+    int SelectLOD(float height) const;
+
+    // camera に合わせて描く LOD を選ぶ。RendererManager が描画の前に呼ぶ
+    void update(const Camera& camera, float deltaTime);
+
+protected:
+    virtual void OnEnable() override;
+    virtual void OnDisable() override;
+
+private:
+    std::vector<LOD> lods_;
+    int   currentLOD_ = 0;
+    int   fadingFrom_ = -1;     // 時間でフェードしているときの前の LOD
+    bool  fading_ = false;
+    float fadeTime_ = 0.0f;
+
+    // lod の Renderer を描くかどうかとフェードの値を設定
+    void setLODState(int lod, bool visible, float fade);
+};
+
+}
@@ -6,6 +6,7 @@
 
 #include "UniDxDefine.h"
 #include "Singleton.h"
+#include "RenderDevice.h"
 
 namespace UniDx
 {
@@ -39,6 +40,9 @@ public:
     // ライト情報を定数バッファに反映
     virtual void updateLightCBuffer();
 
+    // ライトのバッファを device に設定
+    void bind(RenderDevice& device) const;
+
 private:
     std::vector<Light*> lights_;
     size_t              capacity_ = 0;
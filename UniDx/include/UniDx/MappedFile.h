@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "UniDxDefine.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// MappedFile
+//
+// ファイルを読み取り専用でメモリにマップする。
+// 中身は触ったページだけ OS が読み込み、メモリが足りなくなればそのまま捨てられる。
+// マップしたメモリを指すものがある間は、このオブジェクトを残しておくこと。
+// --------------------
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 開いてマップする。失敗したら false
+    bool open(const std::wstring& filePath);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    HANDLE         file_ = nullptr;
+    HANDLE         mapping_ = nullptr;
+    const uint8_t* data_ = nullptr;
+    size_t         size_ = 0;
+};
+
+}
@@ -9,6 +9,7 @@
 #include "Shader.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "RenderQueue.h"
 
 namespace UniDx {
 
@@ -27,11 +28,19 @@ public:
     D3D11_DEPTH_WRITE_MASK depthWrite;
     D3D11_COMPARISON_FUNC ztest;
 
+    // 描画順。RenderQueue::Transparent 以上は奥から手前の順に描画する
+    int renderQueue = RenderQueue::Geometry;
+
+    // 同じメッシュとこのマテリアルを使う Renderer をインスタンス描画でまとめる
+    // シェーダーがインスタンス描画に対応していないときは無視される
+    bool enableInstancing = true;
+
     // コンストラクタ
     Material();
 
     // マテリアル情報設定。Render()内で呼び出す
-    void setForRender() const;
+    // instanced が true ならシェーダーのインスタンス描画版をセットする
+    void setForRender(bool instanced = false) const;
 
     // テクスチャ追加
     void AddTexture(std::shared_ptr<Texture> tex);
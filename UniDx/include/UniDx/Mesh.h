@@ -1,7 +1,11 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <array>
+#include <concepts>
 #include <memory>
 #include <span>
+#include <type_traits>
 #include <vector>
 
 #include <d3d11.h>
@@ -10,117 +14,190 @@
 #include "Object.h"
 #include "Property.h"
 #include "Shader.h"
+#include "Bounds.h"
+#include "RenderDevice.h"
+#include "MeshData.h"
 
 
 namespace UniDx {
 
 class Camera;
 class Texture;
+class MappedFile;
+
+// 位置が Vector3 の position で、ほかの属性も決まった名前のメンバー
+// （normal / color / uv0）で持つ頂点は、setX を通さずに直接並べて書ける
+template<typename TVertex>
+concept InterleavableVertex = std::is_trivially_copyable_v<TVertex> &&
+    requires(TVertex v) { { v.position } -> std::same_as<Vector3&>; };
+
 
 // --------------------
 // SubMesh構造体
+//
+// SubMeshData に GPU の頂点バッファとインデックスバッファを足したもの
 // --------------------
-struct SubMesh
+struct SubMesh : public SubMeshData
 {
-    D3D11_PRIMITIVE_TOPOLOGY topology;
-
-    std::span<const Vector3> positions;
-    std::span<const Vector3> normals;
-    std::span<const Color> colors;
-    std::span<const Vector2> uv;
-    std::span<const Vector2> uv2;
-    std::span<const Vector2> uv3;
-    std::span<const Vector2> uv4;
-    std::span<const uint32_t> indices;
-
     ComPtr<ID3D11Buffer> vertexBuffer;
     ComPtr<ID3D11Buffer> indexBuffer;
 
     UINT stride;
 
     template<typename TVertex>
-    size_t copyTo(std::span<TVertex> vertex)
+    size_t copyTo(std::span<TVertex> vertex) const
     {
         assert(vertex.size() >= positions.size());
 
-        // 位置のコピー
-        for (int i = 0; i < positions.size(); ++i)
+        if constexpr (requires { TVertex::pack(*this, vertex); })
         {
-            vertex[i].setPosition(positions[i]);
+            // 詰めた頂点の形式は、属性ごとにまとめて詰める
+            if (!positions.empty()) TVertex::pack(*this, vertex);
+        }
+        else if constexpr (InterleavableVertex<TVertex>)
+        {
+            // メンバーが分かる形式は、1回で並べて書く
+            interleaveTo(vertex.data());
+        }
+        else
+        {
+            // 位置のコピー
+            for (int i = 0; i < positions.size(); ++i)
+            {
+                vertex[i].setPosition(positions[i]);
+            }
+            // 法線のコピー
+            copyNormalTo(vertex);
+
+            // カラーのコピー
+            copyColorTo(vertex);
+
+            // uvのコピー
+            copyUVTo(vertex);
+            copyUV2To(vertex);
+            copyUV3To(vertex);
+            copyUV4To(vertex);
         }
-        // 法線のコピー
-        copyNormalTo(vertex);
-
-        // カラーのコピー
-        copyColorTo(vertex);
-
-        // uvのコピー
-        copyUVTo(vertex);
-        copyUV2To(vertex);
-        copyUV3To(vertex);
-        copyUV4To(vertex);
 
         return positions.size();
     }
 
     // ID3D11Bufferの頂点バッファとインデックスバッファを作成
-    // 戻ったバッファは破棄しても良い（DirectX12では仕様が変わる）
+    // 頂点はステージングバッファに直接書き込み、GPU 上で頂点バッファにコピーする
     template<typename TVertex>
-    std::unique_ptr< std::vector<TVertex> > createBuffer()
+    bool createBuffer()
     {
-        // メモリ上に頂点を確保
-        std::unique_ptr < std::vector<TVertex> > buf = std::make_unique< std::vector<TVertex> >();
-        buf->resize(positions.size());
-
-        // 確保したメモリに各属性データをコピー
-        copyTo(std::span<TVertex>(*buf));
-
-        // ID3D11Buffer を作成
-        stride = sizeof(TVertex);
-        createVertexBuffer(&buf->front());
-
-        // インデックスが設定されていればバッファを作成
-        if (indices.size() > 0)
-        {
-            createIndexBuffer();
-        }
-        // メモリ上のデータを返す。DirextX11では即座に開放して良い
-        return buf;
+        return createBuffer<TVertex>([](std::span<TVertex>) {});
     }
+    // func は書き込んだ頂点を受け取り、書き換えてもよい
     template<typename TVertex, typename F>
-    std::unique_ptr< std::vector<TVertex> > createBuffer(F func)
+    bool createBuffer(F func)
     {
-        // メモリ上に頂点を確保
-        std::unique_ptr < std::vector<TVertex> > buf = std::make_unique< std::vector<TVertex> >();
-        buf->resize(positions.size());
-
-        // 確保したメモリに各属性データをコピー
-        copyTo(std::span<TVertex>(*buf));
-        func(std::span<TVertex>(*buf));
-
-        // ID3D11Buffer を作成
+        RecalculateBounds();
         stride = sizeof(TVertex);
-        createVertexBuffer(&buf->front());
+        const UINT byteSize = static_cast<UINT>(stride * positions.size());
+        if (byteSize == 0)
+        {
+            return false;
+        }
+
+        // 書き込み先を開いて各属性データを並べる
+        ComPtr<ID3D11Buffer> staging;
+        bool result;
+        if (void* mapped = beginVertexUpload(byteSize, staging))
+        {
+            std::span<TVertex> vertex(static_cast<TVertex*>(mapped), positions.size());
+            copyTo(vertex);
+            func(vertex);
+            result = endVertexUpload(byteSize, staging);
+        }
+        else
+        {
+            // ステージングバッファが使えないときはメモリ上に並べて渡す
+            std::unique_ptr<TVertex[]> buf(new TVertex[positions.size()]);
+            std::span<TVertex> vertex(buf.get(), positions.size());
+            copyTo(vertex);
+            func(vertex);
+            result = createVertexBuffer(buf.get());
+        }
 
         // インデックスが設定されていればバッファを作成
         if (indices.size() > 0)
         {
             createIndexBuffer();
         }
-        // メモリ上のデータを返す。DirextX11では即座に開放して良い
-        return buf;
+        return result;
     }
 
     // GPUにバッファを作成
-    void createVertexBuffer(void* data);
+    bool createVertexBuffer(const void* data);
     void createIndexBuffer();
 
+    // byteSize バイトのステージングバッファを作って書き込み用に開く。使えなければ nullptr
+    void* beginVertexUpload(UINT byteSize, ComPtr<ID3D11Buffer>& staging);
+
+    // ステージングバッファを閉じ、頂点バッファを作ってコピーする
+    bool endVertexUpload(UINT byteSize, ComPtr<ID3D11Buffer>& staging);
+
+    // 頂点を TVertex の形式で dst に1回で並べて書く。TVertex にないメンバーの属性は読まない
+    // 頂点はまとめて組み立ててから、キャッシュを通さずに書き込む
+    template<InterleavableVertex TVertex>
+    void interleaveTo(TVertex* dst) const
+    {
+        constexpr bool hasNormal = requires(TVertex v) { { v.normal } -> std::same_as<Vector3&>; };
+        constexpr bool hasColor = requires(TVertex v) { { v.color } -> std::same_as<Color&>; };
+        constexpr bool hasUV = requires(TVertex v) { { v.uv0 } -> std::same_as<Vector2&>; };
+        assert(normals.empty() || normals.size() == positions.size());
+        assert(colors.empty() || colors.size() == positions.size());
+        assert(uv.empty() || uv.size() == positions.size());
+
+        // 元のデータがあるかどうかで分けて、ループの中では分岐しない
+        auto write = [&]<bool UseNormal, bool UseColor, bool UseUV>()
+            {
+                constexpr size_t Batch = 64;
+                TVertex batch[Batch];
+                const size_t count = positions.size();
+                for (size_t base = 0; base < count; base += Batch)
+                {
+                    const size_t n = std::min(Batch, count - base);
+                    for (size_t k = 0; k < n; ++k)
+                    {
+                        const size_t i = base + k;
+                        TVertex& v = batch[k];
+                        v.position = positions[i];
+                        if constexpr (hasNormal) v.normal = UseNormal ? normals[i] : Vector3::Zero;
+                        if constexpr (hasColor) v.color = UseColor ? colors[i] : Color(0, 0, 0, 0);
+                        if constexpr (hasUV) v.uv0 = UseUV ? uv[i] : Vector2::Zero;
+                    }
+                    StreamStore(dst + base, batch, n * sizeof(TVertex));
+                }
+            };
+        const bool useNormal = hasNormal && !normals.empty();
+        const bool useColor = hasColor && !colors.empty();
+        const bool useUV = hasUV && !uv.empty();
+        const int variant = (useNormal ? 1 : 0) | (useColor ? 2 : 0) | (useUV ? 4 : 0);
+        switch (variant)
+        {
+        case 0: write.template operator()<false, false, false>(); break;
+        case 1: write.template operator()<true, false, false>(); break;
+        case 2: write.template operator()<false, true, false>(); break;
+        case 3: write.template operator()<true, true, false>(); break;
+        case 4: write.template operator()<false, false, true>(); break;
+        case 5: write.template operator()<true, false, true>(); break;
+        case 6: write.template operator()<false, true, true>(); break;
+        default: write.template operator()<true, true, true>(); break;
+        }
+    }
+
     // 描画
     void Render() const;
 
+    // インスタンス描画。instanceBuffer の startInstance 番目から instanceCount 個を描く
+    void RenderInstanced(ID3D11Buffer* instanceBuffer, UINT instanceStride, UINT instanceCount, UINT startInstance) const;
+
     // 法線のコピー
     template<typename TVertex>
-    void copyNormalTo(std::span<TVertex> vertex)
+    void copyNormalTo(std::span<TVertex> vertex) const
     {
         if(normals.size() == 0) return;
         assert(normals.size() == positions.size());
@@ -129,7 +206,7 @@ struct SubMesh
 
     // カラーのコピー
     template<typename TVertex>
-    void copyColorTo(std::span<TVertex> vertex)
+    void copyColorTo(std::span<TVertex> vertex) const
     {
         if(colors.size() == 0) return;
         assert(colors.size() == positions.size());
@@ -138,28 +215,28 @@ struct SubMesh
 
     // UVのコピー
     template<typename TVertex>
-    void copyUVTo(std::span<TVertex> vertex)
+    void copyUVTo(std::span<TVertex> vertex) const
     {
         if(uv.size() == 0) return;
         assert(uv.size() == positions.size());
         for (int i = 0; i < positions.size(); ++i) vertex[i].setUV(uv[i]);
     }
     template<typename TVertex>
-    void copyUV2To(std::span<TVertex> vertex)
+    void copyUV2To(std::span<TVertex> vertex) const
     {
         if(uv2.size() == 0) return;
         assert(uv2.size() == positions.size());
         for (int i = 0; i < positions.size(); ++i) vertex[i].setUV2(uv2[i]);
     }
     template<typename TVertex>
-    void copyUV3To(std::span<TVertex> vertex)
+    void copyUV3To(std::span<TVertex> vertex) const
     {
         if(uv3.size() == 0) return;
         assert(uv3.size() == positions.size());
         for (int i = 0; i < positions.size(); ++i) vertex[i].setUV3(uv3[i]);
     }
     template<typename TVertex>
-    void copyUV4To(std::span<TVertex> vertex)
+    void copyUV4To(std::span<TVertex> vertex) const
     {
         if(uv4.size() == 0) return;
         assert(uv4.size() == positions.size());
@@ -170,61 +247,21 @@ struct SubMesh
 
 // --------------------
 // OwnedSubMesh
+//
+// 配列を自分で持ち、GPU のバッファも作れるサブメッシュ
 // --------------------
-struct OwnedSubMesh : public SubMesh
-{
-    const std::vector<Vector3>& mutablePositions() { return positions_data; }
-    const std::vector<Vector3>& mutableNormals() { return normals_data; }
-    const std::vector<Color>&   mutableColors() { return colors_data; }
-    const std::vector<Vector2>& mutableUV() { return uv_data; }
-    const std::vector<Vector2>& mutableUV2() { return uv2_data; }
-    const std::vector<Vector2>& mutableUV3() { return uv3_data; }
-    const std::vector<Vector2>& mutableUV4() { return uv4_data; }
-    const std::vector<uint32_t>& mutableIndices() { return indices_data; }
-
-    // 必要なサイズだけ確保し、spanを設定
-    void resizePositions(size_t n) {
-        positions_data.resize(n);
-        positions = std::span<const Vector3>(positions_data.data(), n);
-    }
-    void resizeNormals(size_t n) {
-        normals_data.resize(n);
-        normals = std::span<const Vector3>(normals_data.data(), n);
-    }
-    void resizeColors(size_t n) {
-        colors_data.resize(n);
-        colors = std::span<const Color>(colors_data.data(), n);
-    }
-    void resizeUV(size_t n) {
-        uv_data.resize(n);
-        uv = std::span<const Vector2>(uv_data.data(), n);
-    }
-    void resizeUV2(size_t n) {
-        uv2_data.resize(n);
-        uv2 = std::span<const Vector2>(uv2_data.data(), n);
-    }
-    void resizeUV3(size_t n) {
-        uv3_data.resize(n);
-        uv3 = std::span<const Vector2>(uv3_data.data(), n);
-    }
-    void resizeUV4(size_t n) {
-        uv4_data.resize(n);
-        uv4 = std::span<const Vector2>(uv4_data.data(), n);
-    }
-    void resizeIndices(size_t n) {
-        indices_data.resize(n);
-        indices = std::span<const uint32_t>(indices_data.data(), n);
-    }
+using OwnedSubMesh = SubMeshStorage<SubMesh>;
 
-protected:
-    std::vector<Vector3> positions_data;
-    std::vector<Vector3> normals_data;
-    std::vector<Color> colors_data;
-    std::vector<Vector2> uv_data;
-    std::vector<Vector2> uv2_data;
-    std::vector<Vector2> uv3_data;
-    std::vector<Vector2> uv4_data;
-    std::vector<uint32_t> indices_data;
+
+// --------------------
+// MappedSubMesh
+//
+// 属性の一部がマップしたファイルを直接指すサブメッシュ。
+// 型の違う属性だけを OwnedSubMesh の配列にコピーして持つ。指している間はファイルを開いておく
+// --------------------
+struct MappedSubMesh : public OwnedSubMesh
+{
+    std::shared_ptr<const MappedFile> file;
 };
 
 
@@ -247,6 +284,9 @@ public:
         }
     }
 
+    // すべてのサブメッシュを含むローカル空間の境界。サブメッシュがなければ false
+    bool getBounds(Bounds& bounds) const;
+
 protected:
     wstring name_;
 };
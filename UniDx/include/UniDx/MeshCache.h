@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// MeshCache
+//
+// glTF などから読んだメッシュを、エンジンでそのまま使える形で書き出したファイル（.umesh）。
+// 頂点は TVertex の形式に並べてあり、読み込むときはファイルをマップして
+// 頂点バッファとインデックスバッファを作るときにそのまま渡す。ノードの階層と境界も持つ。
+// 元のファイルの大きさ・更新時刻・内容のハッシュを持っていて、元が変わっていたら使わない。
+//
+//   ヘッダー | サブメッシュの表 | ノードの表 | ノードの名前 | 頂点・位置・インデックス（サブメッシュごと）
+//
+// 頂点はサブメッシュごとにページの境界から始める。頂点の形式ごとに別のファイルにする。
+// --------------------
+class MeshCache
+{
+public:
+    static constexpr uint32_t Magic = 0x4D584455;   // "UDXM"
+    static constexpr uint32_t Version = 2;   // 2: スキンのあるモデルは書き出さない
+    static constexpr size_t PageSize = 4096;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t layoutKey;         // 頂点の形式
+        uint32_t stride;
+        uint32_t subMeshCount;
+        uint32_t nodeCount;
+        uint32_t nameSize;
+        int32_t  addressU;          // 0番のテクスチャのラップモード。なければ 0
+        int32_t  addressV;
+        uint64_t sourceSize;        // 元のファイル
+        int64_t  sourceTime;
+        uint64_t sourceHash;
+    };
+
+    struct SubMeshEntry
+    {
+        uint32_t topology;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t reserved;
+        float    boundsCenter[3];
+        float    boundsExtents[3];
+        uint64_t vertexOffset;      // ファイルの先頭からのバイト数
+        uint64_t positionOffset;
+        uint64_t indexOffset;
+    };
+
+    struct NodeEntry
+    {
+        int32_t  parent;            // 親は自分より前にある。なければ -1
+        int32_t  subMesh;           // なければ -1
+        uint32_t nameOffset;        // ノードの名前の中の UTF-8
+        uint32_t nameLength;
+        float    position[3];
+        float    rotation[4];
+        float    scale[3];
+    };
+
+    // 書き出すノード。親が子より前になる順に並べる
+    struct Node
+    {
+        std::string name;           // UTF-8
+        int32_t parent = -1;
+        int32_t subMesh = -1;
+        Vector3 position;
+        DirectX::SimpleMath::Quaternion rotation;
+        Vector3 scale = Vector3::One;
+    };
+
+    // 書き出したファイルを開いたもの。マップしたまま使う
+    class File
+    {
+    public:
+        // 開いて中身を確かめる。頂点の形式が違うか、元のファイルが変わっていれば false
+        // 元のファイルがなければ、書き出したときのものとして使う
+        bool open(const std::wstring& cachePath, const std::wstring& sourcePath, uint64_t layoutKey, UINT stride);
+
+        const Header& header() const { return *reinterpret_cast<const Header*>(mapped_->data()); }
+        std::span<const SubMeshEntry> subMeshes() const { return subMeshes_; }
+        std::span<const NodeEntry> nodes() const { return nodes_; }
+        std::string_view name(const NodeEntry& node) const { return names_.substr(node.nameOffset, node.nameLength); }
+
+        // ファイルの先頭から offset バイトの場所
+        const void* at(uint64_t offset) const { return mapped_->data() + offset; }
+
+        // サブメッシュが指している間、ファイルを開いておくためのもの
+        std::shared_ptr<const MappedFile> getMappedFile() const { return mapped_; }
+
+    private:
+        std::shared_ptr<MappedFile>   mapped_;
+        std::span<const SubMeshEntry> subMeshes_;
+        std::span<const NodeEntry>    nodes_;
+        std::string_view              names_;
+    };
+
+    // 頂点の形式を表すキー
+    static uint64_t LayoutKey(const D3D11_INPUT_ELEMENT_DESC* layout, size_t count, size_t stride);
+    template<typename TVertex>
+    static uint64_t LayoutKey() { return LayoutKey(TVertex::layout.data(), TVertex::layout.size(), sizeof(TVertex)); }
+
+    // sourcePath から書き出すファイルのパス。元のファイルの隣に、頂点の形式ごとに別の名前で置く
+    static std::wstring GetCachePath(const std::wstring& sourcePath, uint64_t layoutKey);
+
+    // サブメッシュを TVertex の形式で並べて書き出す
+    // addressU, addressV は 0番のテクスチャのラップモード
+    template<typename TVertex>
+    static bool Write(const std::wstring& cachePath, const std::wstring& sourcePath,
+        std::span<const std::shared_ptr<SubMesh>> submesh, std::span<const Node> nodes,
+        int32_t addressU = 0, int32_t addressV = 0)
+    {
+        std::vector< std::vector<uint8_t> > vertices(submesh.size());
+        for (size_t i = 0; i < submesh.size(); ++i)
+        {
+            const size_t count = submesh[i]->positions.size();
+            vertices[i].resize(count * sizeof(TVertex));
+            submesh[i]->copyTo(std::span<TVertex>(reinterpret_cast<TVertex*>(vertices[i].data()), count));
+        }
+        return write_(cachePath, sourcePath, LayoutKey<TVertex>(), sizeof(TVertex), submesh, vertices, nodes, addressU, addressV);
+    }
+
+private:
+    static bool write_(const std::wstring& cachePath, const std::wstring& sourcePath, uint64_t layoutKey, UINT stride,
+        std::span<const std::shared_ptr<SubMesh>> submesh, const std::vector< std::vector<uint8_t> >& vertices,
+        std::span<const Node> nodes, int32_t addressU, int32_t addressV);
+};
+
+}
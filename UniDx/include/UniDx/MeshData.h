@@ -0,0 +1,198 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "UniDxMath.h"
+#include "Bounds.h"
+#include "RenderDevice.h"
+
+
+namespace UniDx {
+
+// --------------------
+// SubMeshData構造体
+//
+// サブメッシュの CPU 側のデータ（頂点の属性とインデックス）。GPU のバッファは持たない
+// --------------------
+struct SubMeshData
+{
+    PrimitiveTopology topology;
+
+    std::span<const Vector3> positions;
+    std::span<const Vector3> normals;
+    std::span<const Color> colors;
+    std::span<const Vector2> uv;
+    std::span<const Vector2> uv2;
+    std::span<const Vector2> uv3;
+    std::span<const Vector2> uv4;
+    std::span<const std::array<uint16_t, 4>> joints;    // スキンのジョイントの番号（Skin::joints の何番目か）
+    std::span<const Vector4> weights;                   // joints のそれぞれの重み
+    std::span<const uint32_t> indices;
+
+    // ローカル空間の境界。RecalculateBounds で positions から計算する
+    Bounds bounds;
+    bool hasBounds = false;
+
+    // positions から境界を計算
+    void RecalculateBounds();
+
+    // スキンのジョイントと重みを全ての頂点に持っているか
+    bool isSkinned() const
+    {
+        return !positions.empty() && joints.size() == positions.size() && weights.size() == positions.size();
+    }
+
+    // 境界を取得。未計算なら計算する
+    const Bounds& getBounds()
+    {
+        if (!hasBounds) RecalculateBounds();
+        return bounds;
+    }
+};
+
+
+// --------------------
+// SubMeshStorage
+//
+// TBase（SubMeshData か SubMesh）の span が指す配列を自分で持つ
+// --------------------
+template<typename TBase>
+struct SubMeshStorage : public TBase
+{
+    const std::vector<Vector3>& mutablePositions() { return positions_data; }
+    const std::vector<Vector3>& mutableNormals() { return normals_data; }
+    const std::vector<Color>&   mutableColors() { return colors_data; }
+    const std::vector<Vector2>& mutableUV() { return uv_data; }
+    const std::vector<Vector2>& mutableUV2() { return uv2_data; }
+    const std::vector<Vector2>& mutableUV3() { return uv3_data; }
+    const std::vector<Vector2>& mutableUV4() { return uv4_data; }
+    const std::vector<std::array<uint16_t, 4>>& mutableJoints() { return joints_data; }
+    const std::vector<Vector4>& mutableWeights() { return weights_data; }
+    const std::vector<uint32_t>& mutableIndices() { return indices_data; }
+
+    // 必要なサイズだけ確保し、spanを設定
+    void resizePositions(size_t n) {
+        positions_data.resize(n);
+        this->positions = std::span<const Vector3>(positions_data.data(), n);
+    }
+    void resizeNormals(size_t n) {
+        normals_data.resize(n);
+        this->normals = std::span<const Vector3>(normals_data.data(), n);
+    }
+    void resizeColors(size_t n) {
+        colors_data.resize(n);
+        this->colors = std::span<const Color>(colors_data.data(), n);
+    }
+    void resizeUV(size_t n) {
+        uv_data.resize(n);
+        this->uv = std::span<const Vector2>(uv_data.data(), n);
+    }
+    void resizeUV2(size_t n) {
+        uv2_data.resize(n);
+        this->uv2 = std::span<const Vector2>(uv2_data.data(), n);
+    }
+    void resizeUV3(size_t n) {
+        uv3_data.resize(n);
+        this->uv3 = std::span<const Vector2>(uv3_data.data(), n);
+    }
+    void resizeUV4(size_t n) {
+        uv4_data.resize(n);
+        this->uv4 = std::span<const Vector2>(uv4_data.data(), n);
+    }
+    void resizeJoints(size_t n) {
+        joints_data.resize(n);
+        this->joints = std::span<const std::array<uint16_t, 4>>(joints_data.data(), n);
+    }
+    void resizeWeights(size_t n) {
+        weights_data.resize(n);
+        this->weights = std::span<const Vector4>(weights_data.data(), n);
+    }
+    void resizeIndices(size_t n) {
+        indices_data.resize(n);
+        this->indices = std::span<const uint32_t>(indices_data.data(), n);
+    }
+
+    // 頂点を remap[元の番号] = 新しい番号 の順に並べ替え、インデックスも付け替える
+    // 新しい頂点の数は vertexCount。使わない頂点の remap は ~0u
+    void remapVertices(std::span<const uint32_t> remap, size_t vertexCount)
+    {
+        // 頂点の数だけある属性を並べ替える。同じ番号に移る頂点は同じ値を持っている前提
+        auto apply = [&](auto& data, auto& view)
+            {
+                if (data.size() != remap.size()) return;
+                std::remove_reference_t<decltype(data)> out(vertexCount);
+                for (size_t i = 0; i < remap.size(); ++i)
+                {
+                    if (remap[i] != ~0u) out[remap[i]] = data[i];
+                }
+                data.swap(out);
+                view = { data.data(), data.size() };
+            };
+        apply(positions_data, this->positions);
+        apply(normals_data, this->normals);
+        apply(colors_data, this->colors);
+        apply(uv_data, this->uv);
+        apply(uv2_data, this->uv2);
+        apply(uv3_data, this->uv3);
+        apply(uv4_data, this->uv4);
+        apply(joints_data, this->joints);
+        apply(weights_data, this->weights);
+
+        for (uint32_t& i : indices_data)
+        {
+            i = remap[i];
+        }
+        this->hasBounds = false;
+    }
+
+    // other が持っている配列を引き取り、自分の span で指す。GPU 側の値はそのまま
+    // other はマップしたファイルなどを指さず、すべての属性を自分の配列に持っていること
+    template<typename TOther>
+    void assignData(SubMeshStorage<TOther>&& other)
+    {
+        auto take = [](auto& data, auto& view, auto& src, auto& srcView)
+            {
+                data = std::move(src);
+                view = { data.data(), data.size() };
+                srcView = {};
+            };
+        take(positions_data, this->positions, other.positions_data, other.positions);
+        take(normals_data, this->normals, other.normals_data, other.normals);
+        take(colors_data, this->colors, other.colors_data, other.colors);
+        take(uv_data, this->uv, other.uv_data, other.uv);
+        take(uv2_data, this->uv2, other.uv2_data, other.uv2);
+        take(uv3_data, this->uv3, other.uv3_data, other.uv3);
+        take(uv4_data, this->uv4, other.uv4_data, other.uv4);
+        take(joints_data, this->joints, other.joints_data, other.joints);
+        take(weights_data, this->weights, other.weights_data, other.weights);
+        take(indices_data, this->indices, other.indices_data, other.indices);
+        this->topology = other.topology;
+        this->bounds = other.bounds;
+        this->hasBounds = other.hasBounds;
+        other.hasBounds = false;
+    }
+
+protected:
+    template<typename> friend struct SubMeshStorage;
+
+    std::vector<Vector3> positions_data;
+    std::vector<Vector3> normals_data;
+    std::vector<Color> colors_data;
+    std::vector<Vector2> uv_data;
+    std::vector<Vector2> uv2_data;
+    std::vector<Vector2> uv3_data;
+    std::vector<Vector2> uv4_data;
+    std::vector<std::array<uint16_t, 4>> joints_data;
+    std::vector<Vector4> weights_data;
+    std::vector<uint32_t> indices_data;
+};
+
+
+// GPU のバッファを持たない、配列を自分で持つサブメッシュ。MeshSimplifier などの CPU の処理が作る
+using OwnedSubMeshData = SubMeshStorage<SubMeshData>;
+
+} // namespace UniDx
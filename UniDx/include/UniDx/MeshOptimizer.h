@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// MeshOptimizer
+//
+// 読み込んだメッシュを GPU が速く描けるように並べ替える。
+//   - 全属性が同じ頂点を1つにまとめる（溶接）
+//   - Tipsify で頂点キャッシュに残っている頂点を使う順に三角形を並べ替える
+//   - キャッシュを捨てる切れ目ごとのまとまりを、外を向いているものから描く順にする（オーバードロー）
+//   - 頂点をインデックスで最初に使う順に並べ替え、使わない頂点を除く（フェッチ）
+// 頂点キャッシュの効率は ACMR（三角形あたりに処理する頂点の数、0.5～3）で測る。
+// CPU だけで動くので、読み込み時やツールで使える。
+// --------------------
+class MeshOptimizer
+{
+public:
+    // 頂点キャッシュの大きさ（頂点の数）
+    static constexpr uint32_t DefaultCacheSize = 16;
+
+    struct Stats
+    {
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0;
+        float  acmrBefore = 0.0f;
+        float  acmrAfter = 0.0f;
+        float  atvrBefore = 0.0f;    // 使われている頂点あたりに処理する数。1 が最小
+        float  atvrAfter = 0.0f;
+    };
+
+    // 全属性が同じ頂点を1つにまとめ、まとめた後の頂点の数を返す
+    // インデックスがなければ頂点の順に作る
+    static size_t WeldVertices(OwnedSubMesh& mesh);
+
+    // Tipsify で三角形の順番を並べ替える
+    static void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize = DefaultCacheSize);
+
+    // キャッシュを捨てる切れ目で三角形をまとまりに分け、外を向いているまとまりから描く順に並べる
+    // OptimizeVertexCache の後に使う
+    static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vector3> positions, uint32_t cacheSize = DefaultCacheSize);
+
+    // インデックスで最初に使う順に頂点を並べ替え、使わない頂点を除く
+    static void OptimizeVertexFetch(OwnedSubMesh& mesh);
+
+    // FIFO の頂点キャッシュでの ACMR
+    static float ComputeACMR(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = DefaultCacheSize);
+
+    // FIFO の頂点キャッシュでの ATVR
+    static float ComputeATVR(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = DefaultCacheSize);
+
+    // 溶接・頂点キャッシュ・オーバードロー・フェッチの順にすべて行う。三角形リストでなければ false
+    static bool Optimize(OwnedSubMesh& mesh, Stats* stats = nullptr);
+};
+
+}
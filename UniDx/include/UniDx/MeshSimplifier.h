@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "MeshData.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// MeshSimplifier
+//
+// 二次誤差（Quadric Error Metrics）を使った辺の縮約で、三角形を減らしたサブメッシュを作る。
+// 頂点は辺のもう一方の既存の頂点へ寄せるので、法線・カラー・UV は補間せずにそのまま残る。
+// 同じ位置で UV などが違う頂点（シーム）は、シームに沿う向きにだけ両側をそろえて縮約する。
+// 3つ以上に分かれた頂点と、開いた縁（lockBorder のとき）の頂点は動かさない。
+// CPU だけで動き SubMeshData だけを読み書きするので、GPU やウィンドウがなくても読み込み時やツールで使える。
+// --------------------
+class MeshSimplifier
+{
+public:
+    struct Settings
+    {
+        float targetRatio = 0.5f;   // 残す三角形の割合
+        float maxError = 0.01f;     // 許す誤差。境界の一番長い辺に対する割合
+        bool  lockBorder = true;    // 開いた縁の頂点を動かさない
+    };
+
+    // 三角形リストの indices を簡略化して out に書く。戻り値は out のインデックスの数
+    // error には実際の誤差（境界の一番長い辺に対する割合）を返す
+    static size_t SimplifyIndices(
+        std::span<const Vector3> positions,
+        std::span<const uint32_t> indices,
+        std::vector<uint32_t>& out,
+        size_t targetIndexCount,
+        float maxError,
+        bool lockBorder,
+        float* error = nullptr);
+
+    // source を簡略化し、使われている頂点だけを詰めたサブメッシュを作る
+    // 三角形リストでなければ nullptr。描くときは OwnedSubMesh::assignData で移してバッファを作る
+    static std::shared_ptr<OwnedSubMeshData> Simplify(const SubMeshData& source, const Settings& settings, float* error = nullptr);
+
+    // source の三角形の数に対する ratios の割合ごとに、1つ前の段を簡略化して順に作る
+    // 作れなければ空
+    static std::vector<std::shared_ptr<OwnedSubMeshData>> BuildLODChain(
+        const SubMeshData& source, std::span<const float> ratios, float maxError = 0.05f);
+};
+
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "RenderDevice.h"
+
+namespace UniDx
+{
+
+// --------------------
+// NullRenderDevice
+//
+// GPU を使わない RenderDevice。呼び出しを数えるだけで何も描画しない。
+// 作成したリソースはすべて nullptr になる。mapBuffer と mapStagingBuffer は作業用のメモリを返すので、
+// 書き込む側のコードはそのまま動く（一度に開けるバッファは1つ）。
+// サーバーでのシミュレーションや、描画の呼び出し回数・転送量の計測に使う。
+// --------------------
+class NullRenderDevice : public RenderDevice
+{
+public:
+    struct Stats
+    {
+        uint64_t drawCalls = 0;         // 描画命令の回数
+        uint64_t instances = 0;         // 描いたインスタンスの数（インスタンス描画でなければ1回1つ）
+        uint64_t vertices = 0;          // 描いた頂点（インデックス）の数 × インスタンスの数
+        uint64_t stateChanges = 0;      // 状態を設定した回数
+        uint64_t bytesUploaded = 0;     // 作成時の初期データと転送で GPU に送るはずだったバイト数
+        uint64_t resourcesCreated = 0;  // 作成したリソースの数
+    };
+
+    const Stats& getStats() const { return stats_; }
+    void resetStats() { stats_ = Stats(); }
+
+    virtual bool isNull() const override { return true; }
+    virtual bool supportsConstantBufferOffsetting() const override { return true; }
+
+    virtual bool createBuffer(const BufferDesc& desc, const void* initialData, ID3D11Buffer** buffer) override;
+    virtual bool createTexture2D(const Texture2DDesc& desc, const SubresourceData* initialData, ID3D11Texture2D** texture) override;
+    virtual bool createShaderResourceView(ID3D11Resource* resource, const ShaderResourceViewDesc& desc, ID3D11ShaderResourceView** view) override;
+    virtual bool createDepthStencilState(const DepthStencilDesc& desc, ID3D11DepthStencilState** state) override;
+    virtual bool createSamplerState(const SamplerDesc& desc, ID3D11SamplerState** state) override;
+    virtual bool createVertexShader(const void* bytecode, size_t size, ID3D11VertexShader** shader) override;
+    virtual bool createPixelShader(const void* bytecode, size_t size, ID3D11PixelShader** shader) override;
+    virtual bool createInputLayout(const InputElementDesc* elements, uint32_t count, const void* bytecode, size_t size, ID3D11InputLayout** layout) override;
+
+    virtual void updateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) override;
+    virtual void* mapBuffer(ID3D11Buffer* buffer, uint32_t size, bool discard) override;
+    virtual void unmapBuffer(ID3D11Buffer* buffer, uint32_t bytesWritten) override;
+    virtual void* mapStagingBuffer(ID3D11Buffer* buffer, uint32_t size) override;
+    virtual void unmapStagingBuffer(ID3D11Buffer* buffer) override;
+    virtual void copyBuffer(ID3D11Buffer* dst, ID3D11Buffer* src, uint32_t size) override;
+    virtual void copySubresource(ID3D11Resource* dst, uint32_t dstSubresource, ID3D11Resource* src, uint32_t srcSubresource, uint32_t size) override;
+
+    virtual void setVertexShader(ID3D11VertexShader*) override { ++stats_.stateChanges; }
+    virtual void setPixelShader(ID3D11PixelShader*) override { ++stats_.stateChanges; }
+    virtual void setInputLayout(ID3D11InputLayout*) override { ++stats_.stateChanges; }
+    virtual void setPrimitiveTopology(PrimitiveTopology) override { ++stats_.stateChanges; }
+    virtual void setVertexBuffer(uint32_t, ID3D11Buffer*, uint32_t, uint32_t) override { ++stats_.stateChanges; }
+    virtual void setIndexBuffer(ID3D11Buffer*, GpuFormat, uint32_t) override { ++stats_.stateChanges; }
+    virtual void setVSConstantBuffers(uint32_t, uint32_t, ID3D11Buffer* const*) override { ++stats_.stateChanges; }
+    virtual void setVSConstantBufferRange(uint32_t, ID3D11Buffer*, uint32_t, uint32_t) override { ++stats_.stateChanges; }
+    virtual void setPSShaderResource(uint32_t, ID3D11ShaderResourceView*) override { ++stats_.stateChanges; }
+    virtual void setPSSampler(uint32_t, ID3D11SamplerState*) override { ++stats_.stateChanges; }
+    virtual void setDepthStencilState(ID3D11DepthStencilState*, uint32_t) override { ++stats_.stateChanges; }
+
+    virtual void draw(uint32_t vertexCount) override;
+    virtual void drawIndexed(uint32_t indexCount) override;
+    virtual void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startInstance) override;
+    virtual void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance) override;
+
+private:
+    Stats                stats_;
+    std::vector<uint8_t> scratch_;  // mapBuffer で返す書き込み先
+};
+
+}
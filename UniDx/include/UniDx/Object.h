@@ -6,6 +6,8 @@
 
 namespace UniDx {
 
+class Prefab;
+
 // --------------------
 // Object基底クラス
 // --------------------
@@ -17,6 +19,17 @@ public:
     ReadOnlyProperty<wstring_view> name;
 
     Object(ReadOnlyProperty<wstring_view>::Getter nameGet) : name(nameGet) {}
+
+    // プレハブから GameObject を作成。プールに空きがあれば使い回す
+    static GameObject* Instantiate(Prefab& prefab, const Vector3& position,
+        const DirectX::SimpleMath::Quaternion& rotation = DirectX::SimpleMath::Quaternion::Identity);
+
+    // GameObject をシーンに追加。反映は同期点で、parent が nullptr ならルートに追加
+    static GameObject* Instantiate(unique_ptr<GameObject> gameObject, Transform* parent = nullptr);
+
+    // GameObject の破棄。同期点（delay 秒後まで遅らせることもできる）で、子も含めて
+    // OnDisable と OnDestroy を呼んで破棄する。プレハブから作ったものはプールに返す
+    static void Destroy(GameObject* gameObject, float delay = 0.0f);
 };
 
 } // namespace UniDx
@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace UniDx
+{
+
+// --------------------
+// RecordingBackend
+//
+// 描画コマンドを記録する先。記録先（スロット）ごとに別のスレッドから記録し、
+// 記録が全部終わってから、メインスレッドでスロットの順に実行する。
+// --------------------
+class RecordingBackend
+{
+public:
+    virtual ~RecordingBackend() = default;
+
+    // 同時に記録できるスロットの数
+    virtual size_t getSlotCount() const = 0;
+
+    // slot への記録を始める／終える。記録するスレッドで呼ばれる
+    virtual void beginRecording(size_t slot) = 0;
+    virtual void endRecording(size_t slot) = 0;
+
+    // slot に記録したものを実行する。メインスレッドでスロットの順に呼ばれる
+    virtual void execute(size_t slot) = 0;
+};
+
+
+// --------------------
+// NullRecordingBackend
+//
+// 何も描画しない記録先。記録したコマンドの番号を覚えておき、
+// 実行された順に getExecuted() に並べる。分け方と実行順の確認や計測に使う。
+// --------------------
+class NullRecordingBackend : public RecordingBackend
+{
+public:
+    explicit NullRecordingBackend(size_t slotCount) : slots_(slotCount) {}
+
+    virtual size_t getSlotCount() const override { return slots_.size(); }
+    virtual void beginRecording(size_t slot) override { slots_[slot].clear(); }
+    virtual void endRecording(size_t slot) override {}
+    virtual void execute(size_t slot) override;
+
+    // slot にコマンドを記録する
+    void record(size_t slot, uint32_t command) { slots_[slot].push_back(command); }
+
+    // 実行されたコマンド
+    const std::vector<uint32_t>& getExecuted() const { return executed_; }
+    void clearExecuted() { executed_.clear(); executedLists_ = 0; }
+
+    // 実行したコマンドリストの数
+    size_t getExecutedListCount() const { return executedLists_; }
+
+private:
+    std::vector<std::vector<uint32_t>> slots_;
+    std::vector<uint32_t> executed_;
+    size_t executedLists_ = 0;
+};
+
+
+// --------------------
+// ParallelRecorder
+//
+// 並べ終わった描画項目を連続した区間に分け、区間ごとに JobSystem のスレッドで
+// 別々のスロットに記録し、元の順でスロットを実行する。
+// 区間の中の順番も区間どうしの順番も変わらないので、1スレッドで描いたときと同じ順で描画される。
+// --------------------
+class ParallelRecorder
+{
+public:
+    // recordRange(slot, begin, end) で [begin, end) の項目を slot に記録する
+    using RecordFunc = std::function<void(size_t slot, size_t begin, size_t end)>;
+
+    // 1区間に入れる項目の最小数。少ない区間はスレッドを起こす方が高くつく
+    void setMinItemsPerSlot(size_t count) { minItemsPerSlot_ = count > 0 ? count : 1; }
+    size_t getMinItemsPerSlot() const { return minItemsPerSlot_; }
+
+    // count 個の項目を記録して実行する。使った区間の数を返す。記録先がなければ 0
+    size_t record(RecordingBackend& backend, size_t count, const RecordFunc& recordRange);
+
+    // count 個を parts 個のなるべく同じ大きさの連続区間に分ける
+    // 区間 k は [bounds[k], bounds[k + 1])
+    static void Partition(size_t count, size_t parts, std::vector<size_t>& bounds);
+
+private:
+    size_t minItemsPerSlot_ = 256;
+    std::vector<size_t> bounds_;
+};
+
+}
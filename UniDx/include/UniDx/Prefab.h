@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "UniDxDefine.h"
+
+namespace UniDx
+{
+
+class GameObject;
+
+// --------------------
+// Prefab
+//
+// GameObject を作る関数をひな形として持ち、同じ種類のオブジェクトをプールして使い回す。
+// Object::Instantiate で取り出し、Object::Destroy で同期点にプールへ返す。
+// 取り出しと Release はメインスレッドから呼ぶこと。
+// 返したオブジェクトは非アクティブになって OnDisable が呼ばれ、
+// 再び取り出すと OnEnable が呼ばれる（Awake と Start は最初の1回だけ）。
+// OnDestroy はプールごと破棄されるときに呼ばれる。
+//
+// プールのオブジェクトはシーンのルートに置いた「Pool」オブジェクトの子として持つ。
+// シーンの破棄などで先に「Pool」が消えたときは、プールは空になり、次の取り出しで作り直す。
+// 新しく作ったオブジェクトは SceneCommandBuffer 経由で同期点にシーンへ追加されるので、
+// 最初の Update と描画は次のフレームから。
+// 空きが足りていれば、取り出しと返却でヒープ確保は起きない。
+// --------------------
+class Prefab
+{
+public:
+    using Factory = std::function<std::unique_ptr<GameObject>()>;
+
+    Prefab(const wstring& name, Factory factory);
+    ~Prefab();
+
+    Prefab(const Prefab&) = delete;
+    Prefab& operator=(const Prefab&) = delete;
+
+    // あらかじめ count 個になるまで作っておく
+    void Prewarm(size_t count);
+
+    // 空いているオブジェクトを取り出して有効にする。なければ作る
+    GameObject* Instantiate(const Vector3& position, const DirectX::SimpleMath::Quaternion& rotation);
+
+    // オブジェクトを非アクティブにしてプールに返す
+    void Release(GameObject* gameObject);
+
+    // 作成したオブジェクトの数
+    size_t CountAll() const { return countAll_; }
+
+    // 使用中のオブジェクトの数
+    size_t CountActive() const { return countAll_ - free_.size(); }
+
+    // 空いているオブジェクトの数
+    size_t CountInactive() const { return free_.size(); }
+
+private:
+    friend class GameObject;
+
+    wstring name_;
+    Factory factory_;
+
+    GameObject* root_ = nullptr;        // シーン上のプールのルート
+    std::vector<GameObject*> free_;     // 空いているオブジェクト
+    size_t countAll_ = 0;
+
+    // 非アクティブな状態で1つ作る
+    GameObject* create();
+
+    // GameObject のデストラクタから呼ぶ。プールのルートが消えた／作ったものが1つ消えた
+    void onRootDestroyed();
+    void onObjectDestroyed(GameObject* gameObject);
+};
+
+}
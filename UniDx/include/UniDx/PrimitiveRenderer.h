@@ -2,6 +2,7 @@
 
 #include "Renderer.h"
 #include "Texture.h"
+#include "AssetCache.h"
 
 namespace UniDx {
 
@@ -38,13 +39,25 @@ public:
     template<typename TVertex>
     void setCreateBudderType()
     {
-        createBufer_ = [](SubMesh* submesh) { submesh->createBuffer<TVertex>(); };
+        getSubMesh_ = []()
+        {
+            // 同じ頂点形式のキューブは AssetCache で1つのサブメッシュを共有し、インスタンス描画でまとめられるようにする
+            // AssetCache はエンジンごとにあるので、バッファを作るデバイスごとに共有する
+            return AssetCache::Share<SubMesh>(L"UniDx/Cube", Shader::LayoutKey(TVertex::layout.data(), TVertex::layout.size()), []()
+                {
+                    std::shared_ptr<SubMesh> submesh = createSubMesh();
+                    submesh->createBuffer<TVertex>();
+                    return submesh;
+                });
+        };
     }
 
 protected:
+    static std::shared_ptr<SubMesh> createSubMesh();
+
     virtual void OnEnable() override;
 
-    std::function<void(SubMesh*)> createBufer_;
+    std::function<std::shared_ptr<SubMesh>()> getSubMesh_;
 };
 
 
@@ -71,7 +84,7 @@ public:
         return ptr;
     }
     template<typename TVertex>
-    static std::unique_ptr<CubeRenderer> create(std::shared_ptr<Material> material)
+    static std::unique_ptr<SphereRenderer> create(std::shared_ptr<Material> material)
     {
         auto ptr = std::unique_ptr<SphereRenderer>(new SphereRenderer());
         ptr->AddMaterial(material);
@@ -81,7 +94,17 @@ public:
     template<typename TVertex>
     void setCreateBudderType()
     {
-        createBufer_ = [](SubMesh* submesh) { submesh->createBuffer<TVertex>(); };
+        getSubMesh_ = []()
+        {
+            // 同じ頂点形式の球は AssetCache で1つのサブメッシュを共有し、インスタンス描画でまとめられるようにする
+            // AssetCache はエンジンごとにあるので、バッファを作るデバイスごとに共有する
+            return AssetCache::Share<SubMesh>(L"UniDx/Sphere", Shader::LayoutKey(TVertex::layout.data(), TVertex::layout.size()), []()
+                {
+                    std::shared_ptr<SubMesh> submesh = createSubMesh();
+                    submesh->createBuffer<TVertex>();
+                    return submesh;
+                });
+        };
     }
 
 protected:
@@ -90,10 +113,11 @@ protected:
     static std::vector<Vector2> uvs;
     static std::vector<uint32_t> indices;
     static void createVertex();
+    static std::shared_ptr<SubMesh> createSubMesh();
 
     virtual void OnEnable() override;
 
-    std::function<void(SubMesh*)> createBufer_;
+    std::function<std::shared_ptr<SubMesh>()> getSubMesh_;
 };
 
 
@@ -12,12 +12,17 @@ class Random
 {
 public:
     // シングルトン的に使う場合のグローバルインスタンス
+    // setThreadGlobal で設定したスレッドではそちらを返す
     static Random& global()
     {
         static Random inst;
-        return inst;
+        return threadGlobal_ != nullptr ? *threadGlobal_ : inst;
     }
 
+    // 呼んだスレッドで global() が返すインスタンスを設定する。nullptr で共通のインスタンスに戻す
+    // random の所有権は呼び出し側が持つ
+    static void setThreadGlobal(Random* random) { threadGlobal_ = random; }
+
     explicit Random(uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count())
     {
         InitState(seed);
@@ -101,6 +106,8 @@ public:
 private:
     uint64_t state = 88172645463325252ull; // デフォルトシード
 
+    static inline thread_local Random* threadGlobal_ = nullptr;
+
     // 64bit XorShift
     uint64_t nextUInt64()
     {
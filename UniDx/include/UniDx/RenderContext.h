@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <memory>
+
+#include "UniDxDefine.h"
+#include "RenderDevice.h"
+#include "RenderStateCache.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBuffer.h"
+
+namespace UniDx
+{
+
+// --------------------
+// RenderContext
+//
+// 描画コマンドの記録先。イミディエイトコンテキストか、記録スレッドごとの遅延コンテキスト。
+// 描画の呼び出しは RenderDevice を通して送る。GPU なしで動かすときは NullRenderDevice になる。
+// 状態キャッシュ、描画ごとの定数のリング、インスタンスバッファは記録先ごとに持つ。
+// 描画処理は current() で今のスレッドの記録先を取り出して使う。
+// --------------------
+class RenderContext
+{
+public:
+    // 描画ごとの定数を切り出す定数バッファは、見込んだ描画の数から大きさを決める。
+    // スキンのジョイントの行列で足りなくなったら、次のフレームから MaxObjectConstantsCapacity まで広げる
+    static constexpr size_t DefaultExpectedDraws = 1024;
+    static constexpr UINT   MinObjectConstantsCapacity = 64 * 1024;
+    static constexpr UINT   MaxObjectConstantsCapacity = 4 * 1024 * 1024;
+
+    // expectedDraws 回の描画の定数が入る大きさ
+    static UINT GetObjectConstantsCapacity(size_t expectedDraws);
+
+    // device に記録するように初期化。context は device が送る先の D3D11 のコンテキスト（なければ nullptr）
+    // expectedDraws は 1 フレームにこの記録先で描画する見込みの数
+    void initialize(std::unique_ptr<RenderDevice> device, ID3D11DeviceContext* context = nullptr,
+                    size_t expectedDraws = DefaultExpectedDraws);
+
+    // D3D11 のコンテキスト。NullRenderDevice のときは nullptr
+    ID3D11DeviceContext* get() const { return context_.Get(); }
+    bool isDeferred() const;
+
+    RenderDevice&       getDevice() { return *device_; }
+
+    RenderStateCache&   getStateCache() { return stateCache_; }
+    ConstantBufferRing& getObjectConstants() { return objectConstants_; }
+    InstanceBuffer&     getInstanceBuffer() { return instanceBuffer_; }
+
+    // 記録の始まり。状態キャッシュを捨て、リングは次の書き込みで先頭から使う
+    void beginFrame();
+
+    // 今のスレッドの記録先。設定されていなければイミディエイトコンテキスト
+    static RenderContext& current();
+
+    // スコープの間、今のスレッドの記録先を context にする
+    class Scope
+    {
+    public:
+        explicit Scope(RenderContext& context);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        RenderContext* previous_;
+    };
+
+private:
+    ComPtr<ID3D11DeviceContext> context_;
+    std::unique_ptr<RenderDevice> device_;
+    RenderStateCache            stateCache_;
+    ConstantBufferRing          objectConstants_;
+    InstanceBuffer              instanceBuffer_;
+
+    static thread_local RenderContext* current_;
+};
+
+}
@@ -0,0 +1,218 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// リソースのハンドル。D3D11 のインターフェースは宣言だけして、中身はここでは触らない
+struct ID3D11Resource;
+struct ID3D11Buffer;
+struct ID3D11Texture2D;
+struct ID3D11ShaderResourceView;
+struct ID3D11DepthStencilState;
+struct ID3D11SamplerState;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+
+namespace UniDx
+{
+
+// 列挙の値は D3D11 / DXGI と同じにしてあり、D3D11RenderDevice はそのまま変換する
+
+// ピクセルと頂点属性の形式。名前のないものも DXGI_FORMAT の値のまま渡せる
+enum class GpuFormat : uint32_t
+{
+    Unknown = 0,
+    R32_UInt = 42,
+    R16_UInt = 57,
+};
+
+// プリミティブの種類
+enum class PrimitiveTopology : uint32_t
+{
+    Undefined = 0,
+    PointList = 1,
+    LineList = 2,
+    LineStrip = 3,
+    TriangleList = 4,
+    TriangleStrip = 5,
+};
+
+// リソースの使い方
+enum class GpuUsage : uint32_t
+{
+    Default = 0,    // GPU で読み書きする。CPU からは updateBuffer で書き換える
+    Immutable = 1,  // 作成時の初期データから変えない
+    Dynamic = 2,    // CPU から mapBuffer で毎フレーム書き込む
+    Staging = 3,    // CPU から書いて GPU 上でコピーするだけ
+};
+
+// どこにバインドするか。組み合わせてよい
+enum GpuBindFlags : uint32_t
+{
+    GpuBindVertexBuffer = 0x1,
+    GpuBindIndexBuffer = 0x2,
+    GpuBindConstantBuffer = 0x4,
+    GpuBindShaderResource = 0x8,
+};
+
+// 深度テストの比較
+enum class ComparisonFunc : uint32_t
+{
+    Never = 1,
+    Less = 2,
+    Equal = 3,
+    LessEqual = 4,
+    Greater = 5,
+    NotEqual = 6,
+    GreaterEqual = 7,
+    Always = 8,
+};
+
+// テクスチャ座標が 0～1 の外に出たときの扱い
+enum class TextureAddressMode : uint32_t
+{
+    Wrap = 1,
+    Mirror = 2,
+    Clamp = 3,
+    Border = 4,
+    MirrorOnce = 5,
+};
+
+struct BufferDesc
+{
+    uint32_t byteWidth = 0;
+    GpuUsage usage = GpuUsage::Default;
+    uint32_t bindFlags = 0;             // GpuBindFlags の組み合わせ
+    bool     cpuWrite = false;          // Dynamic と Staging で CPU から書き込む
+    uint32_t structureByteStride = 0;   // 0 以外なら、この大きさの要素を並べた構造化バッファ
+};
+
+struct Texture2DDesc
+{
+    uint32_t  width = 0;
+    uint32_t  height = 0;
+    uint32_t  mipLevels = 1;
+    uint32_t  arraySize = 1;
+    GpuFormat format = GpuFormat::Unknown;
+    GpuUsage  usage = GpuUsage::Default;
+    uint32_t  bindFlags = 0;
+};
+
+// テクスチャのサブリソース1つ分の初期データ
+struct SubresourceData
+{
+    const void* data = nullptr;
+    uint32_t    rowPitch = 0;   // 1行（ブロック圧縮ならブロック1行）のバイト数
+    uint32_t    byteSize = 0;   // サブリソース全体のバイト数
+};
+
+struct ShaderResourceViewDesc
+{
+    enum class Dimension { Buffer, Texture2D };
+
+    GpuFormat format = GpuFormat::Unknown;  // 構造化バッファは Unknown
+    Dimension dimension = Dimension::Texture2D;
+    uint32_t  first = 0;                    // Texture2D は最も細かいミップ、Buffer は最初の要素
+    uint32_t  count = uint32_t(-1);         // Texture2D はミップの数（-1 なら全部）、Buffer は要素の数
+};
+
+struct DepthStencilDesc
+{
+    bool           depthEnable = true;
+    bool           depthWrite = true;
+    ComparisonFunc depthFunc = ComparisonFunc::Less;
+};
+
+// フィルタはトライリニアで固定
+struct SamplerDesc
+{
+    TextureAddressMode addressU = TextureAddressMode::Clamp;
+    TextureAddressMode addressV = TextureAddressMode::Clamp;
+    TextureAddressMode addressW = TextureAddressMode::Clamp;
+};
+
+// 頂点属性1つ分
+struct InputElementDesc
+{
+    const char* semanticName = nullptr;
+    uint32_t    semanticIndex = 0;
+    GpuFormat   format = GpuFormat::Unknown;
+    uint32_t    inputSlot = 0;
+    uint32_t    alignedByteOffset = 0;
+    uint32_t    instanceStepRate = 0;   // 0 なら頂点ごと、1 以上ならその数のインスタンスごとに進む
+};
+
+
+// --------------------
+// RenderDevice
+//
+// 描画で使うリソースの作成、バッファへの転送、状態の設定、描画命令をまとめたインターフェース。
+// Shader・Material・Texture・SubMesh・Renderer・LightManager はデバイスコンテキストを直接触らず、これを通す。
+// D3D11RenderDevice が D3D11 に送り、NullRenderDevice は GPU なしで呼び出しを数えるだけにする。
+// 受け渡しは上のエンジン側の型で行い、このヘッダーは d3d11.h に依存しない。
+// リソースはハンドルとして受け渡すだけで、NullRenderDevice は中身を作らない（nullptr のまま）。
+// --------------------
+class RenderDevice
+{
+public:
+    virtual ~RenderDevice() = default;
+
+    // GPU に何も送らない実装なら true
+    virtual bool isNull() const = 0;
+
+    // 定数バッファのオフセット指定（setVSConstantBufferRange）が使えるか
+    virtual bool supportsConstantBufferOffsetting() const = 0;
+
+    // ---- リソースの作成。失敗したら false ----
+    virtual bool createBuffer(const BufferDesc& desc, const void* initialData, ID3D11Buffer** buffer) = 0;
+    // initialData は nullptr か、ミップの数 × 配列の数だけ並べたもの
+    virtual bool createTexture2D(const Texture2DDesc& desc, const SubresourceData* initialData, ID3D11Texture2D** texture) = 0;
+    virtual bool createShaderResourceView(ID3D11Resource* resource, const ShaderResourceViewDesc& desc, ID3D11ShaderResourceView** view) = 0;
+    virtual bool createDepthStencilState(const DepthStencilDesc& desc, ID3D11DepthStencilState** state) = 0;
+    virtual bool createSamplerState(const SamplerDesc& desc, ID3D11SamplerState** state) = 0;
+    virtual bool createVertexShader(const void* bytecode, size_t size, ID3D11VertexShader** shader) = 0;
+    virtual bool createPixelShader(const void* bytecode, size_t size, ID3D11PixelShader** shader) = 0;
+    virtual bool createInputLayout(const InputElementDesc* elements, uint32_t count, const void* bytecode, size_t size, ID3D11InputLayout** layout) = 0;
+
+    // ---- 転送 ----
+    // GpuUsage::Default のバッファ全体を書き換える
+    virtual void updateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size) = 0;
+
+    // GpuUsage::Dynamic の size バイトのバッファを書き込み用に開く。discard なら前の内容は捨てる
+    // unmapBuffer には実際に書き込んだバイト数を渡す
+    virtual void* mapBuffer(ID3D11Buffer* buffer, uint32_t size, bool discard) = 0;
+    virtual void unmapBuffer(ID3D11Buffer* buffer, uint32_t bytesWritten) = 0;
+
+    // GpuUsage::Staging の size バイトのバッファを CPU から書き込む用に開く
+    virtual void* mapStagingBuffer(ID3D11Buffer* buffer, uint32_t size) = 0;
+    virtual void unmapStagingBuffer(ID3D11Buffer* buffer) = 0;
+
+    // src の内容を同じ大きさの dst に GPU 上でコピーする
+    virtual void copyBuffer(ID3D11Buffer* dst, ID3D11Buffer* src, uint32_t size) = 0;
+
+    // src の srcSubresource を、同じ大きさと形式の dst の dstSubresource に GPU 上でコピーする
+    // size はそのサブリソースのバイト数
+    virtual void copySubresource(ID3D11Resource* dst, uint32_t dstSubresource, ID3D11Resource* src, uint32_t srcSubresource, uint32_t size) = 0;
+
+    // ---- 状態の設定 ----
+    virtual void setVertexShader(ID3D11VertexShader* shader) = 0;
+    virtual void setPixelShader(ID3D11PixelShader* shader) = 0;
+    virtual void setInputLayout(ID3D11InputLayout* layout) = 0;
+    virtual void setPrimitiveTopology(PrimitiveTopology topology) = 0;
+    virtual void setVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset) = 0;
+    virtual void setIndexBuffer(ID3D11Buffer* buffer, GpuFormat format, uint32_t offset) = 0;
+    virtual void setVSConstantBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers) = 0;
+    virtual void setVSConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t numConstants) = 0;
+    virtual void setPSShaderResource(uint32_t slot, ID3D11ShaderResourceView* srv) = 0;
+    virtual void setPSSampler(uint32_t slot, ID3D11SamplerState* sampler) = 0;
+    virtual void setDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef) = 0;
+
+    // ---- 描画命令 ----
+    virtual void draw(uint32_t vertexCount) = 0;
+    virtual void drawIndexed(uint32_t indexCount) = 0;
+    virtual void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startInstance) = 0;
+    virtual void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance) = 0;
+};
+
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace UniDx
+{
+
+// --------------------
+// RenderQueue
+//
+// 描画する項目を 64bit のソートキーで並べ替える。
+//   不透明   : [キュー 13bit][シェーダー 10bit][マテリアル 12bit][メッシュ 13bit][深度 16bit 手前から]
+//   半透明   : [キュー 13bit][深度 24bit 奥から][シェーダー 9bit][マテリアル 9bit][メッシュ 9bit]
+// 不透明は状態の切り替えが少なくなるようにまとめ、同じ組み合わせの中では手前から描く。
+// シェーダー・マテリアル・メッシュはポインタを縮めた値なので、まれに別のものと同じ値になるが
+// まとまり方が少し悪くなるだけで描画結果は変わらない。
+// D3D に依存しないので、GPUなしでも動かせる。
+// --------------------
+class RenderQueue
+{
+public:
+    // Material::renderQueue に設定する値（Unityと同じ）
+    static constexpr int Background = 1000;
+    static constexpr int Geometry = 2000;
+    static constexpr int AlphaTest = 2450;
+    static constexpr int Transparent = 3000;
+    static constexpr int Overlay = 4000;
+
+    struct Item
+    {
+        uint64_t key;
+        uint32_t index;     // 呼び出し側で使う番号
+    };
+
+    // ソートキーを作る。depth01 は near～far を 0～1 にしたカメラからの距離
+    static uint64_t MakeKey(int queue, const void* shader, const void* material, const void* mesh, float depth01);
+
+    // キーの中でシェーダー・マテリアル・メッシュの組み合わせを表す部分だけを取り出す
+    // 同じ値の項目は同じ状態で描画できる
+    static uint64_t StateBits(uint64_t key);
+
+    void clear() { items_.clear(); }
+    void add(uint64_t key, uint32_t index) { items_.push_back({ key, index }); }
+
+    // キーの小さい順に並べる。同じキーは追加順
+    void sort();
+
+    const std::vector<Item>& getItems() const { return items_; }
+    size_t size() const { return items_.size(); }
+
+private:
+    std::vector<Item> items_;
+    std::vector<Item> scratch_;
+};
+
+}
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "RenderDevice.h"
+
+namespace UniDx
+{
+
+// --------------------
+// RenderStateCache
+//
+// RenderDevice に最後に設定した状態を覚えておき、
+// 同じ値の再設定を省略する。省略できなかった呼び出しを状態変更として数える。
+// デバイスが nullptr のときは記録と数え上げだけ行う。
+// キャッシュを通さずにデバイスの状態を変更したあとは invalidate() を呼ぶこと。
+// --------------------
+class RenderStateCache
+{
+public:
+    static constexpr uint32_t SlotCount = 16;
+    static constexpr uint32_t VertexSlotCount = 2;    // 0:頂点 1:インスタンス
+
+    struct Stats
+    {
+        uint32_t stateChanges = 0;  // 実際にデバイスへ設定した回数
+        uint32_t skipped = 0;       // 同じ値だったので省略した回数
+        uint32_t drawCalls = 0;     // 描画命令の回数
+        uint32_t instances = 0;     // インスタンス描画で描いたインスタンスの数
+    };
+
+    RenderStateCache() { invalidate(); }
+
+    // 設定先のデバイス
+    void setDevice(RenderDevice* device) { device_ = device; invalidate(); }
+    RenderDevice* getDevice() const { return device_; }
+
+    // 覚えている状態を捨てる。次の設定は必ずデバイスに送られる
+    void invalidate();
+
+    // フレームの始まり。前フレームの統計を保存して数え直す
+    void beginFrame();
+
+    void setVertexShader(ID3D11VertexShader* shader);
+    void setPixelShader(ID3D11PixelShader* shader);
+    void setInputLayout(ID3D11InputLayout* layout);
+    void setPrimitiveTopology(PrimitiveTopology topology);
+    void setVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset);
+    void setIndexBuffer(ID3D11Buffer* buffer, GpuFormat format, uint32_t offset);
+    void setPSShaderResource(uint32_t slot, ID3D11ShaderResourceView* srv);
+    void setPSSampler(uint32_t slot, ID3D11SamplerState* sampler);
+    void setDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef);
+
+    // 描画命令
+    void drawIndexed(uint32_t indexCount);
+    void draw(uint32_t vertexCount);
+    void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance);
+    void drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startInstance);
+
+    // 現在のフレームの統計
+    const Stats& getStats() const { return stats_; }
+
+    // 前のフレームの統計
+    const Stats& getLastFrameStats() const { return lastFrameStats_; }
+
+private:
+    RenderDevice* device_ = nullptr;
+
+    ID3D11VertexShader*       vertexShader_;
+    ID3D11PixelShader*        pixelShader_;
+    ID3D11InputLayout*        inputLayout_;
+    PrimitiveTopology         topology_;
+    std::array<ID3D11Buffer*, VertexSlotCount> vertexBuffers_;
+    std::array<uint32_t, VertexSlotCount>      vertexStrides_;
+    std::array<uint32_t, VertexSlotCount>      vertexOffsets_;
+    ID3D11Buffer*             indexBuffer_;
+    GpuFormat                 indexFormat_;
+    uint32_t                  indexOffset_;
+    std::array<ID3D11ShaderResourceView*, SlotCount> psResources_;
+    std::array<ID3D11SamplerState*, SlotCount>       psSamplers_;
+    ID3D11DepthStencilState*  depthStencilState_;
+    uint32_t                  stencilRef_;
+
+    Stats stats_;
+    Stats lastFrameStats_;
+
+    // 値が変わっていれば覚えて true
+    template<typename T>
+    bool change(T& current, T value)
+    {
+        if (current == value)
+        {
+            ++stats_.skipped;
+            return false;
+        }
+        current = value;
+        ++stats_.stateChanges;
+        return true;
+    }
+};
+
+}
@@ -18,12 +18,22 @@ class Camera;
 class Material;
 
 // -----------------------------------------------------------------------------
-// 頂点シェーダー側と共有する、モデルビュー行列の定数バッファ
+// 頂点シェーダー側と共有する、描画ごとのワールド行列の定数バッファ
 //     UniDxではすべてのシェーダーでスロット0番に共通で指定する
+//     lodFade.x は LOD のクロスフェード。0 ならそのまま、正なら閾値以上、負なら閾値未満の画素だけ描く
 // -----------------------------------------------------------------------------
 struct VSConstantBuffer0
 {
     Matrix world;
+    Vector4 lodFade;
+};
+
+// -----------------------------------------------------------------------------
+// 頂点シェーダー側と共有する、カメラの定数バッファ
+//     スロット1番。フレームで1回だけ更新する
+// -----------------------------------------------------------------------------
+struct VSConstantBuffer1
+{
     Matrix view;
     Matrix projection;
 };
@@ -37,8 +47,32 @@ class Renderer : public Component
 public:
     std::vector< std::shared_ptr<Material> > materials;
 
+    virtual ~Renderer();
+
     virtual void Render(const Camera& camera) const {}
 
+    // ローカル空間の境界。境界を持たないものは false を返し、カリングされない
+    virtual bool getLocalBounds(Bounds& bounds) const { return false; }
+
+    // 描画順の並べ替えに使うサブメッシュ。なければ nullptr
+    virtual const SubMesh* getSortSubMesh() const { return nullptr; }
+
+    // インスタンス描画でまとめられるときは、描画するサブメッシュを返す。できなければ nullptr
+    // 同じサブメッシュと同じマテリアルを返す Renderer は、ワールド行列だけを変えて1回で描画される
+    virtual const SubMesh* getInstanceSubMesh() const { return nullptr; }
+
+    // ワールド空間の境界。Transform が変わったときだけ再計算する
+    const Bounds& getWorldBounds() const;
+
+    // メッシュを差し替えたときなどに、境界を再計算させる
+    void ResetBounds() { boundsValid_ = false; }
+
+    // LODGroup で今の LOD に選ばれているか
+    bool isLODVisible() const { return lodVisible_; }
+
+    // LODGroup のクロスフェードの値。フェード中でなければ 0
+    float getLODFade() const { return lodFade_; }
+
     // マテリアルを追加（共有）
     void AddMaterial(std::shared_ptr<Material> material)
     {
@@ -52,7 +86,7 @@ public:
         // マテリアルを追加
         materials.push_back(std::make_shared<Material>());
 
-        // マテリアルをシェーダーを読み込んで初期化
+        // マテリアルをシェーダーを読み込んで初期化。コンパイル済みのものは共有する
         materials.back()->shader.compile<TVertex>(shaderPath);
     }
 
@@ -62,18 +96,40 @@ public:
     {
         AddMaterial<TVertex>(shaderPath);
 
-        // テクスチャを読み込んでマテリアルに追加
-        std::unique_ptr<Texture> t = std::make_unique<Texture>();
-        t->Load(textuePath);
-        materials.back()->AddTexture(std::move(t));
+        // テクスチャを読み込んでマテリアルに追加。同じ画像は Renderer の間で共有する
+        if (std::shared_ptr<Texture> t = Texture::LoadShared(textuePath))
+        {
+            materials.back()->AddTexture(std::move(t));
+        }
     }
 
 protected:
-    ComPtr<ID3D11Buffer> constantBuffer0;
+    ComPtr<ID3D11Buffer> constantBuffer0;  // 定数バッファのリングが使えないときだけ作る
 
     virtual void OnEnable() override;
+    virtual void OnDisable() override;
     virtual void updatePositionCameraCBuffer(const UniDx::Camera& camera) const;
     virtual void setShaderForRender() const;
+
+    // world と LOD のクロスフェードを描画ごとの定数としてスロット0番に送る
+    void uploadObjectConstants(const Matrix& world) const;
+
+private:
+    friend class RendererManager;
+    friend class LODGroup;
+
+    int32_t rendererIndex_ = -1;        // RendererManager 内の番号
+    bool    lodVisible_ = true;         // LODGroup が選んだ LOD に入っているか
+    float   lodFade_ = 0.0f;            // LODGroup のクロスフェード
+
+    mutable Bounds   worldBounds_;
+    mutable uint32_t boundsVersion_ = 0;    // 計算に使った Transform のバージョン
+    mutable uint32_t boundsRevision_ = 0;   // worldBounds_ を計算し直すたびに進む
+    mutable bool     boundsValid_ = false;
+
+    // Transform が変わっていればワールド空間の境界を再計算。再計算したら true
+    // getWorldBounds からも呼ばれるので、RendererManager は戻り値ではなく boundsRevision_ で変化を知る
+    bool updateWorldBounds() const;
 };
 
 
@@ -87,6 +143,11 @@ public:
 
     // メッシュを使って描画
     virtual void Render(const Camera& camera) const override;
+
+    // メッシュのローカル空間の境界
+    virtual bool getLocalBounds(Bounds& bounds) const override { return mesh.getBounds(bounds); }
+    virtual const SubMesh* getSortSubMesh() const override { return mesh.submesh.empty() ? nullptr : mesh.submesh.front().get(); }
+    virtual const SubMesh* getInstanceSubMesh() const override;
 };
 
 
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+#include "FrustumCulling.h"
+#include "RenderQueue.h"
+#include "ParallelRecorder.h"
+#include "DeferredContextBackend.h"
+
+namespace UniDx
+{
+
+class Renderer;
+class Camera;
+class LODGroup;
+
+// --------------------
+// RendererManager
+//
+// 有効な Renderer を登録しておき、カメラの視錐台の外にあるものを除いて描画する。
+// ワールド空間の境界は SoA の配列に並べておき、Transform が変わったものだけ書き換える。
+// 見えるものはソートキーで並べ替え、状態の切り替えが少ない順に描画する。
+// 並べた結果、同じサブメッシュとマテリアルが続くところはインスタンス描画で1回にまとめる。
+// カメラの行列はフレームで1回だけ転送し、描画ごとのワールド行列は大きな定数バッファから切り出す。
+// 描画する数が多いときは、並べた順を区間に分けてワーカースレッドで遅延コンテキストに記録し、
+// 元の順でイミディエイトコンテキストで実行する。
+// LODGroup はカリングの前にカメラに合わせて LOD を選び、選ばれていない Renderer は描かない。
+// 見える Renderer の画面上の大きさを見積もって、マテリアルのテクスチャを TextureStreamer に伝える。
+// --------------------
+class RendererManager : public Singleton<RendererManager>
+{
+public:
+    void registerRenderer(Renderer* renderer);
+    void unregisterRenderer(Renderer* renderer);
+
+    void registerLODGroup(LODGroup* group);
+    void unregisterLODGroup(LODGroup* group);
+
+    // 視錐台の内側にある Renderer を描画
+    virtual void render(const Camera& camera);
+
+    // メインカメラ（Camera::main）。最初に有効になったカメラ
+    Camera* getMainCamera() const { return mainCamera_; }
+    void setMainCamera(Camera* camera) { mainCamera_ = camera; }
+
+    // 登録されている Renderer の数
+    size_t getRendererCount() const { return renderers_.size(); }
+
+    // 前回の描画で視錐台の内側にあった数
+    size_t getVisibleCount() const { return visibleCount_; }
+
+    // インスタンス描画でまとめるかどうか
+    void setInstancing(bool enable) { instancing_ = enable; }
+    bool isInstancing() const { return instancing_; }
+
+    // この数以上続いたときだけインスタンス描画にする
+    static constexpr size_t MinInstanceCount = 2;
+
+    // 描画ごとの定数を定数バッファのリングから切り出せるか
+    bool isConstantRingSupported() const;
+
+    // 描画ごとの定数を今の記録先のリングに書き込み、頂点シェーダーのスロット0番にセットする
+    // リングが使えなければ false
+    bool uploadObjectConstants(const void* data, UINT size);
+
+    // 複数のスレッドで記録するかどうか
+    void setParallelRecording(bool enable) { parallelRecording_ = enable; }
+    bool isParallelRecording() const { return parallelRecording_; }
+
+    // 複数のスレッドで記録するときの分け方
+    ParallelRecorder& getRecorder() { return recorder_; }
+
+    // 前回の描画で記録に使ったスレッドの数。1スレッドで直接描いたときは 0
+    size_t getRecordingSlotCount() const { return recordingSlots_; }
+
+private:
+    Camera*                mainCamera_ = nullptr;
+    std::vector<Renderer*> renderers_;
+    std::vector<LODGroup*> lodGroups_;
+    BoundsArray            bounds_;     // renderers_ と同じ順のワールド空間の境界
+    std::vector<uint32_t>  boundsRevisions_;    // bounds_ に書いたときの Renderer::boundsRevision_
+    std::vector<uint32_t>  visible_;
+    size_t                 visibleCount_ = 0;
+    RenderQueue            queue_;
+    bool                   instancing_ = true;
+    ComPtr<ID3D11Buffer>   cameraConstants_;     // ビュー・プロジェクション行列
+
+    bool                   parallelRecording_ = true;
+    ParallelRecorder       recorder_;
+    std::unique_ptr<DeferredContextBackend> deferred_;
+    bool                   deferredInitialized_ = false;
+    size_t                 recordingSlots_ = 0;
+
+    // カメラの行列を転送する
+    void updateCameraConstants(const Camera& camera);
+
+    // カメラの行列とライトを device に設定
+    void bindFrameConstants(RenderDevice& device) const;
+
+    // 記録スレッドごとの遅延コンテキストを作る。items は最初のフレームの描画の数。使えなければ false
+    bool initializeDeferred(size_t items);
+
+    // Transform が変わった Renderer の境界を書き換える
+    void updateBounds();
+
+    // LODGroup ごとに camera に合わせて LOD を選ぶ
+    void updateLODGroups(const Camera& camera);
+
+protected:
+    // 視錐台の内側にある Renderer を visible_ に集め、その数を返す
+    size_t cull(const Camera& camera);
+
+    // 視錐台の内側にある Renderer のテクスチャを、画面上の大きさと一緒に TextureStreamer に伝える
+    void requestTextures(const Camera& camera, size_t visibleCount);
+
+    // 視錐台の内側にある Renderer をソートキーと一緒に queue_ に積んで並べ替える
+    void buildQueue(const Camera& camera, size_t visibleCount);
+
+    // queue_ の [begin, end) を今の記録先に描画する
+    void renderRange(const Camera& camera, size_t begin, size_t end);
+
+    // queue_ の [begin, end) を1回のインスタンス描画で描く。できなければ false
+    bool renderInstanced(size_t begin, size_t end);
+};
+
+}
@@ -54,6 +54,13 @@ public:
 
     virtual void OnEnable() override
     {
+        // プールからの再利用などで Transform が動かされていることがあるので合わせる
+        position_ = transform->position;
+        rotation_ = transform->rotation;
+        move_ = Vector3::Zero;
+        hasMovePos_ = false;
+        hasMoveRot_ = false;
+
         Physics::getInstance()->registerRigidbody(this);
     }
 
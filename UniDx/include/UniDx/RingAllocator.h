@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace UniDx
+{
+
+// --------------------
+// RingAllocator
+//
+// 動的バッファを先頭から順に切り出していくための割り当て計算。
+// D3D11 の動的バッファの使い方に合わせて、1フレームの中では使っていない後ろの領域を
+// 追記し（MAP_WRITE_NO_OVERWRITE）、フレームの始めか末尾まで使い切ったときだけ
+// バッファごと捨てて先頭に戻る（MAP_WRITE_DISCARD）。
+// バッファそのものは持たないので、GPUなしで確かめられる。
+// --------------------
+class RingAllocator
+{
+public:
+    struct Allocation
+    {
+        uint32_t offset = 0;    // バッファ先頭からのバイト位置
+        uint32_t size = 0;      // 切り出したバイト数（alignment の倍数）
+        bool discard = false;   // true なら MAP_WRITE_DISCARD で書き込む
+    };
+
+    RingAllocator() = default;
+    RingAllocator(uint32_t capacity, uint32_t alignment) { reset(capacity, alignment); }
+
+    // 容量と切り出す単位を設定し直す。次の割り当ては捨てて先頭から
+    void reset(uint32_t capacity, uint32_t alignment);
+
+    // フレームの始まり。次の割り当ては捨てて先頭から
+    void beginFrame() { discardNext_ = true; frameUsed_ = 0; }
+
+    // size バイトを切り出す。容量より大きいときは false
+    bool allocate(uint32_t size, Allocation& allocation);
+
+    uint32_t getCapacity() const { return capacity_; }
+    uint32_t getAlignment() const { return alignment_; }
+
+    // 最後に捨ててから使ったバイト数
+    uint32_t getUsed() const { return cursor_; }
+
+    // 捨てた回数
+    uint32_t getDiscardCount() const { return discardCount_; }
+
+    // beginFrame から切り出したバイト数。容量より大きければフレームの途中で先頭に戻っている
+    uint32_t getFrameUsed() const { return frameUsed_; }
+
+    // 1フレームで frameUsed バイト使ったときに広げる容量。
+    // 足りていれば capacity のまま、足りなければ倍にしていき maxCapacity で止める
+    static uint32_t GetGrownCapacity(uint32_t capacity, uint32_t frameUsed, uint32_t maxCapacity);
+
+private:
+    uint32_t capacity_ = 0;
+    uint32_t alignment_ = 1;
+    uint32_t cursor_ = 0;
+    uint32_t discardCount_ = 0;
+    uint32_t frameUsed_ = 0;
+    bool     discardNext_ = true;
+};
+
+}
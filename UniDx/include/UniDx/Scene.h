@@ -24,6 +24,13 @@ public:
 
     const GameObjectContainer& GetRootGameObjects() { return routeGameObjects; }
 
+    // ルートにGameObjectを追加
+    // 更新処理中に呼ぶとルートを巡回中のループが壊れるので、同期点でのみ呼ぶこと
+    GameObject* AddRootGameObject(unique_ptr<GameObject> gameObject);
+
+    // ルートからGameObjectを所有権ごと取り出す。ルートになければ nullptr
+    unique_ptr<GameObject> RemoveRootGameObject(GameObject* gameObject);
+
 protected:
     GameObjectContainer routeGameObjects;
 
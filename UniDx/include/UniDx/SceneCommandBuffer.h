@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_set>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+class Scene;
+
+// --------------------
+// SceneCommandBuffer
+//
+// 生成・破棄・親の変更・有効無効の切り替えといった階層構造の変更を記録しておき、
+// 同期点（Engine::syncStructure）でまとめて反映する。
+// 更新処理中に children やシーンのルートを直接変更すると巡回中のループが壊れるので、
+// Update などからはこちらを使う。
+//
+// 記録先はスレッドごとに分かれているので、メインスレッドと JobSystem のワーカーから
+// ロックなしで記録できる。反映はスレッド番号順、同じスレッド内は記録順で、
+// 破棄だけは他の変更をすべて反映したあとに、同じ順で行う。
+// --------------------
+class SceneCommandBuffer : public Singleton<SceneCommandBuffer>
+{
+public:
+    // 記録先を JobSystem のスレッドの数だけ用意する
+    SceneCommandBuffer();
+
+    // 記録先を threadCount 個用意する。JobSystem より先に作るときに、そのスレッドの数を渡す
+    explicit SceneCommandBuffer(size_t threadCount);
+
+    // GameObject をシーンに追加する。parent が nullptr ならルートに追加
+    // 反映時に Awake / OnEnable が呼ばれ、最初の Update は次のフレームから
+    GameObject* spawn(unique_ptr<GameObject> gameObject, Transform* parent = nullptr);
+
+    // GameObject を破棄する。delay 秒後まで遅らせることもできる
+    // プレハブから作ったものはプールに返す
+    void destroy(GameObject* gameObject, float delay = 0.0f);
+
+    // 親を変更する。newParent が nullptr ならルートに移動
+    void setParent(Transform* transform, Transform* newParent);
+
+    // GameObject のアクティブ状態を変更する
+    void setActive(GameObject* gameObject, bool value);
+
+    // コンポーネントの有効状態を変更する
+    void setEnabled(Component* component, bool value);
+
+    // 記録した変更をまとめて反映する（メインスレッドの同期点で呼ぶ）
+    void apply(Scene* scene);
+
+    // 時刻待ちの破棄の数
+    size_t getDelayedCount() const { return delayed_.size(); }
+
+private:
+    friend class GameObject;
+
+    enum class CommandType
+    {
+        Spawn,
+        Destroy,
+        SetParent,
+        SetActive,
+        SetEnabled,
+    };
+
+    struct Command
+    {
+        CommandType type;
+        GameObject* gameObject = nullptr;
+        Component*  component = nullptr;
+        Transform*  parent = nullptr;
+        unique_ptr<GameObject> spawned;
+        bool  value = false;
+        float destroyTime = 0.0f;   // この時刻を過ぎたら破棄
+    };
+
+    // スレッドごとの記録先。別スレッドの記録先と同じキャッシュラインに乗らないようにする
+    struct alignas(64) Queue
+    {
+        std::vector<Command> commands;
+    };
+
+    struct DelayedDestroy
+    {
+        GameObject* gameObject;
+        float destroyTime;
+    };
+
+    std::vector<Queue>          queues_;
+    std::vector<GameObject*>    destroyList_;   // 今回破棄するもの。記録した順
+    std::unordered_set<GameObject*> destroySet_;    // destroyList_ と同じもの。二重破棄と祖先を調べる
+    std::vector<DelayedDestroy> delayed_;       // 時刻待ちの破棄。GameObject 側に位置を持たせる
+
+    Queue& currentQueue();
+
+    void applyCommand(Command& command, Scene* scene);
+    void destroyNow(GameObject* gameObject, Scene* scene);
+
+    // 時刻待ちの破棄に加える。すでにあれば早いほうの時刻にする
+    void addDelayed(GameObject* gameObject, float destroyTime);
+
+    // delayed_[index] を取り除く
+    void removeDelayed(size_t index);
+
+    // gameObject の時刻待ちの破棄を取り消す。GameObject のデストラクタからも呼ぶ
+    void cancelDelayed(GameObject* gameObject);
+};
+
+}
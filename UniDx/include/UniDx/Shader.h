@@ -3,6 +3,9 @@
 // C++のSTL
 #include <string>
 #include <array>
+#include <span>
+#include <vector>
+#include <algorithm>
 
 // Direct3Dの型・クラス・関数など
 #include <d3d11.h>
@@ -14,6 +17,8 @@ using Microsoft::WRL::ComPtr;
 
 #include "UniDxDefine.h"
 #include "Object.h"
+#include "VertexPacking.h"
+#include "ShaderCache.h"
 
 namespace UniDx
 {
@@ -128,22 +133,246 @@ struct VertexPNC
 };
 
 
+// ----------------------------------------------------------
+// スキニングする頂点。VertexPNT にジョイントの番号と重みを4つずつ付ける
+//     番号は 8bit なので、1つのスキンのジョイントは 256 個まで
+//     重みは合計が 255 になるように 8bit に丸める
+// ----------------------------------------------------------
+struct VertexPNTJW
+{
+	Vector3 position;
+	Vector3 normal;
+	Vector2 uv0;
+	uint8_t joints[4];
+	uint8_t weights[4];
+
+	void setPosition(Vector3 v) { position = v; }
+	void setNormal(Vector3 v) { normal = v; }
+	void setColor(Color c) {}
+	void setUV(Vector2 v) { uv0 = v; }
+	void setUV2(Vector2 v) {}
+	void setUV3(Vector2 v) {}
+	void setUV4(Vector2 v) {}
+
+	void setSkin(const std::array<uint16_t, 4>& j, const Vector4& w)
+	{
+		const float src[4] = { w.x, w.y, w.z, w.w };
+		float sum = 0.0f;
+		for (float f : src) sum += std::max(f, 0.0f);
+		const float scale = sum > 0.0f ? 255.0f / sum : 0.0f;
+
+		// 丸めた残りは一番重いジョイントに足す
+		int total = 0;
+		int heaviest = 0;
+		for (int k = 0; k < 4; ++k)
+		{
+			joints[k] = uint8_t(std::min<uint16_t>(j[k], 255));
+			weights[k] = uint8_t(std::max(src[k], 0.0f) * scale + 0.5f);
+			total += weights[k];
+			if (src[k] > src[heaviest]) heaviest = k;
+		}
+		weights[heaviest] = uint8_t(std::clamp(int(weights[heaviest]) + (sum > 0.0f ? 255 - total : 0), 0, 255));
+	}
+
+	// SubMesh::copyTo から呼ばれる。ジョイントがなければ全て 0 番に重み 0 のまま
+	template<typename TMesh>
+	static void pack(const TMesh& mesh, std::span<VertexPNTJW> vertex)
+	{
+		const bool hasNormal = mesh.normals.size() == mesh.positions.size();
+		const bool hasUV = mesh.uv.size() == mesh.positions.size();
+		const bool hasSkin = mesh.isSkinned();
+		for (size_t i = 0; i < mesh.positions.size(); ++i)
+		{
+			VertexPNTJW& v = vertex[i];
+			v.position = mesh.positions[i];
+			v.normal = hasNormal ? mesh.normals[i] : Vector3::Zero;
+			v.uv0 = hasUV ? mesh.uv[i] : Vector2::Zero;
+			if (hasSkin)
+			{
+				v.setSkin(mesh.joints[i], mesh.weights[i]);
+			}
+			else
+			{
+				std::fill(std::begin(v.joints), std::end(v.joints), uint8_t(0));
+				std::fill(std::begin(v.weights), std::end(v.weights), uint8_t(0));
+			}
+		}
+	}
+
+	static const std::array< D3D11_INPUT_ELEMENT_DESC, 5> layout;
+};
+
+
+// ----------------------------------------------------------
+// 詰めた頂点。VertexPacking の形式で、float の頂点のおよそ半分の大きさ
+//     UV は 0～1 の範囲だけなので、繰り返すテクスチャには float の頂点を使う
+//     法線は八面体で詰めるので、シェーダーは UNIDX_NORMAL_OCT のとき2成分から戻す
+// ----------------------------------------------------------
+struct VertexPackedPN
+{
+	uint16_t position[4];
+	uint32_t normal;
+
+	void setPosition(Vector3 v) { PackHalf4(v, position); }
+	void setNormal(Vector3 v) { normal = PackOctahedralNormal(v); }
+	void setColor(Color c) {}
+	void setUV(Vector2 v) {}
+	void setUV2(Vector2 v) {}
+	void setUV3(Vector2 v) {}
+	void setUV4(Vector2 v) {}
+
+	// SubMesh::copyTo から属性ごとにまとめて詰める
+	template<typename TMesh>
+	static void pack(const TMesh& mesh, std::span<VertexPackedPN> vertex)
+	{
+		PackHalf4Stream(mesh.positions, &vertex[0].position, sizeof(vertex[0]));
+		if (mesh.normals.size() == mesh.positions.size()) PackOctahedralNormalStream(mesh.normals, &vertex[0].normal, sizeof(vertex[0]));
+	}
+
+	static const std::array< D3D11_INPUT_ELEMENT_DESC, 2> layout;
+};
+struct VertexPackedPC
+{
+	uint16_t position[4];
+	uint32_t color;
+
+	void setPosition(Vector3 v) { PackHalf4(v, position); }
+	void setNormal(Vector3 v) {}
+	void setColor(Color c) { color = PackUNorm8x4(c); }
+	void setUV(Vector2 v) {}
+	void setUV2(Vector2 v) {}
+	void setUV3(Vector2 v) {}
+	void setUV4(Vector2 v) {}
+
+	template<typename TMesh>
+	static void pack(const TMesh& mesh, std::span<VertexPackedPC> vertex)
+	{
+		PackHalf4Stream(mesh.positions, &vertex[0].position, sizeof(vertex[0]));
+		if (mesh.colors.size() == mesh.positions.size()) PackUNorm8x4Stream(mesh.colors, &vertex[0].color, sizeof(vertex[0]));
+	}
+
+	static const std::array< D3D11_INPUT_ELEMENT_DESC, 2> layout;
+};
+struct VertexPackedPTC
+{
+	uint16_t position[4];
+	uint32_t uv0;
+	uint32_t color;
+
+	void setPosition(Vector3 v) { PackHalf4(v, position); }
+	void setNormal(Vector3 v) {}
+	void setColor(Color c) { color = PackUNorm8x4(c); }
+	void setUV(Vector2 v) { uv0 = PackUNorm16x2(v); }
+	void setUV2(Vector2 v) {}
+	void setUV3(Vector2 v) {}
+	void setUV4(Vector2 v) {}
+
+	template<typename TMesh>
+	static void pack(const TMesh& mesh, std::span<VertexPackedPTC> vertex)
+	{
+		PackHalf4Stream(mesh.positions, &vertex[0].position, sizeof(vertex[0]));
+		if (mesh.uv.size() == mesh.positions.size()) PackUNorm16x2Stream(mesh.uv, &vertex[0].uv0, sizeof(vertex[0]));
+		if (mesh.colors.size() == mesh.positions.size()) PackUNorm8x4Stream(mesh.colors, &vertex[0].color, sizeof(vertex[0]));
+	}
+
+	static const std::array< D3D11_INPUT_ELEMENT_DESC, 3> layout;
+};
+struct VertexPackedPNT
+{
+	uint16_t position[4];
+	uint32_t normal;
+	uint32_t uv0;
+
+	void setPosition(Vector3 v) { PackHalf4(v, position); }
+	void setNormal(Vector3 v) { normal = PackOctahedralNormal(v); }
+	void setColor(Color c) {}
+	void setUV(Vector2 v) { uv0 = PackUNorm16x2(v); }
+	void setUV2(Vector2 v) {}
+	void setUV3(Vector2 v) {}
+	void setUV4(Vector2 v) {}
+
+	template<typename TMesh>
+	static void pack(const TMesh& mesh, std::span<VertexPackedPNT> vertex)
+	{
+		PackHalf4Stream(mesh.positions, &vertex[0].position, sizeof(vertex[0]));
+		if (mesh.normals.size() == mesh.positions.size()) PackOctahedralNormalStream(mesh.normals, &vertex[0].normal, sizeof(vertex[0]));
+		if (mesh.uv.size() == mesh.positions.size()) PackUNorm16x2Stream(mesh.uv, &vertex[0].uv0, sizeof(vertex[0]));
+	}
+
+	static const std::array< D3D11_INPUT_ELEMENT_DESC, 3> layout;
+};
+struct VertexPackedPNC
+{
+	uint16_t position[4];
+	uint32_t normal;
+	uint32_t color;
+
+	void setPosition(Vector3 v) { PackHalf4(v, position); }
+	void setNormal(Vector3 v) { normal = PackOctahedralNormal(v); }
+	void setColor(Color c) { color = PackUNorm8x4(c); }
+	void setUV(Vector2 v) {}
+	void setUV2(Vector2 v) {}
+	void setUV3(Vector2 v) {}
+	void setUV4(Vector2 v) {}
+
+	template<typename TMesh>
+	static void pack(const TMesh& mesh, std::span<VertexPackedPNC> vertex)
+	{
+		PackHalf4Stream(mesh.positions, &vertex[0].position, sizeof(vertex[0]));
+		if (mesh.normals.size() == mesh.positions.size()) PackOctahedralNormalStream(mesh.normals, &vertex[0].normal, sizeof(vertex[0]));
+		if (mesh.colors.size() == mesh.positions.size()) PackUNorm8x4Stream(mesh.colors, &vertex[0].color, sizeof(vertex[0]));
+	}
+
+	static const std::array< D3D11_INPUT_ELEMENT_DESC, 3> layout;
+};
+
+
 // ----------------------------------------------------------
 // Shaderクラス
 // ----------------------------------------------------------
 class Shader : public Object
 {
 public:
+	// インスタンス描画でワールド行列を渡す頂点バッファのスロット
+	static constexpr UINT InstanceSlot = 1;
+
+	// インスタンス描画版のシェーダーをコンパイルするときに定義するマクロ
+	static constexpr const char* InstancingDefine = "UNIDX_INSTANCING";
+
+	// 頂点の法線が八面体で詰めた2成分（DXGI_FORMAT_R16G16_SNORM）のときに定義するマクロ
+	static constexpr const char* OctahedralNormalDefine = "UNIDX_NORMAL_OCT";
+
+	// スキニングするシェーダーをコンパイルするときに定義するマクロ
+	static constexpr const char* SkinningDefine = "UNIDX_SKINNING";
+
 	Shader() : Object([this]() {return fileName;}) {}
 
 	// シェーダーのパスを指定してコンパイル
-	bool compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size);
+	// 同じファイルと頂点の形式とマクロでコンパイル済みのものがあれば、AssetCache から GPU のシェーダーを共有する
+	// defines でマクロを定義して、同じファイルから別の版（スキニングなど）を作れる
+	// バイトコードは ShaderCache があればディスクに残り、次からはコンパイルしない
+	bool compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size,
+		std::span<const ShaderCache::Define> defines = {});
 
 	template<typename TVertex>
-	bool compile(const std::wstring& filePath) { return compile(filePath, TVertex::layout.data(), TVertex::layout.size()); }
+	bool compile(const std::wstring& filePath, std::span<const ShaderCache::Define> defines = {})
+	{
+		return compile(filePath, TVertex::layout.data(), TVertex::layout.size(), defines);
+	}
 
 	// 描画のため、D3DDeviceContextにこのシェーダーをセット
-	void setToContext() const;
+	// instanced が true ならインスタンス描画版をセットする
+	void setToContext(bool instanced = false) const;
+
+	// インスタンス描画版があるか
+	// シェーダーが UNIDX_INSTANCING 定義時に INSTANCE_WORLD0～3 を入力に持つときだけ作られる
+	bool isInstancingSupported() const { return m_vertexInstanced != nullptr; }
+
+	// 同じシェーダーを共有しているものは同じ値になる。描画順の並べ替えに使う
+	const void* getProgramId() const { return m_shared != nullptr ? static_cast<const void*>(m_shared.get()) : this; }
+
+	// 頂点の形式を表すキー
+	static uint64_t LayoutKey(const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size);
 
 protected:
 	wstring fileName;
@@ -152,6 +381,18 @@ private:
 	ComPtr<ID3D11VertexShader>	m_vertex = nullptr;	// 頂点シェーダー
 	ComPtr<ID3D11PixelShader>	m_pixel = nullptr;	// ピクセルシェーダー
 	ComPtr<ID3D11InputLayout>	m_inputLayout = nullptr;// 入力レイアウト
+
+	ComPtr<ID3D11VertexShader>	m_vertexInstanced = nullptr;		// インスタンス描画版の頂点シェーダー
+	ComPtr<ID3D11InputLayout>	m_inputLayoutInstanced = nullptr;	// インスタンス描画版の入力レイアウト
+
+	std::shared_ptr<const Shader> m_shared;	// AssetCache で共有している元。持っている間は共有が続く
+
+	// AssetCache を通さずにコンパイル
+	bool compileShader(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size,
+		std::span<const ShaderCache::Define> defines);
+
+	// インスタンス描画版のバイトコードから作る。対応していないシェーダーなら何もしない
+	void createInstanced(const std::vector<uint8_t>& bytecode, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+﻿#pragma once
+
+#include <map>
+#include <span>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <memory>
+#include <cstdint>
+
+// ComPtr。GPU のオブジェクトは IUnknown として持つので d3d11.h は読まない
+#include <wrl/client.h>
+using Microsoft::WRL::ComPtr;
+
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// ShaderCache
+//
+// HLSL をコンパイルしたバイトコードをディスクに残し、次からはコンパイルせずに読む。
+// キーは元のファイルの内容のハッシュ・エントリポイント・プロファイル・マクロで、
+// マクロは名前順に並べてからキーにするので、渡す順番が違っても同じものになる。
+// #include したファイルはハッシュと一緒に記録しておき、変わっていたら使わない。
+// 作った GPU のシェーダーと入力レイアウトはバイトコードの内容で覚えておき、
+// 同じバイトコードからは同じものを返す。
+//
+//   ヘッダー | #include したファイル（パスの長さ・ハッシュ・UTF-8 のパス）| バイトコード
+// --------------------
+class ShaderCache : public Singleton<ShaderCache>
+{
+public:
+    static constexpr uint32_t Magic = 0x43534455;   // "UDSC"
+    static constexpr uint32_t Version = 1;
+
+    // コンパイルするときに定義するマクロ
+    struct Define
+    {
+        std::string name;
+        std::string value = "1";
+    };
+
+    // #include したファイル
+    struct Dependency
+    {
+        std::wstring path;
+        uint64_t     hash;
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t dependencyCount;
+        uint32_t bytecodeSize;
+    };
+
+    struct Stats
+    {
+        size_t memoryHits = 0;  // 読み込み済みのバイトコードを返した
+        size_t diskHits = 0;    // ディスクから読んだ
+        size_t misses = 0;      // なかった、または古かった
+        size_t objectHits = 0;  // 作ってあった GPU のオブジェクトを返した
+    };
+
+    // コンパイルの結果を決めるもののキー
+    static uint64_t MakeKey(uint64_t sourceHash, std::string_view entryPoint, std::string_view profile, std::span<const Define> defines);
+
+    // 内容のハッシュ
+    static uint64_t HashContent(const void* data, size_t size);
+
+    // バイトコードを置くディレクトリ。空ならディスクには置かない
+    void setDirectory(const std::wstring& directory);
+    const std::wstring& getDirectory() const { return directory_; }
+
+    // key のバイトコードのファイルのパス
+    std::wstring getPath(uint64_t key) const;
+
+    // key のバイトコードを返す。なければ、または #include したファイルが変わっていれば nullptr
+    std::shared_ptr<const std::vector<uint8_t>> find(uint64_t key);
+
+    // key のバイトコードを覚えて、ディスクに書き出す
+    std::shared_ptr<const std::vector<uint8_t>> store(uint64_t key, std::span<const Dependency> dependencies, const void* bytecode, size_t size);
+
+    // bytecode と variant から作った GPU のオブジェクトを返す。なければ create で作って覚えておく
+    // 種類の違うものは variant で分ける（入力レイアウトなら頂点の形式のキー）
+    template<typename T, typename F>
+    ComPtr<T> getObject(std::span<const uint8_t> bytecode, uint64_t variant, F&& create)
+    {
+        const ObjectKey key{ HashContent(bytecode.data(), bytecode.size()), variant, typeid(T).hash_code() };
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = objects_.find(key);
+            if (it != objects_.end())
+            {
+                ++stats_.objectHits;
+                return ComPtr<T>(static_cast<T*>(it->second.Get()));
+            }
+        }
+
+        // 作るのはロックの外。同時に作られたら先に入った方を使う
+        ComPtr<T> object;
+        if (!create(object.GetAddressOf()))
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = objects_.try_emplace(key, object);
+        return ComPtr<T>(static_cast<T*>(it->second.Get()));
+    }
+
+    Stats getStats() const;
+    void resetStats();
+
+    // 覚えているバイトコードと GPU のオブジェクトを捨てる。ディスクのものは残す
+    void clear();
+
+private:
+    struct ObjectKey
+    {
+        uint64_t bytecode;
+        uint64_t variant;
+        size_t   type;
+
+        bool operator<(const ObjectKey& other) const
+        {
+            if (bytecode != other.bytecode) return bytecode < other.bytecode;
+            if (variant != other.variant) return variant < other.variant;
+            return type < other.type;
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::wstring directory_;
+    std::map<uint64_t, std::shared_ptr<const std::vector<uint8_t>>> bytecodes_;
+    std::map<ObjectKey, ComPtr<IUnknown>> objects_;
+    Stats stats_;
+
+    // ディスクから読む。なければ、または古ければ nullptr
+    std::shared_ptr<const std::vector<uint8_t>> read_(uint64_t key) const;
+    bool write_(uint64_t key, std::span<const Dependency> dependencies, const void* bytecode, size_t size) const;
+};
+
+}
@@ -2,7 +2,6 @@
 
 #include <memory>
 #include <assert.h>
-#include "UniDxDefine.h"
 
 namespace UniDx
 {
@@ -13,13 +12,20 @@ namespace UniDx
 // Ɣj̃^C~O𐧌䂵A
 // ̃NX create ł悤ɂ邽
 // I create  destroy Kv
+//
+// setThreadInstance ŁAĂ񂾃Xbhʂ̃CX^Xg킹邱ƂłB
+// 1̃vZXŕ̃V[ꂼ̃XbhœƂɎg
 // --------------------
 template<class T>
 class Singleton
 {
 public:
-    // CX^X̎擾
-    static T* getInstance() { return instance_.get(); }
+    // CX^X̎擾B̃Xbhp̃CX^X΂
+    static T* getInstance() { return threadInstance_ != nullptr ? threadInstance_ : instance_.get(); }
+
+    // ̃XbhŎgCX^Xݒ肷Bnullptr ŋʂ̃CX^Xɖ߂
+    // instance ̏L͌Ăяo
+    static void setThreadInstance(T* instance) { threadInstance_ = instance; }
 
     // ̃NXCX^XƂč쐬
     static void create()
@@ -38,10 +44,14 @@ protected:
     Singleton() {}
     virtual ~Singleton() {}
 
-    static unique_ptr<T> instance_;
+    static std::unique_ptr<T> instance_;
+    static thread_local T* threadInstance_;
 };
 
 template<class T>
 inline std::unique_ptr<T> Singleton<T>::instance_ = nullptr;
 
+template<class T>
+inline thread_local T* Singleton<T>::threadInstance_ = nullptr;
+
 }
\ No newline at end of file
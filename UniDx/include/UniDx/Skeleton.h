@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include <SimpleMath.h>
+
+#include "UniDxDefine.h"
+#include "AnimationPose.h"
+
+namespace UniDx
+{
+
+// --------------------
+// Skin
+//
+// 1つのメッシュを変形するジョイントの並び。頂点のジョイント番号はこの並びの番号
+// --------------------
+struct Skin
+{
+    std::vector<uint16_t> joints;               // Skeleton のノードの番号
+    std::vector<Matrix>   inverseBindMatrices;  // joints と同じ順。モデル空間からジョイントの空間へ
+};
+
+
+// --------------------
+// Skeleton
+//
+// スキンが使うノードと、その親をたどったルートまでのノードを、親が子より前になる順に並べたもの。
+// ノードごとに GameObject は作らず、Animator がこの並びのままポーズを計算する。
+// 行列はモデル（Animator の GameObject）の空間で、DirectX と同じ行ベクトル。
+// --------------------
+class Skeleton
+{
+public:
+    // 1つのスキンで使えるジョイントの数。シェーダーの定数バッファの大きさと合わせる
+    static constexpr size_t MaxSkinJoints = 128;
+
+    // スキンのジョイント1つあたりの float4 の数
+    static constexpr size_t PaletteRowsPerJoint = 3;
+
+    std::vector<std::string> names;
+    std::vector<int32_t>     parents;       // 親のノードの番号。ルートは -1
+    std::vector<int32_t>     sourceNodes;   // 読み込み元（glTF）のノードの番号
+    std::vector<Skin>        skins;
+
+    size_t size() const { return parents.size(); }
+
+    // ノードを末尾に足す。parent は足したノードより前の番号か -1
+    size_t addNode(const std::string& name, int32_t parent, int32_t sourceNode,
+        const Vector3& position, const Quaternion& rotation, const Vector3& scale);
+
+    // 読み込んだときの姿勢
+    const AnimationPose& getRestPose() const { return restPose_; }
+
+    // ノードのローカルの姿勢から、モデル空間の行列を計算する。out は size() 個
+    void computeModelMatrices(const AnimationPose& pose, Matrix* out) const;
+
+    // skin のジョイントの変形の行列を、転置した3行（float4 × PaletteRowsPerJoint）で out に書き出す
+    // model は computeModelMatrices の結果。書き出したジョイントの数を返す（MaxSkinJoints まで）
+    size_t computeSkinPalette(size_t skin, const Matrix* model, Vector4* out) const;
+
+    // 名前や読み込み元のノードの番号からノードの番号を探す。なければ -1
+    int32_t find(std::string_view name) const;
+    int32_t findSourceNode(int32_t sourceNode) const;
+
+private:
+    AnimationPose restPose_;
+};
+
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "Renderer.h"
+
+namespace UniDx {
+
+class Animator;
+
+// --------------------
+// SkinnedMeshRendererクラス
+//
+// Animator が計算したスキンのジョイントの行列で、頂点シェーダーで頂点を動かして描画する。
+// 行列は描画ごとに定数バッファのリングからスロット2番に切り出して送る。
+// 頂点は Animator の Transform の空間に動かすので、ワールド行列は Animator の Transform を使う。
+// 境界は RecalculateBounds を呼んだときのポーズのものを boundsScale 倍に広げて、動いてもカリングされにくくする。
+// --------------------
+class SkinnedMeshRenderer : public MeshRenderer
+{
+public:
+    // ジョイントの行列を計算する Animator
+    Animator* animator = nullptr;
+
+    // Animator の Skeleton の何番目のスキンを使うか
+    uint32_t skinIndex = 0;
+
+    // 初期姿勢の境界を広げる倍率
+    float boundsScale = 1.5f;
+
+    virtual void Render(const Camera& camera) const override;
+
+    virtual bool getLocalBounds(Bounds& bounds) const override;
+
+    // 今のポーズで頂点を動かして境界を計算する。呼ぶまではメッシュの境界を使う
+    void RecalculateBounds();
+
+    // 描画ごとにジョイントの行列が違うので、インスタンス描画ではまとめない
+    virtual const SubMesh* getInstanceSubMesh() const override { return nullptr; }
+
+protected:
+    mutable ComPtr<ID3D11Buffer> skinConstants_;    // 定数バッファのリングが使えないときだけ作る
+    mutable UINT                 skinConstantsSize_ = 0;
+    Bounds                       skinnedBounds_;
+    bool                         hasSkinnedBounds_ = false;
+
+    // ジョイントの行列をスロット2番に送る。送れなければ false
+    bool uploadSkinConstants() const;
+};
+
+} // namespace UniDx
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace UniDx
+{
+
+// --------------------
+// SourceStamp
+//
+// 書き出したファイル（.umesh や .dds）が元にしたファイルの大きさ・更新時刻・内容のハッシュ。
+// 読み込むときに元のファイルと比べて、変わっていたら書き出したファイルを使わない。
+// --------------------
+struct SourceStamp
+{
+    uint64_t size = 0;
+    int64_t  time = 0;
+    uint64_t hash = 0;
+};
+
+// 内容のハッシュ（8バイトずつの FNV-1a）
+uint64_t HashSourceContent(const void* data, size_t size);
+
+// 元のファイルの大きさ・更新時刻・内容のハッシュ。読めなければ false
+bool GetSourceStamp(const std::wstring& sourcePath, SourceStamp& stamp);
+
+// 元のファイルが stamp のときから変わっていないか。元のファイルがなければ true
+bool IsSourceUnchanged(const std::wstring& sourcePath, const SourceStamp& stamp);
+
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <span>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+
+
+namespace UniDx
+{
+
+// --------------------
+// StridedView
+//
+// メモリ上に stride バイトおきに並んだ T の列を、コピーせずに読むためのビュー。
+// 頂点の属性が交互に並んだバッファ（インターリーブ）の1つの属性だけを見るときに使う。
+// 要素はそろっていない場所にあってもよいので、読むときは1つずつ値で返す。
+// 詰めて並んでいてそろっていれば asSpan で std::span としてそのまま使える。
+// --------------------
+template<typename T>
+class StridedView
+{
+public:
+    StridedView() = default;
+    StridedView(const void* data, size_t count, size_t stride) :
+        data_(static_cast<const uint8_t*>(data)), count_(count), stride_(stride)
+    {
+    }
+
+    size_t size() const { return count_; }
+    size_t stride() const { return stride_; }
+    bool empty() const { return count_ == 0; }
+    const void* data() const { return data_; }
+
+    T operator[](size_t i) const
+    {
+        assert(i < count_);
+        T value;
+        std::memcpy(&value, data_ + i * stride_, sizeof(T));
+        return value;
+    }
+
+    // 詰めて並んでいて、T のそろえの位置にあるか
+    bool isContiguous() const
+    {
+        return stride_ == sizeof(T) && reinterpret_cast<uintptr_t>(data_) % alignof(T) == 0;
+    }
+
+    // isContiguous のときだけ使える
+    std::span<const T> asSpan() const
+    {
+        assert(isContiguous());
+        return std::span<const T>(reinterpret_cast<const T*>(data_), count_);
+    }
+
+    // dst に詰めてコピーする。dst は size() 個以上
+    void copyTo(std::span<T> dst) const
+    {
+        assert(dst.size() >= count_);
+        if (stride_ == sizeof(T))
+        {
+            std::memcpy(dst.data(), data_, count_ * sizeof(T));
+            return;
+        }
+        for (size_t i = 0; i < count_; ++i)
+        {
+            std::memcpy(&dst[i], data_ + i * stride_, sizeof(T));
+        }
+    }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t count_ = 0;
+    size_t stride_ = 0;
+};
+
+}
@@ -6,17 +6,23 @@
 
 #include "Component.h"
 #include "Shader.h"
+#include "TextureCache.h"
 
 
 namespace UniDx {
 
 class Camera;
+class MappedFile;
 
 // --------------------
 // Textureクラス
+//
+// TextureStreamer があれば、書き出した DDS はマップしたまま登録し、ミップを必要な分だけ GPU に置く。
 // --------------------
 class Texture : public Object
 {
+    friend class TextureStreamer;
+
 public:
     Texture() : Object([this]() {return fileName; }),
         wrapModeU(D3D11_TEXTURE_ADDRESS_CLAMP),
@@ -24,10 +30,30 @@ public:
         m_info()
     {
     }
+    ~Texture();
 
     // 画像ファイルを読み込む
     bool Load(const std::wstring& filePath);
 
+    // 画像ファイルを読み込む。同じファイルとラップモードのものは AssetCache で共有する
+    // 読み込めなければ nullptr。共有するので、返したものの設定は変えないこと
+    static std::shared_ptr<Texture> LoadShared(const std::wstring& filePath,
+        D3D11_TEXTURE_ADDRESS_MODE wrapU = D3D11_TEXTURE_ADDRESS_CLAMP,
+        D3D11_TEXTURE_ADDRESS_MODE wrapV = D3D11_TEXTURE_ADDRESS_CLAMP);
+
+    // 画像ファイルを読み込んでミップマップまで作っておく。GPU を使わないので、ワーカースレッドから呼んでよい
+    // 書き出したブロック圧縮の DDS（TextureCache）があれば、デコードせずにそちらを読む
+    bool Decode(const std::wstring& filePath);
+
+    // 画像ファイルからミップを作ってブロック圧縮し、TextureCache の DDS に書き出す。GPU は使わない
+    static bool Cook(const std::wstring& filePath, TextureCache::Format format = TextureCache::Format::Auto);
+
+    // Decode した画像から GPU のリソースを作る。メインスレッドで呼ぶ
+    bool Upload();
+
+    // Decode した画像のバイト数
+    size_t getDecodedSize() const { return decoded_ != nullptr ? decoded_->GetPixelsSize() : 0; }
+
     void setForRender() const;
 
     D3D11_TEXTURE_ADDRESS_MODE wrapModeU;
@@ -42,6 +68,22 @@ protected:
 
     // 画像情報
     DirectX::TexMetadata m_info;
+
+    // Decode した画像。Upload で GPU に送ったら捨てる
+    std::unique_ptr<DirectX::ScratchImage> decoded_;
+
+    // DDS をそのまま読む
+    bool loadDDS(const std::wstring& ddsPath, const std::wstring& filePath);
+
+    // DDS をマップして、Upload で TextureStreamer に登録する。ブロック圧縮でなければ false
+    bool mapDDS(const std::wstring& ddsPath, const std::wstring& filePath);
+
+    // Decode でマップした DDS。Upload で TextureStreamer に渡す
+    std::shared_ptr<MappedFile> streamFile_;
+    TextureCache::Layout streamLayout_;
+
+    // TextureStreamer（TextureResidency）の中での番号。登録されていなければ -1
+    int32_t streamIndex_ = -1;
 };
 
 
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+#include <d3d11.h>
+
+#include "UniDxDefine.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// TextureCache
+//
+// 画像ファイルからミップまで作ってブロック圧縮した DDS ファイル。元のファイルの隣に「元の名前.dds」で置く。
+// Texture は、元が変わっていなければ画像をデコードせずにこちらを読み、そのまま GPU に送る。
+// DDS の予約領域に元のファイルの大きさ・更新時刻・内容のハッシュを書いておき、元が変わっていたら使わない。
+// 普通の DDS なので、ほかのツールでも開ける。
+// --------------------
+class TextureCache
+{
+public:
+    static constexpr uint32_t Magic = 0x54584455;   // "UDXT"
+    static constexpr uint32_t Version = 1;
+
+    enum class Format
+    {
+        Auto,   // 透明なところがあれば BC3、なければ BC1
+        BC1,
+        BC3,
+        BC7,    // DirectXTex で圧縮する。Encode では扱えない
+    };
+
+    // sourcePath から書き出すファイルのパス
+    static std::wstring GetCachePath(const std::wstring& sourcePath);
+
+    // cachePath が書き出したファイルで、元のファイルが変わっていないか
+    // 元のファイルがなければ、書き出したときのものとして使う
+    static bool IsValid(const std::wstring& cachePath, const std::wstring& sourcePath);
+
+    // RGBA8 の画像から 1×1 までのミップを作り、それぞれを BC1 か BC3 に圧縮する。CPU だけで行う
+    // srgb なら色を線形にしてミップを作り、sRGB の形式にする
+    static bool Encode(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, bool srgb, Format format,
+        DXGI_FORMAT& outFormat, std::vector< std::vector<uint8_t> >& mips);
+
+    // 圧縮したミップを DDS に書き出す。mips は大きい順
+    static bool Write(const std::wstring& cachePath, const std::wstring& sourcePath, DXGI_FORMAT format,
+        uint32_t width, uint32_t height, const std::vector< std::vector<uint8_t> >& mips);
+
+    // 1×1 までのミップの数
+    static uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+    // ブロック圧縮の DDS の中身の並び
+    struct Layout
+    {
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        uint32_t    width = 0;
+        uint32_t    height = 0;
+        uint32_t    mipCount = 0;
+        uint32_t    blockBytes = 0;     // 4×4 画素のバイト数
+        size_t      dataOffset = 0;     // ファイルの先頭から 0 番のミップまでのバイト数
+
+        uint32_t getMipWidth(uint32_t level) const { return (std::max)(1u, width >> level); }
+        uint32_t getMipHeight(uint32_t level) const { return (std::max)(1u, height >> level); }
+
+        // level のミップの1行（4画素分）のバイト数と、全体のバイト数
+        uint32_t getRowPitch(uint32_t level) const { return (getMipWidth(level) + 3) / 4 * blockBytes; }
+        size_t getMipSize(uint32_t level) const { return size_t(getRowPitch(level)) * ((getMipHeight(level) + 3) / 4); }
+
+        // ファイルの先頭から level のミップまでのバイト数
+        size_t getMipOffset(uint32_t level) const;
+
+        // level から一番粗いミップまでのバイト数
+        size_t getSizeFrom(uint32_t level) const;
+    };
+
+    // DDS の先頭から並びを読む。ブロック圧縮の 2D テクスチャでなければ、またはファイルが短ければ false
+    static bool ReadLayout(const uint8_t* data, size_t size, Layout& layout);
+};
+
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace UniDx
+{
+
+// --------------------
+// TextureCompression
+//
+// RGBA8 の画像を GPU がそのまま読めるブロック圧縮の形式にする。CPU だけで行う。
+//   BC1 : 4×4 画素を 8 バイト。アルファなし             DXGI_FORMAT_BC1_UNORM
+//   BC3 : 4×4 画素を 16 バイト。アルファ 8 バイト + BC1   DXGI_FORMAT_BC3_UNORM
+// 色はブロックの主軸の両端を端点にして、各画素に近い補間色を選んだあと、端点を最小二乗で合わせ直す。
+// 画素は r, g, b, a の順に 4 バイト。画像の端で 4 画素に足りないブロックは端の画素を繰り返す。
+// --------------------
+
+// 4×4 画素（64 バイト、行ごと）を圧縮する
+void EncodeBC1Block(const uint8_t* rgba, uint8_t* dst);
+void EncodeBC3Block(const uint8_t* rgba, uint8_t* dst);
+
+// 圧縮したブロックを 4×4 画素に戻す。BC1 は 4 色のモードだけ
+void DecodeBC1Block(const uint8_t* src, uint8_t* rgba);
+void DecodeBC3Block(const uint8_t* src, uint8_t* rgba);
+
+// 画像全体を圧縮する。dst は GetCompressedSize のバイト数
+void CompressBC1(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* dst);
+void CompressBC3(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* dst);
+
+// 圧縮した画像のバイト数。blockBytes は BC1 なら 8、BC3 なら 16
+size_t GetCompressedSize(uint32_t width, uint32_t height, size_t blockBytes);
+
+// 縦横半分（1 より小さくはしない）にした画像を作る。2×2 画素の平均
+// srgb なら色を線形にしてから平均する。dst の行は詰めて書く
+void DownsampleRGBA8(const uint8_t* src, uint32_t width, uint32_t height, size_t rowPitch, bool srgb, uint8_t* dst);
+
+// アルファが 255 でない画素があるか
+bool HasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch);
+
+}
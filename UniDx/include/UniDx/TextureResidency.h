@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace UniDx
+{
+
+// --------------------
+// TextureResidency
+//
+// ストリーミングするテクスチャのうち、どれのどのミップを GPU に置くかを決める。GPU には触らない。
+// 粗いミップ（tailSize 以下）は常に置き、残りの予算を最近使われた順、同じなら画面で大きい順に割り当てる。
+// 予算からはみ出したもの、しばらく使われないものは Uploader::evict で粗くし、
+// 細かくするものは優先する順に Uploader::load で読み込みを始める。
+// 登録したテクスチャは番号で指す。番号は登録を解除するまで変わらない。
+// --------------------
+class TextureResidency
+{
+public:
+    struct Settings
+    {
+        size_t   budgetBytes = 256 * 1024 * 1024;  // GPU に置くテクスチャのバイト数
+        uint32_t tailSize = 64;                     // この大きさ以下のミップは常に置いておく
+        uint32_t maxLoadsInFlight = 4;              // 同時に読み込むテクスチャの数
+        uint32_t keepFrames = 60;                   // この間使われなければ粗いミップだけに戻す
+        float    mipBias = 0.0f;                    // 選ぶミップをずらす。正の値で粗くなる
+    };
+
+    struct Stats
+    {
+        size_t   residentBytes = 0;     // GPU に置いているバイト数
+        size_t   textureCount = 0;      // 登録されているテクスチャの数
+        uint32_t loadsInFlight = 0;     // 読み込み中の数
+        uint64_t loads = 0;             // 細かいミップを読み込んだ回数
+        uint64_t evictions = 0;         // 粗いミップに戻した回数
+        uint64_t bytesLoaded = 0;       // 読み込みで GPU に送ったバイト数
+    };
+
+    // 置くミップを変える先。TextureStreamer が GPU のテクスチャで実装する
+    class Uploader
+    {
+    public:
+        virtual ~Uploader() {}
+
+        // id を mip から先だけにする。その場で終える。できなければ false
+        virtual bool evict(uint32_t id, uint32_t mip) = 0;
+
+        // id の mip から先の読み込みを始める。終わったら finishLoad を呼び、true なら作って completeLoad を呼ぶ
+        virtual void load(uint32_t id, uint32_t mip) = 0;
+    };
+
+    Settings& getSettings() { return settings_; }
+
+    // width × height で mipCount 段のテクスチャを登録し、番号を返す
+    // mipBytes は大きい順のミップごとのバイト数。粗いミップ（getTailMip）は置いてあるものとして数える
+    uint32_t add(uint32_t width, uint32_t height, std::vector<size_t> mipBytes);
+    void remove(uint32_t id);
+
+    // id が画面上で screenPixels 画素ほどの大きさで描かれる。同じフレームで何度も呼ばれたら一番大きいもの
+    void request(uint32_t id, float screenPixels);
+
+    // 置くミップを決め直し、粗くするものと、細かくするものの読み込みを uploader に頼む。毎フレーム呼ぶ
+    void update(Uploader& uploader);
+
+    // load で始めた読み込みが終わった。まだその mip が要るなら true
+    bool finishLoad(uint32_t id, uint32_t mip);
+
+    // finishLoad の後、mip から先を GPU に置いた
+    void completeLoad(uint32_t id, uint32_t mip);
+
+    // width × height で mipCount 段のテクスチャを、画面上で screenPixels 画素に描くときのミップ
+    static uint32_t ChooseMip(uint32_t width, uint32_t height, uint32_t mipCount, float screenPixels, float bias);
+
+    uint32_t getTailMip(uint32_t id) const { return entries_[id].tailMip; }
+    uint32_t getResidentMip(uint32_t id) const { return entries_[id].residentMip; }
+    uint32_t getTargetMip(uint32_t id) const { return entries_[id].targetMip; }
+
+    // 今のフレーム。update のたびに進む
+    uint64_t getFrame() const { return frame_; }
+
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        uint32_t            width = 0;
+        uint32_t            height = 0;
+        std::vector<size_t> sizeFrom;       // そのミップから一番粗いミップまでのバイト数
+        uint32_t            tailMip = 0;
+        uint32_t            residentMip = 0;
+        uint32_t            targetMip = 0;
+        uint64_t            lastUsedFrame = 0;
+        float               screenPixels = 0.0f;
+        bool                loading = false;
+        bool                active = false;     // 登録を解除したら false。読み込み中なら終わるまで番号を空けない
+    };
+
+    Settings settings_;
+    Stats    stats_;
+    std::vector<Entry>    entries_;     // 番号の順
+    std::vector<uint32_t> free_;        // 空いている番号
+    std::vector<uint32_t> order_;       // 登録されている番号。update で優先する順に並べる
+    uint64_t frame_ = 0;
+
+    // 予算の範囲で置くミップを決める
+    void assignTargets();
+
+    // id が mip から先を置くようになった
+    void setResident(Entry& entry, uint32_t mip);
+};
+
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+#include "TextureCache.h"
+#include "TextureResidency.h"
+
+namespace UniDx
+{
+
+class Texture;
+class MappedFile;
+class RenderDevice;
+
+// --------------------
+// TextureStreamer
+//
+// 書き出したブロック圧縮の DDS（TextureCache）をマップしておき、細かいミップを必要な分だけ GPU に置く。
+// 登録したときは粗いミップ（tailSize 以下）だけを作り、Renderer が見積もった画面上の大きさで
+// 必要なミップを決めて、細かいものはワーカースレッドでページを読み込んでからメインスレッドで作り直す。
+// どのミップを置くか（予算・最近使われた順・画面の大きさ）は TextureResidency が決め、ここは GPU のテクスチャを作るだけ。
+// D3D11 ではミップ単位で確保と解放ができないので、置くミップが変わるたびにテクスチャを作り直して入れ替える。
+// --------------------
+class TextureStreamer : public Singleton<TextureStreamer>, private TextureResidency::Uploader
+{
+public:
+    using Settings = TextureResidency::Settings;
+    using Stats = TextureResidency::Stats;
+
+    Settings& getSettings() { return residency_.getSettings(); }
+
+    // texture を登録し、粗いミップだけのリソースを作って texture に持たせる。メインスレッドで呼ぶ
+    // file は layout の DDS をマップしたもの。作れなければ false
+    bool registerTexture(Texture* texture, std::shared_ptr<MappedFile> file, const TextureCache::Layout& layout);
+    void unregisterTexture(Texture* texture);
+
+    // texture が画面上で screenPixels 画素ほどの大きさで描かれる。描画のたびに呼ぶ
+    void requestTexture(Texture* texture, float screenPixels);
+
+    // 置くミップを決め直し、粗くするものは作り直し、細かくするものは読み込みを始める。毎フレーム、メインスレッドで呼ぶ
+    void update();
+
+    // texture の今 GPU にある一番細かいミップと、置こうとしているミップ。登録されていなければ -1
+    int32_t getResidentMip(const Texture* texture) const;
+    int32_t getTargetMip(const Texture* texture) const;
+
+    Stats getStats() const { return residency_.getStats(); }
+
+    // リソースを作る先。nullptr なら D3DManager のもの
+    void setDevice(RenderDevice* device) { device_ = device; }
+
+private:
+    struct Stream
+    {
+        Texture*                    texture = nullptr;  // 登録を解除したら nullptr
+        std::shared_ptr<MappedFile> file;
+        TextureCache::Layout        layout;
+        ComPtr<ID3D11Texture2D>     resource;
+    };
+
+    TextureResidency residency_;
+    std::vector< std::shared_ptr<Stream> > streams_;  // TextureResidency の番号（Texture::streamIndex_）の順
+    RenderDevice* device_ = nullptr;
+
+    RenderDevice& getDevice() const;
+
+    // TextureResidency::Uploader
+    virtual bool evict(uint32_t id, uint32_t mip) override;
+    virtual void load(uint32_t id, uint32_t mip) override;
+
+    // stream の mip から先をマップしたファイルから作って入れ替える
+    bool createFromFile(Stream& stream, uint32_t mip);
+
+    // stream の residentMip から先のリソースの、mip から先を GPU 上でコピーして作り、入れ替える
+    bool shrink(Stream& stream, uint32_t residentMip, uint32_t mip);
+
+    // resource の SRV を作って texture に持たせる
+    bool replace(Stream& stream, ComPtr<ID3D11Texture2D> resource);
+};
+
+}
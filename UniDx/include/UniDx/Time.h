@@ -6,50 +6,80 @@ namespace UniDx
 {
 
 // Time情報
+// 値は Clock にまとめてあり、HeadlessEngine はエンジンごとの Clock を
+// そのエンジンのスレッドと JobSystem のワーカーに setThreadClock で設定する
 class Time
 {
 public:
-    static inline int frameCount = 0;
+    struct Clock
+    {
+        int    frameCount = 0;
+        float  fixedDeltaTime = 0.01667f;
+        float  time = 0.0f;
+        float  timeScale = 1.0f;
+        float  unscaledTime = 0.0f;
+        float  unscaledDeltaTime = 0.0f;
+        double realDeltaTime = 0.0;
+    };
+
+private:
+    static inline thread_local Clock* threadClock_ = nullptr;
+
+    // スレッドに設定した Clock がなければ共通の Clock
+    static Clock& clock()
+    {
+        static Clock global;
+        return threadClock_ != nullptr ? *threadClock_ : global;
+    }
+
+public:
+    static inline Property<int> frameCount = Property<int>([]() { return clock().frameCount; }, [](const int& v) { clock().frameCount = v; });
 
-    static inline float fixedDeltaTime = 0.01667f;
+    static inline Property<float> fixedDeltaTime = Property<float>([]() { return clock().fixedDeltaTime; }, [](const float& v) { clock().fixedDeltaTime = v; });
 
-    static inline float time = 0.0f;
+    static inline Property<float> time = Property<float>([]() { return clock().time; }, [](const float& v) { clock().time = v; });
 
-    static inline float timeScale = 1.0f;
+    static inline Property<float> timeScale = Property<float>([]() { return clock().timeScale; }, [](const float& v) { clock().timeScale = v; });
 
-    static inline float unscaledTime = 0.0f;
+    static inline Property<float> unscaledTime = Property<float>([]() { return clock().unscaledTime; }, [](const float& v) { clock().unscaledTime = v; });
 
-    static inline float unscaledDeltaTime = 0.0f;
+    static inline Property<float> unscaledDeltaTime = Property<float>([]() { return clock().unscaledDeltaTime; }, [](const float& v) { clock().unscaledDeltaTime = v; });
 
-    static inline ReadOnlyProperty<float> deltaTime = ReadOnlyProperty<float>([]() { return unscaledDeltaTime * timeScale; });
+    static inline ReadOnlyProperty<float> deltaTime = ReadOnlyProperty<float>([]() { return clock().unscaledDeltaTime * clock().timeScale; });
+
+    // 呼んだスレッドで使う Clock を設定する。nullptr で共通の Clock に戻す
+    // clock の所有権は呼び出し側が持つ
+    static void setThreadClock(Clock* clock) { threadClock_ = clock; }
 
     static void Start()
     {
-        frameCount = 0;
-        time = 0.0f;
-        timeScale = 1.0f;
+        Clock& c = clock();
+        c.frameCount = 0;
+        c.time = 0.0f;
+        c.timeScale = 1.0f;
     }
 
     static void SetDeltaTimeFixed()
     {
-        unscaledDeltaTime = fixedDeltaTime;
+        Clock& c = clock();
+        c.unscaledDeltaTime = c.fixedDeltaTime;
     }
 
     static void SetDeltaTimeFrame()
     {
-        unscaledDeltaTime = float(realDeltaTime);
+        Clock& c = clock();
+        c.unscaledDeltaTime = float(c.realDeltaTime);
     }
 
     static void UpdateFrame(double rt)
     {
-        realDeltaTime = rt;
-        frameCount++;
-        time = float(time + rt * timeScale);
-        unscaledTime += float(rt);
+        Clock& c = clock();
+        c.realDeltaTime = rt;
+        c.frameCount++;
+        c.time = float(c.time + rt * c.timeScale);
+        c.unscaledTime += float(rt);
     }
 
-private:
-    static inline double realDeltaTime;
 };
 
 }
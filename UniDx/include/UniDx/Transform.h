@@ -6,6 +6,7 @@
 #include "UniDxDefine.h"
 #include "Component.h"
 #include "GameObject.h"
+#include "TransformBatch.h"
 
 using namespace DirectX::SimpleMath;
 
@@ -31,7 +32,8 @@ public:
 
     const GameObjectContainer& getChildGameObjects() { return children; }
 
-    // 親の変更
+    // 親の変更。newParent が nullptr ならシーンのルートに移す
+    // 更新処理中は SceneCommandBuffer::setParent で同期点まで遅らせること
     GameObject* SetParent(Transform* newParent);
 
     // 親のいないTransformを持つGameObjectに親を設定
@@ -45,10 +47,10 @@ public:
 
     // ローカル行列
     const Matrix& GetLocalMatrix() const {
-        if (m_dirty) {
-            m_localMatrix = Matrix::CreateScale(_localScale)
-                * Matrix::CreateFromQuaternion(_localRotation)
-                * Matrix::CreateTranslation(_localPosition);
+        if (m_localDirty) {
+            ComposeTRS(&_localPosition.x, &_localRotation.x, &_localScale.x,
+                reinterpret_cast<float*>(&m_localMatrix));
+            m_localDirty = false;
         }
         return m_localMatrix;
     }
@@ -59,26 +61,29 @@ public:
         return m_worldMatrix;
     }
 
+    // ワールド行列を再計算するたびに進むバージョン
+    uint32_t getWorldVersion() const { return m_worldVersion; }
+
     Transform()
         : localPosition(
             // getter
             [this]() { return _localPosition; },
             // setter
-            [this](Vector3 v) { _localPosition = v; m_dirty = true; }
+            [this](Vector3 v) { _localPosition = v; markDirty(); }
         ),
         localRotation(
             [this]() { return _localRotation; },
-            [this](Quaternion q) { _localRotation = q; m_dirty = true; }
+            [this](Quaternion q) { _localRotation = q; markDirty(); }
         ),
         localScale(
             [this]() { return _localScale; },
-            [this](Vector3 v) { _localScale = v; m_dirty = true; }
+            [this](Vector3 v) { _localScale = v; markDirty(); }
         ),
         position(
             // getter: グローバル座標
             [this]() {
                 updateMatrices();
-                return m_worldMatrix.Translation();
+                return m_worldPosition;
             },
             // setter: グローバル座標からlocalPositionを逆算
             [this](Vector3 worldPos) {
@@ -89,32 +94,27 @@ public:
                 } else {
                     _localPosition = worldPos;
                 }
-                m_dirty = true;
+                markDirty();
             }
         ),
         rotation(
             [this]() {
+                // 行列更新時にキャッシュしたワールド回転を返す
                 updateMatrices();
-                // ワールド行列からクォータニオンを取得
-                Vector3 s, t;
-                Quaternion q;
-                m_worldMatrix.Decompose(s, q, t);
-                return q;
+                return m_worldRotation;
             },
             [this](Quaternion worldRot) {
                 if (parent) {
                     parent->updateMatrices();
                     // 親のワールド回転の逆を掛けてローカル回転を算出
-                    Quaternion parentWorldRot, parentWorldRotInv;
-                    Vector3 s, t;
-                    parent->m_worldMatrix.Decompose(s, parentWorldRot, t);
-                    parentWorldRot.Inverse(parentWorldRotInv);
-                    _localRotation = Quaternion::Concatenate(worldRot, parentWorldRotInv);
+                    Quaternion parentWorldRotInv;
+                    parent->m_worldRotation.Inverse(parentWorldRotInv);
+                    _localRotation = worldRot * parentWorldRotInv;
                 }
                 else {
                     _localRotation = worldRot;
                 }
-                m_dirty = true;
+                markDirty();
             }
         )
     {
@@ -142,12 +142,24 @@ public:
     }
 
 private:
+    friend class TransformHierarchy;
+    friend class Scene;
+    friend class SceneCommandBuffer;
+
     // ダーティフラグと行列
-    mutable bool m_dirty = true;
+    // m_dirty が立っている Transform の子孫はすべて m_dirty が立っている。
+    // そのため m_dirty が立っていなければ、親をたどらずにキャッシュを使える
+    mutable bool m_dirty = true;        // ワールド行列の再計算が必要
+    mutable bool m_localDirty = true;   // ローカル行列の再計算が必要
     mutable Matrix m_localMatrix = Matrix::Identity;
     mutable Matrix m_worldMatrix = Matrix::Identity;
 
-    bool dirtyInHierarchy() const { return m_dirty || parent && parent->dirtyInHierarchy(); }
+    // 行列と一緒に更新するワールド姿勢のキャッシュ
+    mutable Vector3 m_worldPosition{ 0,0,0 };
+    mutable Quaternion m_worldRotation = Quaternion::Identity;
+    mutable bool m_uniformScale = true;     // ワールド行列のスケールが正の一様か
+
+    mutable uint32_t m_worldVersion = 0;    // ワールド行列を再計算するたびに進む
 
     Vector3 _localPosition{ 0,0,0 };
     Quaternion _localRotation = Quaternion::Identity;
@@ -157,8 +169,30 @@ private:
     // トップ以外のGameObjectはTransformによって保持される
     GameObjectContainer children;
 
+    // ローカル姿勢の変更を記録
+    void markDirty()
+    {
+        m_localDirty = true;
+        markWorldDirty();
+    }
+
+    // 自分と子孫のワールド行列を再計算が必要にする
+    void markWorldDirty();
+
+    // 親子関係の変更を TransformHierarchy に伝える
+    static void markStructureChanged();
+
+    // 親のTransform（ルートならシーン）から自分のGameObjectを所有権ごと取り出す
+    unique_ptr<GameObject> releaseFromParent();
+
     // 行列の更新
     void updateMatrices() const;
+
+    // 親のワールド行列が確定している前提でワールド行列を再計算
+    void recomputeWorld() const;
+
+    // ワールド行列を計算した後で、ワールド回転とスケールが一様かを更新する
+    void updateWorldRotation() const;
 };
 
 } // namespace UniDx
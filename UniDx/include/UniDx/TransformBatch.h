@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace UniDx
+{
+
+// --------------------
+// TransformBatch
+//
+// 位置・回転・スケールから行列を直接組み立て、親のワールド行列を掛ける。
+// CreateScale * CreateFromQuaternion * CreateTranslation の3回の4x4乗算を
+// 1回の合成にまとめ、複数の Transform をまとめて処理する。
+// 行列は DirectX と同じ行優先（行ベクトル）で、1つあたり float 16個。
+// SimpleMath に依存しないので、GPUやウィンドウなしでも単体で動かせる。
+// --------------------
+
+// バッチ計算の入力（SoA）
+struct TransformBatchInput
+{
+    const float* px; const float* py; const float* pz;
+    const float* qx; const float* qy; const float* qz; const float* qw;
+    const float* sx; const float* sy; const float* sz;
+    const float* const* parentWorld;    // 親のワールド行列。nullptr ならルート
+};
+
+
+// 1つ分の TRS からローカル行列を作る
+inline void ComposeTRS(const float* p, const float* q, const float* s, float* out)
+{
+    const float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+    const float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+    const float xw = q[0] * q[3], yw = q[1] * q[3], zw = q[2] * q[3];
+
+    out[0]  = (1.0f - 2.0f * (yy + zz)) * s[0];
+    out[1]  = 2.0f * (xy + zw) * s[0];
+    out[2]  = 2.0f * (xz - yw) * s[0];
+    out[3]  = 0.0f;
+    out[4]  = 2.0f * (xy - zw) * s[1];
+    out[5]  = (1.0f - 2.0f * (xx + zz)) * s[1];
+    out[6]  = 2.0f * (yz + xw) * s[1];
+    out[7]  = 0.0f;
+    out[8]  = 2.0f * (xz + yw) * s[2];
+    out[9]  = 2.0f * (yz - xw) * s[2];
+    out[10] = (1.0f - 2.0f * (xx + yy)) * s[2];
+    out[11] = 0.0f;
+    out[12] = p[0];
+    out[13] = p[1];
+    out[14] = p[2];
+    out[15] = 1.0f;
+}
+
+
+// count 個の Transform のローカル行列とワールド行列をまとめて計算
+// 親のワールド行列は呼び出し前に確定していること（同じバッチ内の要素を親にしない）
+// AVX2/FMA が使えるCPUでは8個ずつ、それ以外はスカラーで計算する
+void ComposeLocalToWorldBatch(const TransformBatchInput& in, size_t count, float* localOut, float* worldOut);
+
+// スカラー版（比較・フォールバック用）
+void ComposeLocalToWorldBatchScalar(const TransformBatchInput& in, size_t count, float* localOut, float* worldOut);
+
+// AVX2/FMA 版が使われるかどうか
+bool IsTransformBatchAvx2Enabled();
+
+
+// --------------------
+// TransformBatchBuffer
+// バッチ入力用のSoA作業領域。容量は使い回す
+// --------------------
+struct TransformBatchBuffer
+{
+    std::vector<float> px, py, pz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> sx, sy, sz;
+    std::vector<const float*> parentWorld;
+    std::vector<float> local;   // 16 * count
+    std::vector<float> world;   // 16 * count
+
+    void resize(size_t n)
+    {
+        px.resize(n); py.resize(n); pz.resize(n);
+        qx.resize(n); qy.resize(n); qz.resize(n); qw.resize(n);
+        sx.resize(n); sy.resize(n); sz.resize(n);
+        parentWorld.resize(n);
+        local.resize(n * 16);
+        world.resize(n * 16);
+    }
+
+    void set(size_t i, const float* p, const float* q, const float* s, const float* parent)
+    {
+        px[i] = p[0]; py[i] = p[1]; pz[i] = p[2];
+        qx[i] = q[0]; qy[i] = q[1]; qz[i] = q[2]; qw[i] = q[3];
+        sx[i] = s[0]; sy[i] = s[1]; sz[i] = s[2];
+        parentWorld[i] = parent;
+    }
+
+    TransformBatchInput input() const
+    {
+        return TransformBatchInput{
+            px.data(), py.data(), pz.data(),
+            qx.data(), qy.data(), qz.data(), qw.data(),
+            sx.data(), sy.data(), sz.data(),
+            parentWorld.data() };
+    }
+
+    // まとめて計算
+    void compose(size_t n)
+    {
+        ComposeLocalToWorldBatch(input(), n, local.data(), world.data());
+    }
+};
+
+}
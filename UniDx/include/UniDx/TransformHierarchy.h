@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+#include "TransformBatch.h"
+
+namespace UniDx
+{
+
+class Scene;
+class Transform;
+
+// --------------------
+// TransformHierarchy
+//
+// シーン内の Transform を親が子より先に来る順に並べた配列で持ち、
+// 1フレームに1回、親から順にまとめてワールド行列を確定させる。
+// 確定後の position / rotation の読み出しは親をたどらずにキャッシュから返る。
+// 同じ深さの更新が必要な Transform を集めて TransformBatch でまとめて計算する。
+//
+// 並列モードでは、ルートごと（大きすぎるものはその子ごと）の独立した部分木を
+// ノード数で見積もってスレッド数のグループに振り分け、JobSystem で並列に計算する。
+// 分割した部分木の祖先は先にメインスレッドで計算する。
+// --------------------
+class TransformHierarchy : public Singleton<TransformHierarchy>
+{
+public:
+    // これより Transform が少ないシーンは並列にしない
+    static constexpr size_t ParallelMinNodes = 512;
+
+    // シーン全体のワールド行列を更新
+    void update(Scene* scene);
+
+    // 親子関係が変わったことを記録する。次の update で並び順を作り直す
+    void markStructureChanged() { structureChanged_ = true; }
+
+    // 現在の並び順で管理している Transform の数
+    size_t size() const { return nodes_.size(); }
+
+    // 並列モードの切り替え
+    void setParallel(bool parallel) { parallel_ = parallel; builtScene_ = nullptr; }
+    bool isParallel() const { return parallel_; }
+
+    // 並列に計算するグループの数（並列にしていないときは 0）
+    size_t getParallelGroupCount() const { return groups_.size() - 1; }
+
+private:
+    // 1つのスレッドで順に計算する範囲
+    struct Group
+    {
+        std::vector<size_t>           levelStart;   // 深さごとの nodes_ の開始位置（末尾は終了位置）
+        std::vector<const Transform*> batchNodes;   // バッチに詰めた Transform
+        TransformBatchBuffer          batch;
+    };
+
+    std::vector<Transform*> nodes_;         // 親が子より先に来る順に並べた Transform
+    std::vector<Group>      groups_{ 1 };   // [0] は先に計算する部分、[1～] は並列に計算する部分
+
+    bool     parallel_ = true;
+    Scene*   builtScene_ = nullptr;
+    bool     structureChanged_ = true;
+
+    // 親子関係から並び順を作り直す
+    void rebuild(Scene* scene);
+
+    // グループ内を深さ順にまとめて計算
+    void updateGroup(Group& group);
+};
+
+}
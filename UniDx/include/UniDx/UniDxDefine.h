@@ -6,7 +6,8 @@
 
 #include <d3d11.h>
 #include <wrl/client.h>
-#include <SimpleMath.h>
+
+#include "UniDxMath.h"
 
 namespace UniDx
 {
@@ -18,11 +19,6 @@ using std::shared_ptr;
 using std::make_unique;
 using std::make_shared;
 using Microsoft::WRL::ComPtr;
-using DirectX::SimpleMath::Vector3;
-using DirectX::SimpleMath::Vector2;
-using DirectX::SimpleMath::Color;
-using DirectX::XM_PI;
-using DirectX::XM_2PI;
 
 class Object;
 class GameObject;
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <SimpleMath.h>
+
+// 数学の型だけを使うヘッダー用。d3d11.h を読まない
+namespace UniDx
+{
+
+using DirectX::SimpleMath::Vector3;
+using DirectX::SimpleMath::Vector2;
+using DirectX::SimpleMath::Vector4;
+using DirectX::SimpleMath::Quaternion;
+using DirectX::SimpleMath::Matrix;
+using DirectX::SimpleMath::Color;
+using DirectX::XM_PI;
+using DirectX::XM_2PI;
+
+}
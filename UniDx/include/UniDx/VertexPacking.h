@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+#include "UniDxMath.h"
+
+
+namespace UniDx
+{
+
+// --------------------
+// VertexPacking
+//
+// 頂点の属性を GPU が読める小さい形式に詰める。
+//   位置   : 半精度 float ×4（w は 1）          DXGI_FORMAT_R16G16B16A16_FLOAT
+//   法線   : 八面体に展開した snorm16 ×2       DXGI_FORMAT_R16G16_SNORM
+//   UV     : 0～1 の unorm16 ×2               DXGI_FORMAT_R16G16_UNORM
+//   カラー : unorm8 ×4                         DXGI_FORMAT_R8G8B8A8_UNORM
+// Stream がつく関数は SSE2 でまとめて詰め、dst から stride バイトおきに書く。
+// 1つずつ詰める関数と同じ結果になる。
+// --------------------
+
+// 半精度 float。最近接偶数に丸め、範囲外は無限大にする
+uint16_t PackHalf(float value);
+float UnpackHalf(uint16_t value);
+
+// 位置を半精度 ×4 に詰める
+void PackHalf4(const Vector3& value, uint16_t* dst);
+
+// 法線を八面体に展開して snorm16 ×2 に詰める。下位16ビットが x
+uint32_t PackOctahedralNormal(const Vector3& normal);
+Vector3 UnpackOctahedralNormal(uint32_t packed);
+
+// UV を unorm16 ×2 に詰める。0～1 の外は切り詰める
+uint32_t PackUNorm16x2(const Vector2& value);
+Vector2 UnpackUNorm16x2(uint32_t packed);
+
+// カラーを unorm8 ×4 に詰める。下位8ビットが r
+uint32_t PackUNorm8x4(const Color& value);
+Color UnpackUNorm8x4(uint32_t packed);
+
+// まとめて詰める
+void PackHalf4Stream(std::span<const Vector3> src, void* dst, size_t stride);
+void PackOctahedralNormalStream(std::span<const Vector3> src, void* dst, size_t stride);
+void PackUNorm16x2Stream(std::span<const Vector2> src, void* dst, size_t stride);
+void PackUNorm8x4Stream(std::span<const Color> src, void* dst, size_t stride);
+
+// src の bytes バイトを dst にキャッシュを通さずに書き込む。書き込んだ後で読まないバッファ向け
+// dst が16バイトにそろっていなければ普通にコピーする
+void StreamStore(void* dst, const void* src, size_t bytes);
+
+}
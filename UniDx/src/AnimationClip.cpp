@@ -0,0 +1,206 @@
+﻿#include "pch.h"
+#include <UniDx/AnimationClip.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <UniDx/Skeleton.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+using Track = AnimationClip::Track;
+
+// track の time 秒の値を out に書く。width は1つのキーの成分の数
+void EvaluateTrack(const Track& track, size_t width, float time, float* out)
+{
+    const std::vector<float>& times = track.times;
+    const bool cubic = track.interpolation == Track::Interpolation::CubicSpline;
+    const size_t keyWidth = cubic ? width * 3 : width;
+    const size_t valueOffset = cubic ? width : 0;
+    auto value = [&](size_t key) { return track.values.data() + key * keyWidth + valueOffset; };
+
+    // 範囲の外は端のキー
+    if (time <= times.front())
+    {
+        std::copy_n(value(0), width, out);
+        return;
+    }
+    if (time >= times.back())
+    {
+        std::copy_n(value(times.size() - 1), width, out);
+        return;
+    }
+
+    const size_t k1 = size_t(std::upper_bound(times.begin(), times.end(), time) - times.begin());
+    const size_t k0 = k1 - 1;
+    const float dt = times[k1] - times[k0];
+    const float t = dt > 0.0f ? (time - times[k0]) / dt : 0.0f;
+    const float* v0 = value(k0);
+    const float* v1 = value(k1);
+
+    switch (track.interpolation)
+    {
+    case Track::Interpolation::Step:
+        std::copy_n(v0, width, out);
+        return;
+
+    case Track::Interpolation::CubicSpline:
+    {
+        // エルミート曲線。接線は秒あたりなのでキーの間隔を掛ける
+        const float* outTangent0 = v0 + width;
+        const float* inTangent1 = v1 - width;
+        const float t2 = t * t, t3 = t2 * t;
+        const float h00 = 2 * t3 - 3 * t2 + 1, h10 = t3 - 2 * t2 + t, h01 = -2 * t3 + 3 * t2, h11 = t3 - t2;
+        for (size_t c = 0; c < width; ++c)
+        {
+            out[c] = h00 * v0[c] + h10 * dt * outTangent0[c] + h01 * v1[c] + h11 * dt * inTangent1[c];
+        }
+        break;
+    }
+
+    default:
+        if (track.path == Track::Path::Rotation)
+        {
+            const Quaternion q = Quaternion::Slerp(Quaternion(v0[0], v0[1], v0[2], v0[3]), Quaternion(v1[0], v1[1], v1[2], v1[3]), t);
+            out[0] = q.x; out[1] = q.y; out[2] = q.z; out[3] = q.w;
+            return;
+        }
+        for (size_t c = 0; c < width; ++c)
+        {
+            out[c] = v0[c] + (v1[c] - v0[c]) * t;
+        }
+        return;
+    }
+
+    // CubicSpline の回転は正規化する
+    if (track.path == Track::Path::Rotation)
+    {
+        Quaternion q(out[0], out[1], out[2], out[3]);
+        q.Normalize();
+        out[0] = q.x; out[1] = q.y; out[2] = q.z; out[3] = q.w;
+    }
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// キーフレームから一定の間隔の姿勢を作る
+// -----------------------------------------------------------------------------
+bool AnimationClip::build(const std::string& name, const Skeleton& skeleton, std::span<const Track> tracks, float sampleRate)
+{
+    using C = AnimationPose::Channel;
+
+    float length = 0.0f;
+    bool hasKeys = false;
+    for (const Track& track : tracks)
+    {
+        if (!track.times.empty() && track.node >= 0 && size_t(track.node) < skeleton.size())
+        {
+            length = std::max(length, track.times.back());
+            hasKeys = true;
+        }
+    }
+    if (!hasKeys || !(sampleRate > 0.0f))
+    {
+        return false;
+    }
+
+    name_ = name;
+    length_ = length;
+    sampleRate_ = sampleRate;
+    nodeCount_ = skeleton.size();
+    stride_ = AnimationPose::GetStride(nodeCount_);
+    frameCount_ = size_t(std::ceil(length * sampleRate)) + 1;
+
+    // 全フレームに初期姿勢を入れてから、トラックのあるチャンネルを書き換える
+    const size_t frameSize = stride_ * AnimationPose::ChannelCount;
+    const AnimationPose& rest = skeleton.getRestPose();
+    frames_.resize(frameSize * frameCount_);
+    for (size_t f = 0; f < frameCount_; ++f)
+    {
+        std::copy_n(rest.data(), frameSize, frames_.data() + f * frameSize);
+    }
+
+    for (const Track& track : tracks)
+    {
+        if (track.times.empty() || track.node < 0 || size_t(track.node) >= nodeCount_)
+        {
+            continue;
+        }
+        const C first = track.path == Track::Path::Translation ? C::TX : track.path == Track::Path::Rotation ? C::QX : C::SX;
+        const size_t width = track.path == Track::Path::Rotation ? 4 : 3;
+        const size_t keyWidth = track.interpolation == Track::Interpolation::CubicSpline ? width * 3 : width;
+        if (track.values.size() < track.times.size() * keyWidth)
+        {
+            continue;
+        }
+
+        float value[4];
+        for (size_t f = 0; f < frameCount_; ++f)
+        {
+            EvaluateTrack(track, width, std::min(float(f) / sampleRate, length), value);
+            float* frame = frames_.data() + f * frameSize;
+            for (size_t c = 0; c < width; ++c)
+            {
+                frame[(first + c) * stride_ + track.node] = value[c];
+            }
+        }
+    }
+
+    // 隣のフレームとの回転を同じ半球に揃えておく
+    const size_t qx = C::QX * stride_, qy = C::QY * stride_, qz = C::QZ * stride_, qw = C::QW * stride_;
+    for (size_t f = 1; f < frameCount_; ++f)
+    {
+        const float* prev = frames_.data() + (f - 1) * frameSize;
+        float* frame = frames_.data() + f * frameSize;
+        for (size_t i = 0; i < nodeCount_; ++i)
+        {
+            const float dot = prev[qx + i] * frame[qx + i] + prev[qy + i] * frame[qy + i] + prev[qz + i] * frame[qz + i] + prev[qw + i] * frame[qw + i];
+            if (dot < 0.0f)
+            {
+                frame[qx + i] = -frame[qx + i];
+                frame[qy + i] = -frame[qy + i];
+                frame[qz + i] = -frame[qz + i];
+                frame[qw + i] = -frame[qw + i];
+            }
+        }
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 前後のフレームを混ぜて取り出す
+// -----------------------------------------------------------------------------
+void AnimationClip::sample(float time, bool loop, AnimationPose& out) const
+{
+    if (out.size() != nodeCount_)
+    {
+        out.resize(nodeCount_);
+    }
+    if (frameCount_ == 0)
+    {
+        return;
+    }
+
+    if (loop && length_ > 0.0f)
+    {
+        time = std::fmod(time, length_);
+        if (time < 0.0f)
+        {
+            time += length_;
+        }
+    }
+    const float position = std::clamp(time, 0.0f, length_) * sampleRate_;
+    const size_t f0 = std::min(size_t(position), frameCount_ - 1);
+    const size_t f1 = std::min(f0 + 1, frameCount_ - 1);
+    BlendPoseChannels(getFrame(f0), getFrame(f1), position - float(f0), stride_, out.data());
+}
+
+}
@@ -0,0 +1,163 @@
+﻿#include "pch.h"
+#include <UniDx/AnimationPose.h>
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UNIDX_ANIMATION_POSE_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 単位の姿勢で確保
+// -----------------------------------------------------------------------------
+void AnimationPose::resize(size_t count)
+{
+    count_ = count;
+    stride_ = GetStride(count);
+    data_.assign(stride_ * ChannelCount, 0.0f);
+    std::fill_n(channel(QW), stride_, 1.0f);
+    std::fill_n(channel(SX), stride_ * 3, 1.0f);
+}
+
+
+void AnimationPose::set(size_t i, const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+{
+    channel(TX)[i] = position.x;
+    channel(TY)[i] = position.y;
+    channel(TZ)[i] = position.z;
+    channel(QX)[i] = rotation.x;
+    channel(QY)[i] = rotation.y;
+    channel(QZ)[i] = rotation.z;
+    channel(QW)[i] = rotation.w;
+    channel(SX)[i] = scale.x;
+    channel(SY)[i] = scale.y;
+    channel(SZ)[i] = scale.z;
+}
+
+
+Vector3 AnimationPose::getPosition(size_t i) const
+{
+    return Vector3(channel(TX)[i], channel(TY)[i], channel(TZ)[i]);
+}
+
+
+Quaternion AnimationPose::getRotation(size_t i) const
+{
+    return Quaternion(channel(QX)[i], channel(QY)[i], channel(QZ)[i], channel(QW)[i]);
+}
+
+
+Vector3 AnimationPose::getScale(size_t i) const
+{
+    return Vector3(channel(SX)[i], channel(SY)[i], channel(SZ)[i]);
+}
+
+
+// -----------------------------------------------------------------------------
+// 2つの姿勢を混ぜる（スカラー版）
+// -----------------------------------------------------------------------------
+void BlendPoseChannelsScalar(const float* a, const float* b, float t, size_t stride, float* out)
+{
+    using C = AnimationPose::Channel;
+
+    // 位置とスケール
+    for (int c : { C::TX, C::TY, C::TZ, C::SX, C::SY, C::SZ })
+    {
+        const size_t base = size_t(c) * stride;
+        for (size_t i = 0; i < stride; ++i)
+        {
+            out[base + i] = a[base + i] + (b[base + i] - a[base + i]) * t;
+        }
+    }
+
+    // 回転
+    const size_t x = C::QX * stride, y = C::QY * stride, z = C::QZ * stride, w = C::QW * stride;
+    for (size_t i = 0; i < stride; ++i)
+    {
+        const float dot = a[x + i] * b[x + i] + a[y + i] * b[y + i] + a[z + i] * b[z + i] + a[w + i] * b[w + i];
+        const float tb = dot < 0.0f ? -t : t;
+        const float ta = 1.0f - t;
+        const float qx = a[x + i] * ta + b[x + i] * tb;
+        const float qy = a[y + i] * ta + b[y + i] * tb;
+        const float qz = a[z + i] * ta + b[z + i] * tb;
+        const float qw = a[w + i] * ta + b[w + i] * tb;
+        const float inv = 1.0f / std::sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+        out[x + i] = qx * inv;
+        out[y + i] = qy * inv;
+        out[z + i] = qz * inv;
+        out[w + i] = qw * inv;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 2つの姿勢を混ぜる。4ノードずつ
+// -----------------------------------------------------------------------------
+void BlendPoseChannels(const float* a, const float* b, float t, size_t stride, float* out)
+{
+#if defined(UNIDX_ANIMATION_POSE_SSE)
+    using C = AnimationPose::Channel;
+    const __m128 vt = _mm_set1_ps(t);
+    const __m128 vta = _mm_set1_ps(1.0f - t);
+
+    // 位置とスケール
+    for (int c : { C::TX, C::TY, C::TZ, C::SX, C::SY, C::SZ })
+    {
+        const size_t base = size_t(c) * stride;
+        for (size_t i = 0; i < stride; i += 4)
+        {
+            const __m128 va = _mm_loadu_ps(a + base + i);
+            const __m128 vb = _mm_loadu_ps(b + base + i);
+            _mm_storeu_ps(out + base + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), vt)));
+        }
+    }
+
+    // 回転。内積が負なら b の符号を反転して近い方から混ぜる
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000)));
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+    const size_t x = C::QX * stride, y = C::QY * stride, z = C::QZ * stride, w = C::QW * stride;
+    for (size_t i = 0; i < stride; i += 4)
+    {
+        const __m128 ax = _mm_loadu_ps(a + x + i), ay = _mm_loadu_ps(a + y + i), az = _mm_loadu_ps(a + z + i), aw = _mm_loadu_ps(a + w + i);
+        const __m128 bx = _mm_loadu_ps(b + x + i), by = _mm_loadu_ps(b + y + i), bz = _mm_loadu_ps(b + z + i), bw = _mm_loadu_ps(b + w + i);
+
+        const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+        const __m128 tb = _mm_xor_ps(vt, _mm_and_ps(dot, signMask));
+
+        const __m128 qx = _mm_add_ps(_mm_mul_ps(ax, vta), _mm_mul_ps(bx, tb));
+        const __m128 qy = _mm_add_ps(_mm_mul_ps(ay, vta), _mm_mul_ps(by, tb));
+        const __m128 qz = _mm_add_ps(_mm_mul_ps(az, vta), _mm_mul_ps(bz, tb));
+        const __m128 qw = _mm_add_ps(_mm_mul_ps(aw, vta), _mm_mul_ps(bw, tb));
+
+        // 逆数平方根の近似をニュートン法で1回詰める
+        const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+        __m128 inv = _mm_rsqrt_ps(len2);
+        inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, len2), _mm_mul_ps(inv, inv))));
+
+        _mm_storeu_ps(out + x + i, _mm_mul_ps(qx, inv));
+        _mm_storeu_ps(out + y + i, _mm_mul_ps(qy, inv));
+        _mm_storeu_ps(out + z + i, _mm_mul_ps(qz, inv));
+        _mm_storeu_ps(out + w + i, _mm_mul_ps(qw, inv));
+    }
+#else
+    BlendPoseChannelsScalar(a, b, t, stride, out);
+#endif
+}
+
+
+void BlendPoses(const AnimationPose& a, const AnimationPose& b, float t, AnimationPose& out)
+{
+    if (out.size() != a.size())
+    {
+        out.resize(a.size());
+    }
+    BlendPoseChannels(a.data(), b.data(), t, a.getStride(), out.data());
+}
+
+}
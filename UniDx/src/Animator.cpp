@@ -0,0 +1,191 @@
+﻿#include "pch.h"
+#include <UniDx/Animator.h>
+
+#include <algorithm>
+
+#include <UniDx/AnimatorManager.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// デストラクタ
+// ~Component から呼ばれる OnDisable は Animator のものにならないので、ここで登録を外す
+// -----------------------------------------------------------------------------
+Animator::~Animator()
+{
+    if (AnimatorManager::getInstance() != nullptr)
+    {
+        AnimatorManager::getInstance()->unregisterAnimator(this);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 有効化・無効化
+// -----------------------------------------------------------------------------
+void Animator::OnEnable()
+{
+    AnimatorManager::getInstance()->registerAnimator(this);
+}
+
+
+void Animator::OnDisable()
+{
+    AnimatorManager::getInstance()->unregisterAnimator(this);
+}
+
+
+// -----------------------------------------------------------------------------
+// Skeleton を設定し、結果の配列を確保して初期姿勢にする
+// -----------------------------------------------------------------------------
+void Animator::setSkeleton(std::shared_ptr<const Skeleton> skeleton)
+{
+    skeleton_ = std::move(skeleton);
+    current_ = nullptr;
+    previous_ = nullptr;
+
+    const size_t nodes = skeleton_ != nullptr ? skeleton_->size() : 0;
+    pose_.resize(nodes);
+    fadePose_.resize(nodes);
+    model_.resize(nodes);
+
+    paletteOffsets_.clear();
+    size_t rows = 0;
+    if (skeleton_ != nullptr)
+    {
+        for (const Skin& skin : skeleton_->skins)
+        {
+            paletteOffsets_.push_back(rows);
+            rows += std::min(skin.joints.size(), Skeleton::MaxSkinJoints) * Skeleton::PaletteRowsPerJoint;
+        }
+    }
+    paletteOffsets_.push_back(rows);
+    palette_.assign(rows, Vector4::Zero);
+
+    evaluate();
+}
+
+
+// -----------------------------------------------------------------------------
+// クリップを探す
+// -----------------------------------------------------------------------------
+std::shared_ptr<const AnimationClip> Animator::findClip(const std::string& name) const
+{
+    for (const auto& clip : clips_)
+    {
+        if (clip->getName() == name)
+        {
+            return clip;
+        }
+    }
+    return nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// 再生
+// -----------------------------------------------------------------------------
+void Animator::Play(std::shared_ptr<const AnimationClip> clip)
+{
+    current_ = std::move(clip);
+    previous_ = nullptr;
+    time_ = 0.0f;
+    fadeTime_ = 0.0f;
+}
+
+
+bool Animator::Play(const std::string& name)
+{
+    std::shared_ptr<const AnimationClip> clip = findClip(name);
+    if (clip == nullptr)
+    {
+        Debug::Log(L"Animator: クリップがありません: " + ToUtf16(name));
+        return false;
+    }
+    Play(std::move(clip));
+    return true;
+}
+
+
+void Animator::CrossFade(std::shared_ptr<const AnimationClip> clip, float fadeTime)
+{
+    if (current_ == nullptr || fadeTime <= 0.0f)
+    {
+        Play(std::move(clip));
+        return;
+    }
+    previous_ = std::move(current_);
+    previousTime_ = time_;
+    current_ = std::move(clip);
+    time_ = 0.0f;
+    fadeTime_ = fadeTime;
+    fadeElapsed_ = 0.0f;
+}
+
+
+// -----------------------------------------------------------------------------
+// スキンのジョイントの行列
+// -----------------------------------------------------------------------------
+std::span<const Vector4> Animator::getSkinPalette(size_t skin) const
+{
+    if (skin + 1 >= paletteOffsets_.size())
+    {
+        return {};
+    }
+    return std::span<const Vector4>(palette_.data() + paletteOffsets_[skin], paletteOffsets_[skin + 1] - paletteOffsets_[skin]);
+}
+
+
+// -----------------------------------------------------------------------------
+// 時間を進める
+// -----------------------------------------------------------------------------
+void Animator::advance(float deltaTime)
+{
+    const float dt = deltaTime * speed;
+    time_ += dt;
+    if (previous_ != nullptr)
+    {
+        previousTime_ += dt;
+        fadeElapsed_ += deltaTime;
+        if (fadeElapsed_ >= fadeTime_)
+        {
+            previous_ = nullptr;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// ポーズとジョイントの行列を計算する
+// -----------------------------------------------------------------------------
+void Animator::evaluate()
+{
+    if (skeleton_ == nullptr)
+    {
+        return;
+    }
+
+    // クリップを取り出し、フェード中なら抜けていくクリップと混ぜる
+    const AnimationPose& rest = skeleton_->getRestPose();
+    const AnimationPose* pose = &rest;
+    if (current_ != nullptr && current_->getNodeCount() == skeleton_->size())
+    {
+        current_->sample(time_, loop, pose_);
+        pose = &pose_;
+        if (previous_ != nullptr && previous_->getNodeCount() == skeleton_->size())
+        {
+            previous_->sample(previousTime_, loop, fadePose_);
+            BlendPoses(fadePose_, pose_, std::clamp(fadeElapsed_ / fadeTime_, 0.0f, 1.0f), pose_);
+        }
+    }
+
+    skeleton_->computeModelMatrices(*pose, model_.data());
+    for (size_t s = 0; s + 1 < paletteOffsets_.size(); ++s)
+    {
+        skeleton_->computeSkinPalette(s, model_.data(), palette_.data() + paletteOffsets_[s]);
+    }
+}
+
+}
@@ -0,0 +1,92 @@
+﻿#include "pch.h"
+#include <UniDx/AnimatorManager.h>
+
+#include <chrono>
+#include <algorithm>
+
+#include <UniDx/Animator.h>
+#include <UniDx/JobSystem.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 登録
+// -----------------------------------------------------------------------------
+void AnimatorManager::registerAnimator(Animator* animator)
+{
+    if (animator->animatorIndex_ >= 0)
+    {
+        return;
+    }
+    animator->animatorIndex_ = int32_t(animators_.size());
+    animators_.push_back(animator);
+}
+
+
+// -----------------------------------------------------------------------------
+// 登録解除。末尾の Animator を空いた場所に移す
+// -----------------------------------------------------------------------------
+void AnimatorManager::unregisterAnimator(Animator* animator)
+{
+    const int32_t index = animator->animatorIndex_;
+    if (index < 0)
+    {
+        return;
+    }
+
+    Animator* last = animators_.back();
+    animators_[index] = last;
+    last->animatorIndex_ = index;
+    animators_.pop_back();
+
+    animator->animatorIndex_ = -1;
+}
+
+
+// -----------------------------------------------------------------------------
+// 時間を進めてポーズを計算する
+// -----------------------------------------------------------------------------
+void AnimatorManager::update(float deltaTime)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    size_t nodes = 0;
+    for (Animator* animator : animators_)
+    {
+        animator->advance(deltaTime);
+        nodes += animator->model_.size();
+    }
+
+    // Animator ごとに別の配列に書くので、まとめて並列に計算できる
+    const size_t count = animators_.size();
+    const size_t batches = (count + BatchSize - 1) / BatchSize;
+    auto evaluate = [this, count](size_t batch)
+        {
+            const size_t end = std::min(count, (batch + 1) * BatchSize);
+            for (size_t i = batch * BatchSize; i < end; ++i)
+            {
+                animators_[i]->evaluate();
+            }
+        };
+
+    JobSystem* jobs = JobSystem::getInstance();
+    if (parallel_ && jobs != nullptr && batches > 1)
+    {
+        jobs->parallelFor(batches, evaluate);
+    }
+    else
+    {
+        for (size_t b = 0; b < batches; ++b)
+        {
+            evaluate(b);
+        }
+    }
+
+    stats_.animatorCount = count;
+    stats_.nodeCount = nodes;
+    stats_.evaluateTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
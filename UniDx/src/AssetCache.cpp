@@ -0,0 +1,112 @@
+﻿#include "pch.h"
+#include <UniDx/AssetCache.h>
+
+#include <filesystem>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 共有しているものを返す。なければ作る
+// -----------------------------------------------------------------------------
+std::shared_ptr<void> AssetCache::get_(std::type_index type, const std::wstring& path, uint64_t variant,
+    const std::function<std::shared_ptr<void>()>& load)
+{
+    // 同じファイルを別の書き方で指しても同じものになるようにする
+    Key key{ type, std::filesystem::path(path).lexically_normal().make_preferred().wstring(), variant };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    Entry& entry = entries_[key];
+    if (std::shared_ptr<void> asset = entry.asset.lock())
+    {
+        ++stats_.hits;
+        return asset;
+    }
+    if (entry.loading.valid())
+    {
+        // 別のスレッドが作っているので、ロックを外して待つ
+        ++stats_.waits;
+        std::shared_future< std::shared_ptr<void> > loading = entry.loading;
+        lock.unlock();
+        return loading.get();
+    }
+
+    ++stats_.misses;
+    std::promise< std::shared_ptr<void> > promise;
+    entry.loading = promise.get_future().share();
+    lock.unlock();
+
+    // 作っている間はロックしない。作る中で別のものを get してもよい
+    std::shared_ptr<void> asset;
+    try
+    {
+        asset = load();
+    }
+    catch (...)
+    {
+        // 覚えておかず、待っているスレッドにも同じ例外を渡す。次に頼まれたときにまた作る
+        lock.lock();
+        entries_.erase(key);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    Entry& done = entries_[key];
+    done.loading = {};
+    done.asset = asset;
+    if (asset == nullptr)
+    {
+        entries_.erase(key);
+    }
+    lock.unlock();
+
+    promise.set_value(asset);
+    return asset;
+}
+
+
+// -----------------------------------------------------------------------------
+// 統計
+// -----------------------------------------------------------------------------
+AssetCache::Stats AssetCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+
+void AssetCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = Stats();
+}
+
+
+size_t AssetCache::getLiveCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (const auto& [key, entry] : entries_)
+    {
+        if (!entry.asset.expired()) ++count;
+    }
+    return count;
+}
+
+
+// -----------------------------------------------------------------------------
+// 誰も持たなくなったものを除く
+// -----------------------------------------------------------------------------
+void AssetCache::purge()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase_if(entries_, [](const auto& item)
+        {
+            return item.second.asset.expired() && !item.second.loading.valid();
+        });
+}
+
+}
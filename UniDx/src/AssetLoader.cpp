@@ -0,0 +1,214 @@
+﻿#include "pch.h"
+#include <UniDx/AssetLoader.h>
+
+#include <algorithm>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// デコードが済んで作成に移る
+// -----------------------------------------------------------------------------
+bool AssetLoadHandle::beginUpload()
+{
+    State expected = State::Loading;
+    return state_.compare_exchange_strong(expected, State::Uploading, std::memory_order_acq_rel);
+}
+
+
+// -----------------------------------------------------------------------------
+// 終わった状態にして、future に結果を渡す
+// -----------------------------------------------------------------------------
+void AssetLoadHandle::finish(State state)
+{
+    if (finished_.exchange(true))
+    {
+        return;
+    }
+    totalTime_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count();
+    state_.store(state, std::memory_order_release);
+    promise_.set_value(state == State::Completed);
+}
+
+
+// -----------------------------------------------------------------------------
+// 作成にかかった時間を足す。同じフレームの分はまとめて1回分にする
+// -----------------------------------------------------------------------------
+void AssetLoadHandle::addUploadTime(double seconds, uint64_t frame)
+{
+    uploadTime_ += seconds;
+    if (frame != sliceFrame_)
+    {
+        sliceFrame_ = frame;
+        sliceTime_ = 0.0;
+    }
+    sliceTime_ += seconds;
+    maxSliceTime_ = std::max(maxSliceTime_, sliceTime_);
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドを作る
+// -----------------------------------------------------------------------------
+AssetLoader::AssetLoader(size_t workerCount)
+{
+    workerCount = std::max<size_t>(workerCount, 1);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back([this]() { workerMain(); });
+    }
+}
+
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto& t : workers_)
+    {
+        t.join();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 積む
+// -----------------------------------------------------------------------------
+void AssetLoader::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    wakeCondition_.notify_one();
+}
+
+
+void AssetLoader::enqueueMainThread(MainThreadStep step)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        steps_.push_back(std::move(step));
+    }
+    idleCondition_.notify_all();
+}
+
+
+void AssetLoader::enqueueMainThread(std::vector<MainThreadStep> steps)
+{
+    // 1つの読み込みの手順が、ほかの読み込みの手順と混ざらないようにまとめて積む
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& step : steps)
+        {
+            steps_.push_back(std::move(step));
+        }
+    }
+    idleCondition_.notify_all();
+}
+
+
+size_t AssetLoader::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + runningJobs_ + steps_.size();
+}
+
+
+bool AssetLoader::popStep(MainThreadStep& step)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (steps_.empty())
+    {
+        return false;
+    }
+    step = std::move(steps_.front());
+    steps_.pop_front();
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 予算の範囲でメインスレッドの手順を実行する
+// -----------------------------------------------------------------------------
+void AssetLoader::update()
+{
+    ++frame_;
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    size_t bytes = 0;
+    MainThreadStep step;
+    while (popStep(step))
+    {
+        bytes += step();
+        if (bytes >= budget_.bytesPerFrame ||
+            std::chrono::duration<double>(Clock::now() - start).count() >= budget_.secondsPerFrame)
+        {
+            break;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 全部終わるまで実行し続ける
+// -----------------------------------------------------------------------------
+void AssetLoader::finishAll()
+{
+    ++frame_;
+
+    MainThreadStep step;
+    while (true)
+    {
+        while (popStep(step))
+        {
+            step();
+        }
+
+        // ワーカーが手順を積むか、全部終わるまで待つ
+        std::unique_lock<std::mutex> lock(mutex_);
+        idleCondition_.wait(lock, [this]() { return !steps_.empty() || (jobs_.empty() && runningJobs_ == 0); });
+        if (steps_.empty())
+        {
+            return;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッド
+// -----------------------------------------------------------------------------
+void AssetLoader::workerMain()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeCondition_.wait(lock, [this]() { return quit_ || !jobs_.empty(); });
+            if (quit_)
+            {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            ++runningJobs_;
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --runningJobs_;
+        }
+        idleCondition_.notify_all();
+    }
+}
+
+}
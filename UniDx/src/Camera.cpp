@@ -1,10 +1,16 @@
 ﻿#include "pch.h"
 #include <UniDx/Camera.h>
 
+#include <UniDx/RendererManager.h>
+
 namespace UniDx{
 
-// static なメインカメラ
-Camera* Camera::main;
+// メインカメラ。RendererManager がなければ nullptr
+ReadOnlyProperty<Camera*> Camera::main([]() -> Camera*
+    {
+        RendererManager* manager = RendererManager::getInstance();
+        return manager != nullptr ? manager->getMainCamera() : nullptr;
+    });
 
 Matrix Camera::GetViewMatrix() const
 {
@@ -24,18 +30,20 @@ Matrix Camera::GetViewMatrix() const
 
 void Camera::OnEnable()
 {
-    if (main == nullptr)
+    RendererManager* manager = RendererManager::getInstance();
+    if (manager != nullptr && manager->getMainCamera() == nullptr)
     {
-        main = this;
+        manager->setMainCamera(this);
     }
 }
 
 
 void Camera::OnDisable()
 {
-    if (main == this)
+    RendererManager* manager = RendererManager::getInstance();
+    if (manager != nullptr && manager->getMainCamera() == this)
     {
-        main = nullptr;
+        manager->setMainCamera(nullptr);
     }
 }
 
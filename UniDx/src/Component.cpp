@@ -12,11 +12,13 @@ Component::Component() :
 
         // set
         [this](bool value) {
-            if (!_enabled && value) {
+            // 非アクティブな GameObject では、アクティブになるまで呼ばない
+            const bool active = gameObject == nullptr || gameObject->activeInHierarchy();
+            if (!_enabled && value && active) {
                 if (!isCalledAwake) { Awake(); isCalledAwake = true; }
                 OnEnable();
             }
-            else if (_enabled && !value) {
+            else if (_enabled && !value && active) {
                 if (isCalledAwake) { OnDisable(); }
             }
             _enabled = value;
@@ -32,6 +34,31 @@ Component::Component() :
 
 }
 
+// GameObject のアクティブ状態の変更
+void Component::onActiveInHierarchyChanged(bool active)
+{
+    if (!_enabled)
+    {
+        return;
+    }
+
+    if (active)
+    {
+        if (!isCalledAwake)
+        {
+            checkAwake();
+        }
+        else
+        {
+            OnEnable();
+        }
+    }
+    else if (isCalledAwake)
+    {
+        OnDisable();
+    }
+}
+
 // デストラクタ
 Component::~Component()
 {
@@ -0,0 +1,297 @@
+﻿#include "pch.h"
+#include <UniDx/CompressedCurveClip.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <UniDx/Debug.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UNIDX_CURVE_CLIP_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+constexpr size_t Lanes = CompressedCurveClip::LaneCount;
+constexpr float QuantizeMax = 65535.0f;
+
+}
+
+
+// -----------------------------------------------------------------------------
+// カーブを評価し直し、量子化して、誤差に収まらないフレームだけをキーに残す
+// -----------------------------------------------------------------------------
+bool CompressedCurveClip::build(std::span<const AnimationCurve> curves, std::span<const float> maxErrors, float sampleRate)
+{
+    if (curves.empty() || !(sampleRate > 0.0f))
+    {
+        return false;
+    }
+
+    float startTime = std::numeric_limits<float>::max();
+    float endTime = std::numeric_limits<float>::lowest();
+    for (const AnimationCurve& curve : curves)
+    {
+        const std::vector<Keyframe>& keys = curve.GetKeys();
+        if (!keys.empty())
+        {
+            startTime = std::min(startTime, keys.front().time);
+            endTime = std::max(endTime, keys.back().time);
+        }
+    }
+    if (startTime > endTime)
+    {
+        startTime = endTime = 0.0f;
+    }
+
+    const size_t frameCount = size_t(std::ceil((endTime - startTime) * sampleRate)) + 1;
+    if (frameCount > size_t(std::numeric_limits<uint16_t>::max()) + 1)
+    {
+        Debug::Log(L"CompressedCurveClip: フレームが多すぎます");
+        return false;
+    }
+
+    trackCount_ = curves.size();
+    frameCount_ = frameCount;
+    startTime_ = startTime;
+    sampleRate_ = sampleRate;
+
+    const size_t groupCount = (trackCount_ + Lanes - 1) / Lanes;
+    groups_.clear();
+    groups_.reserve(groupCount);
+    keys_.clear();
+    offsets_.assign(groupCount * Lanes, 0.0f);
+    scales_.assign(groupCount * Lanes, 0.0f);
+    errors_.assign(trackCount_, 0.0f);
+
+    // レーン×フレームの順に、元の値・量子化した値・戻した値を並べる
+    std::vector<float> samples(Lanes * frameCount_);
+    std::vector<uint16_t> quantized(Lanes * frameCount_);
+    std::vector<float> decoded(Lanes * frameCount_);
+    float tolerance[Lanes];
+
+    for (size_t g = 0; g < groupCount; ++g)
+    {
+        for (size_t lane = 0; lane < Lanes; ++lane)
+        {
+            float* sample = samples.data() + lane * frameCount_;
+            uint16_t* q = quantized.data() + lane * frameCount_;
+            float* d = decoded.data() + lane * frameCount_;
+            const size_t track = g * Lanes + lane;
+            if (track >= trackCount_)
+            {
+                // 余ったレーンは 0 のまま、どのフレームも捨ててよい
+                std::fill_n(sample, frameCount_, 0.0f);
+                std::fill_n(q, frameCount_, uint16_t(0));
+                std::fill_n(d, frameCount_, 0.0f);
+                tolerance[lane] = std::numeric_limits<float>::max();
+                continue;
+            }
+
+            const AnimationCurve& curve = curves[track];
+            for (size_t f = 0; f < frameCount_; ++f)
+            {
+                sample[f] = curve.Evaluate(std::min(startTime_ + float(f) / sampleRate_, endTime));
+            }
+            const auto [mn, mx] = std::minmax_element(sample, sample + frameCount_);
+            const float offset = *mn;
+            const float scale = (*mx - *mn) / QuantizeMax;
+            for (size_t f = 0; f < frameCount_; ++f)
+            {
+                q[f] = scale > 0.0f ? uint16_t(std::lround(std::clamp((sample[f] - offset) / scale, 0.0f, QuantizeMax))) : uint16_t(0);
+                d[f] = offset + scale * float(q[f]);
+            }
+            offsets_[g * Lanes + lane] = offset;
+            scales_[g * Lanes + lane] = scale;
+            tolerance[lane] = track < maxErrors.size() ? maxErrors[track] : DefaultMaxError;
+        }
+
+        // キー a と b の線形補間で、間のフレームが全レーンとも誤差に収まるか
+        auto fits = [&](size_t a, size_t b)
+            {
+                for (size_t lane = 0; lane < Lanes; ++lane)
+                {
+                    const float* sample = samples.data() + lane * frameCount_;
+                    const float* d = decoded.data() + lane * frameCount_;
+                    for (size_t f = a + 1; f < b; ++f)
+                    {
+                        const float t = float(f - a) / float(b - a);
+                        if (std::abs(d[a] + (d[b] - d[a]) * t - sample[f]) > tolerance[lane])
+                        {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            };
+        auto addKey = [&](size_t f)
+            {
+                Key key;
+                key.frame = uint16_t(f);
+                for (size_t lane = 0; lane < Lanes; ++lane)
+                {
+                    key.values[lane] = quantized[lane * frameCount_ + f];
+                }
+                keys_.push_back(key);
+            };
+
+        // 前のキーからできるだけ遠くまで伸ばして、次のキーを置く
+        Group group{ uint32_t(keys_.size()), 0 };
+        addKey(0);
+        for (size_t a = 0; a + 1 < frameCount_;)
+        {
+            size_t b = a + 1;
+            while (b + 1 < frameCount_ && b + 1 - a <= MaxKeyGap && fits(a, b + 1))
+            {
+                ++b;
+            }
+            addKey(b);
+            a = b;
+        }
+        group.keyCount = uint32_t(keys_.size()) - group.firstKey;
+        groups_.push_back(group);
+    }
+
+    // フレームの間も含めて元のカーブと比べる
+    constexpr size_t subSteps = 4;
+    const size_t checkCount = (frameCount_ - 1) * subSteps + 1;
+    for (size_t track = 0; track < trackCount_; ++track)
+    {
+        float error = 0.0f;
+        for (size_t i = 0; i < checkCount; ++i)
+        {
+            const float time = std::min(startTime_ + float(i) / (subSteps * sampleRate_), endTime);
+            error = std::max(error, std::abs(evaluate(track, time) - curves[track].Evaluate(time)));
+        }
+        errors_[track] = error;
+    }
+    return true;
+}
+
+
+size_t CompressedCurveClip::getMemorySize() const
+{
+    return keys_.size() * sizeof(Key) + groups_.size() * sizeof(Group)
+        + (offsets_.size() + scales_.size()) * sizeof(float);
+}
+
+
+float CompressedCurveClip::toFrame(float time) const
+{
+    return std::clamp((time - startTime_) * sampleRate_, 0.0f, float(frameCount_ - 1));
+}
+
+
+// -----------------------------------------------------------------------------
+// frame を含む区間の最初のキーを二分探索で探す
+// -----------------------------------------------------------------------------
+uint32_t CompressedCurveClip::findKey(const Group& group, float frame) const
+{
+    if (group.keyCount < 2)
+    {
+        return 0;
+    }
+    const Key* first = keys_.data() + group.firstKey;
+    const Key* last = first + group.keyCount - 1;
+    const Key* it = std::upper_bound(first + 1, last, frame, [](float f, const Key& key) { return f < float(key.frame); });
+    return uint32_t(it - first) - 1;
+}
+
+
+float CompressedCurveClip::evaluate(size_t track, float time) const
+{
+    const size_t g = track / Lanes;
+    const size_t lane = track % Lanes;
+    const Group& group = groups_[g];
+    const float frame = toFrame(time);
+    const uint32_t k = findKey(group, frame);
+    const Key& k0 = keys_[group.firstKey + k];
+    const Key& k1 = keys_[group.firstKey + std::min(k + 1, group.keyCount - 1)];
+
+    const float span = float(k1.frame) - float(k0.frame);
+    const float t = span > 0.0f ? std::clamp((frame - float(k0.frame)) / span, 0.0f, 1.0f) : 0.0f;
+    const float q = float(k0.values[lane]) + (float(k1.values[lane]) - float(k0.values[lane])) * t;
+    return offsets_[g * Lanes + lane] + scales_[g * Lanes + lane] * q;
+}
+
+
+void CompressedCurveSampler::reset(const CompressedCurveClip& clip)
+{
+    clip_ = &clip;
+    cursors_.assign(clip.getGroupCount(), 0);
+}
+
+
+// -----------------------------------------------------------------------------
+// グループごとに前後のキーを見つけ、4レーンをまとめて補間して戻す
+// -----------------------------------------------------------------------------
+void CompressedCurveSampler::sample(float time, std::span<float> out)
+{
+    using Key = CompressedCurveClip::Key;
+    const CompressedCurveClip& clip = *clip_;
+    const float frame = clip.toFrame(time);
+    const size_t trackCount = std::min(clip.trackCount_, out.size());
+
+    for (size_t g = 0; g < clip.groups_.size(); ++g)
+    {
+        const CompressedCurveClip::Group& group = clip.groups_[g];
+        const Key* keys = clip.keys_.data() + group.firstKey;
+
+        // 前回の区間から先に進める。戻ったときだけ探し直す
+        uint32_t k = cursors_[g];
+        if (frame < float(keys[k].frame))
+        {
+            k = clip.findKey(group, frame);
+        }
+        else
+        {
+            while (k + 2 < group.keyCount && float(keys[k + 1].frame) <= frame)
+            {
+                ++k;
+            }
+        }
+        cursors_[g] = k;
+
+        const Key& k0 = keys[k];
+        const Key& k1 = keys[std::min(k + 1, group.keyCount - 1)];
+        const float span = float(k1.frame) - float(k0.frame);
+        const float t = span > 0.0f ? std::clamp((frame - float(k0.frame)) / span, 0.0f, 1.0f) : 0.0f;
+        const float* offset = clip.offsets_.data() + g * Lanes;
+        const float* scale = clip.scales_.data() + g * Lanes;
+
+        float values[Lanes];
+#if defined(UNIDX_CURVE_CLIP_SSE)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 q0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(k0.values)), zero));
+        const __m128 q1 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(k1.values)), zero));
+        const __m128 q = _mm_add_ps(q0, _mm_mul_ps(_mm_sub_ps(q1, q0), _mm_set1_ps(t)));
+        const __m128 v = _mm_add_ps(_mm_loadu_ps(offset), _mm_mul_ps(_mm_loadu_ps(scale), q));
+        float* dst = out.data() + g * Lanes;
+        if ((g + 1) * Lanes <= trackCount)
+        {
+            _mm_storeu_ps(dst, v);
+            continue;
+        }
+        _mm_storeu_ps(values, v);
+#else
+        for (size_t lane = 0; lane < Lanes; ++lane)
+        {
+            const float q = float(k0.values[lane]) + (float(k1.values[lane]) - float(k0.values[lane])) * t;
+            values[lane] = offset[lane] + scale[lane] * q;
+        }
+#endif
+        for (size_t lane = 0; lane < Lanes && g * Lanes + lane < trackCount; ++lane)
+        {
+            out[g * Lanes + lane] = values[lane];
+        }
+    }
+}
+
+}
@@ -0,0 +1,108 @@
+﻿#include "pch.h"
+#include <UniDx/ConstantBufferRing.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <UniDx/Debug.h>
+
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// capacity バイトのバッファを作る
+// -----------------------------------------------------------------------------
+bool ConstantBufferRing::initialize(RenderDevice& device, UINT capacity, UINT maxCapacity)
+{
+    buffer_ = nullptr;
+    device_ = nullptr;
+
+    // 定数バッファのオフセット指定と NO_OVERWRITE に対応しているか
+    if (!device.supportsConstantBufferOffsetting())
+    {
+        return false;
+    }
+
+    device_ = &device;
+    maxCapacity_ = std::max(capacity, maxCapacity);
+    if (!createBuffer_(capacity))
+    {
+        device_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// フレームの始まり
+//     前のフレームで容量を超えていたら、使った分が入る大きさで作り直す。
+//     先頭に戻るときはバッファごと捨てているので、超えても描画は正しいが
+//     ドライバーがバッファの名前替えを繰り返すことになる
+// -----------------------------------------------------------------------------
+void ConstantBufferRing::beginFrame()
+{
+    if (isSupported())
+    {
+        const UINT capacity = allocator_.getCapacity();
+        const UINT grown = RingAllocator::GetGrownCapacity(capacity, allocator_.getFrameUsed(), maxCapacity_);
+        if (grown != capacity)
+        {
+            // 作れなければ今のバッファのまま使う
+            createBuffer_(grown);
+        }
+    }
+    allocator_.beginFrame();
+}
+
+
+// -----------------------------------------------------------------------------
+// capacity バイトのバッファを作り、割り当てを先頭からにする
+// -----------------------------------------------------------------------------
+bool ConstantBufferRing::createBuffer_(UINT capacity)
+{
+    BufferDesc desc;
+    desc.byteWidth = capacity - capacity % Alignment;
+    desc.bindFlags = GpuBindConstantBuffer;
+    desc.usage = GpuUsage::Dynamic;
+    desc.cpuWrite = true;
+    ComPtr<ID3D11Buffer> buffer;
+    if (!device_->createBuffer(desc, nullptr, &buffer))
+    {
+        Debug::Log(L"定数バッファリングの作成エラー");
+        return false;
+    }
+
+    buffer_ = buffer;
+    allocator_.reset(desc.byteWidth, Alignment);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// size バイトを書き込み、頂点シェーダーの slot にセットする
+// -----------------------------------------------------------------------------
+bool ConstantBufferRing::uploadVS(UINT slot, const void* data, UINT size)
+{
+    RingAllocator::Allocation allocation;
+    if (!isSupported() || !allocator_.allocate(size, allocation))
+    {
+        return false;
+    }
+
+    void* mapped = device_->mapBuffer(buffer_.Get(), allocator_.getCapacity(), allocation.discard);
+    if (mapped == nullptr)
+    {
+        return false;
+    }
+    std::memcpy(static_cast<uint8_t*>(mapped) + allocation.offset, data, size);
+    device_->unmapBuffer(buffer_.Get(), size);
+
+    // オフセットと大きさは 16 バイトの定数の数で指定する
+    device_->setVSConstantBufferRange(slot, buffer_.Get(), allocation.offset / 16, allocation.size / 16);
+    return true;
+}
+
+}
@@ -0,0 +1,308 @@
+﻿#include "pch.h"
+#include <UniDx/D3D11RenderDevice.h>
+
+#include <cfloat>
+#include <vector>
+
+
+namespace UniDx
+{
+
+// エンジン側の列挙は D3D11 / DXGI と同じ値にしてある
+static_assert(uint32_t(GpuFormat::R32_UInt) == DXGI_FORMAT_R32_UINT && uint32_t(GpuFormat::R16_UInt) == DXGI_FORMAT_R16_UINT);
+static_assert(uint32_t(PrimitiveTopology::TriangleList) == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST &&
+    uint32_t(PrimitiveTopology::TriangleStrip) == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+static_assert(uint32_t(GpuUsage::Immutable) == D3D11_USAGE_IMMUTABLE && uint32_t(GpuUsage::Dynamic) == D3D11_USAGE_DYNAMIC &&
+    uint32_t(GpuUsage::Staging) == D3D11_USAGE_STAGING);
+static_assert(GpuBindVertexBuffer == D3D11_BIND_VERTEX_BUFFER && GpuBindIndexBuffer == D3D11_BIND_INDEX_BUFFER &&
+    GpuBindConstantBuffer == D3D11_BIND_CONSTANT_BUFFER && GpuBindShaderResource == D3D11_BIND_SHADER_RESOURCE);
+static_assert(uint32_t(ComparisonFunc::LessEqual) == D3D11_COMPARISON_LESS_EQUAL && uint32_t(ComparisonFunc::Always) == D3D11_COMPARISON_ALWAYS);
+static_assert(uint32_t(TextureAddressMode::Wrap) == D3D11_TEXTURE_ADDRESS_WRAP && uint32_t(TextureAddressMode::Clamp) == D3D11_TEXTURE_ADDRESS_CLAMP);
+
+// -----------------------------------------------------------------------------
+// コンストラクタ。定数バッファのオフセット指定と NO_OVERWRITE に対応しているか調べる
+// -----------------------------------------------------------------------------
+D3D11RenderDevice::D3D11RenderDevice(ID3D11Device* device, ID3D11DeviceContext* context) :
+    device_(device),
+    context_(context)
+{
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options{};
+    if (SUCCEEDED(device_->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+        options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer &&
+        SUCCEEDED(context_->QueryInterface(IID_PPV_ARGS(&context1_))))
+    {
+        constantBufferOffsetting_ = true;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// リソースの作成
+// -----------------------------------------------------------------------------
+bool D3D11RenderDevice::createBuffer(const BufferDesc& desc, const void* initialData, ID3D11Buffer** buffer)
+{
+    D3D11_BUFFER_DESC d3dDesc{};
+    d3dDesc.ByteWidth = desc.byteWidth;
+    d3dDesc.Usage = D3D11_USAGE(desc.usage);
+    d3dDesc.BindFlags = desc.bindFlags;
+    d3dDesc.CPUAccessFlags = desc.cpuWrite ? D3D11_CPU_ACCESS_WRITE : 0;
+    if (desc.structureByteStride != 0)
+    {
+        d3dDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        d3dDesc.StructureByteStride = desc.structureByteStride;
+    }
+
+    D3D11_SUBRESOURCE_DATA data = { initialData, desc.byteWidth, 0 };
+    return SUCCEEDED(device_->CreateBuffer(&d3dDesc, initialData != nullptr ? &data : nullptr, buffer));
+}
+
+
+bool D3D11RenderDevice::createTexture2D(const Texture2DDesc& desc, const SubresourceData* initialData, ID3D11Texture2D** texture)
+{
+    D3D11_TEXTURE2D_DESC d3dDesc{};
+    d3dDesc.Width = desc.width;
+    d3dDesc.Height = desc.height;
+    d3dDesc.MipLevels = desc.mipLevels;
+    d3dDesc.ArraySize = desc.arraySize;
+    d3dDesc.Format = DXGI_FORMAT(desc.format);
+    d3dDesc.SampleDesc.Count = 1;
+    d3dDesc.Usage = D3D11_USAGE(desc.usage);
+    d3dDesc.BindFlags = desc.bindFlags;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> data;
+    if (initialData != nullptr)
+    {
+        data.resize(size_t(desc.mipLevels) * desc.arraySize);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = { initialData[i].data, initialData[i].rowPitch, initialData[i].byteSize };
+        }
+    }
+    return SUCCEEDED(device_->CreateTexture2D(&d3dDesc, data.empty() ? nullptr : data.data(), texture));
+}
+
+
+bool D3D11RenderDevice::createShaderResourceView(ID3D11Resource* resource, const ShaderResourceViewDesc& desc, ID3D11ShaderResourceView** view)
+{
+    D3D11_SHADER_RESOURCE_VIEW_DESC d3dDesc{};
+    d3dDesc.Format = DXGI_FORMAT(desc.format);
+    if (desc.dimension == ShaderResourceViewDesc::Dimension::Buffer)
+    {
+        d3dDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        d3dDesc.Buffer.FirstElement = desc.first;
+        d3dDesc.Buffer.NumElements = desc.count;
+    }
+    else
+    {
+        d3dDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        d3dDesc.Texture2D.MostDetailedMip = desc.first;
+        d3dDesc.Texture2D.MipLevels = desc.count;
+    }
+    return SUCCEEDED(device_->CreateShaderResourceView(resource, &d3dDesc, view));
+}
+
+
+bool D3D11RenderDevice::createDepthStencilState(const DepthStencilDesc& desc, ID3D11DepthStencilState** state)
+{
+    D3D11_DEPTH_STENCIL_DESC d3dDesc{};
+    d3dDesc.DepthEnable = desc.depthEnable;
+    d3dDesc.DepthWriteMask = desc.depthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+    d3dDesc.DepthFunc = D3D11_COMPARISON_FUNC(desc.depthFunc);
+    d3dDesc.StencilEnable = FALSE;
+    return SUCCEEDED(device_->CreateDepthStencilState(&d3dDesc, state));
+}
+
+
+bool D3D11RenderDevice::createSamplerState(const SamplerDesc& desc, ID3D11SamplerState** state)
+{
+    D3D11_SAMPLER_DESC d3dDesc{};
+    d3dDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    d3dDesc.AddressU = D3D11_TEXTURE_ADDRESS_MODE(desc.addressU);
+    d3dDesc.AddressV = D3D11_TEXTURE_ADDRESS_MODE(desc.addressV);
+    d3dDesc.AddressW = D3D11_TEXTURE_ADDRESS_MODE(desc.addressW);
+    d3dDesc.MipLODBias = 0.0f;
+    d3dDesc.MaxAnisotropy = 1;
+    d3dDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    d3dDesc.MinLOD = -FLT_MAX;
+    d3dDesc.MaxLOD = FLT_MAX;
+    return SUCCEEDED(device_->CreateSamplerState(&d3dDesc, state));
+}
+
+
+bool D3D11RenderDevice::createVertexShader(const void* bytecode, size_t size, ID3D11VertexShader** shader)
+{
+    return SUCCEEDED(device_->CreateVertexShader(bytecode, size, nullptr, shader));
+}
+
+
+bool D3D11RenderDevice::createPixelShader(const void* bytecode, size_t size, ID3D11PixelShader** shader)
+{
+    return SUCCEEDED(device_->CreatePixelShader(bytecode, size, nullptr, shader));
+}
+
+
+bool D3D11RenderDevice::createInputLayout(const InputElementDesc* elements, uint32_t count, const void* bytecode, size_t size, ID3D11InputLayout** layout)
+{
+    std::vector<D3D11_INPUT_ELEMENT_DESC> d3dElements(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const InputElementDesc& e = elements[i];
+        d3dElements[i] = D3D11_INPUT_ELEMENT_DESC{ e.semanticName, e.semanticIndex, DXGI_FORMAT(e.format), e.inputSlot, e.alignedByteOffset,
+            e.instanceStepRate != 0 ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA, e.instanceStepRate };
+    }
+    return SUCCEEDED(device_->CreateInputLayout(d3dElements.data(), count, bytecode, size, layout));
+}
+
+
+// -----------------------------------------------------------------------------
+// 転送
+// -----------------------------------------------------------------------------
+void D3D11RenderDevice::updateBuffer(ID3D11Buffer* buffer, const void* data, uint32_t size)
+{
+    context_->UpdateSubresource(buffer, 0, nullptr, data, 0, 0);
+}
+
+
+void* D3D11RenderDevice::mapBuffer(ID3D11Buffer* buffer, uint32_t size, bool discard)
+{
+    D3D11_MAPPED_SUBRESOURCE mapped{};
+    const D3D11_MAP mapType = discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (FAILED(context_->Map(buffer, 0, mapType, 0, &mapped)))
+    {
+        return nullptr;
+    }
+    return mapped.pData;
+}
+
+
+void D3D11RenderDevice::unmapBuffer(ID3D11Buffer* buffer, uint32_t bytesWritten)
+{
+    context_->Unmap(buffer, 0);
+}
+
+
+void* D3D11RenderDevice::mapStagingBuffer(ID3D11Buffer* buffer, uint32_t size)
+{
+    D3D11_MAPPED_SUBRESOURCE mapped{};
+    if (FAILED(context_->Map(buffer, 0, D3D11_MAP_WRITE, 0, &mapped)))
+    {
+        return nullptr;
+    }
+    return mapped.pData;
+}
+
+
+void D3D11RenderDevice::unmapStagingBuffer(ID3D11Buffer* buffer)
+{
+    context_->Unmap(buffer, 0);
+}
+
+
+void D3D11RenderDevice::copyBuffer(ID3D11Buffer* dst, ID3D11Buffer* src, uint32_t size)
+{
+    context_->CopyResource(dst, src);
+}
+
+
+void D3D11RenderDevice::copySubresource(ID3D11Resource* dst, uint32_t dstSubresource, ID3D11Resource* src, uint32_t srcSubresource, uint32_t size)
+{
+    context_->CopySubresourceRegion(dst, dstSubresource, 0, 0, 0, src, srcSubresource, nullptr);
+}
+
+
+// -----------------------------------------------------------------------------
+// 状態の設定
+// -----------------------------------------------------------------------------
+void D3D11RenderDevice::setVertexShader(ID3D11VertexShader* shader)
+{
+    context_->VSSetShader(shader, nullptr, 0);
+}
+
+
+void D3D11RenderDevice::setPixelShader(ID3D11PixelShader* shader)
+{
+    context_->PSSetShader(shader, nullptr, 0);
+}
+
+
+void D3D11RenderDevice::setInputLayout(ID3D11InputLayout* layout)
+{
+    context_->IASetInputLayout(layout);
+}
+
+
+void D3D11RenderDevice::setPrimitiveTopology(PrimitiveTopology topology)
+{
+    context_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY(topology));
+}
+
+
+void D3D11RenderDevice::setVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset)
+{
+    context_->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+
+void D3D11RenderDevice::setIndexBuffer(ID3D11Buffer* buffer, GpuFormat format, uint32_t offset)
+{
+    context_->IASetIndexBuffer(buffer, DXGI_FORMAT(format), offset);
+}
+
+
+void D3D11RenderDevice::setVSConstantBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers)
+{
+    context_->VSSetConstantBuffers(slot, count, buffers);
+}
+
+
+void D3D11RenderDevice::setVSConstantBufferRange(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t numConstants)
+{
+    context1_->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+}
+
+
+void D3D11RenderDevice::setPSShaderResource(uint32_t slot, ID3D11ShaderResourceView* srv)
+{
+    context_->PSSetShaderResources(slot, 1, &srv);
+}
+
+
+void D3D11RenderDevice::setPSSampler(uint32_t slot, ID3D11SamplerState* sampler)
+{
+    context_->PSSetSamplers(slot, 1, &sampler);
+}
+
+
+void D3D11RenderDevice::setDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef)
+{
+    context_->OMSetDepthStencilState(state, stencilRef);
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画命令
+// -----------------------------------------------------------------------------
+void D3D11RenderDevice::draw(uint32_t vertexCount)
+{
+    context_->Draw(vertexCount, 0);
+}
+
+
+void D3D11RenderDevice::drawIndexed(uint32_t indexCount)
+{
+    context_->DrawIndexed(indexCount, 0, 0);
+}
+
+
+void D3D11RenderDevice::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startInstance)
+{
+    context_->DrawInstanced(vertexCount, instanceCount, 0, startInstance);
+}
+
+
+void D3D11RenderDevice::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance)
+{
+    context_->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, startInstance);
+}
+
+}
@@ -3,6 +3,9 @@
 
 #include <windows.h>
 
+#include <UniDx/D3D11RenderDevice.h>
+#include <UniDx/NullRenderDevice.h>
+
 namespace UniDx{
 
 // Direct3Dを初期化し、使用できるようにする
@@ -153,8 +156,8 @@ bool D3DManager::Initialize(HWND hWnd, int width, int height)
 	m_context->OMSetRenderTargets(1, m_renderTarget.GetAddressOf(), m_depthStencilView.Get());
 
 	// ビューポートの設定
-	D3D11_VIEWPORT vp = { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
-	m_context->RSSetViewports(1, &vp);
+	m_viewport = { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
+	m_context->RSSetViewports(1, &m_viewport);
 
 	// 深度ステンシルステートのセット
 	m_context->OMSetDepthStencilState(m_depthStencilState.Get(), 1);
@@ -162,6 +165,21 @@ bool D3DManager::Initialize(HWND hWnd, int width, int height)
 	screenSize.x = float(width);
 	screenSize.y = float(height);
 
+	// イミディエイトコンテキストの記録先
+	m_immediate.initialize(std::make_unique<D3D11RenderDevice>(m_device.Get(), m_context.Get()), m_context.Get());
+
+	return true;
+}
+
+
+// GPUを使わずに初期化する
+bool D3DManager::InitializeNull(int width, int height)
+{
+	m_viewport = { 0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f };
+	screenSize.x = float(width);
+	screenSize.y = float(height);
+
+	m_immediate.initialize(std::make_unique<NullRenderDevice>());
 	return true;
 }
 
@@ -169,6 +187,11 @@ bool D3DManager::Initialize(HWND hWnd, int width, int height)
 // バックバッファレンダーターゲットをクリア
 void D3DManager::Clear(float r, float g, float b, float a)
 {
+	if (m_context == nullptr)
+	{
+		return;
+	}
+
 	const float color[4] = { r, g, b, a };
 	m_context->ClearRenderTargetView(m_renderTarget.Get(), color);
 //	m_context->OMSetRenderTargets(1, m_renderTarget.GetAddressOf(), nullptr); // 深度ステンシル未使用
@@ -176,4 +199,13 @@ void D3DManager::Clear(float r, float g, float b, float a)
 	m_context->OMSetRenderTargets(1, m_renderTarget.GetAddressOf(), m_depthStencilView.Get());
 }
 
+
+// レンダーターゲット・ビューポート・深度ステンシルステートを設定
+void D3DManager::bindFrameTargets(ID3D11DeviceContext* context) const
+{
+	context->OMSetRenderTargets(1, m_renderTarget.GetAddressOf(), m_depthStencilView.Get());
+	context->RSSetViewports(1, &m_viewport);
+	context->OMSetDepthStencilState(m_depthStencilState.Get(), 1);
+}
+
 } // UniDx
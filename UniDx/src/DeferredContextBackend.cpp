@@ -0,0 +1,80 @@
+﻿#include "pch.h"
+#include <UniDx/DeferredContextBackend.h>
+
+#include <UniDx/D3DManager.h>
+#include <UniDx/D3D11RenderDevice.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// slotCount 個の遅延コンテキストを作る
+// -----------------------------------------------------------------------------
+bool DeferredContextBackend::initialize(size_t slotCount, size_t expectedDrawsPerSlot)
+{
+    slots_.clear();
+    auto& device = D3DManager::getInstance()->GetDevice();
+    if (device == nullptr)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < slotCount; ++i)
+    {
+        ComPtr<ID3D11DeviceContext> deferred;
+        if (FAILED(device->CreateDeferredContext(0, &deferred)))
+        {
+            Debug::Log(L"遅延コンテキストの作成エラー");
+            slots_.clear();
+            return false;
+        }
+        auto slot = std::make_unique<Slot>();
+        slot->context.initialize(std::make_unique<D3D11RenderDevice>(device.Get(), deferred.Get()), deferred.Get(),
+                                 expectedDrawsPerSlot);
+        slots_.push_back(std::move(slot));
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 記録の始まり。このスレッドの記録先をスロットの遅延コンテキストにする
+// -----------------------------------------------------------------------------
+void DeferredContextBackend::beginRecording(size_t slot)
+{
+    Slot& s = *slots_[slot];
+    s.scope = std::make_unique<RenderContext::Scope>(s.context);
+    s.context.beginFrame();
+    D3DManager::getInstance()->bindFrameTargets(s.context.get());
+}
+
+
+// -----------------------------------------------------------------------------
+// 記録の終わり。コマンドリストにまとめる
+// -----------------------------------------------------------------------------
+void DeferredContextBackend::endRecording(size_t slot)
+{
+    Slot& s = *slots_[slot];
+    s.commandList = nullptr;
+    s.context.get()->FinishCommandList(FALSE, &s.commandList);
+    s.scope = nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// イミディエイトコンテキストで実行
+// -----------------------------------------------------------------------------
+void DeferredContextBackend::execute(size_t slot)
+{
+    Slot& s = *slots_[slot];
+    if (s.commandList == nullptr)
+    {
+        return;
+    }
+
+    // 後に続く UI などの描画のため、イミディエイトコンテキストの状態は元に戻す
+    D3DManager::getInstance()->GetContext()->ExecuteCommandList(s.commandList.Get(), TRUE);
+    s.commandList = nullptr;
+}
+
+}
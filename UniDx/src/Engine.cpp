@@ -26,6 +26,15 @@ using namespace DirectX::SimpleMath;
 #include <UniDx/LightManager.h>
 #include <UniDx/Input.h>
 #include <UniDx/Canvas.h>
+#include <UniDx/TransformHierarchy.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/SceneCommandBuffer.h>
+#include <UniDx/RendererManager.h>
+#include <UniDx/AssetLoader.h>
+#include <UniDx/TextureStreamer.h>
+#include <UniDx/AssetCache.h>
+#include <UniDx/ShaderCache.h>
+#include <UniDx/AnimatorManager.h>
 
 using namespace std;
 using namespace UniDx;
@@ -35,6 +44,7 @@ namespace UniDx
 
 // -----------------------------------------------------------------------------
 //   Initialize(HWND hWnd)
+//     hWnd が nullptr のときは GPU を使わずに動かす
 // -----------------------------------------------------------------------------
 void Engine::Initialize(HWND hWnd)
 {
@@ -42,7 +52,14 @@ void Engine::Initialize(HWND hWnd)
     D3DManager::create();
 
     // Direct3D初期化
-    D3DManager::getInstance()->Initialize(hWnd, 1280, 720);
+    if (hWnd != nullptr)
+    {
+        D3DManager::getInstance()->Initialize(hWnd, 1280, 720);
+    }
+    else
+    {
+        D3DManager::getInstance()->InitializeNull(1280, 720);
+    }
 
     // シーンマネージャのインスタンス作成
     SceneManager::create();
@@ -55,6 +72,34 @@ void Engine::Initialize(HWND hWnd)
 
     // ライトマネージャのインスタンス作成
     LightManager::create();
+
+    // ジョブシステムのインスタンス作成
+    JobSystem::create();
+
+    // 階層構造の変更を記録するバッファの作成
+    SceneCommandBuffer::create();
+
+    // レンダラーマネージャのインスタンス作成
+    RendererManager::create();
+
+    // Transform階層のインスタンス作成
+    TransformHierarchy::create();
+
+    // 非同期読み込みのインスタンス作成
+    AssetLoader::create();
+
+    // 共有する資源のキャッシュのインスタンス作成
+    AssetCache::create();
+
+    // コンパイルしたシェーダーのキャッシュのインスタンス作成
+    ShaderCache::create();
+    ShaderCache::getInstance()->setDirectory(L"ShaderCache");
+
+    // テクスチャのミップを必要な分だけ置くインスタンス作成
+    TextureStreamer::create();
+
+    // アニメーションのポーズを計算するインスタンス作成
+    AnimatorManager::create();
 }
 
 
@@ -135,9 +180,21 @@ int Engine::PlayerLoop()
         // 更新処理
         update();
 
+        // アニメーションのポーズを計算
+        animate();
+
         // 後更新処理
         lateUpdate();
 
+        // 非同期で読み込んでいるアセットの GPU リソースを予算の範囲で作成
+        loadAssets();
+
+        // 生成・破棄・親子関係の変更をまとめて反映
+        syncStructure();
+
+        // ワールド行列の確定
+        updateTransforms();
+
         // 描画処理
         render();
 
@@ -203,6 +260,13 @@ void Engine::update()
 }
 
 
+// アニメーションの時間を進め、ポーズとスキンのジョイントの行列をワーカースレッドで計算
+void Engine::animate()
+{
+    AnimatorManager::getInstance()->update(Time::deltaTime);
+}
+
+
 // 後更新処理
 void Engine::lateUpdate()
 {
@@ -214,6 +278,32 @@ void Engine::lateUpdate()
 }
 
 
+// 非同期で読み込んでいるアセットの GPU リソースを予算の範囲で作成
+void Engine::loadAssets()
+{
+    // 前のフレームで描いた大きさからミップを決め直し、足りないものの読み込みを始める
+    if (TextureStreamer* streamer = TextureStreamer::getInstance())
+    {
+        streamer->update();
+    }
+    AssetLoader::getInstance()->update();
+}
+
+
+// 生成・破棄・親子関係の変更をまとめて反映
+void Engine::syncStructure()
+{
+    SceneCommandBuffer::getInstance()->apply(SceneManager::getInstance()->GetActiveScene());
+}
+
+
+// ワールド行列の確定
+void Engine::updateTransforms()
+{
+    TransformHierarchy::getInstance()->update(SceneManager::getInstance()->GetActiveScene());
+}
+
+
 //
 //  関数: Render()
 //
@@ -224,14 +314,17 @@ void Engine::render()
     // ライトバッファの更新と転送
     LightManager::getInstance()->updateLightCBuffer();
 
-    // 各コンポーネントの Render()
+    // 視錐台の内側にある Renderer の Render()
     Camera* camera = Camera::main;
     if (camera != nullptr)
     {
-        for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
-        {
-            render(&*it, *camera);
-        }
+        RendererManager::getInstance()->render(*camera);
+    }
+
+    // GPUを使わないときは UI を描かない
+    if (D3DManager::getInstance()->IsNull())
+    {
+        return;
     }
 
     for (auto& it : canvas_)
@@ -250,6 +343,12 @@ void Engine::finalize()
 
 void Engine::awake(GameObject* object)
 {
+    // 非アクティブなオブジェクトは子も含めて処理しない
+    if (!object->activeInHierarchy())
+    {
+        return;
+    }
+
     // 自身のコンポーネントの中でAwakeを呼び出していないものを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -266,6 +365,12 @@ void Engine::awake(GameObject* object)
 
 void Engine::fixedUpdate(GameObject* object)
 {
+    // 非アクティブなオブジェクトは子も含めて処理しない
+    if (!object->activeInHierarchy())
+    {
+        return;
+    }
+
     // アタッチされている各コンポーネントのFixedUpdateを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -286,6 +391,12 @@ void Engine::fixedUpdate(GameObject* object)
 
 void Engine::checkStart(GameObject* object)
 {
+    // 非アクティブなオブジェクトは子も含めて処理しない
+    if (!object->activeInHierarchy())
+    {
+        return;
+    }
+
     // 自身のコンポーネントの中でStartを呼び出していないものを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -306,6 +417,12 @@ void Engine::checkStart(GameObject* object)
 
 void Engine::update(GameObject* object)
 {
+    // 非アクティブなオブジェクトは子も含めて処理しない
+    if (!object->activeInHierarchy())
+    {
+        return;
+    }
+
     // アタッチされている各コンポーネントのUpdateを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -326,6 +443,12 @@ void Engine::update(GameObject* object)
 
 void Engine::lateUpdate(GameObject* object)
 {
+    // 非アクティブなオブジェクトは子も含めて処理しない
+    if (!object->activeInHierarchy())
+    {
+        return;
+    }
+
     // アタッチされている各コンポーネントのLateUpdateを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -344,26 +467,6 @@ void Engine::lateUpdate(GameObject* object)
 }
 
 
-void Engine::render(GameObject* object, const Camera& camera)
-{
-    // アタッチされている各コンポーネントのRenderを呼ぶ
-    for (auto& it : object->GetComponents())
-    {
-        auto renderer = dynamic_cast<Renderer*>(it.get());
-        if (renderer != nullptr && renderer->enabled)
-        {
-            renderer->Render(camera);
-        }
-    }
-
-    // 子供のオブジェクトについて再帰
-    for (auto& it : object->transform->getChildGameObjects())
-    {
-        render(&*it, camera);
-    }
-}
-
-
 void Engine::registerCanvas(Canvas* c)
 {
     canvas_.push_back(c);
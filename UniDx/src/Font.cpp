@@ -18,9 +18,16 @@ Font::Font() : Object([this]() { return fileName; })
 
 bool Font::Load(const wchar_t* filePath)
 {
-	spriteFont = std::make_unique<DirectX::SpriteFont>(D3DManager::getInstance()->GetDevice().Get(), filePath);
 	std::filesystem::path path(filePath);
 	fileName = path.filename();
+
+	// GPUgȂƂ͓ǂݍ܂Ȃ
+	if (D3DManager::getInstance()->IsNull())
+	{
+		return true;
+	}
+
+	spriteFont = std::make_unique<DirectX::SpriteFont>(D3DManager::getInstance()->GetDevice().Get(), filePath);
 	return spriteFont != nullptr;
 }
 
@@ -0,0 +1,161 @@
+﻿#include "pch.h"
+#include <UniDx/FrustumCulling.h>
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UNIDX_FRUSTUM_CULLING_SSE 1
+#include <emmintrin.h>
+#endif
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// ビュー×プロジェクション行列から平面を作る
+// 行ベクトルなので、クリップ座標の各成分は行列の列との内積になる
+// -----------------------------------------------------------------------------
+FrustumPlanes ExtractFrustumPlanes(const float* m)
+{
+    auto column = [m](int c, float* out)
+        {
+            out[0] = m[0 * 4 + c];
+            out[1] = m[1 * 4 + c];
+            out[2] = m[2 * 4 + c];
+            out[3] = m[3 * 4 + c];
+        };
+    float c0[4], c1[4], c2[4], c3[4];
+    column(0, c0);
+    column(1, c1);
+    column(2, c2);
+    column(3, c3);
+
+    float p[6][4];
+    for (int k = 0; k < 4; ++k)
+    {
+        p[0][k] = c3[k] + c0[k];    // 左
+        p[1][k] = c3[k] - c0[k];    // 右
+        p[2][k] = c3[k] + c1[k];    // 下
+        p[3][k] = c3[k] - c1[k];    // 上
+        p[4][k] = c2[k];            // 手前（z >= 0）
+        p[5][k] = c3[k] - c2[k];    // 奥
+    }
+
+    FrustumPlanes planes;
+    for (int i = 0; i < 6; ++i)
+    {
+        const float len = std::sqrt(p[i][0] * p[i][0] + p[i][1] * p[i][1] + p[i][2] * p[i][2]);
+        const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+        planes.nx[i] = p[i][0] * inv;
+        planes.ny[i] = p[i][1] * inv;
+        planes.nz[i] = p[i][2] * inv;
+        planes.d[i] = p[i][3] * inv;
+    }
+    return planes;
+}
+
+
+namespace
+{
+
+// 1つ分の判定。どれかの平面の完全に外側なら見えない
+inline bool isVisible(const FrustumPlanes& planes, float cx, float cy, float cz, float ex, float ey, float ez)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        const float dist = planes.nx[i] * cx + planes.ny[i] * cy + planes.nz[i] * cz + planes.d[i];
+        const float radius = std::fabs(planes.nx[i]) * ex + std::fabs(planes.ny[i]) * ey + std::fabs(planes.nz[i]) * ez;
+        if (dist < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+size_t cullScalar(const FrustumPlanes& planes, const BoundsArray& bounds, size_t begin, uint32_t* visible, size_t count)
+{
+    for (size_t i = begin; i < bounds.size(); ++i)
+    {
+        if (isVisible(planes, bounds.cx[i], bounds.cy[i], bounds.cz[i], bounds.ex[i], bounds.ey[i], bounds.ez[i]))
+        {
+            visible[count++] = uint32_t(i);
+        }
+    }
+    return count;
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 視錐台と交差する AABB のインデックスを書き出す
+// -----------------------------------------------------------------------------
+size_t CullBounds(const FrustumPlanes& planes, const BoundsArray& bounds, uint32_t* visible)
+{
+#if defined(UNIDX_FRUSTUM_CULLING_SSE)
+    // 4つずつ、6平面との距離を一度に計算する
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 nx[6], ny[6], nz[6], d[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p)
+    {
+        nx[p] = _mm_set1_ps(planes.nx[p]);
+        ny[p] = _mm_set1_ps(planes.ny[p]);
+        nz[p] = _mm_set1_ps(planes.nz[p]);
+        d[p] = _mm_set1_ps(planes.d[p]);
+        ax[p] = _mm_and_ps(nx[p], signMask);
+        ay[p] = _mm_and_ps(ny[p], signMask);
+        az[p] = _mm_and_ps(nz[p], signMask);
+    }
+
+    size_t count = 0;
+    size_t i = 0;
+    const size_t n = bounds.size();
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(&bounds.cx[i]);
+        const __m128 cy = _mm_loadu_ps(&bounds.cy[i]);
+        const __m128 cz = _mm_loadu_ps(&bounds.cz[i]);
+        const __m128 ex = _mm_loadu_ps(&bounds.ex[i]);
+        const __m128 ey = _mm_loadu_ps(&bounds.ey[i]);
+        const __m128 ez = _mm_loadu_ps(&bounds.ez[i]);
+
+        // dist + radius < 0 ならその平面の外側
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 dist = _mm_add_ps(_mm_mul_ps(nx[p], cx), d[p]);
+            dist = _mm_add_ps(dist, _mm_mul_ps(ny[p], cy));
+            dist = _mm_add_ps(dist, _mm_mul_ps(nz[p], cz));
+            __m128 radius = _mm_mul_ps(ax[p], ex);
+            radius = _mm_add_ps(radius, _mm_mul_ps(ay[p], ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(az[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+        }
+
+        int mask = ~_mm_movemask_ps(outside) & 0xf;
+        while (mask != 0)
+        {
+            const int lane = mask & 1 ? 0 : mask & 2 ? 1 : mask & 4 ? 2 : 3;
+            visible[count++] = uint32_t(i + lane);
+            mask &= mask - 1;
+        }
+    }
+    return cullScalar(planes, bounds, i, visible, count);
+#else
+    return cullScalar(planes, bounds, 0, visible, 0);
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// スカラー版
+// -----------------------------------------------------------------------------
+size_t CullBoundsScalar(const FrustumPlanes& planes, const BoundsArray& bounds, uint32_t* visible)
+{
+    return cullScalar(planes, bounds, 0, visible, 0);
+}
+
+}
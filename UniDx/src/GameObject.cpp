@@ -1,11 +1,62 @@
 ﻿#include "pch.h"
 
 #include <UniDx/Behaviour.h>
+#include <UniDx/SceneCommandBuffer.h>
+#include <UniDx/Prefab.h>
 
 
 namespace UniDx{
 
 
+// デストラクタ
+// シーンの破棄など、同期点を通さずに破棄されたときも時刻待ちの破棄とプールから外す
+GameObject::~GameObject()
+{
+	if (delayedDestroyIndex_ >= 0 && SceneCommandBuffer::getInstance() != nullptr)
+	{
+		SceneCommandBuffer::getInstance()->cancelDelayed(this);
+	}
+	if (poolRootOf_ != nullptr)
+	{
+		poolRootOf_->onRootDestroyed();
+	}
+	else if (prefab_ != nullptr)
+	{
+		prefab_->onObjectDestroyed(this);
+	}
+}
+
+
+// アクティブ状態の変更
+void GameObject::SetActive(bool value)
+{
+	if (activeSelf_ == value) return;
+
+	activeSelf_ = value;
+	updateActiveInHierarchy();
+}
+
+
+// 親も含めたアクティブ状態を反映
+void GameObject::updateActiveInHierarchy()
+{
+	const Transform* parent = transform->parent;
+	const bool active = activeSelf_ && (parent == nullptr || parent->gameObject->activeInHierarchy_);
+	if (active == activeInHierarchy_) return;
+
+	activeInHierarchy_ = active;
+	for (auto& i : components)
+	{
+		i->onActiveInHierarchyChanged(active);
+	}
+
+	for (auto& child : transform->getChildGameObjects())
+	{
+		child->updateActiveInHierarchy();
+	}
+}
+
+
 void GameObject::onTriggerEnter(Collider* other)
 {
 	for (auto& i : components)
@@ -2,7 +2,20 @@
 #include <UniDx/GltfModel.h>
 
 #include <tiny_gltf.h>
+#include <json.hpp>
 #include <codecvt>
+#include <map>
+#include <set>
+#include <chrono>
+#include <array>
+#include <cstring>
+
+#include <UniDx/MeshSimplifier.h>
+#include <UniDx/MeshOptimizer.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/MappedFile.h>
+#include <UniDx/StridedView.h>
+#include <UniDx/MeshCache.h>
 
 
 namespace UniDx{
@@ -11,55 +24,108 @@ using namespace std;
 
 namespace {
 
-// tinygltf::Accessor から std::span<T> でデータを取得するヘルパー
-template<typename T>
-void ReadAccessorData(
+// .glb の BIN チャンク。マップして読むときだけ使う
+struct GlbBinary
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// accessor の要素の場所。bufferView の byteStride が 0 なら要素は詰めて並んでいる
+struct AccessorData
+{
+    const uint8_t* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    bool mapped = false;    // マップした BIN チャンクを指している
+
+    template<typename T>
+    StridedView<T> view() const { return StridedView<T>(data, count, stride); }
+};
+
+// accessor の要素の場所を調べる。範囲がバッファに収まっていなければ false
+bool GetAccessorData(
     const tinygltf::Model& model,
     const tinygltf::Accessor& accessor,
-    vector<T>& out)
+    const GlbBinary& bin,
+    AccessorData& out)
 {
-    if (accessor.bufferView < 0) return;
+    if (accessor.bufferView < 0 || accessor.bufferView >= int(model.bufferViews.size())) return false;
     const auto& bufferView = model.bufferViews[accessor.bufferView];
+    if (bufferView.buffer < 0 || bufferView.buffer >= int(model.buffers.size())) return false;
     const auto& buffer = model.buffers[bufferView.buffer];
-    size_t offset = bufferView.byteOffset + accessor.byteOffset;
-    size_t count = accessor.count;
-    const unsigned char* data = buffer.data.data() + offset;
-    out.resize(count);
 
+    // uri のないバッファは .glb の BIN チャンク。マップしているときはそちらを読む
+    const bool mapped = bin.data != nullptr && buffer.uri.empty();
+    const uint8_t* base = mapped ? bin.data : buffer.data.data();
+    const size_t baseSize = mapped ? bin.size : buffer.data.size();
+
+    const int32_t componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    const int32_t components = tinygltf::GetNumComponentsInType(accessor.type);
+    if (componentSize <= 0 || components <= 0) return false;
+    const size_t elementSize = size_t(componentSize) * size_t(components);
+    const size_t stride = bufferView.byteStride != 0 ? bufferView.byteStride : elementSize;
+
+    const size_t offset = bufferView.byteOffset + accessor.byteOffset;
+    const size_t end = accessor.count == 0 ? offset : offset + stride * (accessor.count - 1) + elementSize;
+    if (end > bufferView.byteOffset + bufferView.byteLength || end > baseSize)
+    {
+        Debug::Log(L"glTF: accessor がバッファの範囲を超えています");
+        return false;
+    }
+
+    out.data = base + offset;
+    out.count = accessor.count;
+    out.stride = stride;
+    out.mapped = mapped;
+    return true;
+}
+
+// accessor の要素の型が T と同じか
+template<typename T>
+bool IsSameLayout(const tinygltf::Accessor& accessor)
+{
+    if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.normalized) return false;
+    if constexpr (is_same_v<T, Vector3>) return accessor.type == TINYGLTF_TYPE_VEC3;
+    else if constexpr (is_same_v<T, Vector2>) return accessor.type == TINYGLTF_TYPE_VEC2;
+    else if constexpr (is_same_v<T, Color>) return accessor.type == TINYGLTF_TYPE_VEC4;
+    else return false;
+}
+
+// tinygltf::Accessor のデータを T に変換して out にコピーするヘルパー
+template<typename T>
+void ReadAccessorData(
+    const tinygltf::Accessor& accessor,
+    const AccessorData& src,
+    vector<T>& out)
+{
     // 型チェック
     if constexpr (is_same_v<T, Vector3>) {
         assert(accessor.type == TINYGLTF_TYPE_VEC3);
         assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-        for (size_t i = 0; i < count; ++i) {
-            const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-            out[i] = Vector3(v[0], v[1], v[2]);
-        }
+        src.view<Vector3>().copyTo(out);
     }
     else if constexpr (is_same_v<T, Vector2>) {
         assert(accessor.type == TINYGLTF_TYPE_VEC2);
         assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-        for (size_t i = 0; i < count; ++i) {
-            const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-            out[i] = Vector2(v[0], v[1]);
-        }
+        src.view<Vector2>().copyTo(out);
     }
     else if constexpr (is_same_v<T, Color>) {
         // glTFのCOLOR_0はfloat4またはubyte4
         if (accessor.type == TINYGLTF_TYPE_VEC3 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-            for (size_t i = 0; i < count; ++i) {
-                const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-                out[i] = Color(v[0], v[1], v[2], 1.0f);
+            auto view = src.view<Vector3>();
+            for (size_t i = 0; i < view.size(); ++i) {
+                const Vector3 v = view[i];
+                out[i] = Color(v.x, v.y, v.z, 1.0f);
             }
         }
         else if (accessor.type == TINYGLTF_TYPE_VEC4 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-            for (size_t i = 0; i < count; ++i) {
-                const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-                out[i] = Color(v[0], v[1], v[2], v[3]);
-            }
+            src.view<Color>().copyTo(out);
         }
         else if (accessor.type == TINYGLTF_TYPE_VEC4 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-            for (size_t i = 0; i < count; ++i) {
-                const uint8_t* v = reinterpret_cast<const uint8_t*>(data + i * bufferView.byteStride);
+            auto view = src.view<array<uint8_t, 4>>();
+            for (size_t i = 0; i < view.size(); ++i) {
+                const array<uint8_t, 4> v = view[i];
                 out[i] = Color(
                     v[0] / 255.0f, v[1] / 255.0f, v[2] / 255.0f, v[3] / 255.0f);
             }
@@ -67,28 +133,154 @@ void ReadAccessorData(
     }
 }
 
+// 頂点の属性を読む。マップした BIN チャンクの型と並びがそのまま使えれば、コピーせずに指す
+template<typename T>
+void ReadAttribute(
+    const tinygltf::Model& model,
+    const tinygltf::Primitive& primitive,
+    const char* name,
+    const GlbBinary& bin,
+    OwnedSubMesh& sub,
+    span<const T> SubMeshData::* view,
+    void (OwnedSubMesh::* resize)(size_t),
+    const vector<T>& (OwnedSubMesh::* data)())
+{
+    auto it = primitive.attributes.find(name);
+    if (it == primitive.attributes.end()) return;
+
+    const auto& accessor = model.accessors[it->second];
+    AccessorData src;
+    if (!GetAccessorData(model, accessor, bin, src)) return;
+
+    if (src.mapped && IsSameLayout<T>(accessor) && src.view<T>().isContiguous())
+    {
+        sub.*view = src.view<T>().asSpan();
+        return;
+    }
+    (sub.*resize)(accessor.count);
+    ReadAccessorData(accessor, src, const_cast<vector<T>&>((sub.*data)()));
 }
 
+// インデックスを読む。32bit で詰めて並んでいれば、マップした BIN チャンクをコピーせずに指す
+void ReadIndices(
+    const tinygltf::Model& model,
+    const tinygltf::Accessor& accessor,
+    const GlbBinary& bin,
+    OwnedSubMesh& sub)
+{
+    AccessorData src;
+    if (!GetAccessorData(model, accessor, bin, src)) return;
 
-// -----------------------------------------------------------------------------
-// node生成
-// -----------------------------------------------------------------------------
-void GltfModel::createNodeRecursive(const tinygltf::Model& model,
-    int nodeIndex,
-    GameObject* parentGO)
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
+        // 32bit index
+        auto view = src.view<uint32_t>();
+        if (src.mapped && view.isContiguous()) {
+            sub.indices = view.asSpan();
+            return;
+        }
+        sub.resizeIndices(accessor.count);
+        view.copyTo(const_cast<vector<uint32_t>&>(sub.mutableIndices()));
+        return;
+    }
+
+    sub.resizeIndices(accessor.count);
+    auto& indices = const_cast<vector<uint32_t>&>(sub.mutableIndices());
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+        // 16bit index → 32bitへ変換
+        auto view = src.view<uint16_t>();
+        for (size_t i = 0; i < view.size(); ++i) {
+            indices[i] = view[i];
+        }
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+        // 8bit index → 32bitへ変換
+        auto view = src.view<uint8_t>();
+        for (size_t i = 0; i < view.size(); ++i) {
+            indices[i] = view[i];
+        }
+    }
+}
 
+// マップした .glb のうち JSON だけを tinygltf に読ませ、BIN チャンクはコピーせずに場所を返す
+// BIN チャンクを指すバッファは長さを 4 に書き換え、4バイトの BIN チャンクを付けた .glb を作り直して渡す
+// 画像は BIN チャンクを読むので除いておく（テクスチャは別のファイルから読む）
+bool LoadGlbMapped(const MappedFile& file, tinygltf::Model& model, GlbBinary& bin, string& err, string& warn)
 {
-    const tinygltf::Node& node = model.nodes[nodeIndex];
-    assert(parentGO);
+    const uint8_t* bytes = file.data();
+    const size_t size = file.size();
 
-        // GameObject を作成
-    unique_ptr<GameObject> go = make_unique<GameObject>();
-    go->SetName( UniDx::ToUtf16(node.name) );
+    auto read32 = [&](size_t offset)
+        {
+            uint32_t v;
+            memcpy(&v, bytes + offset, 4);
+            return v;
+        };
+    if (size < 20 || read32(0) != 0x46546C67 || read32(16) != 0x4E4F534A)    // "glTF" と "JSON"
+    {
+        err = "Invalid glTF binary.";
+        return false;
+    }
+    const size_t jsonLength = read32(12);
+    if (20 + jsonLength > size)
+    {
+        err = "Invalid glTF binary.";
+        return false;
+    }
 
-    // 行列を取得
-    Vector3 position;
-    Vector3 scale;
-    Quaternion rotation;
+    // BIN チャンク
+    const size_t binHeader = (20 + jsonLength + 3) & ~size_t(3);
+    if (binHeader + 8 <= size && read32(binHeader + 4) == 0x004E4942)    // "BIN"
+    {
+        const size_t binLength = read32(binHeader);
+        if (binHeader + 8 + binLength > size)
+        {
+            err = "Invalid BIN chunk length.";
+            return false;
+        }
+        bin.data = bytes + binHeader + 8;
+        bin.size = binLength;
+    }
+
+    nlohmann::json json = nlohmann::json::parse(bytes + 20, bytes + 20 + jsonLength, nullptr, false);
+    if (json.is_discarded() || !json.is_object())
+    {
+        err = "Invalid JSON chunk.";
+        return false;
+    }
+    if (auto buffers = json.find("buffers"); buffers != json.end() && buffers->is_array())
+    {
+        for (auto& buffer : *buffers)
+        {
+            if (!buffer.contains("uri"))
+            {
+                buffer["byteLength"] = 4;
+            }
+        }
+    }
+    json.erase("images");
+
+    string text = json.dump();
+    text.resize((text.size() + 3) & ~size_t(3), ' ');
+
+    vector<uint8_t> glb(12 + 8 + text.size() + 8 + 4, 0);
+    auto write32 = [&](size_t offset, uint32_t v) { memcpy(glb.data() + offset, &v, 4); };
+    write32(0, 0x46546C67);
+    write32(4, 2);
+    write32(8, uint32_t(glb.size()));
+    write32(12, uint32_t(text.size()));
+    write32(16, 0x4E4F534A);
+    memcpy(glb.data() + 20, text.data(), text.size());
+    write32(20 + text.size(), 4);
+    write32(24 + text.size(), 0x004E4942);
+
+    tinygltf::TinyGLTF loader;
+    return loader.LoadBinaryFromMemory(&model, &err, &warn, glb.data(), unsigned(glb.size()));
+}
+
+
+// ノードの姿勢を取得
+void GetNodeTransform(const tinygltf::Node& node, Vector3& position, Quaternion& rotation, Vector3& scale)
+{
     if (!node.matrix.empty())
     {
         // 4x4行列が直接指定されている場合は
@@ -106,12 +298,229 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
         rotation = node.rotation.size() == 4 ? Quaternion((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]) : Quaternion::Identity;
         scale = node.scale.size() == 3 ? Vector3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]) : Vector3::One;
     }
-    go->transform->localScale = scale;
-    go->transform->localRotation = rotation;
-    go->transform->localPosition = position;
+}
+
+// accessor の要素を float にして out に並べる。整数は normalized なら 0～1（符号付きは -1～1）にする
+bool ReadFloats(const tinygltf::Model& model, int accessorIndex, const GlbBinary& bin, vector<float>& out)
+{
+    if (accessorIndex < 0 || accessorIndex >= int(model.accessors.size())) return false;
+    const auto& accessor = model.accessors[accessorIndex];
+    AccessorData src;
+    if (!GetAccessorData(model, accessor, bin, src)) return false;
+
+    const size_t components = size_t(tinygltf::GetNumComponentsInType(accessor.type));
+    const bool normalized = accessor.normalized;
+    out.resize(accessor.count * components);
+    for (size_t i = 0; i < accessor.count; ++i)
+    {
+        const uint8_t* e = src.data + i * src.stride;
+        float* o = out.data() + i * components;
+        for (size_t c = 0; c < components; ++c)
+        {
+            switch (accessor.componentType)
+            {
+            case TINYGLTF_COMPONENT_TYPE_FLOAT: { float v; memcpy(&v, e + c * 4, 4); o[c] = v; break; }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: { const uint8_t v = e[c]; o[c] = normalized ? v / 255.0f : float(v); break; }
+            case TINYGLTF_COMPONENT_TYPE_BYTE: { const int8_t v = int8_t(e[c]); o[c] = normalized ? std::max(v / 127.0f, -1.0f) : float(v); break; }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: { uint16_t v; memcpy(&v, e + c * 2, 2); o[c] = normalized ? v / 65535.0f : float(v); break; }
+            case TINYGLTF_COMPONENT_TYPE_SHORT: { int16_t v; memcpy(&v, e + c * 2, 2); o[c] = normalized ? std::max(v / 32767.0f, -1.0f) : float(v); break; }
+            default: return false;
+            }
+        }
+    }
+    return true;
+}
+
+// スキンのジョイントの番号と重み（JOINTS_0 と WEIGHTS_0）を読む。片方しかなければ読まない
+void ReadSkinAttributes(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const GlbBinary& bin, OwnedSubMesh& sub)
+{
+    auto joints = primitive.attributes.find("JOINTS_0");
+    auto weights = primitive.attributes.find("WEIGHTS_0");
+    if (joints == primitive.attributes.end() || weights == primitive.attributes.end()) return;
+
+    vector<float> j, w;
+    if (!ReadFloats(model, joints->second, bin, j) || !ReadFloats(model, weights->second, bin, w)) return;
+    const size_t n = sub.positions.size();
+    if (j.size() != n * 4 || w.size() != n * 4)
+    {
+        Debug::Log(L"glTF: JOINTS_0 と WEIGHTS_0 の数が頂点と合いません");
+        return;
+    }
+
+    sub.resizeJoints(n);
+    sub.resizeWeights(n);
+    auto& outJoints = const_cast<vector<array<uint16_t, 4>>&>(sub.mutableJoints());
+    auto& outWeights = const_cast<vector<Vector4>&>(sub.mutableWeights());
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            outJoints[i][k] = uint16_t(j[i * 4 + k]);
+        }
+        outWeights[i] = Vector4(w[i * 4 + 0], w[i * 4 + 1], w[i * 4 + 2], w[i * 4 + 3]);
+    }
+}
+
+// skin のジョイントとその親をたどったノードで Skeleton を作り、animation をクリップにする
+void ReadSkinData(const tinygltf::Model& model, const GlbBinary& bin, GltfModel::SkinData& out)
+{
+    out = {};
+    if (model.skins.empty() || model.scenes.empty())
+    {
+        return;
+    }
+
+    // 親の番号
+    vector<int32_t> parentOf(model.nodes.size(), -1);
+    for (size_t i = 0; i < model.nodes.size(); ++i)
+    {
+        for (int child : model.nodes[i].children)
+        {
+            if (child >= 0 && size_t(child) < parentOf.size()) parentOf[child] = int32_t(i);
+        }
+    }
+
+    // ジョイントとそのルートまでの親
+    vector<bool> used(model.nodes.size(), false);
+    for (const tinygltf::Skin& skin : model.skins)
+    {
+        for (int joint : skin.joints)
+        {
+            for (int32_t n = joint; n >= 0 && !used[n]; n = parentOf[n])
+            {
+                used[n] = true;
+            }
+        }
+    }
+
+    // シーンのノードを親から順にたどって並べる
+    auto skeleton = make_shared<Skeleton>();
+    auto collect = [&](auto& self, int nodeIndex, int32_t parent) -> void
+        {
+            if (!used[nodeIndex]) return;
+            const tinygltf::Node& node = model.nodes[nodeIndex];
+            Vector3 position, scale;
+            Quaternion rotation;
+            GetNodeTransform(node, position, rotation, scale);
+            const int32_t index = int32_t(skeleton->addNode(node.name, parent, nodeIndex, position, rotation, scale));
+            for (int child : node.children)
+            {
+                self(self, child, index);
+            }
+        };
+    const int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
+    for (int nodeIndex : model.scenes[sceneIndex].nodes)
+    {
+        collect(collect, nodeIndex, -1);
+    }
+
+    // スキン。逆バインド行列がなければ単位行列
+    for (const tinygltf::Skin& gltfSkin : model.skins)
+    {
+        Skin skin;
+        vector<float> matrices;
+        const bool hasMatrices = ReadFloats(model, gltfSkin.inverseBindMatrices, bin, matrices) &&
+            matrices.size() == gltfSkin.joints.size() * 16;
+        for (size_t j = 0; j < gltfSkin.joints.size(); ++j)
+        {
+            const int32_t node = skeleton->findSourceNode(gltfSkin.joints[j]);
+            skin.joints.push_back(uint16_t(std::max(node, 0)));
+
+            // どちらも列優先なので、そのままコピーすると行ベクトルの行列になる
+            Matrix m;
+            if (hasMatrices)
+            {
+                memcpy(&m, matrices.data() + j * 16, sizeof(float) * 16);
+            }
+            skin.inverseBindMatrices.push_back(m);
+        }
+        if (skin.joints.size() > Skeleton::MaxSkinJoints)
+        {
+            Debug::Log(L"glTF: スキンのジョイントが多すぎます: " + ToUtf16(gltfSkin.name));
+        }
+        skeleton->skins.push_back(move(skin));
+    }
+
+    // アニメーション。Skeleton にないノードと weights は読まない
+    for (const tinygltf::Animation& animation : model.animations)
+    {
+        vector<AnimationClip::Track> tracks;
+        for (const tinygltf::AnimationChannel& channel : animation.channels)
+        {
+            if (channel.sampler < 0 || channel.sampler >= int(animation.samplers.size())) continue;
+            const int32_t node = skeleton->findSourceNode(channel.target_node);
+            if (node < 0) continue;
+
+            AnimationClip::Track track;
+            track.node = node;
+            if (channel.target_path == "translation") track.path = AnimationClip::Track::Path::Translation;
+            else if (channel.target_path == "rotation") track.path = AnimationClip::Track::Path::Rotation;
+            else if (channel.target_path == "scale") track.path = AnimationClip::Track::Path::Scale;
+            else continue;
+
+            const tinygltf::AnimationSampler& sampler = animation.samplers[channel.sampler];
+            if (sampler.interpolation == "STEP") track.interpolation = AnimationClip::Track::Interpolation::Step;
+            else if (sampler.interpolation == "CUBICSPLINE") track.interpolation = AnimationClip::Track::Interpolation::CubicSpline;
+            if (!ReadFloats(model, sampler.input, bin, track.times) || !ReadFloats(model, sampler.output, bin, track.values)) continue;
+            tracks.push_back(move(track));
+        }
+
+        auto clip = make_shared<AnimationClip>();
+        const string name = animation.name.empty() ? "Animation" + to_string(out.clips.size()) : animation.name;
+        if (clip->build(name, *skeleton, tracks))
+        {
+            out.clips.push_back(move(clip));
+        }
+    }
+    out.skeleton = move(skeleton);
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// node生成
+// -----------------------------------------------------------------------------
+void GltfModel::createNodeRecursive(const tinygltf::Model& model,
+    int nodeIndex,
+    GameObject* parentGO)
+
+{
+    const tinygltf::Node& node = model.nodes[nodeIndex];
+    assert(parentGO);
+
+        // GameObject を作成
+    unique_ptr<GameObject> go = make_unique<GameObject>();
+    go->SetName( UniDx::ToUtf16(node.name) );
+
+    // 行列を取得
+    // スキンのあるノードの姿勢は glTF では使わないので、Animator と同じ空間になるように単位行列のままにする
+    const bool skinned = node.skin >= 0 && node.mesh >= 0 && node.mesh < submesh.size() && submesh[node.mesh]->isSkinned();
+    if (!skinned)
+    {
+        Vector3 position;
+        Vector3 scale;
+        Quaternion rotation;
+        GetNodeTransform(node, position, rotation, scale);
+        go->transform->localScale = scale;
+        go->transform->localRotation = rotation;
+        go->transform->localPosition = position;
+    }
 
     // メッシュを持っていればアタッチ
-    if (node.mesh >= 0 && node.mesh < submesh.size())
+    if (skinned)
+    {
+        if (animator_ != nullptr && size_t(node.skin) < skin_.skeleton->skins.size())
+        {
+            auto* r = go->AddComponent<SkinnedMeshRenderer>();
+            r->animator = animator_;
+            r->skinIndex = uint32_t(node.skin);
+            renderer.push_back(r);
+            r->mesh.submesh.push_back(submesh[node.mesh]);
+            r->RecalculateBounds();
+        }
+    }
+    else if (node.mesh >= 0 && node.mesh < submesh.size())
     {
         auto* r = go->AddComponent<MeshRenderer>();
         renderer.push_back(r);
@@ -133,20 +542,86 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
 }
 
 
+// -----------------------------------------------------------------------------
+// 破棄。非同期の読み込み中ならやめる
+// -----------------------------------------------------------------------------
+GltfModel::~GltfModel()
+{
+    if (loading_ != nullptr)
+    {
+        loading_->cancel();
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // gltfファイルを読み込み
+//     同じファイルを同じ頂点の形式と読み込み方で読んだものがあれば、サブメッシュのバッファごと共有する
 // -----------------------------------------------------------------------------
-bool GltfModel::load_(const wstring& filePath)
+bool GltfModel::load_(const wstring& filePath, uint64_t layoutKey, size_t (*uploadSubMesh)(SubMesh&))
+{
+    const GltfLoadMode mode = loadMode;
+    shared_ptr<const SharedMesh> shared = AssetCache::Share<const SharedMesh>(filePath, layoutKey * 2 + uint64_t(mode),
+        [&filePath, mode, uploadSubMesh]() -> shared_ptr<SharedMesh>
+        {
+            auto loaded = make_shared<SharedMesh>();
+            unique_ptr<tinygltf::Model> decoded;
+            if (!decode_(filePath, mode, decoded, loaded->submesh, &loaded->skin))
+            {
+                return nullptr;
+            }
+            loaded->model = move(decoded);
+            for (auto& sub : loaded->submesh)
+            {
+                uploadSubMesh(*sub);
+            }
+            return loaded;
+        });
+    if (shared == nullptr)
+    {
+        return false;
+    }
+
+    shared_ = shared;
+    model = shared->model;
+    submesh = shared->submesh;
+    skin_ = shared->skin;
+    attach_();
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ファイルを読み込んでサブメッシュを作る
+// -----------------------------------------------------------------------------
+bool GltfModel::decode_(const wstring& filePath, GltfLoadMode mode,
+    unique_ptr<tinygltf::Model>& outModel, vector< shared_ptr<SubMesh> >& outSubmesh, SkinData* outSkin)
 {
     Debug::Log(filePath);
 
-    model = make_unique<tinygltf::Model>();
-    tinygltf::TinyGLTF loader;
+    auto model = make_unique<tinygltf::Model>();
     string err, warn;
 
-    auto path = ToUtf8(filePath);
-
-    bool ok = loader.LoadBinaryFromFile(model.get(), &err, &warn, path.c_str());
+    // マップして読むときは、BIN チャンクはメモリに読み込まずにマップしたまま指す
+    shared_ptr<MappedFile> file;
+    GlbBinary bin;
+    bool ok;
+    if (mode == GltfLoadMode::Mapped)
+    {
+        file = make_shared<MappedFile>();
+        if (!file->open(filePath))
+        {
+            Debug::Log(L"ファイルを開けません: " + filePath);
+            return false;
+        }
+        ok = LoadGlbMapped(*file, *model, bin, err, warn);
+    }
+    else
+    {
+        tinygltf::TinyGLTF loader;
+        auto path = ToUtf8(filePath);
+        ok = loader.LoadBinaryFromFile(model.get(), &err, &warn, path.c_str());
+    }
     if (!warn.empty())
     {
         Debug::Log(warn);
@@ -158,102 +633,463 @@ bool GltfModel::load_(const wstring& filePath)
     }
 
     // Meshの生成
-    submesh.clear();
+    vector< shared_ptr<SubMesh> > submesh;
 
     for (const auto& gltfMesh : model->meshes)
     {
         for (const auto& primitive : gltfMesh.primitives)
         {
-            auto sub = make_shared<OwnedSubMesh>();
+            shared_ptr<OwnedSubMesh> sub;
+            if (file != nullptr)
+            {
+                // 指している間はファイルを開いておく
+                auto mapped = make_shared<MappedSubMesh>();
+                mapped->file = file;
+                sub = mapped;
+            }
+            else
+            {
+                sub = make_shared<OwnedSubMesh>();
+            }
+
+            ReadAttribute(*model, primitive, "POSITION", bin, *sub, &SubMesh::positions, &OwnedSubMesh::resizePositions, &OwnedSubMesh::mutablePositions);
+            ReadAttribute(*model, primitive, "NORMAL", bin, *sub, &SubMesh::normals, &OwnedSubMesh::resizeNormals, &OwnedSubMesh::mutableNormals);
+            ReadAttribute(*model, primitive, "COLOR_0", bin, *sub, &SubMesh::colors, &OwnedSubMesh::resizeColors, &OwnedSubMesh::mutableColors);
+            ReadAttribute(*model, primitive, "TEXCOORD_0", bin, *sub, &SubMesh::uv, &OwnedSubMesh::resizeUV, &OwnedSubMesh::mutableUV);
+            ReadAttribute(*model, primitive, "TEXCOORD_1", bin, *sub, &SubMesh::uv2, &OwnedSubMesh::resizeUV2, &OwnedSubMesh::mutableUV2);
+            ReadAttribute(*model, primitive, "TEXCOORD_2", bin, *sub, &SubMesh::uv3, &OwnedSubMesh::resizeUV3, &OwnedSubMesh::mutableUV3);
+            ReadAttribute(*model, primitive, "TEXCOORD_3", bin, *sub, &SubMesh::uv4, &OwnedSubMesh::resizeUV4, &OwnedSubMesh::mutableUV4);
+            ReadSkinAttributes(*model, primitive, bin, *sub);
+
+            // indices
+            if (primitive.indices >= 0) {
+                ReadIndices(*model, model->accessors[primitive.indices], bin, *sub);
+            }
 
-            // POSITION
-            if (auto it = primitive.attributes.find("POSITION"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizePositions(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector3>&>(sub->mutablePositions()));
+            sub->topology = PrimitiveTopology::TriangleList;
+
+            // 読み込んだときに1回だけ、頂点の溶接と頂点キャッシュ・フェッチの順の並べ替えをしておく
+            // マップしたものは並べ替えるとコピーになるので、ファイルの順のまま使う
+            MeshOptimizer::Stats stats;
+            if (file == nullptr && MeshOptimizer::Optimize(*sub, &stats))
+            {
+                Debug::Log(L"MeshOptimizer: 頂点 " + to_wstring(stats.verticesBefore) + L" -> " + to_wstring(stats.verticesAfter) +
+                    L", ACMR " + to_wstring(stats.acmrBefore) + L" -> " + to_wstring(stats.acmrAfter));
             }
+            submesh.push_back(sub);
+        }
+    }
+
+    // スキンとアニメーション。マップした BIN チャンクを読むので、ファイルを閉じる前に作る
+    if (outSkin != nullptr)
+    {
+        ReadSkinData(*model, bin, *outSkin);
+    }
+
+    outModel = move(model);
+    outSubmesh = move(submesh);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ノードから階層構造を作りながら姿勢を取得
+// -----------------------------------------------------------------------------
+void GltfModel::attach_()
+{
+    if (model->scenes.empty())
+    {
+        return;
+    }
 
-            // NORMAL
-            if (auto it = primitive.attributes.find("NORMAL"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeNormals(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector3>&>(sub->mutableNormals()));
+    // スキンがあれば、ノードより先に Animator を付けておく
+    if (skin_.skeleton != nullptr && !skin_.skeleton->skins.empty())
+    {
+        animator_ = gameObject->GetComponent<Animator>(true);
+        if (animator_ == nullptr)
+        {
+            animator_ = gameObject->AddComponent<Animator>();
+        }
+        animator_->setSkeleton(skin_.skeleton);
+        for (const auto& clip : skin_.clips)
+        {
+            animator_->addClip(clip);
+        }
+        if (!skin_.clips.empty())
+        {
+            animator_->Play(skin_.clips.front());
+        }
+    }
+
+    int sceneIndex = model->defaultScene >= 0 ? model->defaultScene : 0;
+    const auto& scene = model->scenes[sceneIndex];
+    for (int nodeIndex : scene.nodes)
+    {
+        createNodeRecursive(*model.get(), nodeIndex, gameObject);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// MeshCache のファイルから読み込む
+// -----------------------------------------------------------------------------
+bool GltfModel::loadCache_(const wstring& cachePath, const wstring& sourcePath, uint64_t layoutKey, UINT stride)
+{
+    MeshCache::File file;
+    if (!file.open(cachePath, sourcePath, layoutKey, stride))
+    {
+        return false;
+    }
+    const MeshCache::Header& header = file.header();
+    if (header.addressU != 0) cachedAddressU_ = D3D11_TEXTURE_ADDRESS_MODE(header.addressU);
+    if (header.addressV != 0) cachedAddressV_ = D3D11_TEXTURE_ADDRESS_MODE(header.addressV);
+
+    // 位置とインデックスはファイルを指したまま使い、頂点はそのままバッファに渡す
+    // 同じファイルを読んだものがあれば、サブメッシュのバッファごと共有する
+    shared_ptr<const SharedMesh> shared = AssetCache::Share<const SharedMesh>(cachePath, layoutKey,
+        [&file, stride]() -> shared_ptr<SharedMesh>
+        {
+            auto loaded = make_shared<SharedMesh>();
+            for (const MeshCache::SubMeshEntry& e : file.subMeshes())
+            {
+                auto sub = make_shared<MappedSubMesh>();
+                sub->file = file.getMappedFile();
+                sub->topology = PrimitiveTopology(e.topology);
+                sub->positions = span<const Vector3>(static_cast<const Vector3*>(file.at(e.positionOffset)), e.vertexCount);
+                sub->indices = span<const uint32_t>(static_cast<const uint32_t*>(file.at(e.indexOffset)), e.indexCount);
+                sub->bounds = Bounds(Vector3(e.boundsCenter[0], e.boundsCenter[1], e.boundsCenter[2]), Vector3(e.boundsExtents[0], e.boundsExtents[1], e.boundsExtents[2]));
+                sub->hasBounds = true;
+                sub->stride = stride;
+                if (e.vertexCount > 0 && !sub->createVertexBuffer(file.at(e.vertexOffset)))
+                {
+                    return nullptr;
+                }
+                if (e.indexCount > 0)
+                {
+                    sub->createIndexBuffer();
+                }
+                loaded->submesh.push_back(sub);
             }
+            return loaded;
+        });
+    if (shared == nullptr || shared->submesh.size() != file.subMeshes().size())
+    {
+        return false;
+    }
+    shared_ = shared;
+    submesh = shared->submesh;
+
+    // ノード。親は自分より前にある
+    vector<GameObject*> created;
+    for (const MeshCache::NodeEntry& e : file.nodes())
+    {
+        unique_ptr<GameObject> go = make_unique<GameObject>();
+        go->SetName(UniDx::ToUtf16(string(file.name(e))));
+        go->transform->localScale = Vector3(e.scale[0], e.scale[1], e.scale[2]);
+        go->transform->localRotation = Quaternion(e.rotation[0], e.rotation[1], e.rotation[2], e.rotation[3]);
+        go->transform->localPosition = Vector3(e.position[0], e.position[1], e.position[2]);
+
+        if (e.subMesh >= 0)
+        {
+            auto* r = go->AddComponent<MeshRenderer>();
+            renderer.push_back(r);
+            r->mesh.submesh.push_back(submesh[e.subMesh]);
+        }
+
+        created.push_back(go.get());
+        GameObject* parent = e.parent >= 0 ? created[e.parent] : gameObject;
+        Transform::SetParent(move(go), parent->transform);
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// シーンのノードを、親が子より前になる順に並べる
+// -----------------------------------------------------------------------------
+void GltfModel::collectNodes_(const tinygltf::Model& model, size_t subMeshCount, vector<MeshCache::Node>& nodes,
+    D3D11_TEXTURE_ADDRESS_MODE& addressU, D3D11_TEXTURE_ADDRESS_MODE& addressV)
+{
+    addressU = addressV = D3D11_TEXTURE_ADDRESS_MODE(0);
+    if (!model.textures.empty())
+    {
+        getAddressModeUV_(model, 0, addressU, addressV);
+    }
+
+    nodes.clear();
+    if (model.scenes.empty())
+    {
+        return;
+    }
+
+    // attach_ と同じ順にたどる
+    auto collect = [&](auto& self, int nodeIndex, int32_t parent) -> void
+        {
+            const tinygltf::Node& node = model.nodes[nodeIndex];
+            MeshCache::Node n;
+            n.name = node.name;
+            n.parent = parent;
+            n.subMesh = node.mesh >= 0 && size_t(node.mesh) < subMeshCount ? node.mesh : -1;
+            GetNodeTransform(node, n.position, n.rotation, n.scale);
+            nodes.push_back(move(n));
 
-            // COLOR_0
-            if (auto it = primitive.attributes.find("COLOR_0"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeColors(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Color>&>(sub->mutableColors()));
+            const int32_t index = int32_t(nodes.size() - 1);
+            for (int child : node.children)
+            {
+                self(self, child, index);
             }
+        };
+    const int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
+    for (int nodeIndex : model.scenes[sceneIndex].nodes)
+    {
+        collect(collect, nodeIndex, -1);
+    }
+}
 
-            // TEXCOORD_0
-            if (auto it = primitive.attributes.find("TEXCOORD_0"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV()));
+
+// -----------------------------------------------------------------------------
+// 非同期で読み込む
+// -----------------------------------------------------------------------------
+shared_ptr<AssetLoadHandle> GltfModel::loadAsync_(const wstring& modelPath, const wstring& texturePath,
+    size_t (*uploadSubMesh)(SubMesh&), function<bool(Material&, bool)> compileShader)
+{
+    using Clock = chrono::steady_clock;
+    using State = AssetLoadHandle::State;
+
+    // 前の読み込みが残っていればやめる
+    if (loading_ != nullptr)
+    {
+        loading_->cancel();
+    }
+    auto handle = make_shared<AssetLoadHandle>();
+    loading_ = handle;
+
+    // ワーカーからは this を触らない。メインスレッドの手順は handle が終わっていたら何もしない
+    AssetLoader* loader = AssetLoader::getInstance();
+    const GltfLoadMode mode = loadMode;
+    const bool decodeTexture = !texturePath.empty() && !D3DManager::getInstance()->GetRenderDevice().isNull();
+    loader->enqueue([=, this]()
+        {
+            if (handle->isDone())
+            {
+                return;
             }
-            // TEXCOORD_1
-            if (auto it = primitive.attributes.find("TEXCOORD_1"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV2(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV2()));
+
+            // ファイルの読み込み、デコード、頂点の最適化、テクスチャのデコード
+            struct Decoded
+            {
+                unique_ptr<tinygltf::Model> model;
+                vector< shared_ptr<SubMesh> > submesh;
+                SkinData skin;
+                unique_ptr<Texture> texture;
+            };
+            auto decoded = make_shared<Decoded>();
+            const Clock::time_point start = Clock::now();
+            bool ok = decode_(modelPath, mode, decoded->model, decoded->submesh, &decoded->skin);
+            if (ok && !texturePath.empty())
+            {
+                decoded->texture = make_unique<Texture>();
+                setAddressModeUV_(*decoded->model, decoded->texture.get(), 0);
+                ok = !decodeTexture || decoded->texture->Decode(texturePath);
             }
-            // TEXCOORD_2
-            if (auto it = primitive.attributes.find("TEXCOORD_2"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV3(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV3()));
+            handle->addDecodeTime(chrono::duration<double>(Clock::now() - start).count());
+
+            if (!ok || !handle->beginUpload())
+            {
+                loader->enqueueMainThread([handle]() -> size_t
+                    {
+                        handle->finish(State::Failed);
+                        return 0;
+                    });
+                return;
             }
-            // TEXCOORD_3
-            if (auto it = primitive.attributes.find("TEXCOORD_3"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV4(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV4()));
+
+            // GPU のバッファはサブメッシュごとに1つの手順にして、予算で区切れるようにする
+            vector<AssetLoader::MainThreadStep> steps;
+            for (const auto& sub : decoded->submesh)
+            {
+                steps.push_back([loader, handle, sub, uploadSubMesh]() -> size_t
+                    {
+                        if (handle->isDone())
+                        {
+                            return 0;
+                        }
+                        const Clock::time_point t = Clock::now();
+                        const size_t bytes = uploadSubMesh(*sub);
+                        handle->addUploadTime(chrono::duration<double>(Clock::now() - t).count(), loader->getFrameCount());
+                        return bytes;
+                    });
             }
 
-            // indices
-            if (primitive.indices >= 0) {
-                const auto& accessor = model->accessors[primitive.indices];
-                sub->resizeIndices(accessor.count);
-                auto& indices = const_cast<std::vector<uint32_t>&>(sub->mutableIndices());
-
-                const auto& bufferView = model->bufferViews[accessor.bufferView];
-                const auto& buffer = model->buffers[bufferView.buffer];
-                size_t offset = bufferView.byteOffset + accessor.byteOffset;
-                const unsigned char* data = buffer.data.data() + offset;
-
-                if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-                    // 32bit index
-                    memcpy(indices.data(), data, accessor.count * sizeof(uint32_t));
-                }
-                else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-                    // 16bit index → 32bitへ変換
-                    for (size_t i = 0; i < accessor.count; ++i) {
-                        indices[i] = reinterpret_cast<const uint16_t*>(data)[i];
+            // 最後にマテリアルとノードを作って完了にする
+            steps.push_back([this, loader, handle, decoded, compileShader]() -> size_t
+                {
+                    if (handle->isDone())
+                    {
+                        return 0;
                     }
-                }
-                else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-                    // 8bit index → 32bitへ変換
-                    for (size_t i = 0; i < accessor.count; ++i) {
-                        indices[i] = data[i];
+                    const Clock::time_point t = Clock::now();
+                    model = move(decoded->model);
+                    submesh = move(decoded->submesh);
+                    skin_ = move(decoded->skin);
+                    shared_ = nullptr;
+
+                    bool ok = true;
+                    size_t bytes = 0;
+                    shared_ptr<Material> material;
+                    shared_ptr<Material> skinned;
+                    if (compileShader)
+                    {
+                        material = make_shared<Material>();
+                        ok = compileShader(*material, false);
+
+                        // スキンのあるサブメッシュには、同じテクスチャでスキニングするシェーダーのマテリアル
+                        const bool hasSkin = any_of(submesh.begin(), submesh.end(), [](const auto& sub) { return sub->isSkinned(); });
+                        if (ok && hasSkin)
+                        {
+                            skinned = make_shared<Material>();
+                            ok = compileShader(*skinned, true);
+                        }
+                        if (ok && decoded->texture != nullptr)
+                        {
+                            bytes = decoded->texture->getDecodedSize();
+                            ok = decoded->texture->Upload();
+                            shared_ptr<Texture> texture = move(decoded->texture);
+                            if (skinned != nullptr) skinned->AddTexture(texture);
+                            material->AddTexture(move(texture));
+                        }
+                    }
+                    if (ok)
+                    {
+                        attach_();
+                        if (material != nullptr)
+                        {
+                            addMaterial_(material, skinned);
+                        }
+                    }
+
+                    handle->addUploadTime(chrono::duration<double>(Clock::now() - t).count(), loader->getFrameCount());
+                    handle->finish(ok ? State::Completed : State::Failed);
+                    if (loading_ == handle)
+                    {
+                        loading_ = nullptr;
+                    }
+                    return bytes;
+                });
+            loader->enqueueMainThread(move(steps));
+        });
+    return handle;
+}
+
+
+// -----------------------------------------------------------------------------
+// 簡略化した LOD の Renderer を子に作り、LODGroup に登録
+// -----------------------------------------------------------------------------
+bool GltfModel::generateLODs_(span<const float> ratios, span<const float> screenHeights,
+    LODFadeMode fadeMode, vector< shared_ptr<SubMesh> >& created)
+{
+    if (screenHeights.size() != ratios.size() + 1)
+    {
+        Debug::Log(L"GenerateLODs: screenHeights は ratios より1つ多く指定してください");
+        return false;
+    }
+    if (renderer.empty())
+    {
+        return false;
+    }
+
+    vector<LOD> lods(screenHeights.size());
+    for (size_t i = 0; i < lods.size(); ++i)
+    {
+        lods[i].screenRelativeTransitionHeight = screenHeights[i];
+        lods[i].fadeTransitionWidth = 0.2f;
+    }
+
+    // 同じサブメッシュを使うノードでは、簡略化したものも共有する
+    map<const SubMesh*, vector< shared_ptr<SubMesh> > > chains;
+
+    const vector<MeshRenderer*> sources = renderer;
+    for (MeshRenderer* source : sources)
+    {
+        // スキンのあるものは簡略化すると重みが崩れるので、LOD に入れずにいつも描く
+        if (dynamic_cast<SkinnedMeshRenderer*>(source) != nullptr)
+        {
+            continue;
+        }
+        lods[0].renderers.push_back(source);
+
+        for (size_t level = 0; level < ratios.size(); ++level)
+        {
+            unique_ptr<GameObject> go = make_unique<GameObject>(L"LOD" + to_wstring(level + 1));
+            auto* r = go->AddComponent<MeshRenderer>();
+            r->materials = source->materials;
+            for (const auto& sub : source->mesh.submesh)
+            {
+                auto& chain = chains[sub.get()];
+                if (chain.empty())
+                {
+                    // 簡略化できないものは元のサブメッシュをそのまま使う
+                    auto simplified = MeshSimplifier::BuildLODChain(*sub, ratios);
+                    for (size_t k = 0; k < ratios.size(); ++k)
+                    {
+                        if (simplified.empty())
+                        {
+                            chain.push_back(sub);
+                            continue;
+                        }
+                        // 簡略化したデータを GPU のバッファを作れるサブメッシュに移す
+                        auto lod = make_shared<OwnedSubMesh>();
+                        lod->assignData(move(*simplified[k]));
+                        chain.push_back(lod);
+                        created.push_back(lod);
                     }
                 }
+                r->mesh.submesh.push_back(chain[level]);
             }
 
-            sub->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-            submesh.push_back(sub);
+            renderer.push_back(r);
+            lods[level + 1].renderers.push_back(r);
+            Transform::SetParent(move(go), source->gameObject->transform);
         }
     }
 
-    // ノードから階層構造を作りながら姿勢を取得
-    int sceneIndex = model->defaultScene >= 0 ? model->defaultScene : 0;
-    const auto& scene = model->scenes[sceneIndex];
-    for (int nodeIndex : scene.nodes)
+    auto* group = gameObject->AddComponent<LODGroup>();
+    group->fadeMode = fadeMode;
+    group->SetLODs(move(lods));
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// スキニングするマテリアル
+// -----------------------------------------------------------------------------
+bool GltfModel::compileSkinned_(Shader& shader, const wstring& shaderPath)
+{
+    const ShaderCache::Define defines[] = { { Shader::SkinningDefine } };
+    return shader.compile<VertexPNTJW>(shaderPath, defines);
+}
+
+
+bool GltfModel::hasSkinnedRenderer_() const
+{
+    for (MeshRenderer* r : renderer)
     {
-        createNodeRecursive(*model.get(), nodeIndex, gameObject);
+        if (dynamic_cast<SkinnedMeshRenderer*>(r) != nullptr)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void GltfModel::addMaterial_(const shared_ptr<Material>& material, const shared_ptr<Material>& skinned)
+{
+    for (MeshRenderer* r : renderer)
+    {
+        const bool isSkinned = skinned != nullptr && dynamic_cast<SkinnedMeshRenderer*>(r) != nullptr;
+        r->AddMaterial(isSkinned ? skinned : material);
     }
-    return true;
 }
 
 
@@ -262,12 +1098,38 @@ bool GltfModel::load_(const wstring& filePath)
 // -----------------------------------------------------------------------------
 void GltfModel::SetAddressModeUV(Texture* texture, int texIndex) const
 {
-    const tinygltf::Texture& tex = model->textures[texIndex];
+    GetAddressModeUV(texIndex, texture->wrapModeU, texture->wrapModeV);
+}
+
+
+void GltfModel::GetAddressModeUV(int texIndex, D3D11_TEXTURE_ADDRESS_MODE& addressU, D3D11_TEXTURE_ADDRESS_MODE& addressV) const
+{
+    if (model == nullptr)
+    {
+        // MeshCache から読んだときは 0番のテクスチャの設定だけを持っている
+        addressU = cachedAddressU_;
+        addressV = cachedAddressV_;
+        return;
+    }
+    getAddressModeUV_(*model, texIndex, addressU, addressV);
+}
+
+
+void GltfModel::setAddressModeUV_(const tinygltf::Model& model, Texture* texture, int texIndex)
+{
+    getAddressModeUV_(model, texIndex, texture->wrapModeU, texture->wrapModeV);
+}
+
+
+void GltfModel::getAddressModeUV_(const tinygltf::Model& model, int texIndex,
+    D3D11_TEXTURE_ADDRESS_MODE& addressU, D3D11_TEXTURE_ADDRESS_MODE& addressV)
+{
+    const tinygltf::Texture& tex = model.textures[texIndex];
 
     int samplerIndex = tex.sampler; // -1 の場合あり
     tinygltf::Sampler sampler;
-    if (samplerIndex >= 0 && samplerIndex < model->samplers.size()) {
-        sampler = model->samplers[samplerIndex];
+    if (samplerIndex >= 0 && samplerIndex < model.samplers.size()) {
+        sampler = model.samplers[samplerIndex];
     }
     else {
         // デフォルト扱い
@@ -286,8 +1148,8 @@ void GltfModel::SetAddressModeUV(Texture* texture, int texIndex) const
         default:    return D3D11_TEXTURE_ADDRESS_WRAP;
         }
     };
-    texture->wrapModeU = ToDXAddr(sampler.wrapS);
-    texture->wrapModeV = ToDXAddr(sampler.wrapT);
+    addressU = ToDXAddr(sampler.wrapS);
+    addressV = ToDXAddr(sampler.wrapT);
 }
 
 }
@@ -0,0 +1,241 @@
+﻿#include "pch.h"
+#include <UniDx/HeadlessEngine.h>
+
+#include <chrono>
+#include <thread>
+
+#include <UniDx/D3DManager.h>
+#include <UniDx/Time.h>
+#include <UniDx/SceneManager.h>
+#include <UniDx/Physics.h>
+#include <UniDx/LightManager.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/SceneCommandBuffer.h>
+#include <UniDx/RendererManager.h>
+#include <UniDx/TransformHierarchy.h>
+#include <UniDx/AssetLoader.h>
+#include <UniDx/AssetCache.h>
+#include <UniDx/AnimatorManager.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// target まで待つ。直前の spin の間はスリープせずに譲りながら待ち、起きる時刻のずれを小さくする
+void waitUntil(Clock::time_point target, Clock::duration spin)
+{
+    if (Clock::now() < target - spin)
+    {
+        std::this_thread::sleep_until(target - spin);
+    }
+    while (Clock::now() < target)
+    {
+        std::this_thread::yield();
+    }
+}
+
+}
+
+
+HeadlessEngine::HeadlessEngine(const Settings& settings) : settings_(settings)
+{
+}
+
+
+HeadlessEngine::~HeadlessEngine()
+{
+    // PlayerLoop を呼ばずに破棄されたときは、ここで片付ける
+    if (sceneManager_ != nullptr)
+    {
+        bindThread();
+        shutdown();
+        unbindThread();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// マネージャを作り、呼んだスレッドで使うようにする
+// -----------------------------------------------------------------------------
+void HeadlessEngine::Initialize(HWND)
+{
+    const size_t workerCount = JobSystem::ResolveWorkerCount(settings_.workerCount);
+
+    d3d_ = std::make_unique<D3DManager>();
+    sceneManager_ = std::make_unique<SceneManager>();
+    physics_ = std::make_unique<Physics>();
+    lightManager_ = std::make_unique<LightManager>();
+    // JobSystem はあとで作るので、記録先はワーカーとこのスレッドの分を直接指定する
+    commandBuffer_ = std::make_unique<SceneCommandBuffer>(workerCount + 1);
+    rendererManager_ = std::make_unique<RendererManager>();
+    transformHierarchy_ = std::make_unique<TransformHierarchy>();
+    assetLoader_ = std::make_unique<AssetLoader>(settings_.loaderWorkerCount);
+    assetCache_ = std::make_unique<AssetCache>();
+    animatorManager_ = std::make_unique<AnimatorManager>();
+
+    // ワーカーからも同じマネージャと時刻を使う。ほかのマネージャを作り終えてから起動する
+    jobSystem_ = std::make_unique<JobSystem>(workerCount, [this]() { bindManagers(); });
+
+    bindThread();
+    d3d_->InitializeNull(1280, 720);
+}
+
+
+// -----------------------------------------------------------------------------
+// 一定の間隔で更新する
+// -----------------------------------------------------------------------------
+int HeadlessEngine::PlayerLoop()
+{
+    bindThread();
+
+    const double period = 1.0 / settings_.tickRate;
+    const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+    const auto spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(settings_.spinTime));
+
+    Time::Start();
+    Time::fixedDeltaTime = float(period);
+    Time::SetDeltaTimeFixed();
+
+    createScene();
+
+    stats_ = Stats();
+    Clock::time_point next = Clock::now();
+    while (!stopRequested_.load(std::memory_order_relaxed) &&
+        (settings_.maxTicks == 0 || stats_.ticks < settings_.maxTicks))
+    {
+        const Clock::time_point start = Clock::now();
+        tick();
+        const Clock::time_point end = Clock::now();
+
+        const double tickTime = std::chrono::duration<double>(end - start).count();
+        stats_.busyTime += tickTime;
+        stats_.maxTickTime = std::max(stats_.maxTickTime, tickTime);
+        ++stats_.ticks;
+        tickCount_.store(stats_.ticks, std::memory_order_relaxed);
+
+        // 次の予定の時刻。遅れたときは詰めて回し、遅れすぎたら予定を今に合わせ直す
+        next += tickDuration;
+        if (end > next)
+        {
+            ++stats_.overruns;
+            const auto behind = uint64_t((end - next) / tickDuration);
+            if (behind > settings_.maxCatchUpTicks)
+            {
+                stats_.droppedTicks += behind;
+                next = end;
+            }
+            continue;
+        }
+        waitUntil(next, spin);
+    }
+
+    finalize();
+    shutdown();
+    unbindThread();
+    return 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// 1回分の更新。描画と入力は行わない
+// -----------------------------------------------------------------------------
+void HeadlessEngine::tick()
+{
+    // 固定時間更新と物理計算は1回の更新につき1回
+    fixedUpdate();
+    physics();
+
+    // 更新処理
+    update();
+
+    // アニメーションのポーズを計算
+    animate();
+
+    // 後更新処理
+    lateUpdate();
+
+    // 非同期で読み込んでいるアセットの GPU リソースを作成
+    loadAssets();
+
+    // 生成・破棄・親子関係の変更をまとめて反映
+    syncStructure();
+
+    // ワールド行列の確定
+    updateTransforms();
+
+    Time::UpdateFrame(Time::fixedDeltaTime);
+}
+
+
+// -----------------------------------------------------------------------------
+// 持っているマネージャを呼んだスレッドで使うようにする
+// -----------------------------------------------------------------------------
+void HeadlessEngine::bindThread()
+{
+    bindManagers();
+    JobSystem::setThreadInstance(jobSystem_.get());
+}
+
+
+void HeadlessEngine::bindManagers()
+{
+    Time::setThreadClock(&clock_);
+    Random::setThreadGlobal(&random_);
+    Engine::setThreadInstance(this);
+    D3DManager::setThreadInstance(d3d_.get());
+    SceneManager::setThreadInstance(sceneManager_.get());
+    Physics::setThreadInstance(physics_.get());
+    LightManager::setThreadInstance(lightManager_.get());
+    SceneCommandBuffer::setThreadInstance(commandBuffer_.get());
+    RendererManager::setThreadInstance(rendererManager_.get());
+    TransformHierarchy::setThreadInstance(transformHierarchy_.get());
+    AssetLoader::setThreadInstance(assetLoader_.get());
+    AssetCache::setThreadInstance(assetCache_.get());
+    AnimatorManager::setThreadInstance(animatorManager_.get());
+}
+
+
+void HeadlessEngine::unbindThread()
+{
+    Time::setThreadClock(nullptr);
+    Random::setThreadGlobal(nullptr);
+    Engine::setThreadInstance(nullptr);
+    D3DManager::setThreadInstance(nullptr);
+    SceneManager::setThreadInstance(nullptr);
+    Physics::setThreadInstance(nullptr);
+    LightManager::setThreadInstance(nullptr);
+    JobSystem::setThreadInstance(nullptr);
+    SceneCommandBuffer::setThreadInstance(nullptr);
+    RendererManager::setThreadInstance(nullptr);
+    TransformHierarchy::setThreadInstance(nullptr);
+    AssetLoader::setThreadInstance(nullptr);
+    AssetCache::setThreadInstance(nullptr);
+    AnimatorManager::setThreadInstance(nullptr);
+}
+
+
+// -----------------------------------------------------------------------------
+// シーンとマネージャを破棄する
+// -----------------------------------------------------------------------------
+void HeadlessEngine::shutdown()
+{
+    // シーンのコンポーネントが登録を外せるよう、シーンを先に破棄する
+    sceneManager_ = nullptr;
+    assetLoader_ = nullptr;
+    assetCache_ = nullptr;
+    animatorManager_ = nullptr;
+    transformHierarchy_ = nullptr;
+    rendererManager_ = nullptr;
+    commandBuffer_ = nullptr;
+    jobSystem_ = nullptr;
+    lightManager_ = nullptr;
+    physics_ = nullptr;
+    d3d_ = nullptr;
+}
+
+}
@@ -0,0 +1,82 @@
+﻿#include "pch.h"
+#include <UniDx/HeadlessServer.h>
+
+// スリープの精度を上げるため timeBeginPeriod を使う
+#pragma comment(lib, "winmm.lib")
+#include <timeapi.h>
+
+
+namespace UniDx
+{
+
+HeadlessServer::~HeadlessServer()
+{
+    requestStop();
+    join();
+}
+
+
+// -----------------------------------------------------------------------------
+// count 個のシーンを動かし始める
+// -----------------------------------------------------------------------------
+bool HeadlessServer::start(size_t count, const HeadlessEngine::Settings& settings)
+{
+    if (!threads_.empty())
+    {
+        return false;
+    }
+
+    // 動いている間は Sleep の単位を 1ms にする
+    timeBeginPeriod(1);
+
+    engines_.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        engines_.push_back(std::make_unique<HeadlessEngine>(settings));
+    }
+
+    // マネージャの作成からシーンの破棄まで、すべてそのシーンのスレッドで行う
+    threads_.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        HeadlessEngine* engine = engines_[i].get();
+        threads_.emplace_back([engine]()
+            {
+                engine->Initialize(nullptr);
+                engine->PlayerLoop();
+            });
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// すべてのシーンに止めるように伝える
+// -----------------------------------------------------------------------------
+void HeadlessServer::requestStop()
+{
+    for (auto& engine : engines_)
+    {
+        engine->requestStop();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// すべてのシーンが終わるまで待つ
+// -----------------------------------------------------------------------------
+void HeadlessServer::join()
+{
+    if (threads_.empty())
+    {
+        return;
+    }
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+    threads_.clear();
+    timeEndPeriod(1);
+}
+
+}
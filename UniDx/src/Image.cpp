@@ -23,12 +23,18 @@ constexpr Vector2 image_uvs[] = {
 namespace UniDx {
 
 // -----------------------------------------------------------------------------
-// _VF[_[ƋLAfr[s̒萔obt@
-//     UniDxłׂ͂ẴVF[_[ŃXbg0ԂɋʂŎw肷
+// _VF[_[ƋLA[hs̒萔obt@iXbg0ԁj
 // -----------------------------------------------------------------------------
 struct VSConstantBuffer0
 {
     Matrix world;
+};
+
+// -----------------------------------------------------------------------------
+// _VF[_[ƋLAJ̒萔obt@iXbg1ԁj
+// -----------------------------------------------------------------------------
+struct VSConstantBuffer1
+{
     Matrix view;
     Matrix projection;
 };
@@ -38,7 +44,7 @@ struct VSConstantBuffer0
 Image::Image()
 {
 	mesh = make_unique<SubMesh>();
-	mesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+	mesh->topology = PrimitiveTopology::TriangleStrip;
 	colors.resize(4, Color(1, 1, 1, 1));
 }
 
@@ -48,12 +54,14 @@ void Image::OnEnable()
 	UIBehaviour::OnEnable();
 
 	// sp̒萔obt@
-	D3D11_BUFFER_DESC desc{};
-	desc.ByteWidth = sizeof(VSConstantBuffer0);
-	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	desc.CPUAccessFlags = 0;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBuffer0.GetAddressOf());
+	BufferDesc desc;
+	desc.byteWidth = sizeof(VSConstantBuffer0);
+	desc.bindFlags = GpuBindConstantBuffer;
+	desc.usage = GpuUsage::Default;
+	RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+	device.createBuffer(desc, nullptr, constantBuffer0.GetAddressOf());
+	desc.byteWidth = sizeof(VSConstantBuffer1);
+	device.createBuffer(desc, nullptr, constantBuffer1.GetAddressOf());
 
 	mesh->positions = std::span<const Vector3>(image_positions, std::size(image_positions));
 	mesh->uv = std::span<const Vector2>(image_uvs, std::size(image_uvs));
@@ -83,17 +91,21 @@ void Image::Render(const Matrix& proj) const
 	}
 
 	// 萔obt@
-	ID3D11Buffer* cbs[1] = { constantBuffer0.Get() };
-	D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(0, 1, cbs);
+	RenderDevice& device = RenderContext::current().getDevice();
+	ID3D11Buffer* cbs[2] = { constantBuffer0.Get(), constantBuffer1.Get() };
+	device.setVSConstantBuffers(UNIDX_VS_SLOT_OBJECT, 2, cbs);
 
 	//  [hsʒuɍ킹č쐬
 	VSConstantBuffer0 cb{};
 	cb.world = transform->getLocalToWorldMatrix();
-	cb.view = Matrix::Identity;
-	cb.projection = proj;
+
+	VSConstantBuffer1 camera{};
+	camera.view = Matrix::Identity;
+	camera.projection = proj;
 
 	// 萔obt@XV
-	D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBuffer0.Get(), 0, nullptr, &cb, 0, 0);
+	device.updateBuffer(constantBuffer0.Get(), &cb, sizeof(cb));
+	device.updateBuffer(constantBuffer1.Get(), &camera, sizeof(camera));
 
 	mesh->Render();
 }
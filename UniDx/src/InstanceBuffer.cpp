@@ -0,0 +1,70 @@
+﻿#include "pch.h"
+#include <UniDx/InstanceBuffer.h>
+
+#include <algorithm>
+
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// count 個入るバッファを作り直す
+// -----------------------------------------------------------------------------
+bool InstanceBuffer::reserve(UINT count)
+{
+    // 足りなくなるたびに作り直さないよう、倍々で広げる
+    const UINT capacity = std::max({ count, getCapacity() * 2, 1024u });
+
+    BufferDesc desc;
+    desc.byteWidth = capacity * Stride;
+    desc.bindFlags = GpuBindVertexBuffer;
+    desc.usage = GpuUsage::Dynamic;
+    desc.cpuWrite = true;
+
+    ComPtr<ID3D11Buffer> buffer;
+    if (!device_->createBuffer(desc, nullptr, &buffer))
+    {
+        Debug::Log(L"インスタンスバッファの作成エラー");
+        return false;
+    }
+    buffer_ = buffer;
+    allocator_.reset(capacity * Stride, Stride);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// count 個分の書き込み先を返す
+// -----------------------------------------------------------------------------
+DirectX::SimpleMath::Matrix* InstanceBuffer::map(UINT count, UINT& startInstance)
+{
+    if (device_ == nullptr || (count > getCapacity() && !reserve(count)))
+    {
+        return nullptr;
+    }
+
+    RingAllocator::Allocation allocation;
+    if (!allocator_.allocate(count * Stride, allocation))
+    {
+        return nullptr;
+    }
+
+    void* mapped = device_->mapBuffer(buffer_.Get(), allocator_.getCapacity(), allocation.discard);
+    if (mapped == nullptr)
+    {
+        return nullptr;
+    }
+
+    mappedBytes_ = count * Stride;
+    startInstance = allocation.offset / Stride;
+    return static_cast<DirectX::SimpleMath::Matrix*>(mapped) + startInstance;
+}
+
+
+void InstanceBuffer::unmap()
+{
+    device_->unmapBuffer(buffer_.Get(), mappedBytes_);
+}
+
+}
@@ -0,0 +1,151 @@
+﻿#include "pch.h"
+#include <UniDx/JobSystem.h>
+
+
+namespace UniDx
+{
+
+thread_local size_t JobSystem::threadIndex_ = 0;
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドの起動
+// -----------------------------------------------------------------------------
+JobSystem::JobSystem(size_t workerCount, std::function<void()> workerInit) :
+    workerInit_(std::move(workerInit))
+{
+    workerCount = ResolveWorkerCount(workerCount);
+    workers_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back(&JobSystem::workerMain, this, i + 1);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 作るワーカーの数
+// -----------------------------------------------------------------------------
+size_t JobSystem::ResolveWorkerCount(size_t workerCount)
+{
+    if (workerCount == AutoWorkerCount)
+    {
+        const size_t hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 0;
+    }
+    return workerCount;
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドの終了
+// -----------------------------------------------------------------------------
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wakeCondition_.notify_all();
+
+    for (auto& w : workers_)
+    {
+        w.join();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// job(0) ～ job(count - 1) を並列に実行し、全部終わるまで待つ
+// -----------------------------------------------------------------------------
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& job)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // ワーカーがいないか、仕事が1つならこのスレッドで実行
+    if (workers_.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &job;
+        jobCount_ = count;
+        nextIndex_ = 0;
+        pendingWorkers_ = workers_.size();
+        ++generation_;
+    }
+    wakeCondition_.notify_all();
+
+    // 呼び出し元も仕事を取る
+    runJobs();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCondition_.wait(lock, [this]() { return pendingWorkers_ == 0; });
+    job_ = nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドの本体
+// -----------------------------------------------------------------------------
+void JobSystem::workerMain(size_t index)
+{
+    threadIndex_ = index;
+    setThreadInstance(this);
+    if (workerInit_)
+    {
+        workerInit_();
+    }
+
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeCondition_.wait(lock, [this, seen]() { return quit_ || generation_ != seen; });
+            if (quit_)
+            {
+                return;
+            }
+            seen = generation_;
+        }
+
+        runJobs();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pendingWorkers_ == 0)
+            {
+                doneCondition_.notify_one();
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 残っている仕事を順に取って実行
+// -----------------------------------------------------------------------------
+void JobSystem::runJobs()
+{
+    for (;;)
+    {
+        const size_t i = nextIndex_.fetch_add(1);
+        if (i >= jobCount_)
+        {
+            break;
+        }
+        (*job_)(i);
+    }
+}
+
+}
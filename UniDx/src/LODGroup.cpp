@@ -0,0 +1,211 @@
+﻿#include "pch.h"
+#include <UniDx/LODGroup.h>
+
+#include <cfloat>
+#include <cmath>
+
+#include <UniDx/Camera.h>
+#include <UniDx/Renderer.h>
+#include <UniDx/RendererManager.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// デストラクタ
+// ~Component から呼ばれる OnDisable は LODGroup のものにならないので、ここで登録を外す
+// Renderer は先に壊れていることがあるので触らない
+// -----------------------------------------------------------------------------
+LODGroup::~LODGroup()
+{
+    if (RendererManager::getInstance() != nullptr)
+    {
+        RendererManager::getInstance()->unregisterLODGroup(this);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 有効化
+// -----------------------------------------------------------------------------
+void LODGroup::OnEnable()
+{
+    RendererManager::getInstance()->registerLODGroup(this);
+}
+
+
+// -----------------------------------------------------------------------------
+// 無効化。すべての LOD を描く状態に戻す
+// -----------------------------------------------------------------------------
+void LODGroup::OnDisable()
+{
+    RendererManager::getInstance()->unregisterLODGroup(this);
+    for (int i = 0; i < lodCount(); ++i)
+    {
+        setLODState(i, true, 0.0f);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// LOD を設定
+// -----------------------------------------------------------------------------
+void LODGroup::SetLODs(std::vector<LOD> lods)
+{
+    // 前の LOD の Renderer は描く状態に戻す
+    for (int i = 0; i < lodCount(); ++i)
+    {
+        setLODState(i, true, 0.0f);
+    }
+
+    lods_ = std::move(lods);
+    currentLOD_ = 0;
+    fadingFrom_ = -1;
+    fading_ = false;
+    fadeTime_ = 0.0f;
+}
+
+
+// -----------------------------------------------------------------------------
+// camera から見たときの、画面の高さに対する大きさ
+// -----------------------------------------------------------------------------
+float LODGroup::GetScreenRelativeHeight(const Camera& camera) const
+{
+    if (lods_.empty())
+    {
+        return 0.0f;
+    }
+
+    // LOD0 の Renderer の境界を合わせる
+    bool found = false;
+    Vector3 mn, mx;
+    for (const Renderer* renderer : lods_.front().renderers)
+    {
+        const Bounds& b = renderer->getWorldBounds();
+        mn = found ? Vector3::Min(mn, b.min()) : b.min();
+        mx = found ? Vector3::Max(mx, b.max()) : b.max();
+        found = true;
+    }
+    if (!found)
+    {
+        return 0.0f;
+    }
+
+    const Vector3 size = mx - mn;
+    const float length = std::max({ size.x, size.y, size.z });
+    const Vector3 center = Vector3::Transform((mn + mx) * 0.5f, camera.GetViewMatrix());
+
+    // 距離 distance での画面の高さの半分
+    const float halfHeight = center.Length() * std::tan(DirectX::XMConvertToRadians(camera.fov) * 0.5f);
+    return halfHeight > 0.0f ? length / (halfHeight * 2.0f) : FLT_MAX;
+}
+
+
+// -----------------------------------------------------------------------------
+// 画面上の大きさで使う LOD
+// -----------------------------------------------------------------------------
+int LODGroup::SelectLOD(float height) const
+{
+    for (int i = 0; i < lodCount(); ++i)
+    {
+        if (height >= lods_[i].screenRelativeTransitionHeight)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+// -----------------------------------------------------------------------------
+// camera に合わせて描く LOD を選ぶ
+// -----------------------------------------------------------------------------
+void LODGroup::update(const Camera& camera, float deltaTime)
+{
+    if (lods_.empty())
+    {
+        return;
+    }
+
+    const float height = GetScreenRelativeHeight(camera);
+    const int lod = SelectLOD(height);
+
+    // 出ていく LOD は fade > 0、入ってくる LOD は fade < 0 で描き、ディザの画素を分け合う
+    int outgoing = -1;
+    int incoming = lod;
+    float fade = 0.0f;
+
+    if (fadeMode == LODFadeMode::CrossFade && animateCrossFading)
+    {
+        // 変わったときから時間でフェード
+        if (lod != currentLOD_)
+        {
+            fadingFrom_ = currentLOD_;
+            fading_ = true;
+            fadeTime_ = 0.0f;
+        }
+        if (fading_)
+        {
+            fadeTime_ += deltaTime;
+            fade = crossFadeAnimationDuration > 0.0f ? fadeTime_ / crossFadeAnimationDuration : 1.0f;
+            if (fade >= 1.0f)
+            {
+                fading_ = false;
+                fade = 0.0f;
+            }
+            else
+            {
+                outgoing = fadingFrom_;
+            }
+        }
+    }
+    else if (fadeMode == LODFadeMode::CrossFade && lod >= 0)
+    {
+        // この LOD の範囲の下側で、次の LOD とフェードする
+        const float lower = lods_[lod].screenRelativeTransitionHeight;
+        const float upper = lod > 0 ? lods_[lod - 1].screenRelativeTransitionHeight : 1.0f;
+        const float band = (upper - lower) * lods_[lod].fadeTransitionWidth;
+        if (band > 0.0f && height < lower + band)
+        {
+            outgoing = lod;
+            incoming = lod + 1 < lodCount() ? lod + 1 : -1;
+            fade = 1.0f - (height - lower) / band;
+        }
+    }
+    currentLOD_ = lod;
+
+    // 一度すべて隠してから描くものだけ戻す（同じ Renderer が複数の LOD にあってもよい）
+    for (int i = 0; i < lodCount(); ++i)
+    {
+        setLODState(i, false, 0.0f);
+    }
+    if (outgoing >= 0)
+    {
+        // fade が 0 のフェードの始まりは、出ていく LOD だけをそのまま描く
+        setLODState(outgoing, true, fade);
+        if (incoming >= 0 && fade > 0.0f)
+        {
+            setLODState(incoming, true, -fade);
+        }
+    }
+    else if (incoming >= 0)
+    {
+        setLODState(incoming, true, 0.0f);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// lod の Renderer を描くかどうかとフェードの値を設定
+// -----------------------------------------------------------------------------
+void LODGroup::setLODState(int lod, bool visible, float fade)
+{
+    for (Renderer* renderer : lods_[lod].renderers)
+    {
+        renderer->lodVisible_ = visible;
+        renderer->lodFade_ = fade;
+    }
+}
+
+}
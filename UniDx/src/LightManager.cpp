@@ -98,34 +98,38 @@ void LightManager::updateLightCBuffer()
     }
 
     // --- バッファ容量を確保 ---
-    if (capacity_ < gpuLights_.size() || lightBuf_ == nullptr)
+    RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+    if (capacity_ < gpuLights_.size() || capacity_ == 0)
     {
-        capacity_ = gpuLights_.size();
-        D3D11_BUFFER_DESC bd{};
-        bd.ByteWidth = UINT(sizeof(GPULight) * capacity_);
-        bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        bd.StructureByteStride = sizeof(GPULight);
-        bd.Usage = D3D11_USAGE_DYNAMIC;
-        bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        capacity_ = std::max<size_t>(gpuLights_.size(), 1);
+        BufferDesc bd;
+        bd.byteWidth = UINT(sizeof(GPULight) * capacity_);
+        bd.bindFlags = GpuBindShaderResource;
+        bd.structureByteStride = sizeof(GPULight);
+        bd.usage = GpuUsage::Dynamic;
+        bd.cpuWrite = true;
         lightBuf_.Reset();
-        D3DManager::getInstance()->GetDevice()->CreateBuffer(&bd, nullptr, lightBuf_.GetAddressOf());
+        device.createBuffer(bd, nullptr, lightBuf_.GetAddressOf());
 
         // SRV
-        D3D11_SHADER_RESOURCE_VIEW_DESC sd{};
-        sd.Format = DXGI_FORMAT_UNKNOWN;  // Structured
-        sd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-        sd.Buffer.NumElements = UINT(capacity_);
-        D3DManager::getInstance()->GetDevice()->CreateShaderResourceView(lightBuf_.Get(), &sd, lightSRV_.GetAddressOf());
+        ShaderResourceViewDesc sd;
+        sd.format = GpuFormat::Unknown;  // Structured
+        sd.dimension = ShaderResourceViewDesc::Dimension::Buffer;
+        sd.count = UINT(capacity_);
+        lightSRV_.Reset();
+        device.createShaderResourceView(lightBuf_.Get(), sd, lightSRV_.GetAddressOf());
     }
 
     // --- Map & Copy ---
     if (!gpuLights_.empty())
     {
-        D3D11_MAPPED_SUBRESOURCE ms{};
-        D3DManager::getInstance()->GetContext()->Map(lightBuf_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
-        memcpy(ms.pData, gpuLights_.data(), sizeof(GPULight) * gpuLights_.size());
-        D3DManager::getInstance()->GetContext()->Unmap(lightBuf_.Get(), 0);
+        const UINT size = UINT(sizeof(GPULight) * gpuLights_.size());
+        void* mapped = device.mapBuffer(lightBuf_.Get(), UINT(sizeof(GPULight) * capacity_), true);
+        if (mapped != nullptr)
+        {
+            memcpy(mapped, gpuLights_.data(), size);
+            device.unmapBuffer(lightBuf_.Get(), size);
+        }
     }
     /*
     // --- LightCount CB 更新 ---
@@ -142,8 +146,14 @@ void LightManager::updateLightCBuffer()
     D3DManager::instance->GetContext()->UpdateSubresource(metaCB_.Get(), 0, nullptr, &meta, 0, 0);
 */
     // ライト
-    ID3D11ShaderResourceView* srv = lightSRV_.Get();
-    D3DManager::getInstance()->GetContext()->PSSetShaderResources(UNIDX_PS_SLOT_LIGHTS, 1, &srv);
+    bind(device);
+}
+
+
+// ライトのバッファを device に設定
+void LightManager::bind(RenderDevice& device) const
+{
+    device.setPSShaderResource(UNIDX_PS_SLOT_LIGHTS, lightSRV_.Get());
 }
 
 
@@ -0,0 +1,71 @@
+﻿#include "pch.h"
+#include <UniDx/MappedFile.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 開いてマップする
+// -----------------------------------------------------------------------------
+bool MappedFile::open(const std::wstring& filePath)
+{
+    close();
+
+    file_ = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+    {
+        // 空のファイルはマップできない
+        close();
+        return false;
+    }
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr)
+    {
+        close();
+        return false;
+    }
+    size_ = size_t(size.QuadPart);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 閉じる
+// -----------------------------------------------------------------------------
+void MappedFile::close()
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_ != nullptr)
+    {
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+    size_ = 0;
+}
+
+}
@@ -6,18 +6,6 @@
 
 namespace UniDx{
 
-// -----------------------------------------------------------------------------
-// 頂点シェーダー側と共有する、モデルビュー行列の定数バッファ
-//     UniDxではすべてのシェーダーでスロット0番に共通で指定する
-// -----------------------------------------------------------------------------
-struct VSConstantBuffer0
-{
-    Matrix world;
-    Matrix view;
-    Matrix projection;
-};
-
-
 // -----------------------------------------------------------------------------
 // コンストラクタ
 // -----------------------------------------------------------------------------
@@ -35,16 +23,16 @@ Material::Material() :
 // -----------------------------------------------------------------------------
 // レンダリング用にデバイスへ設定
 // -----------------------------------------------------------------------------
-void Material::setForRender() const
+void Material::setForRender(bool instanced) const
 {
-    shader.setToContext();
+    shader.setToContext(instanced);
     for (auto& tex : textures)
     {
         tex->setForRender();
     }
 
     // デプス
-    D3DManager::getInstance()->GetContext()->OMSetDepthStencilState(depthStencilState.Get(), 1);
+    D3DManager::getInstance()->GetStateCache().setDepthStencilState(depthStencilState.Get(), 1);
 }
 
 
@@ -62,14 +50,18 @@ void Material::AddTexture(std::shared_ptr<Texture> tex)
 // -----------------------------------------------------------------------------
 void Material::OnEnable()
 {
-    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-    dsDesc.DepthEnable = TRUE; // 深度テスト有効
-    dsDesc.DepthWriteMask = depthWrite; // 書き込み有効
-    dsDesc.DepthFunc = ztest; // 小さい値が手前
+    // 再有効化のときは作成済みのものを使う
+    if (depthStencilState != nullptr)
+    {
+        return;
+    }
 
-    dsDesc.StencilEnable = FALSE;
+    DepthStencilDesc dsDesc;
+    dsDesc.depthEnable = true; // 深度テスト有効
+    dsDesc.depthWrite = depthWrite != D3D11_DEPTH_WRITE_MASK_ZERO; // 書き込み有効
+    dsDesc.depthFunc = ComparisonFunc(ztest); // 小さい値が手前
 
-    D3DManager::getInstance()->GetDevice()->CreateDepthStencilState(&dsDesc, &depthStencilState);
+    D3DManager::getInstance()->GetRenderDevice().createDepthStencilState(dsDesc, &depthStencilState);
 }
 
 
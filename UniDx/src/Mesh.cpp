@@ -6,25 +6,56 @@
 namespace UniDx{
 
 
-void SubMesh::createVertexBuffer(void* data)
+bool SubMesh::createVertexBuffer(const void* data)
 {
     // 事前に設定されたstrideと位置の数でデータサイズを計算
     UINT byteSize = static_cast<UINT>(stride * positions.size());
 
     // 作成するバッファの仕様を決める
-    D3D11_BUFFER_DESC vbDesc = {};
-    vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;	// デバイスにバインドするときの種類(頂点バッファ)
-    vbDesc.ByteWidth = byteSize;				    // 作成するバッファのバイトサイズ
-    vbDesc.MiscFlags = 0;							// その他のフラグ
-    vbDesc.StructureByteStride = 0;					// 構造化バッファの場合、その構造体のサイズ
-    vbDesc.Usage = D3D11_USAGE_DEFAULT;				// 作成するバッファの使用法
-    vbDesc.CPUAccessFlags = 0;
-
-    // 上の仕様を渡して頂点バッファを作ってもらう
-    D3D11_SUBRESOURCE_DATA initData = { data, byteSize, 0 };	// 書き込むデータ
-
-    // 頂点バッファの作成
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&vbDesc, &initData, &vertexBuffer);
+    BufferDesc vbDesc;
+    vbDesc.bindFlags = GpuBindVertexBuffer;	        // デバイスにバインドするときの種類(頂点バッファ)
+    vbDesc.byteWidth = byteSize;				    // 作成するバッファのバイトサイズ
+    vbDesc.usage = GpuUsage::Default;				// 作成するバッファの使用法
+
+    // 上の仕様と書き込むデータを渡して頂点バッファを作ってもらう
+    return D3DManager::getInstance()->GetRenderDevice().createBuffer(vbDesc, data, &vertexBuffer);
+}
+
+
+// -----------------------------------------------------------------------------
+// 頂点を書き込むステージングバッファを作って開く
+// -----------------------------------------------------------------------------
+void* SubMesh::beginVertexUpload(UINT byteSize, ComPtr<ID3D11Buffer>& staging)
+{
+    BufferDesc desc;
+    desc.byteWidth = byteSize;
+    desc.usage = GpuUsage::Staging;                 // CPU から書いて GPU 上でコピーするだけ
+    desc.cpuWrite = true;
+
+    RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+    if (!device.createBuffer(desc, nullptr, staging.ReleaseAndGetAddressOf()))
+    {
+        return nullptr;
+    }
+    return device.mapStagingBuffer(staging.Get(), byteSize);
+}
+
+
+// -----------------------------------------------------------------------------
+// ステージングバッファを閉じ、頂点バッファを作ってコピーする
+// -----------------------------------------------------------------------------
+bool SubMesh::endVertexUpload(UINT byteSize, ComPtr<ID3D11Buffer>& staging)
+{
+    RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+    device.unmapStagingBuffer(staging.Get());
+
+    if (!createVertexBuffer(nullptr))
+    {
+        return false;
+    }
+    device.copyBuffer(vertexBuffer.Get(), staging.Get(), byteSize);
+    staging.Reset();
+    return true;
 }
 
 
@@ -34,43 +65,87 @@ void SubMesh::createIndexBuffer()
     UINT byteSize = static_cast<UINT>(indices.size() * sizeof(uint32_t));
 
     // 作成するバッファの仕様を決める
-    D3D11_BUFFER_DESC vbDesc = {};
-    vbDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;	    // デバイスにバインドするときの種類(インデックスバッファ)
-    vbDesc.ByteWidth = byteSize;				    // 作成するバッファのバイトサイズ
-    vbDesc.MiscFlags = 0;							// その他のフラグ
-    vbDesc.StructureByteStride = 0;					// 構造化バッファの場合、その構造体のサイズ
-    vbDesc.Usage = D3D11_USAGE_DEFAULT;				// 作成するバッファの使用法
-    vbDesc.CPUAccessFlags = 0;
-
-    // 上の仕様を渡して頂点バッファを作ってもらう
-    D3D11_SUBRESOURCE_DATA initData = { &indices.front(), byteSize, 0};	// 書き込むデータ
-
-    // 頂点バッファの作成
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&vbDesc, &initData, &indexBuffer);
+    BufferDesc vbDesc;
+    vbDesc.bindFlags = GpuBindIndexBuffer;	        // デバイスにバインドするときの種類(インデックスバッファ)
+    vbDesc.byteWidth = byteSize;				    // 作成するバッファのバイトサイズ
+    vbDesc.usage = GpuUsage::Default;				// 作成するバッファの使用法
+
+    // 上の仕様と書き込むデータを渡してインデックスバッファを作ってもらう
+    D3DManager::getInstance()->GetRenderDevice().createBuffer(vbDesc, &indices.front(), &indexBuffer);
 }
 
 
 void SubMesh::Render() const
 {
+    RenderStateCache& cache = D3DManager::getInstance()->GetStateCache();
+
     // 頂点バッファを描画で使えるようにセットする
-    UINT offset = 0;
-    D3DManager::getInstance()->GetContext()->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+    cache.setVertexBuffer(0, vertexBuffer.Get(), stride, 0);
 
     // プロミティブ・トポロジーをセット
-    D3DManager::getInstance()->GetContext()->IASetPrimitiveTopology(topology);
+    cache.setPrimitiveTopology(topology);
 
     // GPUへの描画命令発行
-    if (indices.size() > 0 && indexBuffer)
+    // NullRenderDevice ではバッファが nullptr のままなので、インデックスの有無だけで分ける
+    if (indices.size() > 0)
     {
         // インデックスバッファを使う場合
-        D3DManager::getInstance()->GetContext()->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-        D3DManager::getInstance()->GetContext()->DrawIndexed(static_cast<UINT>(indices.size()), 0, 0);
+        cache.setIndexBuffer(indexBuffer.Get(), GpuFormat::R32_UInt, 0);
+        cache.drawIndexed(static_cast<UINT>(indices.size()));
     }
     else
     {
         // 頂点データのみ場合
-        D3DManager::getInstance()->GetContext()->Draw(static_cast<UINT>(positions.size()), 0);
+        cache.draw(static_cast<UINT>(positions.size()));
+    }
+}
+
+
+void SubMesh::RenderInstanced(ID3D11Buffer* instanceBuffer, UINT instanceStride, UINT instanceCount, UINT startInstance) const
+{
+    RenderStateCache& cache = D3DManager::getInstance()->GetStateCache();
+
+    // 頂点バッファとインスタンスごとのデータのバッファをセットする
+    cache.setVertexBuffer(0, vertexBuffer.Get(), stride, 0);
+    cache.setVertexBuffer(Shader::InstanceSlot, instanceBuffer, instanceStride, 0);
+    cache.setPrimitiveTopology(topology);
+
+    if (indices.size() > 0)
+    {
+        cache.setIndexBuffer(indexBuffer.Get(), GpuFormat::R32_UInt, 0);
+        cache.drawIndexedInstanced(static_cast<UINT>(indices.size()), instanceCount, startInstance);
+    }
+    else
+    {
+        cache.drawInstanced(static_cast<UINT>(positions.size()), instanceCount, startInstance);
+    }
+}
+
+
+bool Mesh::getBounds(Bounds& bounds) const
+{
+    bool found = false;
+    Vector3 mn, mx;
+    for (auto& sub : submesh)
+    {
+        const Bounds& b = sub->getBounds();
+        if (!found)
+        {
+            mn = b.min();
+            mx = b.max();
+            found = true;
+        }
+        else
+        {
+            mn = Vector3::Min(mn, b.min());
+            mx = Vector3::Max(mx, b.max());
+        }
+    }
+    if (found)
+    {
+        bounds = Bounds((mn + mx) * 0.5f, (mx - mn) * 0.5f);
     }
+    return found;
 }
 
 
@@ -0,0 +1,229 @@
+﻿#include "pch.h"
+#include <UniDx/MeshCache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+#include <UniDx/SourceStamp.h>
+
+
+namespace UniDx
+{
+
+using namespace std;
+
+namespace
+{
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// out の位置が offset になるまで 0 を書く
+void padTo(ofstream& out, size_t offset)
+{
+    static const char zero[64] = {};
+    size_t pos = size_t(out.tellp());
+    while (pos < offset)
+    {
+        const size_t n = min(sizeof(zero), offset - pos);
+        out.write(zero, streamsize(n));
+        pos += n;
+    }
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 頂点の形式を表すキー
+// -----------------------------------------------------------------------------
+uint64_t MeshCache::LayoutKey(const D3D11_INPUT_ELEMENT_DESC* layout, size_t count, size_t stride)
+{
+    // 要素の並びが同じでも、頂点の大きさが違えば別の形式
+    return (Shader::LayoutKey(layout, count) ^ stride) * 1099511628211ull;
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出すファイルのパス
+// -----------------------------------------------------------------------------
+wstring MeshCache::GetCachePath(const wstring& sourcePath, uint64_t layoutKey)
+{
+    wchar_t suffix[32];
+    swprintf(suffix, 32, L".%016llx.umesh", static_cast<unsigned long long>(layoutKey));
+    return sourcePath + suffix;
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出す。途中のファイルを見せないよう、別の名前で書いてから置き換える
+// -----------------------------------------------------------------------------
+bool MeshCache::write_(const wstring& cachePath, const wstring& sourcePath, uint64_t layoutKey, UINT stride,
+    span<const shared_ptr<SubMesh>> submesh, const vector< vector<uint8_t> >& vertices,
+    span<const Node> nodes, int32_t addressU, int32_t addressV)
+{
+    Header header{};
+    header.magic = Magic;
+    header.version = Version;
+    header.layoutKey = layoutKey;
+    header.stride = stride;
+    header.subMeshCount = uint32_t(submesh.size());
+    header.nodeCount = uint32_t(nodes.size());
+    header.addressU = addressU;
+    header.addressV = addressV;
+    SourceStamp stamp;
+    if (!GetSourceStamp(sourcePath, stamp))
+    {
+        Debug::Log(L"MeshCache: 元のファイルを読めません: " + sourcePath);
+        return false;
+    }
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.sourceHash = stamp.hash;
+
+    // ノードの表と名前
+    string names;
+    vector<NodeEntry> nodeEntries(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const Node& node = nodes[i];
+        NodeEntry& e = nodeEntries[i];
+        e.parent = node.parent;
+        e.subMesh = node.subMesh;
+        e.nameOffset = uint32_t(names.size());
+        e.nameLength = uint32_t(node.name.size());
+        names += node.name;
+        memcpy(e.position, &node.position, sizeof(e.position));
+        memcpy(e.rotation, &node.rotation, sizeof(e.rotation));
+        memcpy(e.scale, &node.scale, sizeof(e.scale));
+    }
+    header.nameSize = uint32_t(names.size());
+
+    // サブメッシュの表。データの場所を先に決める
+    vector<SubMeshEntry> subEntries(submesh.size());
+    size_t offset = sizeof(Header) + sizeof(SubMeshEntry) * subEntries.size() + sizeof(NodeEntry) * nodeEntries.size() + names.size();
+    for (size_t i = 0; i < submesh.size(); ++i)
+    {
+        SubMesh& sub = *submesh[i];
+        const Bounds& bounds = sub.getBounds();
+        SubMeshEntry& e = subEntries[i];
+        e.topology = uint32_t(sub.topology);
+        e.vertexCount = uint32_t(sub.positions.size());
+        e.indexCount = uint32_t(sub.indices.size());
+        memcpy(e.boundsCenter, &bounds.Center, sizeof(e.boundsCenter));
+        memcpy(e.boundsExtents, &bounds.Extents, sizeof(e.boundsExtents));
+
+        e.vertexOffset = alignUp(offset, PageSize);
+        offset = e.vertexOffset + vertices[i].size();
+        e.positionOffset = alignUp(offset, 16);
+        offset = e.positionOffset + sub.positions.size_bytes();
+        e.indexOffset = alignUp(offset, 16);
+        offset = e.indexOffset + sub.indices.size_bytes();
+    }
+
+    const filesystem::path path(cachePath);
+    filesystem::path temp = path;
+    temp += L".tmp";
+    {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out)
+        {
+            Debug::Log(L"MeshCache: 書き出せません: " + cachePath);
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(subEntries.data()), streamsize(sizeof(SubMeshEntry) * subEntries.size()));
+        out.write(reinterpret_cast<const char*>(nodeEntries.data()), streamsize(sizeof(NodeEntry) * nodeEntries.size()));
+        out.write(names.data(), streamsize(names.size()));
+        for (size_t i = 0; i < submesh.size(); ++i)
+        {
+            const SubMesh& sub = *submesh[i];
+            const SubMeshEntry& e = subEntries[i];
+            padTo(out, size_t(e.vertexOffset));
+            out.write(reinterpret_cast<const char*>(vertices[i].data()), streamsize(vertices[i].size()));
+            padTo(out, size_t(e.positionOffset));
+            out.write(reinterpret_cast<const char*>(sub.positions.data()), streamsize(sub.positions.size_bytes()));
+            padTo(out, size_t(e.indexOffset));
+            out.write(reinterpret_cast<const char*>(sub.indices.data()), streamsize(sub.indices.size_bytes()));
+        }
+        if (!out)
+        {
+            Debug::Log(L"MeshCache: 書き出せません: " + cachePath);
+            return false;
+        }
+    }
+
+    error_code ec;
+    filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        filesystem::remove(temp, ec);
+        Debug::Log(L"MeshCache: 置き換えられません: " + cachePath);
+        return false;
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 開いて中身を確かめる
+// -----------------------------------------------------------------------------
+bool MeshCache::File::open(const wstring& cachePath, const wstring& sourcePath, uint64_t layoutKey, UINT stride)
+{
+    auto mapped = make_shared<MappedFile>();
+    if (!mapped->open(cachePath) || mapped->size() < sizeof(Header))
+    {
+        return false;
+    }
+
+    const Header& h = *reinterpret_cast<const Header*>(mapped->data());
+    if (h.magic != Magic || h.version != Version || h.layoutKey != layoutKey || h.stride != stride)
+    {
+        return false;
+    }
+
+    // 表がファイルに収まっているか
+    const size_t fileSize = mapped->size();
+    const size_t subOffset = sizeof(Header);
+    const size_t nodeOffset = subOffset + sizeof(SubMeshEntry) * size_t(h.subMeshCount);
+    const size_t nameOffset = nodeOffset + sizeof(NodeEntry) * size_t(h.nodeCount);
+    if (nameOffset + h.nameSize > fileSize)
+    {
+        return false;
+    }
+    span<const SubMeshEntry> subMeshes(reinterpret_cast<const SubMeshEntry*>(mapped->data() + subOffset), h.subMeshCount);
+    span<const NodeEntry> nodes(reinterpret_cast<const NodeEntry*>(mapped->data() + nodeOffset), h.nodeCount);
+    for (const SubMeshEntry& e : subMeshes)
+    {
+        if (e.vertexOffset + uint64_t(e.vertexCount) * stride > fileSize ||
+            e.positionOffset + uint64_t(e.vertexCount) * sizeof(Vector3) > fileSize ||
+            e.indexOffset + uint64_t(e.indexCount) * sizeof(uint32_t) > fileSize)
+        {
+            return false;
+        }
+    }
+    for (const NodeEntry& e : nodes)
+    {
+        if (uint64_t(e.nameOffset) + e.nameLength > h.nameSize || e.subMesh >= int32_t(h.subMeshCount) ||
+            e.parent >= int32_t(&e - nodes.data()))
+        {
+            return false;
+        }
+    }
+
+    if (!IsSourceUnchanged(sourcePath, SourceStamp{ h.sourceSize, h.sourceTime, h.sourceHash }))
+    {
+        return false;
+    }
+
+    mapped_ = move(mapped);
+    subMeshes_ = subMeshes;
+    nodes_ = nodes;
+    names_ = string_view(reinterpret_cast<const char*>(mapped_->data() + nameOffset), h.nameSize);
+    return true;
+}
+
+}
@@ -0,0 +1,28 @@
+﻿#include "pch.h"
+#include <UniDx/MeshData.h>
+
+
+namespace UniDx
+{
+
+void SubMeshData::RecalculateBounds()
+{
+    if (positions.empty())
+    {
+        bounds = Bounds(Vector3::Zero, Vector3::Zero);
+        hasBounds = true;
+        return;
+    }
+
+    Vector3 mn = positions[0];
+    Vector3 mx = positions[0];
+    for (const Vector3& p : positions)
+    {
+        mn = Vector3::Min(mn, p);
+        mx = Vector3::Max(mx, p);
+    }
+    bounds = Bounds((mn + mx) * 0.5f, (mx - mn) * 0.5f);
+    hasBounds = true;
+}
+
+}
@@ -0,0 +1,434 @@
+﻿#include "pch.h"
+#include <UniDx/MeshOptimizer.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+constexpr uint32_t Invalid = ~0u;
+
+
+// 頂点から三角形への隣接リスト
+struct TriangleAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    void build(std::span<const uint32_t> indices, size_t vertexCount)
+    {
+        offsets.assign(vertexCount + 1, 0);
+        for (uint32_t i : indices)
+        {
+            ++offsets[i + 1];
+        }
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+        triangles.resize(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t k = 0; k < indices.size(); ++k)
+        {
+            triangles[fill[indices[k]]++] = uint32_t(k / 3);
+        }
+    }
+
+    uint32_t count(uint32_t v) const { return offsets[v + 1] - offsets[v]; }
+};
+
+
+// 属性のバイト列をハッシュに混ぜる
+template<typename T>
+uint64_t HashAttribute(uint64_t h, std::span<const T> data, uint32_t v)
+{
+    if (data.empty()) return h;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&data[v]);
+    for (size_t k = 0; k < sizeof(T); ++k)
+    {
+        h = (h ^ p[k]) * 1099511628211ull;
+    }
+    return h;
+}
+
+template<typename T>
+bool EqualAttribute(std::span<const T> data, uint32_t a, uint32_t b)
+{
+    return data.empty() || std::memcmp(&data[a], &data[b], sizeof(T)) == 0;
+}
+
+
+// FIFO の頂点キャッシュで処理する頂点の数
+size_t CountCacheMisses(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    // 最後に入れた時刻が cacheSize 以上前なら追い出されている
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (uint32_t i : indices)
+    {
+        if (time - timestamps[i] > cacheSize)
+        {
+            timestamps[i] = time++;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 全属性が同じ頂点を1つにまとめる
+// -----------------------------------------------------------------------------
+size_t MeshOptimizer::WeldVertices(OwnedSubMesh& mesh)
+{
+    const size_t n = mesh.positions.size();
+    if (mesh.indices.empty())
+    {
+        mesh.resizeIndices(n);
+        auto& indices = const_cast<std::vector<uint32_t>&>(mesh.mutableIndices());
+        for (size_t i = 0; i < n; ++i) indices[i] = uint32_t(i);
+    }
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    auto hash = [&](uint32_t v)
+        {
+            uint64_t h = 14695981039346656037ull;
+            h = HashAttribute(h, mesh.positions, v);
+            h = HashAttribute(h, mesh.normals, v);
+            h = HashAttribute(h, mesh.colors, v);
+            h = HashAttribute(h, mesh.uv, v);
+            h = HashAttribute(h, mesh.uv2, v);
+            h = HashAttribute(h, mesh.uv3, v);
+            h = HashAttribute(h, mesh.uv4, v);
+            h = HashAttribute(h, mesh.joints, v);
+            h = HashAttribute(h, mesh.weights, v);
+            return h;
+        };
+    auto equal = [&](uint32_t a, uint32_t b)
+        {
+            return EqualAttribute(mesh.positions, a, b) && EqualAttribute(mesh.normals, a, b) &&
+                EqualAttribute(mesh.colors, a, b) && EqualAttribute(mesh.uv, a, b) &&
+                EqualAttribute(mesh.uv2, a, b) && EqualAttribute(mesh.uv3, a, b) && EqualAttribute(mesh.uv4, a, b) &&
+                EqualAttribute(mesh.joints, a, b) && EqualAttribute(mesh.weights, a, b);
+        };
+
+    // 開番地法のハッシュ表で、同じ頂点のうち最初のものを探す
+    size_t tableSize = 1;
+    while (tableSize < n * 2) tableSize <<= 1;
+    std::vector<uint32_t> table(tableSize, Invalid);
+
+    std::vector<uint32_t> remap(n);
+    size_t count = 0;
+    for (uint32_t v = 0; v < n; ++v)
+    {
+        size_t slot = size_t(hash(v)) & (tableSize - 1);
+        while (table[slot] != Invalid && !equal(table[slot], v))
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == Invalid)
+        {
+            table[slot] = v;
+            remap[v] = uint32_t(count++);
+        }
+        else
+        {
+            remap[v] = remap[table[slot]];
+        }
+    }
+
+    if (count < n)
+    {
+        mesh.remapVertices(remap, count);
+    }
+    return count;
+}
+
+
+// -----------------------------------------------------------------------------
+// Tipsify で三角形の順番を並べ替える
+//     Sander, Nehab, Barczak "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007)
+// -----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+    {
+        return;
+    }
+
+    TriangleAdjacency adjacency;
+    adjacency.build(indices.first(triangleCount * 3), vertexCount);
+
+    std::vector<uint32_t> live(vertexCount);                 // まだ出していない三角形の数
+    for (uint32_t v = 0; v < vertexCount; ++v) live[v] = adjacency.count(v);
+    std::vector<uint32_t> cacheTime(vertexCount, 0);         // キャッシュに入れた時刻
+    std::vector<uint8_t>  emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;                           // 最近使った頂点の積み上げ
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+
+    // 行き止まりでは最近使った頂点、なければ番号順にまだ三角形が残っている頂点から続ける
+    auto skipDeadEnd = [&]() -> uint32_t
+        {
+            while (!deadEnd.empty())
+            {
+                const uint32_t d = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[d] > 0) return d;
+            }
+            while (cursor < vertexCount)
+            {
+                if (live[cursor] > 0) return cursor;
+                ++cursor;
+            }
+            return Invalid;
+        };
+
+    uint32_t fan = skipDeadEnd();
+    while (fan != Invalid)
+    {
+        // fan を使う三角形をすべて出す
+        candidates.clear();
+        for (uint32_t k = adjacency.offsets[fan]; k < adjacency.offsets[fan + 1]; ++k)
+        {
+            const uint32_t t = adjacency.triangles[k];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+
+            for (int c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[t * 3 + c];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // 次の扇の中心は、残りの三角形を出してもキャッシュに残っている頂点のうち一番古いもの
+        uint32_t next = Invalid;
+        int best = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0) continue;
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+            {
+                priority = int(time - cacheTime[v]);
+            }
+            if (priority > best)
+            {
+                best = priority;
+                next = v;
+            }
+        }
+        fan = next != Invalid ? next : skipDeadEnd();
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+
+// -----------------------------------------------------------------------------
+// キャッシュを捨てる切れ目ごとのまとまりを、外を向いているものから描く順に並べる
+// -----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vector3> positions, uint32_t cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || positions.empty())
+    {
+        return;
+    }
+
+    // 3頂点とも処理し直す三角形で切る。そこで並べ替えてもキャッシュの効率はほとんど変わらない
+    std::vector<uint32_t> clusters;
+    {
+        std::vector<uint32_t> timestamps(positions.size(), 0);
+        uint32_t time = cacheSize + 1;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            int misses = 0;
+            for (int c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[t * 3 + c];
+                if (time - timestamps[v] > cacheSize)
+                {
+                    timestamps[v] = time++;
+                    ++misses;
+                }
+            }
+            if (t == 0 || misses == 3)
+            {
+                clusters.push_back(uint32_t(t));
+            }
+        }
+    }
+    if (clusters.size() <= 1)
+    {
+        return;
+    }
+
+    // メッシュ全体の中心
+    Vector3 meshCenter = Vector3::Zero;
+    for (const Vector3& p : positions) meshCenter += p;
+    meshCenter *= 1.0f / float(positions.size());
+
+    // まとまりの面積で重みづけした中心と法線から、外を向いている度合いを求める
+    struct Cluster
+    {
+        uint32_t begin;
+        uint32_t end;
+        float    sortKey;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const uint32_t begin = clusters[c];
+        const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : uint32_t(triangleCount);
+
+        Vector3 center = Vector3::Zero;
+        Vector3 normal = Vector3::Zero;
+        float area = 0.0f;
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            const Vector3& p0 = positions[indices[t * 3 + 0]];
+            const Vector3& p1 = positions[indices[t * 3 + 1]];
+            const Vector3& p2 = positions[indices[t * 3 + 2]];
+            const Vector3 n = (p1 - p0).Cross(p2 - p0);
+            const float a = n.Length();
+            center += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        if (area > 0.0f) center *= 1.0f / area;
+        normal.Normalize();
+        sorted[c] = { begin, end, (center - meshCenter).Dot(normal) };
+    }
+
+    // 外を向いているまとまりほど手前の面を覆いやすいので先に描く
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (const Cluster& c : sorted)
+    {
+        result.insert(result.end(), indices.begin() + c.begin * 3, indices.begin() + c.end * 3);
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+
+// -----------------------------------------------------------------------------
+// インデックスで最初に使う順に頂点を並べ替える
+// -----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(OwnedSubMesh& mesh)
+{
+    const size_t n = mesh.positions.size();
+    std::vector<uint32_t> remap(n, Invalid);
+    size_t count = 0;
+    for (uint32_t i : mesh.indices)
+    {
+        if (remap[i] == Invalid)
+        {
+            remap[i] = uint32_t(count++);
+        }
+    }
+    mesh.remapVertices(remap, count);
+}
+
+
+// -----------------------------------------------------------------------------
+// FIFO の頂点キャッシュでの ACMR / ATVR
+// -----------------------------------------------------------------------------
+float MeshOptimizer::ComputeACMR(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    const size_t triangles = indices.size() / 3;
+    return triangles > 0 ? float(CountCacheMisses(indices, vertexCount, cacheSize)) / float(triangles) : 0.0f;
+}
+
+
+float MeshOptimizer::ComputeATVR(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    std::vector<uint8_t> used(vertexCount, 0);
+    size_t unique = 0;
+    for (uint32_t i : indices)
+    {
+        if (!used[i])
+        {
+            used[i] = 1;
+            ++unique;
+        }
+    }
+    return unique > 0 ? float(CountCacheMisses(indices, vertexCount, cacheSize)) / float(unique) : 0.0f;
+}
+
+
+// -----------------------------------------------------------------------------
+// すべての最適化を行う
+// -----------------------------------------------------------------------------
+bool MeshOptimizer::Optimize(OwnedSubMesh& mesh, Stats* stats)
+{
+    if (mesh.topology != PrimitiveTopology::TriangleList)
+    {
+        return false;
+    }
+
+    // 範囲外のインデックスがあるものはそのままにする
+    const size_t n = mesh.positions.size();
+    if (std::any_of(mesh.indices.begin(), mesh.indices.end(), [n](uint32_t i) { return i >= n; }))
+    {
+        Debug::Log(L"MeshOptimizer: 範囲外のインデックスがあるので最適化しません");
+        return false;
+    }
+
+    Stats s;
+    s.verticesBefore = n;
+    const bool indexed = !mesh.indices.empty();
+    if (indexed)
+    {
+        s.acmrBefore = ComputeACMR(mesh.indices, n);
+        s.atvrBefore = ComputeATVR(mesh.indices, n);
+    }
+
+    WeldVertices(mesh);
+
+    auto& indices = const_cast<std::vector<uint32_t>&>(mesh.mutableIndices());
+    OptimizeVertexCache(indices, mesh.positions.size());
+    OptimizeOverdraw(indices, mesh.positions);
+    OptimizeVertexFetch(mesh);
+
+    s.verticesAfter = mesh.positions.size();
+    s.acmrAfter = ComputeACMR(mesh.indices, s.verticesAfter);
+    s.atvrAfter = ComputeATVR(mesh.indices, s.verticesAfter);
+    if (!indexed)
+    {
+        // インデックスがなかったときは、すべての頂点を処理していた
+        s.acmrBefore = 3.0f;
+        s.atvrBefore = s.verticesAfter > 0 ? float(n) / float(s.verticesAfter) : 0.0f;
+    }
+
+    if (stats != nullptr) *stats = s;
+    return true;
+}
+
+}
@@ -0,0 +1,625 @@
+﻿#include "pch.h"
+#include <UniDx/MeshSimplifier.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include <UniDx/Debug.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+constexpr uint32_t Invalid = ~0u;
+
+// 縁やシームの形を保つために、辺に垂直な面の誤差にかける重み
+constexpr float BorderWeight = 10.0f;
+
+// 縮約で面の向きがこれ以上変わるものは裏返りとみなす（cos）
+constexpr float FlipThreshold = 0.25f;
+
+// 縮約で面積がこれ以下の割合に潰れるものも裏返りとみなす。一直線に並ぶと丸めで向きが決まらないため
+constexpr float CollapseAreaRatio = 1.0e-3f;
+
+// 頂点の種類
+enum VertexKind : uint8_t
+{
+    Kind_Manifold,  // 閉じた面の内側。どの向きにも縮約できる
+    Kind_Border,    // 開いた縁。縁に沿ってだけ縮約できる
+    Kind_Seam,      // 同じ位置に2つの頂点があるシーム。シームに沿ってだけ縮約できる
+    Kind_Locked,    // 動かさない
+};
+
+
+// 対称な 4x4 行列で表した二次誤差
+struct Quadric
+{
+    float a00 = 0, a11 = 0, a22 = 0;
+    float a10 = 0, a20 = 0, a21 = 0;
+    float b0 = 0, b1 = 0, b2 = 0;
+    float c = 0;
+    float w = 0;
+
+    void add(const Quadric& q)
+    {
+        a00 += q.a00; a11 += q.a11; a22 += q.a22;
+        a10 += q.a10; a20 += q.a20; a21 += q.a21;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        w += q.w;
+    }
+
+    // 平面 n・p + d = 0 からの距離の2乗を weight の重みで足す
+    void addPlane(const Vector3& n, float d, float weight)
+    {
+        a00 += n.x * n.x * weight; a11 += n.y * n.y * weight; a22 += n.z * n.z * weight;
+        a10 += n.y * n.x * weight; a20 += n.z * n.x * weight; a21 += n.z * n.y * weight;
+        b0 += n.x * d * weight; b1 += n.y * d * weight; b2 += n.z * d * weight;
+        c += d * d * weight;
+        w += weight;
+    }
+
+    // p に置いたときの誤差。重みで割って距離の2乗にそろえる
+    float evaluate(const Vector3& p) const
+    {
+        const float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+        const float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+        const float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+        const float r = rx * p.x + ry * p.y + rz * p.z + 2 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return w > 0 ? std::abs(r) / w : 0.0f;
+    }
+};
+
+
+// 縮約の候補。v0 を v1 に寄せる
+struct Collapse
+{
+    uint32_t v0;
+    uint32_t v1;
+    float    error;
+};
+
+
+// 頂点から出る辺（三角形の向き）の隣接リスト
+struct EdgeAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> targets;
+
+    void build(std::span<const uint32_t> indices, size_t vertexCount)
+    {
+        offsets.assign(vertexCount + 1, 0);
+        for (uint32_t i : indices)
+        {
+            ++offsets[i + 1];
+        }
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+
+        targets.resize(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                targets[fill[indices[t + e]]++] = indices[t + (e + 1) % 3];
+            }
+        }
+    }
+
+    bool hasEdge(uint32_t a, uint32_t b) const
+    {
+        for (uint32_t k = offsets[a]; k < offsets[a + 1]; ++k)
+        {
+            if (targets[k] == b) return true;
+        }
+        return false;
+    }
+};
+
+
+// 位置が同じ頂点をまとめる。remap は代表の頂点、wedge は同じ位置の頂点をたどる輪
+void BuildPositionRemap(std::span<const Vector3> positions, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge)
+{
+    struct Key
+    {
+        uint32_t x, y, z;
+        bool operator==(const Key& k) const { return x == k.x && y == k.y && z == k.z; }
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const { return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u); }
+    };
+
+    const size_t n = positions.size();
+    remap.resize(n);
+    wedge.resize(n);
+
+    std::unordered_map<Key, uint32_t, KeyHash> table;
+    table.reserve(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        Key key;
+        std::memcpy(&key, &positions[i], sizeof(key));
+        auto [it, inserted] = table.try_emplace(key, i);
+        remap[i] = it->second;
+        wedge[i] = i;
+        if (!inserted)
+        {
+            // 代表の輪に差し込む
+            const uint32_t r = it->second;
+            wedge[i] = wedge[r];
+            wedge[r] = i;
+        }
+    }
+}
+
+
+// 開いた辺をたどって頂点の種類を決める
+void ClassifyVertices(
+    const EdgeAdjacency& adjacency,
+    const std::vector<uint32_t>& remap,
+    const std::vector<uint32_t>& wedge,
+    bool lockBorder,
+    std::vector<uint8_t>& kind,
+    std::vector<uint32_t>& loop,
+    std::vector<uint32_t>& loopback)
+{
+    const size_t n = remap.size();
+    kind.assign(n, Kind_Locked);
+    loop.assign(n, Invalid);
+    loopback.assign(n, Invalid);
+
+    // 逆向きの辺がない辺は開いている。2本目が見つかった頂点は自分を入れて複雑な点の印にする
+    for (uint32_t v = 0; v < n; ++v)
+    {
+        for (uint32_t k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; ++k)
+        {
+            const uint32_t t = adjacency.targets[k];
+            if (!adjacency.hasEdge(t, v))
+            {
+                loop[v] = loop[v] == Invalid ? t : v;
+                loopback[t] = loopback[t] == Invalid ? v : t;
+            }
+        }
+    }
+
+    // 同じ位置の頂点のどれかから b への辺があるか
+    auto hasWeldedEdge = [&](uint32_t a, uint32_t b)
+        {
+            uint32_t w = a;
+            do
+            {
+                for (uint32_t k = adjacency.offsets[w]; k < adjacency.offsets[w + 1]; ++k)
+                {
+                    if (remap[adjacency.targets[k]] == remap[b]) return true;
+                }
+                w = wedge[w];
+            } while (w != a);
+            return false;
+        };
+
+    auto isSimple = [&](uint32_t v) { return loop[v] != Invalid && loopback[v] != Invalid && loop[v] != v && loopback[v] != v; };
+
+    for (uint32_t v = 0; v < n; ++v)
+    {
+        if (wedge[v] == v)
+        {
+            if (loop[v] == Invalid && loopback[v] == Invalid)
+            {
+                kind[v] = Kind_Manifold;
+            }
+            else if (isSimple(v) && !hasWeldedEdge(loop[v], v) && !hasWeldedEdge(v, loopback[v]))
+            {
+                kind[v] = lockBorder ? Kind_Locked : Kind_Border;
+            }
+        }
+        else if (wedge[wedge[v]] == v)
+        {
+            // 2つの頂点の開いた辺が、位置として向かい合っていればシーム
+            const uint32_t s = wedge[v];
+            if (isSimple(v) && isSimple(s) &&
+                remap[loop[v]] == remap[loopback[s]] && remap[loopback[v]] == remap[loop[s]])
+            {
+                kind[v] = Kind_Seam;
+            }
+        }
+    }
+}
+
+
+// v を t に寄せてよいか
+bool CanCollapse(uint32_t v, uint32_t t, const std::vector<uint8_t>& kind, const std::vector<uint32_t>& loop, const std::vector<uint32_t>& loopback)
+{
+    switch (kind[v])
+    {
+    case Kind_Manifold:
+        return true;
+    case Kind_Border:
+    case Kind_Seam:
+        return kind[t] == kind[v] && (loop[v] == t || loopback[v] == t);
+    default:
+        return false;
+    }
+}
+
+
+// シームの v を t に寄せるとき、反対側の頂点の寄せ先
+uint32_t SeamSiblingTarget(uint32_t v, uint32_t t, const std::vector<uint32_t>& remap, const std::vector<uint32_t>& wedge,
+    const std::vector<uint32_t>& loop, const std::vector<uint32_t>& loopback)
+{
+    const uint32_t s = wedge[v];
+    if (loop[s] != Invalid && remap[loop[s]] == remap[t]) return loop[s];
+    if (loopback[s] != Invalid && remap[loopback[s]] == remap[t]) return loopback[s];
+    return Invalid;
+}
+
+
+// 使われている頂点の属性を詰めてコピー
+template<typename T>
+void CopyUsed(std::span<const T> src, const std::vector<uint32_t>& used, const std::vector<T>& dst)
+{
+    T* out = const_cast<std::vector<T>&>(dst).data();
+    for (size_t k = 0; k < used.size(); ++k)
+    {
+        out[k] = src[used[k]];
+    }
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 三角形リストのインデックスを簡略化
+// -----------------------------------------------------------------------------
+size_t MeshSimplifier::SimplifyIndices(
+    std::span<const Vector3> positions,
+    std::span<const uint32_t> indices,
+    std::vector<uint32_t>& out,
+    size_t targetIndexCount,
+    float maxError,
+    bool lockBorder,
+    float* error)
+{
+    const size_t n = positions.size();
+    out.clear();
+    out.reserve(indices.size());
+    if (error != nullptr) *error = 0.0f;
+
+    // 範囲外のインデックスや最初から潰れている三角形は除く
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        const uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+        if (a >= n || b >= n || c >= n || a == b || b == c || c == a) continue;
+        out.insert(out.end(), { a, b, c });
+    }
+    if (out.size() <= targetIndexCount || n == 0)
+    {
+        return out.size();
+    }
+
+    // 大きさによらず誤差を比べられるよう、一番長い辺が 1 になるように縮める
+    Vector3 mn = positions[0], mx = positions[0];
+    for (const Vector3& p : positions)
+    {
+        mn = Vector3::Min(mn, p);
+        mx = Vector3::Max(mx, p);
+    }
+    const Vector3 size = mx - mn;
+    const float extent = std::max({ size.x, size.y, size.z });
+    const float scale = extent > 0 ? 1.0f / extent : 1.0f;
+    std::vector<Vector3> pos(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        pos[i] = (positions[i] - mn) * scale;
+    }
+
+    std::vector<uint32_t> remap, wedge;
+    BuildPositionRemap(positions, remap, wedge);
+
+    EdgeAdjacency adjacency;
+    adjacency.build(out, n);
+
+    std::vector<uint8_t> kind;
+    std::vector<uint32_t> loop, loopback;
+    ClassifyVertices(adjacency, remap, wedge, lockBorder, kind, loop, loopback);
+
+    // 位置ごとの二次誤差。面の平面と、開いた辺に垂直な面を足しておく
+    std::vector<Quadric> quadrics(n);
+    for (size_t t = 0; t < out.size(); t += 3)
+    {
+        const uint32_t i[3] = { out[t], out[t + 1], out[t + 2] };
+        const Vector3 e1 = pos[i[1]] - pos[i[0]];
+        const Vector3 e2 = pos[i[2]] - pos[i[0]];
+        Vector3 normal = e1.Cross(e2);
+        const float area = normal.Length();
+        if (area <= 0) continue;
+        normal *= 1.0f / area;
+
+        const float d = -normal.Dot(pos[i[0]]);
+        for (int k = 0; k < 3; ++k)
+        {
+            quadrics[remap[i[k]]].addPlane(normal, d, area * 0.5f);
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t a = i[k], b = i[(k + 1) % 3];
+            if (kind[a] == Kind_Manifold && kind[b] == Kind_Manifold) continue;
+            if (adjacency.hasEdge(b, a)) continue;
+
+            const Vector3 edge = pos[b] - pos[a];
+            const float length = edge.Length();
+            Vector3 edgeNormal = edge.Cross(normal);
+            if (length <= 0 || edgeNormal.LengthSquared() <= 0) continue;
+            edgeNormal.Normalize();
+            const float edgeD = -edgeNormal.Dot(pos[a]);
+            quadrics[remap[a]].addPlane(edgeNormal, edgeD, length * BorderWeight);
+            quadrics[remap[b]].addPlane(edgeNormal, edgeD, length * BorderWeight);
+        }
+    }
+
+    const float errorLimit = maxError * maxError;
+    float resultError = 0.0f;
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapseRemap(n);
+    std::vector<uint8_t> locked(n);
+    std::vector<uint32_t> triangleOffsets(n + 1);
+    std::vector<uint32_t> triangles;
+
+    while (out.size() > targetIndexCount)
+    {
+        // 位置ごとに、その位置を使う三角形の一覧を作る
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (uint32_t i : out)
+        {
+            ++triangleOffsets[remap[i] + 1];
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        }
+        triangles.resize(out.size());
+        {
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t k = 0; k < out.size(); ++k)
+            {
+                triangles[fill[remap[out[k]]]++] = uint32_t(k / 3);
+            }
+        }
+
+        // 辺ごとに誤差の小さい向きを候補にする
+        collapses.clear();
+        for (size_t t = 0; t < out.size(); t += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                const uint32_t a = out[t + e], b = out[t + (e + 1) % 3];
+                if (remap[a] == remap[b]) continue;
+
+                const bool ab = CanCollapse(a, b, kind, loop, loopback);
+                const bool ba = CanCollapse(b, a, kind, loop, loopback);
+                if (!ab && !ba) continue;
+
+                const float eab = ab ? quadrics[remap[a]].evaluate(pos[b]) : std::numeric_limits<float>::max();
+                const float eba = ba ? quadrics[remap[b]].evaluate(pos[a]) : std::numeric_limits<float>::max();
+                collapses.push_back(eab <= eba ? Collapse{ a, b, eab } : Collapse{ b, a, eba });
+            }
+        }
+        if (collapses.empty()) break;
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // 誤差の小さい順に、同じ回で周りが重ならないものを縮約する
+        for (uint32_t i = 0; i < n; ++i) collapseRemap[i] = i;
+        std::fill(locked.begin(), locked.end(), 0);
+
+        const size_t triangleGoal = (out.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        size_t performed = 0;
+        for (const Collapse& c : collapses)
+        {
+            if (c.error > errorLimit) break;
+
+            const uint32_t r0 = remap[c.v0];
+            const uint32_t r1 = remap[c.v1];
+            if (locked[r0] || locked[r1]) continue;
+
+            uint32_t sibling = Invalid, siblingTarget = Invalid;
+            if (kind[c.v0] == Kind_Seam)
+            {
+                sibling = wedge[c.v0];
+                siblingTarget = SeamSiblingTarget(c.v0, c.v1, remap, wedge, loop, loopback);
+                if (siblingTarget == Invalid) continue;
+            }
+
+            // 残る三角形の向きが大きく変わるなら裏返るので止める
+            bool flipped = false;
+            for (uint32_t k = triangleOffsets[r0]; k < triangleOffsets[r0 + 1] && !flipped; ++k)
+            {
+                const uint32_t* tri = &out[triangles[k] * 3];
+                Vector3 p[3], q[3];
+                bool hasTarget = false;
+                for (int j = 0; j < 3; ++j)
+                {
+                    p[j] = pos[tri[j]];
+                    q[j] = remap[tri[j]] == r0 ? pos[c.v1] : p[j];
+                    hasTarget |= remap[tri[j]] == r1;
+                }
+                if (hasTarget) continue;
+
+                const Vector3 n0 = (p[1] - p[0]).Cross(p[2] - p[0]);
+                const Vector3 n1 = (q[1] - q[0]).Cross(q[2] - q[0]);
+                flipped = n0.Dot(n1) <= FlipThreshold * std::sqrt(n0.LengthSquared() * n1.LengthSquared()) ||
+                    n1.LengthSquared() <= CollapseAreaRatio * CollapseAreaRatio * n0.LengthSquared();
+            }
+            if (flipped) continue;
+
+            collapseRemap[c.v0] = c.v1;
+            if (sibling != Invalid)
+            {
+                collapseRemap[sibling] = siblingTarget;
+            }
+            quadrics[r1].add(quadrics[r0]);
+
+            // 周りの三角形の頂点はこの回では動かさない
+            for (uint32_t k = triangleOffsets[r0]; k < triangleOffsets[r0 + 1]; ++k)
+            {
+                const uint32_t* tri = &out[triangles[k] * 3];
+                locked[remap[tri[0]]] = locked[remap[tri[1]]] = locked[remap[tri[2]]] = 1;
+            }
+
+            resultError = std::max(resultError, c.error);
+            removed += kind[c.v0] == Kind_Border ? 1 : 2;
+            ++performed;
+            if (removed >= triangleGoal) break;
+        }
+        if (performed == 0) break;
+
+        // インデックスを付け替え、潰れた三角形を除く
+        size_t write = 0;
+        for (size_t t = 0; t < out.size(); t += 3)
+        {
+            const uint32_t a = collapseRemap[out[t]], b = collapseRemap[out[t + 1]], c = collapseRemap[out[t + 2]];
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a]) continue;
+            out[write++] = a;
+            out[write++] = b;
+            out[write++] = c;
+        }
+        out.resize(write);
+    }
+
+    if (error != nullptr) *error = std::sqrt(resultError);
+    return out.size();
+}
+
+
+// -----------------------------------------------------------------------------
+// サブメッシュを簡略化
+// -----------------------------------------------------------------------------
+std::shared_ptr<OwnedSubMeshData> MeshSimplifier::Simplify(const SubMeshData& source, const Settings& settings, float* error)
+{
+    if (source.topology != PrimitiveTopology::TriangleList)
+    {
+        Debug::Log(L"MeshSimplifier: 三角形リストではないので簡略化できません");
+        return nullptr;
+    }
+
+    // インデックスがなければ頂点の順に三角形を作る
+    std::vector<uint32_t> sequential;
+    std::span<const uint32_t> indices = source.indices;
+    if (indices.empty())
+    {
+        sequential.resize(source.positions.size());
+        for (size_t i = 0; i < sequential.size(); ++i) sequential[i] = uint32_t(i);
+        indices = sequential;
+    }
+
+    const size_t target = size_t(float(indices.size() / 3) * std::clamp(settings.targetRatio, 0.0f, 1.0f)) * 3;
+    std::vector<uint32_t> simplified;
+    SimplifyIndices(source.positions, indices, simplified, target, settings.maxError, settings.lockBorder, error);
+
+    // 使われている頂点を出てくる順に詰める
+    std::vector<uint32_t> newIndex(source.positions.size(), Invalid);
+    std::vector<uint32_t> used;
+    for (uint32_t& i : simplified)
+    {
+        if (newIndex[i] == Invalid)
+        {
+            newIndex[i] = uint32_t(used.size());
+            used.push_back(i);
+        }
+        i = newIndex[i];
+    }
+
+    auto result = std::make_shared<OwnedSubMeshData>();
+    result->topology = source.topology;
+
+    const size_t n = source.positions.size();
+    result->resizePositions(used.size());
+    CopyUsed(source.positions, used, result->mutablePositions());
+    if (source.normals.size() == n)
+    {
+        result->resizeNormals(used.size());
+        CopyUsed(source.normals, used, result->mutableNormals());
+    }
+    if (source.colors.size() == n)
+    {
+        result->resizeColors(used.size());
+        CopyUsed(source.colors, used, result->mutableColors());
+    }
+    if (source.uv.size() == n)
+    {
+        result->resizeUV(used.size());
+        CopyUsed(source.uv, used, result->mutableUV());
+    }
+    if (source.uv2.size() == n)
+    {
+        result->resizeUV2(used.size());
+        CopyUsed(source.uv2, used, result->mutableUV2());
+    }
+    if (source.uv3.size() == n)
+    {
+        result->resizeUV3(used.size());
+        CopyUsed(source.uv3, used, result->mutableUV3());
+    }
+    if (source.uv4.size() == n)
+    {
+        result->resizeUV4(used.size());
+        CopyUsed(source.uv4, used, result->mutableUV4());
+    }
+    if (source.joints.size() == n && source.weights.size() == n)
+    {
+        result->resizeJoints(used.size());
+        CopyUsed(source.joints, used, result->mutableJoints());
+        result->resizeWeights(used.size());
+        CopyUsed(source.weights, used, result->mutableWeights());
+    }
+
+    result->resizeIndices(simplified.size());
+    std::copy(simplified.begin(), simplified.end(), const_cast<std::vector<uint32_t>&>(result->mutableIndices()).begin());
+
+    result->RecalculateBounds();
+    return result;
+}
+
+
+// -----------------------------------------------------------------------------
+// 割合ごとの LOD を順に作る
+// -----------------------------------------------------------------------------
+std::vector<std::shared_ptr<OwnedSubMeshData>> MeshSimplifier::BuildLODChain(
+    const SubMeshData& source, std::span<const float> ratios, float maxError)
+{
+    std::vector<std::shared_ptr<OwnedSubMeshData>> chain;
+    const size_t sourceTriangles = (source.indices.empty() ? source.positions.size() : source.indices.size()) / 3;
+
+    const SubMeshData* previous = &source;
+    size_t previousTriangles = sourceTriangles;
+    for (float ratio : ratios)
+    {
+        // 元の三角形の数に対する割合を、1つ前の段に対する割合に直す
+        Settings settings;
+        settings.maxError = maxError;
+        settings.targetRatio = previousTriangles > 0 ? ratio * float(sourceTriangles) / float(previousTriangles) : 1.0f;
+
+        auto lod = Simplify(*previous, settings);
+        if (lod == nullptr)
+        {
+            return {};
+        }
+        previousTriangles = lod->indices.size() / 3;
+        chain.push_back(lod);
+        previous = chain.back().get();
+    }
+    return chain;
+}
+
+}
@@ -0,0 +1,162 @@
+﻿#include "pch.h"
+#include <UniDx/NullRenderDevice.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// リソースの作成。数えるだけで、作成したものは nullptr
+// -----------------------------------------------------------------------------
+bool NullRenderDevice::createBuffer(const BufferDesc& desc, const void* initialData, ID3D11Buffer** buffer)
+{
+    *buffer = nullptr;
+    ++stats_.resourcesCreated;
+    if (initialData != nullptr)
+    {
+        stats_.bytesUploaded += desc.byteWidth;
+    }
+    return true;
+}
+
+
+bool NullRenderDevice::createTexture2D(const Texture2DDesc& desc, const SubresourceData* initialData, ID3D11Texture2D** texture)
+{
+    *texture = nullptr;
+    ++stats_.resourcesCreated;
+    if (initialData != nullptr)
+    {
+        for (uint32_t i = 0; i < desc.mipLevels * desc.arraySize; ++i)
+        {
+            stats_.bytesUploaded += initialData[i].byteSize;
+        }
+    }
+    return true;
+}
+
+
+bool NullRenderDevice::createShaderResourceView(ID3D11Resource*, const ShaderResourceViewDesc&, ID3D11ShaderResourceView** view)
+{
+    *view = nullptr;
+    ++stats_.resourcesCreated;
+    return true;
+}
+
+
+bool NullRenderDevice::createDepthStencilState(const DepthStencilDesc&, ID3D11DepthStencilState** state)
+{
+    *state = nullptr;
+    ++stats_.resourcesCreated;
+    return true;
+}
+
+
+bool NullRenderDevice::createSamplerState(const SamplerDesc&, ID3D11SamplerState** state)
+{
+    *state = nullptr;
+    ++stats_.resourcesCreated;
+    return true;
+}
+
+
+bool NullRenderDevice::createVertexShader(const void*, size_t, ID3D11VertexShader** shader)
+{
+    *shader = nullptr;
+    ++stats_.resourcesCreated;
+    return true;
+}
+
+
+bool NullRenderDevice::createPixelShader(const void*, size_t, ID3D11PixelShader** shader)
+{
+    *shader = nullptr;
+    ++stats_.resourcesCreated;
+    return true;
+}
+
+
+bool NullRenderDevice::createInputLayout(const InputElementDesc*, uint32_t, const void*, size_t, ID3D11InputLayout** layout)
+{
+    *layout = nullptr;
+    ++stats_.resourcesCreated;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 転送
+// -----------------------------------------------------------------------------
+void NullRenderDevice::updateBuffer(ID3D11Buffer*, const void*, uint32_t size)
+{
+    stats_.bytesUploaded += size;
+}
+
+
+void* NullRenderDevice::mapBuffer(ID3D11Buffer*, uint32_t size, bool)
+{
+    if (scratch_.size() < size)
+    {
+        scratch_.resize(size);
+    }
+    return scratch_.data();
+}
+
+
+void NullRenderDevice::unmapBuffer(ID3D11Buffer*, uint32_t bytesWritten)
+{
+    stats_.bytesUploaded += bytesWritten;
+}
+
+
+void* NullRenderDevice::mapStagingBuffer(ID3D11Buffer* buffer, uint32_t size)
+{
+    return mapBuffer(buffer, size, true);
+}
+
+
+void NullRenderDevice::unmapStagingBuffer(ID3D11Buffer*)
+{
+}
+
+
+void NullRenderDevice::copyBuffer(ID3D11Buffer*, ID3D11Buffer*, uint32_t size)
+{
+    stats_.bytesUploaded += size;
+}
+
+
+void NullRenderDevice::copySubresource(ID3D11Resource*, uint32_t, ID3D11Resource*, uint32_t, uint32_t size)
+{
+    stats_.bytesUploaded += size;
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画命令
+// -----------------------------------------------------------------------------
+void NullRenderDevice::draw(uint32_t vertexCount)
+{
+    drawInstanced(vertexCount, 1, 0);
+}
+
+
+void NullRenderDevice::drawIndexed(uint32_t indexCount)
+{
+    drawInstanced(indexCount, 1, 0);
+}
+
+
+void NullRenderDevice::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t)
+{
+    ++stats_.drawCalls;
+    stats_.instances += instanceCount;
+    stats_.vertices += uint64_t(vertexCount) * instanceCount;
+}
+
+
+void NullRenderDevice::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance)
+{
+    drawInstanced(indexCount, instanceCount, startInstance);
+}
+
+}
@@ -0,0 +1,41 @@
+﻿#include "pch.h"
+#include <UniDx/Object.h>
+
+#include <UniDx/Prefab.h>
+#include <UniDx/SceneCommandBuffer.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// プレハブから GameObject を作成
+// -----------------------------------------------------------------------------
+GameObject* Object::Instantiate(Prefab& prefab, const Vector3& position, const DirectX::SimpleMath::Quaternion& rotation)
+{
+    return prefab.Instantiate(position, rotation);
+}
+
+
+// -----------------------------------------------------------------------------
+// GameObject をシーンに追加
+// -----------------------------------------------------------------------------
+GameObject* Object::Instantiate(unique_ptr<GameObject> gameObject, Transform* parent)
+{
+    return SceneCommandBuffer::getInstance()->spawn(std::move(gameObject), parent);
+}
+
+
+// -----------------------------------------------------------------------------
+// GameObject の破棄
+// -----------------------------------------------------------------------------
+void Object::Destroy(GameObject* gameObject, float delay)
+{
+    if (gameObject == nullptr)
+    {
+        return;
+    }
+    SceneCommandBuffer::getInstance()->destroy(gameObject, delay);
+}
+
+}
@@ -0,0 +1,80 @@
+﻿#include "pch.h"
+#include <UniDx/ParallelRecorder.h>
+
+#include <algorithm>
+
+#include <UniDx/JobSystem.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 記録したコマンドを実行順に並べる
+// -----------------------------------------------------------------------------
+void NullRecordingBackend::execute(size_t slot)
+{
+    executed_.insert(executed_.end(), slots_[slot].begin(), slots_[slot].end());
+    ++executedLists_;
+}
+
+
+// -----------------------------------------------------------------------------
+// count 個を parts 個の連続区間に分ける
+// -----------------------------------------------------------------------------
+void ParallelRecorder::Partition(size_t count, size_t parts, std::vector<size_t>& bounds)
+{
+    parts = std::max<size_t>(parts, 1);
+    bounds.resize(parts + 1);
+
+    // 余りは前の区間から1つずつ配る
+    const size_t base = count / parts;
+    const size_t rest = count % parts;
+    bounds[0] = 0;
+    for (size_t k = 0; k < parts; ++k)
+    {
+        bounds[k + 1] = bounds[k] + base + (k < rest ? 1 : 0);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// count 個の項目を区間ごとに並列に記録し、元の順で実行する
+// -----------------------------------------------------------------------------
+size_t ParallelRecorder::record(RecordingBackend& backend, size_t count, const RecordFunc& recordRange)
+{
+    if (backend.getSlotCount() == 0 || count == 0)
+    {
+        return 0;
+    }
+
+    JobSystem* jobs = JobSystem::getInstance();
+    const size_t threads = jobs != nullptr ? jobs->getThreadCount() : 1;
+    const size_t byItems = (count + minItemsPerSlot_ - 1) / minItemsPerSlot_;
+    const size_t parts = std::max<size_t>(1, std::min({ backend.getSlotCount(), threads, byItems }));
+    Partition(count, parts, bounds_);
+
+    auto job = [&](size_t k)
+        {
+            backend.beginRecording(k);
+            recordRange(k, bounds_[k], bounds_[k + 1]);
+            backend.endRecording(k);
+        };
+    if (jobs != nullptr && parts > 1)
+    {
+        jobs->parallelFor(parts, job);
+    }
+    else
+    {
+        for (size_t k = 0; k < parts; ++k) job(k);
+    }
+
+    // 記録が終わったら元の順で実行
+    for (size_t k = 0; k < parts; ++k)
+    {
+        backend.execute(k);
+    }
+    return parts;
+}
+
+}
@@ -0,0 +1,160 @@
+﻿#include "pch.h"
+#include <UniDx/Prefab.h>
+
+#include <algorithm>
+
+#include <UniDx/SceneCommandBuffer.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// コンストラクタ
+// -----------------------------------------------------------------------------
+Prefab::Prefab(const wstring& name, Factory factory) :
+    name_(name),
+    factory_(std::move(factory))
+{
+}
+
+
+// -----------------------------------------------------------------------------
+// デストラクタ
+// シーンに残っているオブジェクトはプールとの関係を切って通常のオブジェクトにする
+// ルートが先に消えていれば root_ は onRootDestroyed で nullptr になっている
+// -----------------------------------------------------------------------------
+Prefab::~Prefab()
+{
+    if (root_ != nullptr)
+    {
+        root_->poolRootOf_ = nullptr;
+        for (auto& child : root_->transform->getChildGameObjects())
+        {
+            child->prefab_ = nullptr;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// あらかじめ count 個になるまで作っておく
+// -----------------------------------------------------------------------------
+void Prefab::Prewarm(size_t count)
+{
+    free_.reserve(count);
+    while (countAll_ < count)
+    {
+        GameObject* gameObject = create();
+        gameObject->inPool_ = true;
+        free_.push_back(gameObject);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 空いているオブジェクトを取り出して有効にする
+// -----------------------------------------------------------------------------
+GameObject* Prefab::Instantiate(const Vector3& position, const DirectX::SimpleMath::Quaternion& rotation)
+{
+    GameObject* gameObject;
+    if (free_.empty())
+    {
+        gameObject = create();
+    }
+    else
+    {
+        gameObject = free_.back();
+        free_.pop_back();
+    }
+    gameObject->inPool_ = false;
+
+    // プールのルートは原点にあるので、ローカル姿勢がそのままワールド姿勢になる
+    gameObject->transform->localPosition = position;
+    gameObject->transform->localRotation = rotation;
+    gameObject->SetActive(true);
+    return gameObject;
+}
+
+
+// -----------------------------------------------------------------------------
+// オブジェクトを非アクティブにしてプールに返す
+// -----------------------------------------------------------------------------
+void Prefab::Release(GameObject* gameObject)
+{
+    if (gameObject == nullptr || gameObject->prefab_ != this)
+    {
+        Debug::Log(L"Prefab::Release このプールのオブジェクトではありません");
+        return;
+    }
+
+    // 二重に返したものは無視
+    // ゲーム側で非アクティブにしただけのものは、まだ使用中なので返す
+    if (gameObject->inPool_)
+    {
+        return;
+    }
+
+    gameObject->SetActive(false);
+    gameObject->inPool_ = true;
+    free_.push_back(gameObject);
+}
+
+
+// -----------------------------------------------------------------------------
+// 非アクティブな状態で1つ作る
+// -----------------------------------------------------------------------------
+GameObject* Prefab::create()
+{
+    if (root_ == nullptr)
+    {
+        root_ = SceneCommandBuffer::getInstance()->spawn(make_unique<GameObject>(L"Pool " + name_));
+        root_->poolRootOf_ = this;
+    }
+
+    std::unique_ptr<GameObject> gameObject = factory_();
+    GameObject* ptr = gameObject.get();
+    ptr->prefab_ = this;
+    ptr->SetActive(false);
+
+    SceneCommandBuffer::getInstance()->spawn(std::move(gameObject), root_->transform);
+    ++countAll_;
+
+    // 返却時に確保が起きないよう、空きリストは全数分確保しておく
+    free_.reserve(countAll_);
+    return ptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// プールのルートが消えた
+//     子のオブジェクトもこのあと一緒に消えるので、プールとの関係を切って数から除く
+// -----------------------------------------------------------------------------
+void Prefab::onRootDestroyed()
+{
+    for (auto& child : root_->transform->getChildGameObjects())
+    {
+        if (child->prefab_ == this)
+        {
+            child->prefab_ = nullptr;
+            --countAll_;
+        }
+    }
+    free_.erase(std::remove_if(free_.begin(), free_.end(), [](GameObject* g) { return g->prefab_ == nullptr; }), free_.end());
+    root_ = nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// 作ったものが、ルートの外に移されてから消えた
+// -----------------------------------------------------------------------------
+void Prefab::onObjectDestroyed(GameObject* gameObject)
+{
+    if (gameObject->inPool_)
+    {
+        free_.erase(std::find(free_.begin(), free_.end(), gameObject));
+    }
+    --countAll_;
+}
+
+}
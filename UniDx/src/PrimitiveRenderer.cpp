@@ -3,6 +3,7 @@
 
 #include <UniDx/Texture.h>
 #include <UniDx/Camera.h>
+#include <UniDx/MeshOptimizer.h>
 
 // キューブの1面あたり4頂点、3面で12頂点、2セットで24頂点
 namespace {
@@ -58,22 +59,29 @@ constexpr Vector3 cube_normals[] = {
 
 namespace UniDx {
 
-void CubeRenderer::OnEnable()
+std::shared_ptr<SubMesh> CubeRenderer::createSubMesh()
 {
-    MeshRenderer::OnEnable();
-
-    // メッシュの初期化
-    auto submesh = std::make_unique<SubMesh>();
+    auto submesh = std::make_shared<SubMesh>();
     submesh->positions = std::span<const Vector3>(cube_positions, std::size(cube_positions));
     submesh->uv = std::span<const Vector2>(cube_uvs, std::size(cube_uvs));
     submesh->normals = std::span<const Vector3>(cube_normals, std::size(cube_normals));
-    submesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    if (createBufer_ != nullptr)
+    submesh->topology = PrimitiveTopology::TriangleList;
+    return submesh;
+}
+
+
+void CubeRenderer::OnEnable()
+{
+    MeshRenderer::OnEnable();
+
+    // 再有効化のときは作成済みのメッシュを使う
+    if (!mesh.submesh.empty() || getSubMesh_ == nullptr)
     {
-        createBufer_(submesh.get());
+        return;
     }
 
-    mesh.submesh.push_back(std::move(submesh));
+    // 頂点形式ごとに共有しているメッシュを使う
+    mesh.submesh.push_back(getSubMesh_());
 }
 
 
@@ -122,6 +130,9 @@ void SphereRenderer::createVertex()
             indices.push_back(next);
         }
     }
+
+    // 緯度経度の順では頂点キャッシュに残りにくいので並べ替える
+    MeshOptimizer::OptimizeVertexCache(indices, positions.size());
 }
 
 
@@ -130,24 +141,32 @@ std::vector<Vector3> SphereRenderer::normals;
 std::vector<Vector2> SphereRenderer::uvs;
 std::vector<uint32_t> SphereRenderer::indices;
 
-void SphereRenderer::OnEnable()
+std::shared_ptr<SubMesh> SphereRenderer::createSubMesh()
 {
-    MeshRenderer::OnEnable();
-
     createVertex();
 
-    auto submesh = std::make_unique<SubMesh>();
+    auto submesh = std::make_shared<SubMesh>();
     submesh->positions = std::span<const Vector3>(positions.data(), positions.size());
     submesh->normals = std::span<const Vector3>(normals.data(), normals.size());
     submesh->uv = std::span<const Vector2>(uvs.data(), uvs.size());
     submesh->indices = std::span<const uint32_t>(indices.data(), indices.size());
-    submesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    if (createBufer_ != nullptr)
+    submesh->topology = PrimitiveTopology::TriangleList;
+    return submesh;
+}
+
+
+void SphereRenderer::OnEnable()
+{
+    MeshRenderer::OnEnable();
+
+    // 再有効化のときは作成済みのメッシュを使う
+    if (!mesh.submesh.empty() || getSubMesh_ == nullptr)
     {
-        createBufer_(submesh.get());
+        return;
     }
 
-    mesh.submesh.push_back(std::move(submesh));
+    // 頂点形式ごとに共有しているメッシュを使う
+    mesh.submesh.push_back(getSubMesh_());
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+﻿#include "pch.h"
+#include <UniDx/RenderContext.h>
+
+#include <algorithm>
+
+#include <UniDx/D3DManager.h>
+
+
+namespace UniDx
+{
+
+thread_local RenderContext* RenderContext::current_ = nullptr;
+
+
+// -----------------------------------------------------------------------------
+// device に記録するように初期化
+// -----------------------------------------------------------------------------
+void RenderContext::initialize(std::unique_ptr<RenderDevice> device, ID3D11DeviceContext* context,
+                               size_t expectedDraws)
+{
+    context_ = context;
+    device_ = std::move(device);
+    stateCache_.setDevice(device_.get());
+    objectConstants_.initialize(*device_, GetObjectConstantsCapacity(expectedDraws), MaxObjectConstantsCapacity);
+    instanceBuffer_.setDevice(device_.get());
+}
+
+
+// -----------------------------------------------------------------------------
+// expectedDraws 回の描画の定数が入る大きさ
+//     1 回の描画の定数は切り出す単位の 256 バイトに収まる
+// -----------------------------------------------------------------------------
+UINT RenderContext::GetObjectConstantsCapacity(size_t expectedDraws)
+{
+    const size_t bytes = expectedDraws * ConstantBufferRing::Alignment;
+    return UINT(std::clamp<size_t>(bytes, MinObjectConstantsCapacity, MaxObjectConstantsCapacity));
+}
+
+
+bool RenderContext::isDeferred() const
+{
+    return context_ != nullptr && context_->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED;
+}
+
+
+// -----------------------------------------------------------------------------
+// 記録の始まり
+// -----------------------------------------------------------------------------
+void RenderContext::beginFrame()
+{
+    stateCache_.beginFrame();
+    objectConstants_.beginFrame();
+    instanceBuffer_.beginFrame();
+}
+
+
+// -----------------------------------------------------------------------------
+// 今のスレッドの記録先
+// -----------------------------------------------------------------------------
+RenderContext& RenderContext::current()
+{
+    return current_ != nullptr ? *current_ : D3DManager::getInstance()->GetRenderContext();
+}
+
+
+RenderContext::Scope::Scope(RenderContext& context) : previous_(current_)
+{
+    current_ = &context;
+}
+
+
+RenderContext::Scope::~Scope()
+{
+    current_ = previous_;
+}
+
+}
@@ -0,0 +1,126 @@
+﻿#include "pch.h"
+#include <UniDx/RenderQueue.h>
+
+#include <algorithm>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+// ポインタを bits ビットに縮める
+inline uint64_t compressPointer(const void* p, int bits)
+{
+    uint64_t v = uint64_t(reinterpret_cast<uintptr_t>(p)) >> 4;
+    v *= 0x9E3779B97F4A7C15ull;
+    return v >> (64 - bits);
+}
+
+// 0～1 の値を bits ビットに量子化
+inline uint64_t quantize(float v, int bits)
+{
+    const float clamped = std::min(std::max(v, 0.0f), 1.0f);
+    const uint64_t maxValue = (uint64_t(1) << bits) - 1;
+    return uint64_t(clamped * float(maxValue) + 0.5f);
+}
+
+constexpr int QueueShift = 51;
+
+}
+
+
+// -----------------------------------------------------------------------------
+// ソートキーを作る
+// -----------------------------------------------------------------------------
+uint64_t RenderQueue::MakeKey(int queue, const void* shader, const void* material, const void* mesh, float depth01)
+{
+    const uint64_t q = uint64_t(std::min(std::max(queue, 0), 8191)) << QueueShift;
+    if (queue < Transparent)
+    {
+        return q
+            | compressPointer(shader, 10) << 41
+            | compressPointer(material, 12) << 29
+            | compressPointer(mesh, 13) << 16
+            | quantize(depth01, 16);
+    }
+    else
+    {
+        // 奥から描くので、深度を反転する
+        return q
+            | (quantize(1.0f - depth01, 24)) << 27
+            | compressPointer(shader, 9) << 18
+            | compressPointer(material, 9) << 9
+            | compressPointer(mesh, 9);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// シェーダー・マテリアル・メッシュの部分を取り出す
+// -----------------------------------------------------------------------------
+uint64_t RenderQueue::StateBits(uint64_t key)
+{
+    const int queue = int(key >> QueueShift);
+    if (queue < Transparent)
+    {
+        return key & ~((uint64_t(1) << 16) - 1);
+    }
+    else
+    {
+        return key & (((uint64_t(1) << 27) - 1) | (uint64_t(8191) << QueueShift));
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// キーの小さい順に並べる（8bit ずつの基数ソート）
+// -----------------------------------------------------------------------------
+void RenderQueue::sort()
+{
+    const size_t n = items_.size();
+    if (n < 64)
+    {
+        std::stable_sort(items_.begin(), items_.end(), [](const Item& a, const Item& b) { return a.key < b.key; });
+        return;
+    }
+
+    scratch_.resize(n);
+    Item* src = items_.data();
+    Item* dst = scratch_.data();
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t count[256] = {};
+        for (size_t i = 0; i < n; ++i)
+        {
+            ++count[(src[i].key >> shift) & 0xff];
+        }
+
+        // すべて同じバケツなら並べ替え不要
+        if (count[(src[0].key >> shift) & 0xff] == n)
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t b = 0; b < 256; ++b)
+        {
+            const size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            dst[count[(src[i].key >> shift) & 0xff]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != items_.data())
+    {
+        std::copy(src, src + n, items_.data());
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+﻿#include "pch.h"
+#include <UniDx/RenderStateCache.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+// どの有効な値とも一致しない「不明」を表す値
+template<typename T>
+T* unknownPointer() { return reinterpret_cast<T*>(~uintptr_t(0)); }
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 覚えている状態を捨てる
+// -----------------------------------------------------------------------------
+void RenderStateCache::invalidate()
+{
+    vertexShader_ = unknownPointer<ID3D11VertexShader>();
+    pixelShader_ = unknownPointer<ID3D11PixelShader>();
+    inputLayout_ = unknownPointer<ID3D11InputLayout>();
+    topology_ = PrimitiveTopology(-1);
+    vertexBuffers_.fill(unknownPointer<ID3D11Buffer>());
+    vertexStrides_.fill(0);
+    vertexOffsets_.fill(0);
+    indexBuffer_ = unknownPointer<ID3D11Buffer>();
+    indexFormat_ = GpuFormat::Unknown;
+    indexOffset_ = 0;
+    psResources_.fill(unknownPointer<ID3D11ShaderResourceView>());
+    psSamplers_.fill(unknownPointer<ID3D11SamplerState>());
+    depthStencilState_ = unknownPointer<ID3D11DepthStencilState>();
+    stencilRef_ = 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// フレームの始まり
+// -----------------------------------------------------------------------------
+void RenderStateCache::beginFrame()
+{
+    lastFrameStats_ = stats_;
+    stats_ = Stats();
+    invalidate();
+}
+
+
+void RenderStateCache::setVertexShader(ID3D11VertexShader* shader)
+{
+    if (change(vertexShader_, shader) && device_) device_->setVertexShader(shader);
+}
+
+
+void RenderStateCache::setPixelShader(ID3D11PixelShader* shader)
+{
+    if (change(pixelShader_, shader) && device_) device_->setPixelShader(shader);
+}
+
+
+void RenderStateCache::setInputLayout(ID3D11InputLayout* layout)
+{
+    if (change(inputLayout_, layout) && device_) device_->setInputLayout(layout);
+}
+
+
+void RenderStateCache::setPrimitiveTopology(PrimitiveTopology topology)
+{
+    if (change(topology_, topology) && device_) device_->setPrimitiveTopology(topology);
+}
+
+
+void RenderStateCache::setVertexBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t stride, uint32_t offset)
+{
+    assert(slot < VertexSlotCount);
+    if (vertexBuffers_[slot] == buffer && vertexStrides_[slot] == stride && vertexOffsets_[slot] == offset)
+    {
+        ++stats_.skipped;
+        return;
+    }
+    vertexBuffers_[slot] = buffer;
+    vertexStrides_[slot] = stride;
+    vertexOffsets_[slot] = offset;
+    ++stats_.stateChanges;
+    if (device_) device_->setVertexBuffer(slot, buffer, stride, offset);
+}
+
+
+void RenderStateCache::setIndexBuffer(ID3D11Buffer* buffer, GpuFormat format, uint32_t offset)
+{
+    if (indexBuffer_ == buffer && indexFormat_ == format && indexOffset_ == offset)
+    {
+        ++stats_.skipped;
+        return;
+    }
+    indexBuffer_ = buffer;
+    indexFormat_ = format;
+    indexOffset_ = offset;
+    ++stats_.stateChanges;
+    if (device_) device_->setIndexBuffer(buffer, format, offset);
+}
+
+
+void RenderStateCache::setPSShaderResource(uint32_t slot, ID3D11ShaderResourceView* srv)
+{
+    assert(slot < SlotCount);
+    if (change(psResources_[slot], srv) && device_) device_->setPSShaderResource(slot, srv);
+}
+
+
+void RenderStateCache::setPSSampler(uint32_t slot, ID3D11SamplerState* sampler)
+{
+    assert(slot < SlotCount);
+    if (change(psSamplers_[slot], sampler) && device_) device_->setPSSampler(slot, sampler);
+}
+
+
+void RenderStateCache::setDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef)
+{
+    if (depthStencilState_ == state && stencilRef_ == stencilRef)
+    {
+        ++stats_.skipped;
+        return;
+    }
+    depthStencilState_ = state;
+    stencilRef_ = stencilRef;
+    ++stats_.stateChanges;
+    if (device_) device_->setDepthStencilState(state, stencilRef);
+}
+
+
+void RenderStateCache::drawIndexed(uint32_t indexCount)
+{
+    ++stats_.drawCalls;
+    if (device_) device_->drawIndexed(indexCount);
+}
+
+
+void RenderStateCache::draw(uint32_t vertexCount)
+{
+    ++stats_.drawCalls;
+    if (device_) device_->draw(vertexCount);
+}
+
+
+void RenderStateCache::drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startInstance)
+{
+    ++stats_.drawCalls;
+    stats_.instances += instanceCount;
+    if (device_) device_->drawIndexedInstanced(indexCount, instanceCount, startInstance);
+}
+
+
+void RenderStateCache::drawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startInstance)
+{
+    ++stats_.drawCalls;
+    stats_.instances += instanceCount;
+    if (device_) device_->drawInstanced(vertexCount, instanceCount, startInstance);
+}
+
+}
@@ -6,10 +6,24 @@
 #include <UniDx/Camera.h>
 #include <UniDx/Material.h>
 #include <UniDx/SceneManager.h>
+#include <UniDx/RendererManager.h>
 
 namespace UniDx{
 
 
+// -----------------------------------------------------------------------------
+// デストラクタ
+// ~Component から呼ばれる OnDisable は Renderer のものにならないので、ここで登録を外す
+// -----------------------------------------------------------------------------
+Renderer::~Renderer()
+{
+    if (rendererIndex_ >= 0 && RendererManager::getInstance() != nullptr)
+    {
+        RendererManager::getInstance()->unregisterRenderer(this);
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // 有効化
 // -----------------------------------------------------------------------------
@@ -21,31 +35,114 @@ void Renderer::OnEnable()
         material->OnEnable();
     }
 
-    // 行列用の定数バッファ生成
-    D3D11_BUFFER_DESC desc{};
-    desc.ByteWidth = sizeof(VSConstantBuffer0);
-    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    desc.CPUAccessFlags = 0;
-    desc.Usage = D3D11_USAGE_DEFAULT;
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBuffer0.GetAddressOf());
+    // 描画対象として登録
+    boundsValid_ = false;
+    RendererManager::getInstance()->registerRenderer(this);
+
+    // 行列用の定数バッファ生成（再有効化のときは作成済みのものを使う）
+    // 定数バッファのリングが使えるときは、そこから切り出すので作らない
+    if (constantBuffer0 != nullptr || RendererManager::getInstance()->isConstantRingSupported())
+    {
+        return;
+    }
+    BufferDesc desc;
+    desc.byteWidth = sizeof(VSConstantBuffer0);
+    desc.bindFlags = GpuBindConstantBuffer;
+    desc.usage = GpuUsage::Default;
+    D3DManager::getInstance()->GetRenderDevice().createBuffer(desc, nullptr, constantBuffer0.GetAddressOf());
 }
 
 
 // -----------------------------------------------------------------------------
-// 現在の姿勢とカメラをシェーダーの定数バッファに転送
+// 無効化
+// -----------------------------------------------------------------------------
+void Renderer::OnDisable()
+{
+    RendererManager::getInstance()->unregisterRenderer(this);
+}
+
+
+// -----------------------------------------------------------------------------
+// ワールド空間の境界
+// -----------------------------------------------------------------------------
+const Bounds& Renderer::getWorldBounds() const
+{
+    updateWorldBounds();
+    return worldBounds_;
+}
+
+
+// -----------------------------------------------------------------------------
+// Transform が変わっていればワールド空間の境界を再計算
+// -----------------------------------------------------------------------------
+bool Renderer::updateWorldBounds() const
+{
+    const Matrix& world = transform->getLocalToWorldMatrix();
+    const uint32_t version = transform->getWorldVersion();
+    if (boundsValid_ && boundsVersion_ == version)
+    {
+        return false;
+    }
+
+    Bounds local;
+    if (getLocalBounds(local))
+    {
+        // 中心を変換し、半径は行列の絶対値で広げる
+        const Vector3 center = Vector3::Transform(Vector3(local.Center), world);
+        const Vector3 e(local.Extents);
+        const Vector3 extents(
+            std::abs(world._11) * e.x + std::abs(world._21) * e.y + std::abs(world._31) * e.z,
+            std::abs(world._12) * e.x + std::abs(world._22) * e.y + std::abs(world._32) * e.z,
+            std::abs(world._13) * e.x + std::abs(world._23) * e.y + std::abs(world._33) * e.z);
+        worldBounds_ = Bounds(center, extents);
+    }
+    else
+    {
+        // 境界がないものは常に見えるようにする
+        worldBounds_ = Bounds(Vector3::Zero, Vector3(1e30f, 1e30f, 1e30f));
+    }
+    boundsVersion_ = version;
+    ++boundsRevision_;
+    boundsValid_ = true;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 現在の姿勢をシェーダーの定数バッファに転送
+//     カメラの行列は RendererManager がフレームで1回スロット1番にセットする
 // -----------------------------------------------------------------------------
 void Renderer::updatePositionCameraCBuffer(const UniDx::Camera& camera) const
 {
     // ワールド行列を transform から合わせて作成
+    uploadObjectConstants(transform->getLocalToWorldMatrix());
+}
+
+
+// -----------------------------------------------------------------------------
+// ワールド行列を描画ごとの定数バッファに転送
+// -----------------------------------------------------------------------------
+void Renderer::uploadObjectConstants(const Matrix& world) const
+{
     VSConstantBuffer0 cb{};
-    cb.world = transform->getLocalToWorldMatrix();
-    cb.view = camera.GetViewMatrix();
-    cb.projection = camera.GetProjectionMatrix(16.0f/9.0f);
+    cb.world = world;
+    cb.lodFade = Vector4(lodFade_, 0, 0, 0);
 
-    // 定数バッファ更新
+    // 共有の大きな定数バッファから切り出して書き込む
+    if (RendererManager::getInstance()->uploadObjectConstants(&cb, sizeof(cb)))
+    {
+        return;
+    }
+
+    // 使えないときは自分の定数バッファを更新
+    if (constantBuffer0 == nullptr)
+    {
+        return;
+    }
+    RenderDevice& device = RenderContext::current().getDevice();
     ID3D11Buffer* cbs[1] = { constantBuffer0.Get() };
-    D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(0, 1, cbs);
-    D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBuffer0.Get(), 0, nullptr, &cb, 0, 0);
+    device.setVSConstantBuffers(UNIDX_VS_SLOT_OBJECT, 1, cbs);
+    device.updateBuffer(constantBuffer0.Get(), &cb, sizeof(cb));
 }
 
 
@@ -65,6 +162,25 @@ void Renderer::setShaderForRender() const
 }
 
 
+// -----------------------------------------------------------------------------
+// サブメッシュとマテリアルが1つずつで、シェーダーが対応していればインスタンス描画できる
+// LOD のクロスフェード中は描画ごとの値が要るので、まとめない
+// -----------------------------------------------------------------------------
+const SubMesh* MeshRenderer::getInstanceSubMesh() const
+{
+    if (mesh.submesh.size() != 1 || materials.size() != 1 || getLODFade() != 0.0f)
+    {
+        return nullptr;
+    }
+    const Material* material = materials.front().get();
+    if (!material->enableInstancing || !material->shader.isInstancingSupported())
+    {
+        return nullptr;
+    }
+    return mesh.submesh.front().get();
+}
+
+
 // -----------------------------------------------------------------------------
 // メッシュを使って描画
 // -----------------------------------------------------------------------------
@@ -0,0 +1,388 @@
+﻿#include "pch.h"
+#include <UniDx/RendererManager.h>
+
+#include <UniDx/Renderer.h>
+#include <UniDx/Camera.h>
+#include <UniDx/Material.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/LightManager.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/LODGroup.h>
+#include <UniDx/Time.h>
+#include <UniDx/TextureStreamer.h>
+
+#include <algorithm>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 登録
+// -----------------------------------------------------------------------------
+void RendererManager::registerRenderer(Renderer* renderer)
+{
+    if (renderer->rendererIndex_ >= 0)
+    {
+        return;
+    }
+
+    renderer->rendererIndex_ = int32_t(renderers_.size());
+    renderers_.push_back(renderer);
+
+    // 境界は次の描画で計算する。計算し直すと boundsRevision_ が進むので、そのとき bounds_ に書く
+    renderer->boundsValid_ = false;
+    const float zero[3] = { 0, 0, 0 };
+    bounds_.resize(renderers_.size());
+    bounds_.set(renderer->rendererIndex_, zero, zero);
+    boundsRevisions_.push_back(renderer->boundsRevision_);
+}
+
+
+// -----------------------------------------------------------------------------
+// 登録解除。末尾の Renderer を空いた場所に移す
+// -----------------------------------------------------------------------------
+void RendererManager::unregisterRenderer(Renderer* renderer)
+{
+    const int32_t index = renderer->rendererIndex_;
+    if (index < 0)
+    {
+        return;
+    }
+
+    Renderer* last = renderers_.back();
+    renderers_[index] = last;
+    last->rendererIndex_ = index;
+    renderers_.pop_back();
+    bounds_.removeSwapBack(index);
+    boundsRevisions_[index] = boundsRevisions_.back();
+    boundsRevisions_.pop_back();
+
+    renderer->rendererIndex_ = -1;
+}
+
+
+// -----------------------------------------------------------------------------
+// LODGroup の登録
+// -----------------------------------------------------------------------------
+void RendererManager::registerLODGroup(LODGroup* group)
+{
+    if (std::find(lodGroups_.begin(), lodGroups_.end(), group) == lodGroups_.end())
+    {
+        lodGroups_.push_back(group);
+    }
+}
+
+
+void RendererManager::unregisterLODGroup(LODGroup* group)
+{
+    auto it = std::find(lodGroups_.begin(), lodGroups_.end(), group);
+    if (it != lodGroups_.end())
+    {
+        *it = lodGroups_.back();
+        lodGroups_.pop_back();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// LODGroup ごとに camera に合わせて LOD を選ぶ
+// -----------------------------------------------------------------------------
+void RendererManager::updateLODGroups(const Camera& camera)
+{
+    const float deltaTime = Time::deltaTime;
+    for (LODGroup* group : lodGroups_)
+    {
+        group->update(camera, deltaTime);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// Transform が変わった Renderer の境界を書き換える
+//     LODGroup などが先に getWorldBounds で計算し直していることがあるので、
+//     前に書いたときから計算し直されたかどうかで判断する
+// -----------------------------------------------------------------------------
+void RendererManager::updateBounds()
+{
+    for (size_t i = 0; i < renderers_.size(); ++i)
+    {
+        const Renderer* renderer = renderers_[i];
+        renderer->updateWorldBounds();
+        if (boundsRevisions_[i] != renderer->boundsRevision_)
+        {
+            const Bounds& b = renderer->worldBounds_;
+            bounds_.set(i, &b.Center.x, &b.Extents.x);
+            boundsRevisions_[i] = renderer->boundsRevision_;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 視錐台の内側にある Renderer を集める
+// -----------------------------------------------------------------------------
+size_t RendererManager::cull(const Camera& camera)
+{
+    updateBounds();
+
+    // 描画と同じ投影で判定する
+    const Matrix viewProjection = camera.GetViewMatrix() * camera.GetProjectionMatrix(D3DManager::getInstance()->getAspectRatio());
+    const FrustumPlanes planes = ExtractFrustumPlanes(reinterpret_cast<const float*>(&viewProjection));
+
+    visible_.resize(renderers_.size());
+    const size_t inside = CullBounds(planes, bounds_, visible_.data());
+
+    // LODGroup で選ばれていないものを除く
+    visibleCount_ = 0;
+    for (size_t i = 0; i < inside; ++i)
+    {
+        if (renderers_[visible_[i]]->lodVisible_)
+        {
+            visible_[visibleCount_++] = visible_[i];
+        }
+    }
+    return visibleCount_;
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画ごとの定数のリング
+// -----------------------------------------------------------------------------
+bool RendererManager::isConstantRingSupported() const
+{
+    return D3DManager::getInstance()->GetRenderContext().getObjectConstants().isSupported();
+}
+
+
+bool RendererManager::uploadObjectConstants(const void* data, UINT size)
+{
+    return RenderContext::current().getObjectConstants().uploadVS(UNIDX_VS_SLOT_OBJECT, data, size);
+}
+
+
+// -----------------------------------------------------------------------------
+// カメラの行列を転送する
+// -----------------------------------------------------------------------------
+void RendererManager::updateCameraConstants(const Camera& camera)
+{
+    if (cameraConstants_ == nullptr)
+    {
+        BufferDesc desc;
+        desc.byteWidth = sizeof(VSConstantBuffer1);
+        desc.bindFlags = GpuBindConstantBuffer;
+        desc.usage = GpuUsage::Default;
+        D3DManager::getInstance()->GetRenderDevice().createBuffer(desc, nullptr, cameraConstants_.GetAddressOf());
+    }
+
+    VSConstantBuffer1 cb{};
+    cb.view = camera.GetViewMatrix();
+    cb.projection = camera.GetProjectionMatrix(D3DManager::getInstance()->getAspectRatio());
+
+    // コマンドリストを実行する前に転送しておけば、遅延コンテキストからも同じ内容が見える
+    D3DManager::getInstance()->GetRenderDevice().updateBuffer(cameraConstants_.Get(), &cb, sizeof(cb));
+}
+
+
+// -----------------------------------------------------------------------------
+// カメラの行列とライトを device に設定
+// -----------------------------------------------------------------------------
+void RendererManager::bindFrameConstants(RenderDevice& device) const
+{
+    ID3D11Buffer* cbs[1] = { cameraConstants_.Get() };
+    device.setVSConstantBuffers(UNIDX_VS_SLOT_CAMERA, 1, cbs);
+    LightManager::getInstance()->bind(device);
+}
+
+
+// -----------------------------------------------------------------------------
+// 記録スレッドごとの遅延コンテキストを作る
+//     描画はスレッドに分けて記録するので、定数のリングは 1 スレッドの分の大きさで作る
+// -----------------------------------------------------------------------------
+bool RendererManager::initializeDeferred(size_t items)
+{
+    if (!deferredInitialized_)
+    {
+        deferredInitialized_ = true;
+
+        JobSystem* jobs = JobSystem::getInstance();
+        const size_t threads = jobs != nullptr ? jobs->getThreadCount() : 1;
+        if (threads > 1)
+        {
+            deferred_ = std::make_unique<DeferredContextBackend>();
+            if (!deferred_->initialize(threads, (items + threads - 1) / threads))
+            {
+                deferred_ = nullptr;
+            }
+        }
+    }
+    return deferred_ != nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// 見える Renderer のテクスチャを TextureStreamer に伝える
+//     境界球の直径が画面の縦で何画素になるかを、テクスチャの幅が描かれる大きさとみなす
+// -----------------------------------------------------------------------------
+void RendererManager::requestTextures(const Camera& camera, size_t visibleCount)
+{
+    TextureStreamer* streamer = TextureStreamer::getInstance();
+    if (streamer == nullptr)
+    {
+        return;
+    }
+
+    const Matrix view = camera.GetViewMatrix();
+    const float screenHeight = D3DManager::getInstance()->getScreenSize().y;
+    const float pixelsPerUnit = screenHeight / std::tan(DirectX::XMConvertToRadians(camera.fov) * 0.5f);
+
+    for (size_t i = 0; i < visibleCount; ++i)
+    {
+        const Renderer* renderer = renderers_[visible_[i]];
+        const Vector3 center = Vector3::Transform(Vector3(renderer->worldBounds_.Center), view);
+        const float radius = Vector3(renderer->worldBounds_.Extents).Length();
+        const float pixels = pixelsPerUnit * radius / std::max(center.z, camera.nearClip);
+
+        for (const std::shared_ptr<Material>& material : renderer->materials)
+        {
+            for (const std::shared_ptr<Texture>& texture : material->getTextures())
+            {
+                streamer->requestTexture(texture.get(), pixels);
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 視錐台の内側にある Renderer をソートキーと一緒に積んで並べ替える
+// -----------------------------------------------------------------------------
+void RendererManager::buildQueue(const Camera& camera, size_t visibleCount)
+{
+    const Matrix view = camera.GetViewMatrix();
+    const float nearClip = camera.nearClip;
+    const float invRange = 1.0f / std::max(camera.farClip - nearClip, 1e-6f);
+
+    queue_.clear();
+    for (size_t i = 0; i < visibleCount; ++i)
+    {
+        const uint32_t index = visible_[i];
+        const Renderer* renderer = renderers_[index];
+
+        // 境界の中心のカメラからの距離を near～far で 0～1 にする
+        const Vector3 center = Vector3::Transform(Vector3(renderer->worldBounds_.Center), view);
+        const float depth01 = (center.z - nearClip) * invRange;
+
+        const Material* material = renderer->materials.empty() ? nullptr : renderer->materials.front().get();
+        const int queue = material != nullptr ? material->renderQueue : RenderQueue::Geometry;
+        const void* shader = material != nullptr ? material->shader.getProgramId() : nullptr;
+
+        queue_.add(RenderQueue::MakeKey(queue, shader, material, renderer->getSortSubMesh(), depth01), index);
+    }
+    queue_.sort();
+}
+
+
+// -----------------------------------------------------------------------------
+// 視錐台の内側にある Renderer を描画
+// -----------------------------------------------------------------------------
+void RendererManager::render(const Camera& camera)
+{
+    RenderContext& immediate = D3DManager::getInstance()->GetRenderContext();
+    immediate.beginFrame();
+    updateCameraConstants(camera);
+
+    updateLODGroups(camera);
+    const size_t count = cull(camera);
+    requestTextures(camera, count);
+    buildQueue(camera, count);
+
+    // 多いときは区間に分けて並列に記録する
+    const size_t items = queue_.size();
+    recordingSlots_ = 0;
+    if (parallelRecording_ && items >= recorder_.getMinItemsPerSlot() * 2 && initializeDeferred(items))
+    {
+        recordingSlots_ = recorder_.record(*deferred_, items, [this, &camera](size_t slot, size_t begin, size_t end)
+            {
+                bindFrameConstants(RenderContext::current().getDevice());
+                renderRange(camera, begin, end);
+            });
+    }
+    if (recordingSlots_ == 0)
+    {
+        bindFrameConstants(immediate.getDevice());
+        renderRange(camera, 0, items);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// queue_ の [begin, end) を今の記録先に描画する
+// -----------------------------------------------------------------------------
+void RendererManager::renderRange(const Camera& camera, size_t begin, size_t end)
+{
+    const std::vector<RenderQueue::Item>& items = queue_.getItems();
+    size_t i = begin;
+    while (i < end)
+    {
+        // 同じサブメッシュとマテリアルが続く範囲を探す
+        const Renderer* renderer = renderers_[items[i].index];
+        const SubMesh* submesh = instancing_ ? renderer->getInstanceSubMesh() : nullptr;
+        size_t runEnd = i + 1;
+        if (submesh != nullptr)
+        {
+            const Material* material = renderer->materials.front().get();
+            while (runEnd < end)
+            {
+                const Renderer* next = renderers_[items[runEnd].index];
+                if (next->getInstanceSubMesh() != submesh || next->materials.front().get() != material)
+                {
+                    break;
+                }
+                ++runEnd;
+            }
+        }
+
+        if (runEnd - i < MinInstanceCount || !renderInstanced(i, runEnd))
+        {
+            for (size_t k = i; k < runEnd; ++k)
+            {
+                renderers_[items[k].index]->Render(camera);
+            }
+        }
+        i = runEnd;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 同じサブメッシュとマテリアルの Renderer をまとめて描画
+// -----------------------------------------------------------------------------
+bool RendererManager::renderInstanced(size_t begin, size_t end)
+{
+    const std::vector<RenderQueue::Item>& items = queue_.getItems();
+    const Renderer* first = renderers_[items[begin].index];
+    const SubMesh* submesh = first->getInstanceSubMesh();
+    const UINT count = UINT(end - begin);
+
+    // インスタンスごとのワールド行列を書き込む
+    InstanceBuffer& instanceBuffer = RenderContext::current().getInstanceBuffer();
+    UINT startInstance = 0;
+    Matrix* worlds = instanceBuffer.map(count, startInstance);
+    if (worlds == nullptr)
+    {
+        return false;
+    }
+    for (size_t k = begin; k < end; ++k)
+    {
+        *worlds++ = renderers_[items[k].index]->transform->getLocalToWorldMatrix();
+    }
+    instanceBuffer.unmap();
+
+    // カメラの行列はスロット1番にセット済み。ワールド行列はインスタンスごとのデータから読む
+    first->materials.front()->setForRender(true);
+    submesh->RenderInstanced(instanceBuffer.getBuffer(), InstanceBuffer::Stride, count, startInstance);
+    return true;
+}
+
+}
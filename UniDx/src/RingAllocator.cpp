@@ -0,0 +1,70 @@
+﻿#include "pch.h"
+#include <UniDx/RingAllocator.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 容量と切り出す単位を設定し直す
+// -----------------------------------------------------------------------------
+void RingAllocator::reset(uint32_t capacity, uint32_t alignment)
+{
+    alignment_ = alignment > 0 ? alignment : 1;
+    capacity_ = capacity - capacity % alignment_;
+    cursor_ = 0;
+    frameUsed_ = 0;
+    discardNext_ = true;
+}
+
+
+// -----------------------------------------------------------------------------
+// size バイトを切り出す
+// -----------------------------------------------------------------------------
+bool RingAllocator::allocate(uint32_t size, Allocation& allocation)
+{
+    const uint32_t aligned = (size + alignment_ - 1) / alignment_ * alignment_;
+    if (size == 0 || aligned > capacity_)
+    {
+        return false;
+    }
+
+    // 末尾まで使い切ったら、捨てて先頭から
+    if (discardNext_ || cursor_ + aligned > capacity_)
+    {
+        cursor_ = 0;
+        discardNext_ = false;
+        ++discardCount_;
+        allocation.discard = true;
+    }
+    else
+    {
+        allocation.discard = false;
+    }
+
+    allocation.offset = cursor_;
+    allocation.size = aligned;
+    cursor_ += aligned;
+    frameUsed_ += aligned;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 1フレームで frameUsed バイト使ったときに広げる容量
+// -----------------------------------------------------------------------------
+uint32_t RingAllocator::GetGrownCapacity(uint32_t capacity, uint32_t frameUsed, uint32_t maxCapacity)
+{
+    if (frameUsed <= capacity || capacity >= maxCapacity)
+    {
+        return capacity;
+    }
+    uint64_t grown = capacity > 0 ? capacity : 1;
+    while (grown < frameUsed && grown < maxCapacity)
+    {
+        grown *= 2;
+    }
+    return grown < maxCapacity ? uint32_t(grown) : maxCapacity;
+}
+
+}
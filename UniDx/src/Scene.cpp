@@ -0,0 +1,38 @@
+﻿#include "pch.h"
+#include <UniDx/Scene.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// ルートにGameObjectを追加
+// -----------------------------------------------------------------------------
+GameObject* Scene::AddRootGameObject(unique_ptr<GameObject> gameObject)
+{
+    GameObject* ptr = gameObject.get();
+    routeGameObjects.push_back(std::move(gameObject));
+    Transform::markStructureChanged();
+    return ptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// ルートからGameObjectを所有権ごと取り出す
+// -----------------------------------------------------------------------------
+unique_ptr<GameObject> Scene::RemoveRootGameObject(GameObject* gameObject)
+{
+    auto it = std::find_if(routeGameObjects.begin(), routeGameObjects.end(),
+        [gameObject](const unique_ptr<GameObject>& ptr) { return ptr.get() == gameObject; });
+    if (it == routeGameObjects.end())
+    {
+        return nullptr;
+    }
+
+    unique_ptr<GameObject> ptr = std::move(*it);
+    routeGameObjects.erase(it);
+    Transform::markStructureChanged();
+    return ptr;
+}
+
+}
@@ -0,0 +1,323 @@
+﻿#include "pch.h"
+#include <UniDx/SceneCommandBuffer.h>
+
+#include <UniDx/Scene.h>
+#include <UniDx/Prefab.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/Time.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+// 追加したオブジェクトの Awake を呼ぶ
+void awakeRecursive(GameObject* gameObject)
+{
+    if (!gameObject->activeInHierarchy())
+    {
+        return;
+    }
+
+    for (auto& it : gameObject->GetComponents())
+    {
+        it->checkAwake();
+    }
+    for (auto& it : gameObject->transform->getChildGameObjects())
+    {
+        awakeRecursive(&*it);
+    }
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// コンストラクタ
+// -----------------------------------------------------------------------------
+SceneCommandBuffer::SceneCommandBuffer() :
+    SceneCommandBuffer(JobSystem::getInstance() ? JobSystem::getInstance()->getThreadCount() : 1)
+{
+}
+
+
+SceneCommandBuffer::SceneCommandBuffer(size_t threadCount)
+{
+    queues_.resize(std::max<size_t>(threadCount, 1));
+    for (auto& q : queues_)
+    {
+        q.commands.reserve(64);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 現在のスレッドの記録先
+// -----------------------------------------------------------------------------
+SceneCommandBuffer::Queue& SceneCommandBuffer::currentQueue()
+{
+    const size_t index = JobSystem::getCurrentThreadIndex();
+    assert(index < queues_.size());
+    return queues_[index];
+}
+
+
+// -----------------------------------------------------------------------------
+// GameObject をシーンに追加
+// -----------------------------------------------------------------------------
+GameObject* SceneCommandBuffer::spawn(unique_ptr<GameObject> gameObject, Transform* parent)
+{
+    GameObject* ptr = gameObject.get();
+
+    Command command;
+    command.type = CommandType::Spawn;
+    command.gameObject = ptr;
+    command.parent = parent;
+    command.spawned = std::move(gameObject);
+    currentQueue().commands.push_back(std::move(command));
+    return ptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// GameObject を破棄
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::destroy(GameObject* gameObject, float delay)
+{
+    Command command;
+    command.type = CommandType::Destroy;
+    command.gameObject = gameObject;
+    command.destroyTime = Time::time + std::max(0.0f, delay);
+    currentQueue().commands.push_back(std::move(command));
+}
+
+
+// -----------------------------------------------------------------------------
+// 親を変更
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::setParent(Transform* transform, Transform* newParent)
+{
+    Command command;
+    command.type = CommandType::SetParent;
+    command.gameObject = transform->gameObject;
+    command.parent = newParent;
+    currentQueue().commands.push_back(std::move(command));
+}
+
+
+// -----------------------------------------------------------------------------
+// GameObject のアクティブ状態を変更
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::setActive(GameObject* gameObject, bool value)
+{
+    Command command;
+    command.type = CommandType::SetActive;
+    command.gameObject = gameObject;
+    command.value = value;
+    currentQueue().commands.push_back(std::move(command));
+}
+
+
+// -----------------------------------------------------------------------------
+// コンポーネントの有効状態を変更
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::setEnabled(Component* component, bool value)
+{
+    Command command;
+    command.type = CommandType::SetEnabled;
+    command.component = component;
+    command.value = value;
+    currentQueue().commands.push_back(std::move(command));
+}
+
+
+// -----------------------------------------------------------------------------
+// 記録した変更をまとめて反映
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::apply(Scene* scene)
+{
+    // 破棄以外をスレッド番号順、記録順に反映
+    for (auto& queue : queues_)
+    {
+        for (auto& command : queue.commands)
+        {
+            if (command.type == CommandType::Destroy)
+            {
+                if (command.destroyTime <= Time::time)
+                {
+                    destroyList_.push_back(command.gameObject);
+                }
+                else
+                {
+                    addDelayed(command.gameObject, command.destroyTime);
+                }
+                continue;
+            }
+            applyCommand(command, scene);
+        }
+        queue.commands.clear();
+    }
+
+    // 時刻になった遅延破棄
+    for (size_t i = 0; i < delayed_.size();)
+    {
+        if (delayed_[i].destroyTime <= Time::time)
+        {
+            destroyList_.push_back(delayed_[i].gameObject);
+            removeDelayed(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    if (destroyList_.empty())
+    {
+        return;
+    }
+
+    // 同じものの二重破棄を除く。OnDestroy の順が実行ごとに変わらないよう、記録した順のまま
+    size_t count = 0;
+    for (GameObject* gameObject : destroyList_)
+    {
+        if (destroySet_.insert(gameObject).second)
+        {
+            destroyList_[count++] = gameObject;
+        }
+    }
+    destroyList_.resize(count);
+
+    // 祖先と一緒に解放されるものを除く。プールに返すだけの祖先は子孫を解放しないので除かない
+    count = 0;
+    for (GameObject* gameObject : destroyList_)
+    {
+        bool freedWithAncestor = false;
+        for (const Transform* t = gameObject->transform->parent; t != nullptr; t = t->parent)
+        {
+            if (t->gameObject->getPrefab() == nullptr && destroySet_.count(t->gameObject) != 0)
+            {
+                freedWithAncestor = true;
+                break;
+            }
+        }
+        if (!freedWithAncestor)
+        {
+            destroyList_[count++] = gameObject;
+        }
+    }
+    destroyList_.resize(count);
+    destroySet_.clear();
+
+    for (GameObject* gameObject : destroyList_)
+    {
+        destroyNow(gameObject, scene);
+    }
+    destroyList_.clear();
+}
+
+
+// -----------------------------------------------------------------------------
+// 破棄以外の変更を反映
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::applyCommand(Command& command, Scene* scene)
+{
+    switch (command.type)
+    {
+    case CommandType::Spawn:
+        if (command.parent != nullptr)
+        {
+            Transform::SetParent(std::move(command.spawned), command.parent);
+        }
+        else
+        {
+            scene->AddRootGameObject(std::move(command.spawned));
+        }
+        awakeRecursive(command.gameObject);
+        break;
+
+    case CommandType::SetParent:
+        command.gameObject->transform->SetParent(command.parent);
+        break;
+
+    case CommandType::SetActive:
+        command.gameObject->SetActive(command.value);
+        break;
+
+    case CommandType::SetEnabled:
+        command.component->enabled = command.value;
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// GameObject をすぐに破棄
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::destroyNow(GameObject* gameObject, Scene* scene)
+{
+    // プレハブから作ったものはプールに返す
+    // 子孫は残るので、取り消すのは自分の遅延破棄だけ。使い回した後に古い遅延破棄で消えないようにする
+    if (gameObject->getPrefab() != nullptr)
+    {
+        cancelDelayed(gameObject);
+        gameObject->getPrefab()->Release(gameObject);
+        return;
+    }
+
+    // 先に子孫も含めて OnDisable を呼んでから、所有者から外して OnDestroy
+    // 一緒に消える子孫の遅延破棄は、GameObject のデストラクタが取り消す
+    gameObject->SetActive(false);
+    // ルートは反映先のシーンから外す。アクティブなシーンとは限らない
+    unique_ptr<GameObject> owner = gameObject->transform->parent == nullptr
+        ? scene->RemoveRootGameObject(gameObject)
+        : gameObject->transform->releaseFromParent();
+    owner.reset();
+}
+
+
+// -----------------------------------------------------------------------------
+// 時刻待ちの破棄に加える
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::addDelayed(GameObject* gameObject, float destroyTime)
+{
+    if (gameObject->delayedDestroyIndex_ >= 0)
+    {
+        DelayedDestroy& delayed = delayed_[gameObject->delayedDestroyIndex_];
+        delayed.destroyTime = std::min(delayed.destroyTime, destroyTime);
+        return;
+    }
+    gameObject->delayedDestroyIndex_ = int32_t(delayed_.size());
+    delayed_.push_back({ gameObject, destroyTime });
+}
+
+
+// -----------------------------------------------------------------------------
+// 末尾と入れ替えて取り除き、移したものの位置を書き換える
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::removeDelayed(size_t index)
+{
+    GameObject* removed = delayed_[index].gameObject;
+    delayed_[index] = delayed_.back();
+    delayed_[index].gameObject->delayedDestroyIndex_ = int32_t(index);
+    delayed_.pop_back();
+    removed->delayedDestroyIndex_ = -1;
+}
+
+
+// -----------------------------------------------------------------------------
+// 時刻待ちの破棄を取り消す
+// -----------------------------------------------------------------------------
+void SceneCommandBuffer::cancelDelayed(GameObject* gameObject)
+{
+    if (gameObject->delayedDestroyIndex_ >= 0)
+    {
+        removeDelayed(size_t(gameObject->delayedDestroyIndex_));
+    }
+}
+
+}
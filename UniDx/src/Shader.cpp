@@ -2,12 +2,21 @@
 #include <UniDx/Shader.h>
 
 #include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <algorithm>
 #include <d3d11.h>
+#include <d3d11shader.h>
 #include <SimpleMath.h>
 
 #include <UniDx/D3DManager.h>
+#include <UniDx/AssetCache.h>
+#include <UniDx/ShaderCache.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "dxguid.lib")
 
 using namespace DirectX::SimpleMath;
 
@@ -51,67 +60,432 @@ const std::array< D3D11_INPUT_ELEMENT_DESC, 3> VertexPNC::layout =
 	D3D11_INPUT_ELEMENT_DESC{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	D3D11_INPUT_ELEMENT_DESC{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 };
+const std::array< D3D11_INPUT_ELEMENT_DESC, 5> VertexPNTJW::layout =
+{
+	D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "TEXUV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, 32, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "BLENDWEIGHT", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 36, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+
+// 詰めた頂点のレイアウト
+const std::array< D3D11_INPUT_ELEMENT_DESC, 2> VertexPackedPN::layout =
+{
+	D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+const std::array< D3D11_INPUT_ELEMENT_DESC, 2> VertexPackedPC::layout =
+{
+	D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+const std::array< D3D11_INPUT_ELEMENT_DESC, 3> VertexPackedPTC::layout =
+{
+	D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "TEXUV", 0, DXGI_FORMAT_R16G16_UNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+const std::array< D3D11_INPUT_ELEMENT_DESC, 3> VertexPackedPNT::layout =
+{
+	D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "TEXUV", 0, DXGI_FORMAT_R16G16_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+const std::array< D3D11_INPUT_ELEMENT_DESC, 3> VertexPackedPNC::layout =
+{
+	D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	D3D11_INPUT_ELEMENT_DESC{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
 
 
-bool Shader::compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
+namespace
 {
-	ID3DBlob* error = nullptr;
 
-	// 頂点シェーダーを読み込み＆コンパイル
-	ComPtr<ID3DBlob> compiledVS;
-	if (FAILED(D3DCompileFromFile(filePath.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VS", "vs_5_0", 0, 0, &compiledVS, &error)))
+// 頂点のレイアウトから決まるマクロを defines に足す
+void AddLayoutDefines(const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size, std::vector<ShaderCache::Define>& defines)
+{
+	for (size_t i = 0; i < layout_size; ++i)
 	{
-		Debug::Log(L"頂点シェーダーのコンパイルエラー");
-		if (error)
+		if (std::strcmp(layout[i].SemanticName, "NORMAL") == 0 && layout[i].Format == DXGI_FORMAT_R16G16_SNORM)
 		{
-			Debug::Log(static_cast<const char*>(error->GetBufferPointer()));
+			defines.push_back({ Shader::OctahedralNormalDefine, "1" });
 		}
-		abort();
+	}
+}
+
+
+// 頂点のレイアウトを RenderDevice に渡す形にする
+std::vector<InputElementDesc> ToInputElements(const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
+{
+	std::vector<InputElementDesc> elements(layout_size);
+	for (size_t i = 0; i < layout_size; ++i)
+	{
+		const D3D11_INPUT_ELEMENT_DESC& e = layout[i];
+		elements[i] = InputElementDesc{ e.SemanticName, e.SemanticIndex, GpuFormat(e.Format), e.InputSlot, e.AlignedByteOffset,
+			e.InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA ? std::max(e.InstanceDataStepRate, 1u) : 0u };
+	}
+	return elements;
+}
+
+
+// マクロを D3DCompile に渡す形にする。終端を付ける
+std::vector<D3D_SHADER_MACRO> MakeMacros(std::span<const ShaderCache::Define> defines)
+{
+	std::vector<D3D_SHADER_MACRO> macros;
+	macros.reserve(defines.size() + 1);
+	for (const ShaderCache::Define& d : defines)
+	{
+		macros.push_back({ d.name.c_str(), d.value.c_str() });
+	}
+	macros.push_back({ nullptr, nullptr });
+	return macros;
+}
+
+
+// ファイルを全部読む
+bool ReadFile(const std::filesystem::path& path, std::vector<char>& data)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+	{
 		return false;
 	}
-	// ピクセルシェーダーを読み込み＆コンパイル
-	ComPtr<ID3DBlob> compiledPS;
-	if (FAILED(D3DCompileFromFile(filePath.c_str(), nullptr, nullptr, "PS", "ps_5_0", 0, 0, &compiledPS, &error)))
+	data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return true;
+}
+
+
+// --------------------
+// #include を読み、読んだファイルを ShaderCache に記録するために覚えておく
+// 相対パスは #include を書いたファイルのディレクトリから探す
+// --------------------
+class IncludeHandler : public ID3DInclude
+{
+public:
+	explicit IncludeHandler(const std::filesystem::path& sourcePath) : directory_(sourcePath.parent_path()) {}
+
+	HRESULT __stdcall Open(D3D_INCLUDE_TYPE type, const char* fileName, const void* parentData, const void** data, UINT* bytes) override
+	{
+		auto parent = directories_.find(parentData);
+		const std::filesystem::path& base = parent != directories_.end() ? parent->second : directory_;
+		const std::filesystem::path path = (base / std::filesystem::u8path(fileName)).lexically_normal();
+
+		auto file = std::make_unique<std::vector<char>>();
+		if (!ReadFile(path, *file))
+		{
+			return E_FAIL;
+		}
+		dependencies.push_back({ path.wstring(), ShaderCache::HashContent(file->data(), file->size()) });
+
+		*data = file->data();
+		*bytes = UINT(file->size());
+		directories_[file->data()] = path.parent_path();
+		files_.push_back(std::move(file));
+		return S_OK;
+	}
+
+	HRESULT __stdcall Close(const void* data) override
+	{
+		// 読んだものはコンパイルが終わるまで持っておく
+		return S_OK;
+	}
+
+	std::vector<ShaderCache::Dependency> dependencies;
+
+private:
+	std::filesystem::path directory_;
+	std::map<const void*, std::filesystem::path> directories_;
+	std::vector<std::unique_ptr<std::vector<char>>> files_;
+};
+
+
+// --------------------
+// 1つのファイルから、マクロを変えていくつかのステージをコンパイルする
+// ShaderCache があれば、同じ内容・エントリポイント・プロファイル・マクロのバイトコードはそこから取る
+// --------------------
+class ShaderCompiler
+{
+public:
+	bool open(const std::wstring& filePath)
+	{
+		path_ = filePath;
+		if (!ReadFile(path_, source_))
+		{
+			Debug::Log(L"シェーダーのファイルが読めません: " + filePath);
+			return false;
+		}
+		sourceHash_ = ShaderCache::HashContent(source_.data(), source_.size());
+		return true;
+	}
+
+	// コンパイルしたバイトコード。失敗したら nullptr で、error にコンパイラのメッセージ
+	std::shared_ptr<const std::vector<uint8_t>> compile(const char* entryPoint, const char* profile,
+		std::span<const ShaderCache::Define> defines, ComPtr<ID3DBlob>& error)
+	{
+		ShaderCache* cache = ShaderCache::getInstance();
+		const uint64_t key = ShaderCache::MakeKey(sourceHash_, entryPoint, profile, defines);
+		if (cache != nullptr)
+		{
+			if (auto bytecode = cache->find(key))
+			{
+				return bytecode;
+			}
+		}
+
+		const std::vector<D3D_SHADER_MACRO> macros = MakeMacros(defines);
+		const std::string sourceName = path_.string();
+		IncludeHandler include(path_);
+		ComPtr<ID3DBlob> compiled;
+		if (FAILED(D3DCompile(source_.data(), source_.size(), sourceName.c_str(), macros.data(), &include,
+			entryPoint, profile, 0, 0, &compiled, &error)))
+		{
+			return nullptr;
+		}
+
+		if (cache != nullptr)
+		{
+			return cache->store(key, include.dependencies, compiled->GetBufferPointer(), compiled->GetBufferSize());
+		}
+		const uint8_t* p = static_cast<const uint8_t*>(compiled->GetBufferPointer());
+		return std::make_shared<const std::vector<uint8_t>>(p, p + compiled->GetBufferSize());
+	}
+
+private:
+	std::filesystem::path path_;
+	std::vector<char> source_;
+	uint64_t sourceHash_ = 0;
+};
+
+
+// GPU のオブジェクトを作る。ShaderCache があれば同じバイトコードからは同じものを返す
+template<typename T, typename F>
+bool CreateObject(const std::vector<uint8_t>& bytecode, uint64_t variant, ComPtr<T>& object, F&& create)
+{
+	ShaderCache* cache = ShaderCache::getInstance();
+	if (cache != nullptr)
 	{
-		Debug::Log(L"ピクセルシェーダーシェーダーのコンパイルエラー");
-		if (error)
+		object = cache->getObject<T>(bytecode, variant, std::forward<F>(create));
+		return object != nullptr;
+	}
+	object = nullptr;
+	return create(object.GetAddressOf());
+}
+
+
+void LogCompileError(const wchar_t* message, const ComPtr<ID3DBlob>& error)
+{
+	Debug::Log(message);
+	if (error)
+	{
+		Debug::Log(static_cast<const char*>(error->GetBufferPointer()));
+	}
+}
+
+}
+
+
+uint64_t Shader::LayoutKey(const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
+{
+	uint64_t key = 14695981039346656037ull;
+	auto mix = [&key](uint64_t v)
+		{
+			key ^= v;
+			key *= 1099511628211ull;
+		};
+	for (size_t i = 0; i < layout_size; ++i)
+	{
+		for (const char* c = layout[i].SemanticName; *c != '\0'; ++c)
 		{
-			Debug::Log(static_cast<const char*>(error->GetBufferPointer()));
+			mix(uint8_t(*c));
 		}
+		mix(layout[i].SemanticIndex);
+		mix(layout[i].Format);
+		mix(layout[i].AlignedByteOffset);
+	}
+	return key;
+}
+
+
+bool Shader::compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size,
+	std::span<const ShaderCache::Define> defines)
+{
+	// 同じファイルと頂点の形式とマクロのものは1回だけコンパイルして共有する
+	const uint64_t variant = LayoutKey(layout, layout_size) ^ ShaderCache::MakeKey(0, {}, {}, defines);
+	std::shared_ptr<const Shader> shared = AssetCache::Share<const Shader>(filePath, variant,
+		[&]()
+		{
+			auto shader = std::make_shared<Shader>();
+			return shader->compileShader(filePath, layout, layout_size, defines) ? shader : nullptr;
+		});
+	if (shared == nullptr)
+	{
+		return false;
+	}
+
+	// GPU のシェーダーは参照を増やして共有する
+	m_vertex = shared->m_vertex;
+	m_pixel = shared->m_pixel;
+	m_inputLayout = shared->m_inputLayout;
+	m_vertexInstanced = shared->m_vertexInstanced;
+	m_inputLayoutInstanced = shared->m_inputLayoutInstanced;
+	fileName = shared->fileName;
+	m_shared = shared;
+	return true;
+}
+
+
+bool Shader::compileShader(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size,
+	std::span<const ShaderCache::Define> userDefines)
+{
+	std::filesystem::path path(filePath);
+	RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+
+	// GPUを使わないときはコンパイルしない
+	if (device.isNull())
+	{
+		fileName = path.filename();
+		return true;
+	}
+
+	ShaderCompiler compiler;
+	if (!compiler.open(filePath))
+	{
+		return false;
+	}
+
+	// 指定されたマクロと、頂点の形式に合わせたマクロ
+	std::vector<ShaderCache::Define> defines(userDefines.begin(), userDefines.end());
+	AddLayoutDefines(layout, layout_size, defines);
+
+	// 頂点シェーダーを読み込み＆コンパイル
+	ComPtr<ID3DBlob> error;
+	auto compiledVS = compiler.compile("VS", "vs_5_0", defines, error);
+	if (compiledVS == nullptr)
+	{
+		LogCompileError(L"頂点シェーダーのコンパイルエラー", error);
+		abort();
+		return false;
+	}
+	// ピクセルシェーダーを読み込み＆コンパイル
+	auto compiledPS = compiler.compile("PS", "ps_5_0", defines, error);
+	if (compiledPS == nullptr)
+	{
+		LogCompileError(L"ピクセルシェーダーシェーダーのコンパイルエラー", error);
 		return false;
 	}
 
 	// 頂点シェーダー作成
-	if (FAILED(D3DManager::getInstance()->GetDevice()->CreateVertexShader(compiledVS->GetBufferPointer(), compiledVS->GetBufferSize(), nullptr, &m_vertex)))
+	const std::vector<uint8_t>& vs = *compiledVS;
+	if (!CreateObject(vs, 0, m_vertex, [&](ID3D11VertexShader** out) { return device.createVertexShader(vs.data(), vs.size(), out); }))
 	{
 		Debug::Log(L"頂点シェーダーの作成エラー");
 		return false;
 	}
 	// ピクセルシェーダー作成
-	if (FAILED(D3DManager::getInstance()->GetDevice()->CreatePixelShader(compiledPS->GetBufferPointer(), compiledPS->GetBufferSize(), nullptr, &m_pixel)))
+	const std::vector<uint8_t>& ps = *compiledPS;
+	if (!CreateObject(ps, 0, m_pixel, [&](ID3D11PixelShader** out) { return device.createPixelShader(ps.data(), ps.size(), out); }))
 	{
 		Debug::Log(L"ピクセルシェーダーの作成エラー");
 		return false;
 	}
 
 	// 頂点インプットレイアウト作成
-	if (FAILED(D3DManager::getInstance()->GetDevice()->CreateInputLayout(layout, (UINT)layout_size, compiledVS->GetBufferPointer(), compiledVS->GetBufferSize(), &m_inputLayout)))
+	if (!CreateObject(vs, LayoutKey(layout, layout_size), m_inputLayout, [&](ID3D11InputLayout** out)
+		{
+			const std::vector<InputElementDesc> elements = ToInputElements(layout, layout_size);
+			return device.createInputLayout(elements.data(), (UINT)elements.size(), vs.data(), vs.size(), out);
+		}))
 	{
 		Debug::Log(L"頂点インプットレイアウトの作成エラー");
 		return false;
 	}
 
-	std::filesystem::path path(filePath);
+	// インスタンス描画版
+	m_vertexInstanced = nullptr;
+	m_inputLayoutInstanced = nullptr;
+	defines.push_back({ InstancingDefine, "1" });
+	if (auto compiledInstanced = compiler.compile("VS", "vs_5_0", defines, error))
+	{
+		createInstanced(*compiledInstanced, layout, layout_size);
+	}
+
 	fileName = path.filename();
 
 	return true;
 }
 
-void Shader::setToContext() const
+
+void Shader::createInstanced(const std::vector<uint8_t>& vs, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
 {
-	D3DManager::getInstance()->GetContext()->VSSetShader(m_vertex.Get(), 0, 0);
-	D3DManager::getInstance()->GetContext()->PSSetShader(m_pixel.Get(), 0, 0);
-	D3DManager::getInstance()->GetContext()->IASetInputLayout(m_inputLayout.Get());
+
+	// INSTANCE_WORLD を入力に持たないシェーダーはインスタンス描画に対応していない
+	ComPtr<ID3D11ShaderReflection> reflection;
+	if (FAILED(D3DReflect(vs.data(), vs.size(), IID_PPV_ARGS(&reflection))))
+	{
+		return;
+	}
+	D3D11_SHADER_DESC shaderDesc{};
+	reflection->GetDesc(&shaderDesc);
+	bool found = false;
+	for (UINT i = 0; i < shaderDesc.InputParameters; ++i)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC param{};
+		reflection->GetInputParameterDesc(i, &param);
+		if (std::strcmp(param.SemanticName, "INSTANCE_WORLD") == 0)
+		{
+			found = true;
+			break;
+		}
+	}
+	if (!found)
+	{
+		return;
+	}
+
+	// 頂点のレイアウトの後ろに、スロット1のインスタンスごとのワールド行列（4行）を足す
+	std::vector<D3D11_INPUT_ELEMENT_DESC> instancedLayout(layout, layout + layout_size);
+	for (UINT row = 0; row < 4; ++row)
+	{
+		instancedLayout.push_back(D3D11_INPUT_ELEMENT_DESC{ "INSTANCE_WORLD", row, DXGI_FORMAT_R32G32B32A32_FLOAT, InstanceSlot, row * 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+	}
+
+	RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+	if (!CreateObject(vs, 0, m_vertexInstanced, [&](ID3D11VertexShader** out) { return device.createVertexShader(vs.data(), vs.size(), out); }))
+	{
+		Debug::Log(L"インスタンス描画版の頂点シェーダーの作成エラー");
+		m_vertexInstanced = nullptr;
+		return;
+	}
+	if (!CreateObject(vs, LayoutKey(instancedLayout.data(), instancedLayout.size()), m_inputLayoutInstanced, [&](ID3D11InputLayout** out)
+		{
+			const std::vector<InputElementDesc> elements = ToInputElements(instancedLayout.data(), instancedLayout.size());
+			return device.createInputLayout(elements.data(), (UINT)elements.size(), vs.data(), vs.size(), out);
+		}))
+	{
+		Debug::Log(L"インスタンス描画版の頂点インプットレイアウトの作成エラー");
+		m_vertexInstanced = nullptr;
+		m_inputLayoutInstanced = nullptr;
+	}
+}
+
+
+void Shader::setToContext(bool instanced) const
+{
+	RenderStateCache& cache = D3DManager::getInstance()->GetStateCache();
+	if (instanced && m_vertexInstanced)
+	{
+		cache.setVertexShader(m_vertexInstanced.Get());
+		cache.setInputLayout(m_inputLayoutInstanced.Get());
+	}
+	else
+	{
+		cache.setVertexShader(m_vertex.Get());
+		cache.setInputLayout(m_inputLayout.Get());
+	}
+	cache.setPixelShader(m_pixel.Get());
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,300 @@
+﻿#include "pch.h"
+#include <UniDx/ShaderCache.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <thread>
+
+#include <UniDx/Debug.h>
+
+
+namespace UniDx
+{
+
+using namespace std;
+
+namespace
+{
+
+constexpr uint64_t FnvOffset = 14695981039346656037ull;
+constexpr uint64_t FnvPrime = 1099511628211ull;
+
+uint64_t mixString(uint64_t hash, string_view s)
+{
+    for (char c : s)
+    {
+        hash = (hash ^ uint8_t(c)) * FnvPrime;
+    }
+    // 区切り。"AB"+"C" と "A"+"BC" を別にする
+    return (hash ^ 0xFF) * FnvPrime;
+}
+
+// ファイルの内容のハッシュ。読めなければ false
+bool hashFile(const filesystem::path& path, uint64_t& hash)
+{
+    ifstream in(path, ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+    vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    hash = ShaderCache::HashContent(data.data(), data.size());
+    return true;
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// コンパイルの結果を決めるもののキー
+// -----------------------------------------------------------------------------
+uint64_t ShaderCache::MakeKey(uint64_t sourceHash, string_view entryPoint, string_view profile, span<const Define> defines)
+{
+    // マクロは名前順に並べる
+    vector<const Define*> sorted;
+    sorted.reserve(defines.size());
+    for (const Define& d : defines)
+    {
+        sorted.push_back(&d);
+    }
+    sort(sorted.begin(), sorted.end(), [](const Define* a, const Define* b)
+        {
+            return a->name != b->name ? a->name < b->name : a->value < b->value;
+        });
+
+    uint64_t key = (FnvOffset ^ sourceHash) * FnvPrime;
+    key = mixString(key, entryPoint);
+    key = mixString(key, profile);
+    for (const Define* d : sorted)
+    {
+        key = mixString(key, d->name);
+        key = mixString(key, d->value);
+    }
+    return key;
+}
+
+
+// -----------------------------------------------------------------------------
+// 内容のハッシュ（8バイトずつの FNV-1a）
+// -----------------------------------------------------------------------------
+uint64_t ShaderCache::HashContent(const void* data, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t hash = FnvOffset ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        hash = (hash ^ v) * FnvPrime;
+    }
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ p[i]) * FnvPrime;
+    }
+    return hash ^ (hash >> 32);
+}
+
+
+// -----------------------------------------------------------------------------
+// バイトコードを置くディレクトリ
+// -----------------------------------------------------------------------------
+void ShaderCache::setDirectory(const wstring& directory)
+{
+    lock_guard<mutex> lock(mutex_);
+    directory_ = directory;
+}
+
+
+wstring ShaderCache::getPath(uint64_t key) const
+{
+    wchar_t name[32];
+    swprintf(name, 32, L"%016llx.cso", static_cast<unsigned long long>(key));
+    return (filesystem::path(directory_) / name).wstring();
+}
+
+
+// -----------------------------------------------------------------------------
+// key のバイトコードを返す
+// -----------------------------------------------------------------------------
+shared_ptr<const vector<uint8_t>> ShaderCache::find(uint64_t key)
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = bytecodes_.find(key);
+        if (it != bytecodes_.end())
+        {
+            ++stats_.memoryHits;
+            return it->second;
+        }
+        if (directory_.empty())
+        {
+            ++stats_.misses;
+            return nullptr;
+        }
+    }
+
+    // ディスクから読むのはロックの外
+    shared_ptr<const vector<uint8_t>> bytecode = read_(key);
+
+    lock_guard<mutex> lock(mutex_);
+    if (bytecode == nullptr)
+    {
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.diskHits;
+    return bytecodes_.try_emplace(key, bytecode).first->second;
+}
+
+
+// -----------------------------------------------------------------------------
+// key のバイトコードを覚えて、ディスクに書き出す
+// -----------------------------------------------------------------------------
+shared_ptr<const vector<uint8_t>> ShaderCache::store(uint64_t key, span<const Dependency> dependencies, const void* bytecode, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(bytecode);
+    auto data = make_shared<const vector<uint8_t>>(p, p + size);
+
+    bool toDisk;
+    {
+        lock_guard<mutex> lock(mutex_);
+        bytecodes_[key] = data;
+        toDisk = !directory_.empty();
+    }
+    if (toDisk)
+    {
+        write_(key, dependencies, bytecode, size);
+    }
+    return data;
+}
+
+
+// -----------------------------------------------------------------------------
+// ディスクから読む。#include したファイルが変わっていたら使わない
+// -----------------------------------------------------------------------------
+shared_ptr<const vector<uint8_t>> ShaderCache::read_(uint64_t key) const
+{
+    ifstream in(filesystem::path(getPath(key)), ios::binary);
+    if (!in)
+    {
+        return nullptr;
+    }
+
+    Header header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != Magic || header.version != Version || header.key != key || header.bytecodeSize == 0)
+    {
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < header.dependencyCount; ++i)
+    {
+        uint32_t length = 0;
+        uint64_t hash = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        in.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+        if (!in || length > 4096)
+        {
+            return nullptr;
+        }
+        u8string path(length, u8'\0');
+        in.read(reinterpret_cast<char*>(path.data()), length);
+
+        uint64_t current = 0;
+        if (!in || !hashFile(filesystem::path(path), current) || current != hash)
+        {
+            return nullptr;
+        }
+    }
+
+    auto bytecode = make_shared<vector<uint8_t>>(header.bytecodeSize);
+    in.read(reinterpret_cast<char*>(bytecode->data()), header.bytecodeSize);
+    if (!in)
+    {
+        return nullptr;
+    }
+    return bytecode;
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出す。途中のファイルを見せないよう、別の名前で書いてから置き換える
+// -----------------------------------------------------------------------------
+bool ShaderCache::write_(uint64_t key, span<const Dependency> dependencies, const void* bytecode, size_t size) const
+{
+    const filesystem::path path(getPath(key));
+    error_code ec;
+    filesystem::create_directories(path.parent_path(), ec);
+
+    Header header{};
+    header.magic = Magic;
+    header.version = Version;
+    header.key = key;
+    header.dependencyCount = uint32_t(dependencies.size());
+    header.bytecodeSize = uint32_t(size);
+
+    // 別のスレッドが同じものを書いていても混ざらないよう、スレッドごとの名前にする
+    filesystem::path temp = path;
+    temp += L"." + to_wstring(hash<thread::id>()(this_thread::get_id())) + L".tmp";
+    {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out)
+        {
+            Debug::Log(L"ShaderCache: 書き出せません: " + path.wstring());
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const Dependency& d : dependencies)
+        {
+            const u8string utf8 = filesystem::path(d.path).u8string();
+            const uint32_t length = uint32_t(utf8.size());
+            out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.write(reinterpret_cast<const char*>(&d.hash), sizeof(d.hash));
+            out.write(reinterpret_cast<const char*>(utf8.data()), length);
+        }
+        out.write(static_cast<const char*>(bytecode), streamsize(size));
+        if (!out)
+        {
+            Debug::Log(L"ShaderCache: 書き出せません: " + path.wstring());
+            return false;
+        }
+    }
+
+    filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 統計
+// -----------------------------------------------------------------------------
+ShaderCache::Stats ShaderCache::getStats() const
+{
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+
+
+void ShaderCache::resetStats()
+{
+    lock_guard<mutex> lock(mutex_);
+    stats_ = Stats();
+}
+
+
+void ShaderCache::clear()
+{
+    lock_guard<mutex> lock(mutex_);
+    bytecodes_.clear();
+    objects_.clear();
+}
+
+}
@@ -0,0 +1,94 @@
+﻿#include "pch.h"
+#include <UniDx/Skeleton.h>
+
+#include <algorithm>
+
+#include <UniDx/TransformBatch.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// ノードを足す
+// -----------------------------------------------------------------------------
+size_t Skeleton::addNode(const std::string& name, int32_t parent, int32_t sourceNode,
+    const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+{
+    assert(parent < int32_t(parents.size()));
+    const size_t index = parents.size();
+    names.push_back(name);
+    parents.push_back(parent);
+    sourceNodes.push_back(sourceNode);
+
+    // 姿勢はノードの数が変わるたびに確保し直す
+    AnimationPose pose;
+    pose.resize(index + 1);
+    for (size_t i = 0; i < index; ++i)
+    {
+        pose.set(i, restPose_.getPosition(i), restPose_.getRotation(i), restPose_.getScale(i));
+    }
+    pose.set(index, position, rotation, scale);
+    restPose_ = std::move(pose);
+    return index;
+}
+
+
+// -----------------------------------------------------------------------------
+// モデル空間の行列。親は子より前にあるので、前から順に親の行列を掛ける
+// -----------------------------------------------------------------------------
+void Skeleton::computeModelMatrices(const AnimationPose& pose, Matrix* out) const
+{
+    using C = AnimationPose::Channel;
+    const float* tx = pose.channel(C::TX); const float* ty = pose.channel(C::TY); const float* tz = pose.channel(C::TZ);
+    const float* qx = pose.channel(C::QX); const float* qy = pose.channel(C::QY); const float* qz = pose.channel(C::QZ); const float* qw = pose.channel(C::QW);
+    const float* sx = pose.channel(C::SX); const float* sy = pose.channel(C::SY); const float* sz = pose.channel(C::SZ);
+
+    for (size_t i = 0; i < parents.size(); ++i)
+    {
+        const float p[3] = { tx[i], ty[i], tz[i] };
+        const float q[4] = { qx[i], qy[i], qz[i], qw[i] };
+        const float s[3] = { sx[i], sy[i], sz[i] };
+        Matrix local;
+        ComposeTRS(p, q, s, reinterpret_cast<float*>(&local));
+        out[i] = parents[i] >= 0 ? local * out[parents[i]] : local;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// スキンのジョイントの行列。逆バインド行列とモデル空間の行列を掛け、転置した3行だけを書く
+//     シェーダーでは行ごとに float4(位置, 1) との内積を取る
+// -----------------------------------------------------------------------------
+size_t Skeleton::computeSkinPalette(size_t skin, const Matrix* model, Vector4* out) const
+{
+    const Skin& s = skins[skin];
+    const size_t count = std::min(s.joints.size(), MaxSkinJoints);
+    for (size_t j = 0; j < count; ++j)
+    {
+        const Matrix m = s.inverseBindMatrices[j] * model[s.joints[j]];
+        out[j * 3 + 0] = Vector4(m._11, m._21, m._31, m._41);
+        out[j * 3 + 1] = Vector4(m._12, m._22, m._32, m._42);
+        out[j * 3 + 2] = Vector4(m._13, m._23, m._33, m._43);
+    }
+    return count;
+}
+
+
+// -----------------------------------------------------------------------------
+// ノードを探す
+// -----------------------------------------------------------------------------
+int32_t Skeleton::find(std::string_view name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    return it != names.end() ? int32_t(it - names.begin()) : -1;
+}
+
+
+int32_t Skeleton::findSourceNode(int32_t sourceNode) const
+{
+    auto it = std::find(sourceNodes.begin(), sourceNodes.end(), sourceNode);
+    return it != sourceNodes.end() ? int32_t(it - sourceNodes.begin()) : -1;
+}
+
+}
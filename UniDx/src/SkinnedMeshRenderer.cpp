@@ -0,0 +1,145 @@
+﻿#include "pch.h"
+#include <UniDx/SkinnedMeshRenderer.h>
+
+#include <UniDx/D3DManager.h>
+#include <UniDx/Animator.h>
+#include <UniDx/Camera.h>
+
+
+namespace UniDx{
+
+// -----------------------------------------------------------------------------
+// 今のポーズで頂点を動かした境界
+// -----------------------------------------------------------------------------
+void SkinnedMeshRenderer::RecalculateBounds()
+{
+    hasSkinnedBounds_ = false;
+    if (animator == nullptr)
+    {
+        return;
+    }
+    const std::span<const Vector4> palette = animator->getSkinPalette(skinIndex);
+    const size_t joints = palette.size() / Skeleton::PaletteRowsPerJoint;
+
+    Vector3 mn, mx;
+    bool found = false;
+    for (const auto& sub : mesh.submesh)
+    {
+        if (!sub->isSkinned())
+        {
+            continue;
+        }
+        for (size_t i = 0; i < sub->positions.size(); ++i)
+        {
+            // 重みで混ぜた行列で位置だけ動かす
+            const Vector4 p(sub->positions[i].x, sub->positions[i].y, sub->positions[i].z, 1.0f);
+            const float w[4] = { sub->weights[i].x, sub->weights[i].y, sub->weights[i].z, sub->weights[i].w };
+            Vector3 q = Vector3::Zero;
+            for (size_t k = 0; k < 4; ++k)
+            {
+                const size_t j = sub->joints[i][k];
+                if (w[k] == 0.0f || j >= joints)
+                {
+                    continue;
+                }
+                const Vector4* rows = palette.data() + j * Skeleton::PaletteRowsPerJoint;
+                q = q + Vector3(rows[0].Dot(p), rows[1].Dot(p), rows[2].Dot(p)) * w[k];
+            }
+            mn = found ? Vector3::Min(mn, q) : q;
+            mx = found ? Vector3::Max(mx, q) : q;
+            found = true;
+        }
+    }
+    if (found)
+    {
+        skinnedBounds_ = Bounds((mn + mx) * 0.5f, (mx - mn) * 0.5f);
+        hasSkinnedBounds_ = true;
+    }
+    ResetBounds();
+}
+
+
+// -----------------------------------------------------------------------------
+// 境界を広げる
+// -----------------------------------------------------------------------------
+bool SkinnedMeshRenderer::getLocalBounds(Bounds& bounds) const
+{
+    if (hasSkinnedBounds_)
+    {
+        bounds = skinnedBounds_;
+    }
+    else if (!mesh.getBounds(bounds))
+    {
+        return false;
+    }
+    bounds.Extents.x *= boundsScale;
+    bounds.Extents.y *= boundsScale;
+    bounds.Extents.z *= boundsScale;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ジョイントの行列を定数バッファに転送
+// -----------------------------------------------------------------------------
+bool SkinnedMeshRenderer::uploadSkinConstants() const
+{
+    if (animator == nullptr)
+    {
+        return false;
+    }
+    const std::span<const Vector4> palette = animator->getSkinPalette(skinIndex);
+    if (palette.empty())
+    {
+        return false;
+    }
+    const UINT size = UINT(palette.size_bytes());
+
+    // 共有の大きな定数バッファから切り出して書き込む
+    RenderContext& context = RenderContext::current();
+    if (context.getObjectConstants().uploadVS(UNIDX_VS_SLOT_SKIN, palette.data(), size))
+    {
+        return true;
+    }
+
+    // 使えないときは自分の定数バッファを更新。大きさはスキンのジョイントの数に合わせる
+    RenderDevice& device = context.getDevice();
+    if (skinConstants_ == nullptr || skinConstantsSize_ != size)
+    {
+        BufferDesc desc;
+        desc.byteWidth = size;
+        desc.bindFlags = GpuBindConstantBuffer;
+        desc.usage = GpuUsage::Default;
+        skinConstants_.Reset();
+        if (!D3DManager::getInstance()->GetRenderDevice().createBuffer(desc, nullptr, skinConstants_.GetAddressOf()))
+        {
+            return false;
+        }
+        skinConstantsSize_ = size;
+    }
+    ID3D11Buffer* cbs[1] = { skinConstants_.Get() };
+    device.setVSConstantBuffers(UNIDX_VS_SLOT_SKIN, 1, cbs);
+    device.updateBuffer(skinConstants_.Get(), palette.data(), size);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ジョイントの行列で頂点を動かして描画
+// -----------------------------------------------------------------------------
+void SkinnedMeshRenderer::Render(const Camera& camera) const
+{
+    // シェーダーはジョイントの行列を読むので、送れなければ描かない
+    setShaderForRender();
+    if (!uploadSkinConstants())
+    {
+        return;
+    }
+
+    // 頂点は Animator の Transform の空間に動く
+    uploadObjectConstants(animator->transform->getLocalToWorldMatrix());
+
+    mesh.Render();
+}
+
+}
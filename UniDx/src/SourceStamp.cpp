@@ -0,0 +1,93 @@
+﻿#include "pch.h"
+#include <UniDx/SourceStamp.h>
+
+#include <filesystem>
+#include <cstring>
+
+#include <UniDx/MappedFile.h>
+
+
+namespace UniDx
+{
+
+using namespace std;
+
+namespace
+{
+
+// 元のファイルの大きさと更新時刻。なければ false
+bool getSourceTime(const wstring& sourcePath, uint64_t& size, int64_t& time)
+{
+    error_code ec;
+    const filesystem::path path(sourcePath);
+    size = filesystem::file_size(path, ec);
+    if (ec) return false;
+    time = filesystem::last_write_time(path, ec).time_since_epoch().count();
+    return !ec;
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 内容のハッシュ
+// -----------------------------------------------------------------------------
+uint64_t HashSourceContent(const void* data, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t hash = 14695981039346656037ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        hash = (hash ^ v) * 1099511628211ull;
+    }
+    for (; i < size; ++i)
+    {
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash ^ (hash >> 32);
+}
+
+
+// -----------------------------------------------------------------------------
+// 元のファイルの大きさ・更新時刻・内容のハッシュ
+// -----------------------------------------------------------------------------
+bool GetSourceStamp(const wstring& sourcePath, SourceStamp& stamp)
+{
+    if (!getSourceTime(sourcePath, stamp.size, stamp.time))
+    {
+        return false;
+    }
+    MappedFile file;
+    if (!file.open(sourcePath))
+    {
+        return false;
+    }
+    stamp.hash = HashSourceContent(file.data(), file.size());
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 元のファイルが変わっていないか
+// 大きさと更新時刻が同じならそのまま使う。違っていても内容が同じなら使う
+// -----------------------------------------------------------------------------
+bool IsSourceUnchanged(const wstring& sourcePath, const SourceStamp& stamp)
+{
+    uint64_t size;
+    int64_t time;
+    if (!getSourceTime(sourcePath, size, time) || (size == stamp.size && time == stamp.time))
+    {
+        return true;
+    }
+    if (size != stamp.size)
+    {
+        return false;
+    }
+    MappedFile file;
+    return file.open(sourcePath) && HashSourceContent(file.data(), file.size()) == stamp.hash;
+}
+
+}
@@ -12,7 +12,11 @@ namespace UniDx {
 void TextMesh::Awake()
 {
 	UIBehaviour::Awake();
-	spriteBatch = std::make_unique<SpriteBatch>(D3DManager::getInstance()->GetContext().Get());
+	// GPUgȂƂ͍Ȃ
+	if (!D3DManager::getInstance()->IsNull())
+	{
+		spriteBatch = std::make_unique<SpriteBatch>(D3DManager::getInstance()->GetContext().Get());
+	}
 }
 
 
@@ -29,6 +33,9 @@ void TextMesh::Render(const Matrix& proj) const
     font->getSpriteFont()->DrawString(spriteBatch.get(), text.c_str(), drawPos);
 
     spriteBatch->End();
+
+    // SpriteBatch ReLXg̏Ԃ𒼐ڕς̂ŁAoĂԂ̂Ă
+    D3DManager::getInstance()->GetStateCache().invalidate();
 }
 
 }
@@ -4,13 +4,73 @@
 #include <filesystem>
 
 #include <UniDx/D3DManager.h>
+#include <UniDx/AssetCache.h>
+#include <UniDx/TextureStreamer.h>
+#include <UniDx/MappedFile.h>
 
 
 namespace UniDx
 {
 
+Texture::~Texture()
+{
+	if (streamIndex_ >= 0)
+	{
+		TextureStreamer::getInstance()->unregisterTexture(this);
+	}
+}
+
+
 bool Texture::Load(const std::wstring& filePath)
 {
+	// GPUを使わないときは画像を読み込まない。ストリーミングはミップの選び方を確かめられるように動かす
+	if (D3DManager::getInstance()->GetRenderDevice().isNull() && TextureStreamer::getInstance() == nullptr)
+	{
+		fileName = std::filesystem::path(filePath).filename();
+		return true;
+	}
+
+	return Decode(filePath) && Upload();
+}
+
+
+// -----------------------------------------------------------------------------
+// 画像ファイルを読み込んで共有する
+// -----------------------------------------------------------------------------
+std::shared_ptr<Texture> Texture::LoadShared(const std::wstring& filePath,
+	D3D11_TEXTURE_ADDRESS_MODE wrapU, D3D11_TEXTURE_ADDRESS_MODE wrapV)
+{
+	// サンプラはラップモードで変わるので、違うものとして扱う
+	const uint64_t variant = uint64_t(wrapU) | (uint64_t(wrapV) << 8);
+	return AssetCache::Share<Texture>(filePath, variant, [&]()
+		{
+			auto texture = std::make_shared<Texture>();
+			texture->wrapModeU = wrapU;
+			texture->wrapModeV = wrapV;
+			return texture->Load(filePath) ? texture : nullptr;
+		});
+}
+
+
+// -----------------------------------------------------------------------------
+// 画像ファイルを読み込んでミップマップまで作る
+// -----------------------------------------------------------------------------
+bool Texture::Decode(const std::wstring& filePath)
+{
+	// 書き出した DDS があれば、ミップも圧縮も済んでいるのでそのまま読む
+	// ストリーミングするときは読まずにマップしておく
+	const bool streaming = TextureStreamer::getInstance() != nullptr;
+	if (std::filesystem::path(filePath).extension() == L".dds")
+	{
+		return (streaming && mapDDS(filePath, filePath)) || loadDDS(filePath, filePath);
+	}
+	const std::wstring cachePath = TextureCache::GetCachePath(filePath);
+	if (TextureCache::IsValid(cachePath, filePath) &&
+		((streaming && mapDDS(cachePath, filePath)) || loadDDS(cachePath, filePath)))
+	{
+		return true;
+	}
+
 	// WIC画像を読み込む
 	auto image = std::make_unique<DirectX::ScratchImage>();
 	if (FAILED(DirectX::LoadFromWICFile(filePath.c_str(), DirectX::WIC_FLAGS_NONE, &m_info, *image)))
@@ -30,32 +90,168 @@ bool Texture::Load(const std::wstring& filePath)
 		}
 	}
 
-	// リソースとシェーダーリソースビューを作成
-	if (FAILED(DirectX::CreateShaderResourceView(D3DManager::getInstance()->GetDevice().Get(), image->GetImages(), image->GetImageCount(), m_info, &m_srv)))
+	decoded_ = std::move(image);
+	fileName = std::filesystem::path(filePath).filename();
+	return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// DDS をそのまま読む。ブロック圧縮のまま GPU に送る
+// -----------------------------------------------------------------------------
+bool Texture::loadDDS(const std::wstring& ddsPath, const std::wstring& filePath)
+{
+	auto image = std::make_unique<DirectX::ScratchImage>();
+	if (FAILED(DirectX::LoadFromDDSFile(ddsPath.c_str(), DirectX::DDS_FLAGS_NONE, &m_info, *image)))
 	{
-		// 失敗
 		m_info = {};
 		return false;
 	}
+	decoded_ = std::move(image);
+	fileName = std::filesystem::path(filePath).filename();
+	return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// DDS をマップしておく。中身はミップを置くときに TextureStreamer が読む
+// -----------------------------------------------------------------------------
+bool Texture::mapDDS(const std::wstring& ddsPath, const std::wstring& filePath)
+{
+	auto file = std::make_shared<MappedFile>();
+	TextureCache::Layout layout;
+	if (!file->open(ddsPath) || !TextureCache::ReadLayout(file->data(), file->size(), layout))
+	{
+		return false;
+	}
+
+	m_info = {};
+	m_info.width = layout.width;
+	m_info.height = layout.height;
+	m_info.depth = 1;
+	m_info.arraySize = 1;
+	m_info.mipLevels = layout.mipCount;
+	m_info.format = layout.format;
+	m_info.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+
+	streamFile_ = std::move(file);
+	streamLayout_ = layout;
+	fileName = std::filesystem::path(filePath).filename();
+	return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 画像ファイルからミップを作ってブロック圧縮し、DDS に書き出す
+// -----------------------------------------------------------------------------
+bool Texture::Cook(const std::wstring& filePath, TextureCache::Format format)
+{
+	DirectX::TexMetadata info;
+	DirectX::ScratchImage image;
+	if (FAILED(DirectX::LoadFromWICFile(filePath.c_str(), DirectX::WIC_FLAGS_NONE, &info, image)))
+	{
+		Debug::Log(L"画像ファイルを読めません: " + filePath);
+		return false;
+	}
 
-	std::filesystem::path path(filePath);
-	fileName = path.filename();
+	// 1枚目の RGBA8 を使う。違う形式なら変換する
+	const bool srgb = DirectX::IsSRGB(info.format);
+	const DXGI_FORMAT rgbaFormat = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	if (info.format != rgbaFormat)
+	{
+		DirectX::ScratchImage converted;
+		if (FAILED(DirectX::Convert(*image.GetImage(0, 0, 0), rgbaFormat, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted)))
+		{
+			Debug::Log(L"画像を RGBA8 に変換できません: " + filePath);
+			return false;
+		}
+		image = std::move(converted);
+		info = image.GetMetadata();
+	}
+	const DirectX::Image& top = *image.GetImage(0, 0, 0);
+	const uint32_t width = uint32_t(top.width);
+	const uint32_t height = uint32_t(top.height);
+
+	DXGI_FORMAT compressedFormat;
+	std::vector< std::vector<uint8_t> > mips;
+	if (format == TextureCache::Format::BC7)
+	{
+		// BC7 は DirectXTex で圧縮する
+		DirectX::ScratchImage mipChain;
+		DirectX::ScratchImage compressed;
+		compressedFormat = srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		if (FAILED(DirectX::GenerateMipMaps(&top, 1, info, DirectX::TEX_FILTER_DEFAULT, 0, mipChain)) ||
+			FAILED(DirectX::Compress(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(),
+				compressedFormat, DirectX::TEX_COMPRESS_PARALLEL, DirectX::TEX_THRESHOLD_DEFAULT, compressed)))
+		{
+			Debug::Log(L"BC7 に圧縮できません: " + filePath);
+			return false;
+		}
+		for (size_t level = 0; level < compressed.GetMetadata().mipLevels; ++level)
+		{
+			const DirectX::Image* mip = compressed.GetImage(level, 0, 0);
+			mips.emplace_back(mip->pixels, mip->pixels + mip->slicePitch);
+		}
+	}
+	else if (!TextureCache::Encode(top.pixels, width, height, top.rowPitch, srgb, format, compressedFormat, mips))
+	{
+		Debug::Log(L"圧縮できません: " + filePath);
+		return false;
+	}
+
+	return TextureCache::Write(TextureCache::GetCachePath(filePath), filePath, compressedFormat, width, height, mips);
+}
+
+
+// -----------------------------------------------------------------------------
+// Decode した画像から GPU のリソースを作る
+// -----------------------------------------------------------------------------
+bool Texture::Upload()
+{
+	RenderDevice& device = D3DManager::getInstance()->GetRenderDevice();
+
+	if (streamFile_ != nullptr)
+	{
+		// 粗いミップだけを作って登録する。細かいミップは TextureStreamer が後から置く
+		const bool registered = TextureStreamer::getInstance()->registerTexture(this, std::move(streamFile_), streamLayout_);
+		streamFile_ = nullptr;
+		if (!registered)
+		{
+			m_info = {};
+			return false;
+		}
+	}
+	else
+	{
+		// GPUを使わないときは画像を捨てるだけ
+		if (device.isNull())
+		{
+			decoded_ = nullptr;
+			return true;
+		}
+		if (decoded_ == nullptr)
+		{
+			return false;
+		}
+
+		// リソースとシェーダーリソースビューを作成
+		if (FAILED(DirectX::CreateShaderResourceView(D3DManager::getInstance()->GetDevice().Get(), decoded_->GetImages(), decoded_->GetImageCount(), m_info, &m_srv)))
+		{
+			// 失敗
+			m_info = {};
+			decoded_ = nullptr;
+			return false;
+		}
+		decoded_ = nullptr;
+	}
 
 	// サンプラ
-	D3D11_SAMPLER_DESC samplerDesc;
-	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	samplerDesc.AddressU = wrapModeU;
-	samplerDesc.AddressV = wrapModeV;
-	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-	samplerDesc.MipLODBias = 0.0f;
-	samplerDesc.MaxAnisotropy = 1;
-	samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-	samplerDesc.MinLOD = -FLT_MAX;
-	samplerDesc.MaxLOD = FLT_MAX;
-
-	ID3D11SamplerState* pState;
-	D3DManager::getInstance()->GetDevice()->CreateSamplerState(&samplerDesc, &pState);
-	samplerState = pState;
+	SamplerDesc samplerDesc;
+	samplerDesc.addressU = TextureAddressMode(wrapModeU);
+	samplerDesc.addressV = TextureAddressMode(wrapModeV);
+	samplerDesc.addressW = TextureAddressMode::Clamp;
+
+	device.createSamplerState(samplerDesc, &samplerState);
 
 	// 成功！
 	return true;
@@ -65,11 +261,11 @@ bool Texture::Load(const std::wstring& filePath)
 void Texture::setForRender() const
 {
 	// テクスチャのバインド
-	D3DManager::getInstance()->GetContext()->PSSetShaderResources(UNIDX_PS_SLOT_ALBEDO, 1, m_srv.GetAddressOf());
+	RenderStateCache& cache = D3DManager::getInstance()->GetStateCache();
+	cache.setPSShaderResource(UNIDX_PS_SLOT_ALBEDO, m_srv.Get());
 
 	// サンプラのバインド
-	ID3D11SamplerState* pState = samplerState.Get();
-	D3DManager::getInstance()->GetContext()->PSSetSamplers(UNIDX_PS_SLOT_ALBEDO, 1, &pState);
+	cache.setPSSampler(UNIDX_PS_SLOT_ALBEDO, samplerState.Get());
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,368 @@
+﻿#include "pch.h"
+#include <UniDx/TextureCache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+#include <UniDx/SourceStamp.h>
+#include <UniDx/TextureCompression.h>
+
+
+namespace UniDx
+{
+
+using namespace std;
+
+namespace
+{
+
+constexpr uint32_t DdsMagic = 0x20534444;       // "DDS "
+
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+struct DdsPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+// 予約領域に書く、元のファイルの情報
+struct SourceInfo
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+    int64_t  time;
+    uint64_t hash;
+};
+
+struct DdsHeader
+{
+    uint32_t       size;
+    uint32_t       flags;
+    uint32_t       height;
+    uint32_t       width;
+    uint32_t       pitchOrLinearSize;
+    uint32_t       depth;
+    uint32_t       mipMapCount;
+    uint32_t       reserved1[11];   // SourceInfo を書く
+    DdsPixelFormat pixelFormat;
+    uint32_t       caps;
+    uint32_t       caps2;
+    uint32_t       caps3;
+    uint32_t       caps4;
+    uint32_t       reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER");
+static_assert(sizeof(SourceInfo) <= sizeof(uint32_t) * 11, "SourceInfo");
+
+struct DdsHeaderDxt10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DimensionTexture2D = 3;
+
+// ブロックのバイト数。扱えない形式なら 0
+size_t getBlockBytes(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        return 8;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出すファイルのパス
+// -----------------------------------------------------------------------------
+wstring TextureCache::GetCachePath(const wstring& sourcePath)
+{
+    return sourcePath + L".dds";
+}
+
+
+uint32_t TextureCache::GetMipCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = max(1u, width / 2);
+        height = max(1u, height / 2);
+        ++count;
+    }
+    return count;
+}
+
+
+// -----------------------------------------------------------------------------
+// DDS の中身の並び
+// -----------------------------------------------------------------------------
+size_t TextureCache::Layout::getMipOffset(uint32_t level) const
+{
+    size_t offset = dataOffset;
+    for (uint32_t l = 0; l < level; ++l)
+    {
+        offset += getMipSize(l);
+    }
+    return offset;
+}
+
+
+size_t TextureCache::Layout::getSizeFrom(uint32_t level) const
+{
+    size_t bytes = 0;
+    for (uint32_t l = level; l < mipCount; ++l)
+    {
+        bytes += getMipSize(l);
+    }
+    return bytes;
+}
+
+
+bool TextureCache::ReadLayout(const uint8_t* data, size_t size, Layout& layout)
+{
+    if (size < sizeof(uint32_t) + sizeof(DdsHeader))
+    {
+        return false;
+    }
+    uint32_t magic;
+    DdsHeader header;
+    memcpy(&magic, data, sizeof(magic));
+    memcpy(&header, data + sizeof(magic), sizeof(header));
+    if (magic != DdsMagic || header.size != sizeof(DdsHeader) || (header.pixelFormat.flags & DDPF_FOURCC) == 0)
+    {
+        return false;
+    }
+
+    layout = Layout();
+    layout.dataOffset = sizeof(magic) + sizeof(header);
+    switch (header.pixelFormat.fourCC)
+    {
+    case MakeFourCC('D', 'X', 'T', '1'): layout.format = DXGI_FORMAT_BC1_UNORM; break;
+    case MakeFourCC('D', 'X', 'T', '5'): layout.format = DXGI_FORMAT_BC3_UNORM; break;
+    case MakeFourCC('D', 'X', '1', '0'):
+    {
+        DdsHeaderDxt10 ext;
+        if (size < layout.dataOffset + sizeof(ext))
+        {
+            return false;
+        }
+        memcpy(&ext, data + layout.dataOffset, sizeof(ext));
+        if (ext.resourceDimension != DimensionTexture2D || ext.arraySize != 1 || (ext.miscFlag & 0x4) != 0)
+        {
+            return false;
+        }
+        layout.format = DXGI_FORMAT(ext.dxgiFormat);
+        layout.dataOffset += sizeof(ext);
+        break;
+    }
+    default:
+        return false;
+    }
+
+    layout.blockBytes = uint32_t(getBlockBytes(layout.format));
+    layout.width = header.width;
+    layout.height = header.height;
+    layout.mipCount = (header.flags & DDSD_MIPMAPCOUNT) != 0 ? max(1u, header.mipMapCount) : 1;
+    if (layout.blockBytes == 0 || layout.width == 0 || layout.height == 0 || layout.mipCount > GetMipCount(layout.width, layout.height))
+    {
+        return false;
+    }
+    return layout.getMipOffset(layout.mipCount) <= size;
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出したファイルで、元のファイルが変わっていないか
+// -----------------------------------------------------------------------------
+bool TextureCache::IsValid(const wstring& cachePath, const wstring& sourcePath)
+{
+    ifstream in(filesystem::path(cachePath), ios::binary);
+    uint32_t magic = 0;
+    DdsHeader header{};
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    SourceInfo source;
+    memcpy(&source, header.reserved1, sizeof(source));
+    if (!in || magic != DdsMagic || header.size != sizeof(DdsHeader) || source.magic != Magic || source.version != Version)
+    {
+        return false;
+    }
+    return IsSourceUnchanged(sourcePath, SourceStamp{ source.size, source.time, source.hash });
+}
+
+
+// -----------------------------------------------------------------------------
+// ミップを作って圧縮する
+// -----------------------------------------------------------------------------
+bool TextureCache::Encode(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, bool srgb, Format format,
+    DXGI_FORMAT& outFormat, vector< vector<uint8_t> >& mips)
+{
+    if (width == 0 || height == 0 || format == Format::BC7)
+    {
+        return false;
+    }
+    if (format == Format::Auto)
+    {
+        format = HasTransparency(rgba, width, height, rowPitch) ? Format::BC3 : Format::BC1;
+    }
+    const bool bc1 = format == Format::BC1;
+    const size_t blockBytes = bc1 ? 8 : 16;
+    outFormat = bc1 ? (srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM)
+                    : (srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM);
+
+    const uint32_t mipCount = GetMipCount(width, height);
+    mips.assign(mipCount, {});
+
+    // 1つ上のミップから半分にしていく。縮めた画像は行を詰めて持つ
+    vector<uint8_t> current, next;
+    const uint8_t* src = rgba;
+    size_t pitch = rowPitch;
+    for (uint32_t level = 0; level < mipCount; ++level)
+    {
+        mips[level].resize(GetCompressedSize(width, height, blockBytes));
+        if (bc1)
+        {
+            CompressBC1(src, width, height, pitch, mips[level].data());
+        }
+        else
+        {
+            CompressBC3(src, width, height, pitch, mips[level].data());
+        }
+
+        if (level + 1 < mipCount)
+        {
+            next.resize(size_t(max(1u, width / 2)) * max(1u, height / 2) * 4);
+            DownsampleRGBA8(src, width, height, pitch, srgb, next.data());
+            current.swap(next);
+            src = current.data();
+            width = max(1u, width / 2);
+            height = max(1u, height / 2);
+            pitch = size_t(width) * 4;
+        }
+    }
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// DDS に書き出す。途中のファイルを見せないよう、別の名前で書いてから置き換える
+// -----------------------------------------------------------------------------
+bool TextureCache::Write(const wstring& cachePath, const wstring& sourcePath, DXGI_FORMAT format,
+    uint32_t width, uint32_t height, const vector< vector<uint8_t> >& mips)
+{
+    const size_t blockBytes = getBlockBytes(format);
+    if (blockBytes == 0 || mips.empty())
+    {
+        Debug::Log(L"TextureCache: 書き出せない形式です: " + cachePath);
+        return false;
+    }
+
+    DdsHeader header{};
+    header.size = sizeof(DdsHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = height;
+    header.width = width;
+    header.pitchOrLinearSize = uint32_t(GetCompressedSize(width, height, blockBytes));
+    header.mipMapCount = uint32_t(mips.size());
+    header.caps = DDSCAPS_TEXTURE | (mips.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    SourceStamp stamp;
+    if (!GetSourceStamp(sourcePath, stamp))
+    {
+        Debug::Log(L"TextureCache: 元のファイルを読めません: " + sourcePath);
+        return false;
+    }
+    const SourceInfo source{ Magic, Version, stamp.size, stamp.time, stamp.hash };
+    memcpy(header.reserved1, &source, sizeof(source));
+
+    // BC1 と BC3 は古い FourCC で書き、それ以外は DX10 の拡張ヘッダーを付ける
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    bool dx10 = false;
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM: header.pixelFormat.fourCC = MakeFourCC('D', 'X', 'T', '1'); break;
+    case DXGI_FORMAT_BC3_UNORM: header.pixelFormat.fourCC = MakeFourCC('D', 'X', 'T', '5'); break;
+    default:
+        header.pixelFormat.fourCC = MakeFourCC('D', 'X', '1', '0');
+        dx10 = true;
+        break;
+    }
+
+    const filesystem::path path(cachePath);
+    filesystem::path temp = path;
+    temp += L".tmp";
+    {
+        ofstream out(temp, ios::binary | ios::trunc);
+        if (!out)
+        {
+            Debug::Log(L"TextureCache: 書き出せません: " + cachePath);
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&DdsMagic), sizeof(DdsMagic));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (dx10)
+        {
+            const DdsHeaderDxt10 ext{ uint32_t(format), DimensionTexture2D, 0, 1, 0 };
+            out.write(reinterpret_cast<const char*>(&ext), sizeof(ext));
+        }
+        for (const vector<uint8_t>& mip : mips)
+        {
+            out.write(reinterpret_cast<const char*>(mip.data()), streamsize(mip.size()));
+        }
+        if (!out)
+        {
+            Debug::Log(L"TextureCache: 書き出せません: " + cachePath);
+            return false;
+        }
+    }
+
+    error_code ec;
+    filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        filesystem::remove(temp, ec);
+        Debug::Log(L"TextureCache: 置き換えられません: " + cachePath);
+        return false;
+    }
+    return true;
+}
+
+}
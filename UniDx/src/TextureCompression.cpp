@@ -0,0 +1,473 @@
+﻿#include "pch.h"
+#include <UniDx/TextureCompression.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+#include <cstring>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+struct Color3
+{
+    float r, g, b;
+};
+
+inline Color3 operator+(Color3 a, Color3 b) { return { a.r + b.r, a.g + b.g, a.b + b.b }; }
+inline Color3 operator-(Color3 a, Color3 b) { return { a.r - b.r, a.g - b.g, a.b - b.b }; }
+inline Color3 operator*(Color3 a, float s) { return { a.r * s, a.g * s, a.b * s }; }
+inline float Dot(Color3 a, Color3 b) { return a.r * b.r + a.g * b.g + a.b * b.b; }
+
+
+// 8 ビットの色を 565 に丸める
+inline uint16_t PackRGB565(Color3 c)
+{
+    const int r = std::clamp(int(c.r * 31.0f / 255.0f + 0.5f), 0, 31);
+    const int g = std::clamp(int(c.g * 63.0f / 255.0f + 0.5f), 0, 63);
+    const int b = std::clamp(int(c.b * 31.0f / 255.0f + 0.5f), 0, 31);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+
+// 565 を 8 ビットに戻す。デコーダーと同じく上位ビットを下に繰り返す
+inline Color3 UnpackRGB565(uint16_t c)
+{
+    const int r = (c >> 11) & 31;
+    const int g = (c >> 5) & 63;
+    const int b = c & 31;
+    return { float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)) };
+}
+
+
+// 端点 c0, c1 から 4 色のパレットを作る。順番はブロックに書く番号の順
+inline void MakePalette(uint16_t c0, uint16_t c1, Color3* palette)
+{
+    const Color3 a = UnpackRGB565(c0);
+    const Color3 b = UnpackRGB565(c1);
+    palette[0] = a;
+    palette[1] = b;
+    palette[2] = a * (2.0f / 3.0f) + b * (1.0f / 3.0f);
+    palette[3] = a * (1.0f / 3.0f) + b * (2.0f / 3.0f);
+}
+
+
+// 各画素に一番近いパレットの番号を選ぶ。誤差の合計を返す
+float SelectIndices(const Color3* colors, const Color3* palette, uint8_t* indices)
+{
+    float total = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float best = FLT_MAX;
+        for (uint8_t k = 0; k < 4; ++k)
+        {
+            const Color3 d = colors[i] - palette[k];
+            const float e = Dot(d, d);
+            if (e < best)
+            {
+                best = e;
+                indices[i] = k;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+
+// 番号を決めたときに誤差が最小になる端点を最小二乗で求める
+bool RefitEndpoints(const Color3* colors, const uint8_t* indices, Color3& a, Color3& b)
+{
+    // 番号ごとの a の重み
+    static const float weightA[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float aa = 0, bb = 0, ab = 0;
+    Color3 ax{ 0, 0, 0 }, bx{ 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+    {
+        const float wa = weightA[indices[i]];
+        const float wb = 1.0f - wa;
+        aa += wa * wa;
+        bb += wb * wb;
+        ab += wa * wb;
+        ax = ax + colors[i] * wa;
+        bx = bx + colors[i] * wb;
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f)
+    {
+        return false;
+    }
+    const float inv = 1.0f / det;
+    a = (ax * bb - bx * ab) * inv;
+    b = (bx * aa - ax * ab) * inv;
+    return true;
+}
+
+
+// 16 画素の色を BC1 の色ブロックにする
+void EncodeColorBlock(const uint8_t* rgba, uint8_t* dst)
+{
+    Color3 colors[16];
+    Color3 mean{ 0, 0, 0 };
+    for (int i = 0; i < 16; ++i)
+    {
+        colors[i] = { float(rgba[i * 4 + 0]), float(rgba[i * 4 + 1]), float(rgba[i * 4 + 2]) };
+        mean = mean + colors[i];
+    }
+    mean = mean * (1.0f / 16.0f);
+
+    // 色の広がりの主軸をべき乗法で求める
+    // 始めの向きは平均から一番離れた画素へ向ける。決まった向きだと主軸と直交したときに求まらない
+    float cov[6] = {};
+    Color3 axis{ 1.0f, 1.0f, 1.0f };
+    float farthest = 0.0f;
+    for (const Color3& c : colors)
+    {
+        const Color3 d = c - mean;
+        cov[0] += d.r * d.r; cov[1] += d.r * d.g; cov[2] += d.r * d.b;
+        cov[3] += d.g * d.g; cov[4] += d.g * d.b; cov[5] += d.b * d.b;
+        if (Dot(d, d) > farthest)
+        {
+            farthest = Dot(d, d);
+            axis = d;
+        }
+    }
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        const Color3 next{
+            cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+            cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+            cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b };
+        const float length = std::sqrt(Dot(next, next));
+        if (length < 1e-6f)
+        {
+            break;
+        }
+        axis = next * (1.0f / length);
+    }
+
+    // 主軸の上の両端を端点にする。外れた画素に引っ張られないよう少し内側に寄せる
+    float tMin = FLT_MAX, tMax = -FLT_MAX;
+    for (const Color3& c : colors)
+    {
+        const float t = Dot(c - mean, axis);
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    const float inset = (tMax - tMin) / 16.0f;
+    Color3 endA = mean + axis * (tMax - inset);
+    Color3 endB = mean + axis * (tMin + inset);
+
+    uint16_t c0 = PackRGB565(endA);
+    uint16_t c1 = PackRGB565(endB);
+    Color3 palette[4];
+    uint8_t indices[16];
+    MakePalette(c0, c1, palette);
+    float error = SelectIndices(colors, palette, indices);
+
+    // 選んだ番号に合わせて端点を直し、よくなったら使う
+    if (RefitEndpoints(colors, indices, endA, endB))
+    {
+        const uint16_t r0 = PackRGB565(endA);
+        const uint16_t r1 = PackRGB565(endB);
+        Color3 refitPalette[4];
+        uint8_t refitIndices[16];
+        MakePalette(r0, r1, refitPalette);
+        const float refitError = SelectIndices(colors, refitPalette, refitIndices);
+        if (refitError < error)
+        {
+            c0 = r0;
+            c1 = r1;
+            std::memcpy(indices, refitIndices, sizeof(indices));
+        }
+    }
+
+    // c0 > c1 のときが 4 色のモード。逆なら端点を入れ替えて番号を付け替える
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+        static const uint8_t swapped[4] = { 1, 0, 3, 2 };
+        for (uint8_t& index : indices)
+        {
+            index = swapped[index];
+        }
+    }
+    else if (c0 == c1)
+    {
+        std::memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        bits |= uint32_t(indices[i]) << (i * 2);
+    }
+    std::memcpy(dst + 0, &c0, 2);
+    std::memcpy(dst + 2, &c1, 2);
+    std::memcpy(dst + 4, &bits, 4);
+}
+
+
+// 16 画素のアルファを BC3 のアルファブロックにする。8 段階のモードで、最大と最小を端点にする
+void EncodeAlphaBlock(const uint8_t* rgba, uint8_t* dst)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        a0 = std::max(a0, int(rgba[i * 4 + 3]));
+        a1 = std::min(a1, int(rgba[i * 4 + 3]));
+    }
+
+    uint64_t bits = 0;
+    if (a0 != a1)
+    {
+        // 番号の順の値。0 と 1 が端点で、2～7 がその間
+        int palette[8] = { a0, a1 };
+        for (int k = 1; k < 7; ++k)
+        {
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            const int a = rgba[i * 4 + 3];
+            int best = INT_MAX;
+            uint64_t index = 0;
+            for (int k = 0; k < 8; ++k)
+            {
+                const int e = std::abs(a - palette[k]);
+                if (e < best)
+                {
+                    best = e;
+                    index = uint64_t(k);
+                }
+            }
+            bits |= index << (i * 3);
+        }
+    }
+    dst[0] = uint8_t(a0);
+    dst[1] = uint8_t(a1);
+    for (int i = 0; i < 6; ++i)
+    {
+        dst[2 + i] = uint8_t(bits >> (i * 8));
+    }
+}
+
+
+// 色ブロックを戻す
+void DecodeColorBlock(const uint8_t* src, uint8_t* rgba)
+{
+    uint16_t c0, c1;
+    uint32_t bits;
+    std::memcpy(&c0, src + 0, 2);
+    std::memcpy(&c1, src + 2, 2);
+    std::memcpy(&bits, src + 4, 4);
+    Color3 palette[4];
+    MakePalette(c0, c1, palette);
+    for (int i = 0; i < 16; ++i)
+    {
+        const Color3& c = palette[(bits >> (i * 2)) & 3];
+        rgba[i * 4 + 0] = uint8_t(c.r + 0.5f);
+        rgba[i * 4 + 1] = uint8_t(c.g + 0.5f);
+        rgba[i * 4 + 2] = uint8_t(c.b + 0.5f);
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+
+// (x, y) から 4×4 画素を取り出す。画像の外は端の画素を繰り返す
+void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, uint32_t x, uint32_t y, uint8_t* block)
+{
+    for (uint32_t j = 0; j < 4; ++j)
+    {
+        const uint8_t* row = rgba + size_t(std::min(y + j, height - 1)) * rowPitch;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            std::memcpy(block + (j * 4 + i) * 4, row + size_t(std::min(x + i, width - 1)) * 4, 4);
+        }
+    }
+}
+
+
+template<typename F>
+void CompressBlocks(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, size_t blockBytes, uint8_t* dst, F encode)
+{
+    uint8_t block[64];
+    for (uint32_t y = 0; y < height; y += 4)
+    {
+        for (uint32_t x = 0; x < width; x += 4)
+        {
+            LoadBlock(rgba, width, height, rowPitch, x, y, block);
+            encode(block, dst);
+            dst += blockBytes;
+        }
+    }
+}
+
+
+// sRGB と線形の変換
+float SrgbToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+uint8_t LinearToSrgb8(float c)
+{
+    const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return uint8_t(std::clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 4×4 画素を圧縮する
+// -----------------------------------------------------------------------------
+void EncodeBC1Block(const uint8_t* rgba, uint8_t* dst)
+{
+    EncodeColorBlock(rgba, dst);
+}
+
+
+void EncodeBC3Block(const uint8_t* rgba, uint8_t* dst)
+{
+    EncodeAlphaBlock(rgba, dst);
+    EncodeColorBlock(rgba, dst + 8);
+}
+
+
+// -----------------------------------------------------------------------------
+// 圧縮したブロックを戻す
+// -----------------------------------------------------------------------------
+void DecodeBC1Block(const uint8_t* src, uint8_t* rgba)
+{
+    DecodeColorBlock(src, rgba);
+}
+
+
+void DecodeBC3Block(const uint8_t* src, uint8_t* rgba)
+{
+    DecodeColorBlock(src + 8, rgba);
+
+    const int a0 = src[0];
+    const int a1 = src[1];
+    int palette[8] = { a0, a1 };
+    if (a0 > a1)
+    {
+        for (int k = 1; k < 7; ++k)
+        {
+            palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+        }
+    }
+    else
+    {
+        // 6 段階と 0, 255 のモード。エンコーダーは端点が同じときだけ使う
+        for (int k = 1; k < 5; ++k)
+        {
+            palette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        bits |= uint64_t(src[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        rgba[i * 4 + 3] = uint8_t(palette[(bits >> (i * 3)) & 7]);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 画像全体を圧縮する
+// -----------------------------------------------------------------------------
+void CompressBC1(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* dst)
+{
+    CompressBlocks(rgba, width, height, rowPitch, 8, dst, EncodeBC1Block);
+}
+
+
+void CompressBC3(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, uint8_t* dst)
+{
+    CompressBlocks(rgba, width, height, rowPitch, 16, dst, EncodeBC3Block);
+}
+
+
+size_t GetCompressedSize(uint32_t width, uint32_t height, size_t blockBytes)
+{
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockBytes;
+}
+
+
+// -----------------------------------------------------------------------------
+// 縦横半分にする
+// -----------------------------------------------------------------------------
+void DownsampleRGBA8(const uint8_t* src, uint32_t width, uint32_t height, size_t rowPitch, bool srgb, uint8_t* dst)
+{
+    static const auto toLinear = []()
+        {
+            std::array<float, 256> table;
+            for (int i = 0; i < 256; ++i)
+            {
+                table[i] = SrgbToLinear(i / 255.0f);
+            }
+            return table;
+        }();
+
+    const uint32_t outWidth = std::max(1u, width / 2);
+    const uint32_t outHeight = std::max(1u, height / 2);
+    for (uint32_t y = 0; y < outHeight; ++y)
+    {
+        // 奇数の大きさのときは端の画素を 2 回使う
+        const uint8_t* row0 = src + size_t(std::min(y * 2, height - 1)) * rowPitch;
+        const uint8_t* row1 = src + size_t(std::min(y * 2 + 1, height - 1)) * rowPitch;
+        for (uint32_t x = 0; x < outWidth; ++x)
+        {
+            const size_t x0 = size_t(std::min(x * 2, width - 1)) * 4;
+            const size_t x1 = size_t(std::min(x * 2 + 1, width - 1)) * 4;
+            uint8_t* out = dst + (size_t(y) * outWidth + x) * 4;
+            for (int c = 0; c < 4; ++c)
+            {
+                if (srgb && c < 3)
+                {
+                    const float sum = toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]] + toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]];
+                    out[c] = LinearToSrgb8(sum * 0.25f);
+                }
+                else
+                {
+                    out[c] = uint8_t((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// アルファが 255 でない画素があるか
+// -----------------------------------------------------------------------------
+bool HasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch)
+{
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = rgba + size_t(y) * rowPitch;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            if (row[x * 4 + 3] != 255)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,247 @@
+﻿#include "pch.h"
+#include <UniDx/TextureResidency.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// 登録。空いている番号があれば使う
+// -----------------------------------------------------------------------------
+uint32_t TextureResidency::add(uint32_t width, uint32_t height, std::vector<size_t> mipBytes)
+{
+    uint32_t id;
+    if (!free_.empty())
+    {
+        id = free_.back();
+        free_.pop_back();
+    }
+    else
+    {
+        id = uint32_t(entries_.size());
+        entries_.emplace_back();
+    }
+
+    Entry& entry = entries_[id];
+    entry = Entry();
+    entry.width = width;
+    entry.height = height;
+    entry.active = true;
+    entry.lastUsedFrame = frame_;
+
+    // 粗い方から足していく
+    const uint32_t mipCount = uint32_t(mipBytes.size());
+    entry.sizeFrom.assign(mipCount + 1, 0);
+    for (uint32_t mip = mipCount; mip > 0; --mip)
+    {
+        entry.sizeFrom[mip - 1] = entry.sizeFrom[mip] + mipBytes[mip - 1];
+    }
+
+    // 大きい方の辺が tailSize 以下になる最初のミップ
+    uint32_t tail = 0;
+    while (tail + 1 < mipCount && (std::max)((std::max)(1u, width >> tail), (std::max)(1u, height >> tail)) > settings_.tailSize)
+    {
+        ++tail;
+    }
+    entry.tailMip = tail;
+    entry.targetMip = tail;
+    entry.residentMip = mipCount;
+    setResident(entry, tail);
+
+    order_.push_back(id);
+    return id;
+}
+
+
+// -----------------------------------------------------------------------------
+// 登録解除。読み込み中なら finishLoad まで番号を空けない
+// -----------------------------------------------------------------------------
+void TextureResidency::remove(uint32_t id)
+{
+    Entry& entry = entries_[id];
+    if (!entry.active)
+    {
+        return;
+    }
+    order_.erase(std::find(order_.begin(), order_.end(), id));
+    setResident(entry, uint32_t(entry.sizeFrom.size() - 1));
+    entry.active = false;
+    if (!entry.loading)
+    {
+        free_.push_back(id);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画で使う。同じフレームで何度も使われたら一番大きいものにする
+// -----------------------------------------------------------------------------
+void TextureResidency::request(uint32_t id, float screenPixels)
+{
+    Entry& entry = entries_[id];
+    if (entry.lastUsedFrame != frame_)
+    {
+        entry.lastUsedFrame = frame_;
+        entry.screenPixels = screenPixels;
+    }
+    else
+    {
+        entry.screenPixels = (std::max)(entry.screenPixels, screenPixels);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 画面上の大きさからミップを選ぶ
+//     テクスチャの1画素が画面の1画素くらいになるミップ
+// -----------------------------------------------------------------------------
+uint32_t TextureResidency::ChooseMip(uint32_t width, uint32_t height, uint32_t mipCount, float screenPixels, float bias)
+{
+    const uint32_t coarsest = mipCount > 0 ? mipCount - 1 : 0;
+    if (!(screenPixels > 0.0f))
+    {
+        return coarsest;
+    }
+    const float level = std::floor(std::log2(float((std::max)(width, height)) / screenPixels) + bias);
+    if (level <= 0.0f)
+    {
+        return 0;
+    }
+    return (std::min)(coarsest, uint32_t(level));
+}
+
+
+// -----------------------------------------------------------------------------
+// 毎フレームの更新
+// -----------------------------------------------------------------------------
+void TextureResidency::update(Uploader& uploader)
+{
+    assignTargets();
+
+    // 予算からはみ出したものは、その場で粗くする
+    for (uint32_t id : order_)
+    {
+        Entry& entry = entries_[id];
+        if (!entry.loading && entry.targetMip > entry.residentMip && uploader.evict(id, entry.targetMip))
+        {
+            setResident(entry, entry.targetMip);
+            ++stats_.evictions;
+        }
+    }
+
+    // 細かくするものは、優先するものから読み込みを始める
+    for (uint32_t id : order_)
+    {
+        if (stats_.loadsInFlight >= settings_.maxLoadsInFlight)
+        {
+            break;
+        }
+        Entry& entry = entries_[id];
+        if (!entry.loading && entry.targetMip < entry.residentMip)
+        {
+            entry.loading = true;
+            ++stats_.loadsInFlight;
+            uploader.load(id, entry.targetMip);
+        }
+    }
+
+    // ここから後の request は次のフレームの分
+    ++frame_;
+}
+
+
+// -----------------------------------------------------------------------------
+// 予算の範囲で置くミップを決める
+//     粗いミップは常に置いておき、残りの予算を最近使われた順、同じなら画面で大きい順に割り当てる
+// -----------------------------------------------------------------------------
+void TextureResidency::assignTargets()
+{
+    std::sort(order_.begin(), order_.end(), [this](uint32_t a, uint32_t b)
+        {
+            const Entry& ea = entries_[a];
+            const Entry& eb = entries_[b];
+            if (ea.lastUsedFrame != eb.lastUsedFrame)
+            {
+                return ea.lastUsedFrame > eb.lastUsedFrame;
+            }
+            return ea.screenPixels > eb.screenPixels;
+        });
+
+    size_t tailBytes = 0;
+    for (uint32_t id : order_)
+    {
+        tailBytes += entries_[id].sizeFrom[entries_[id].tailMip];
+    }
+    size_t remaining = settings_.budgetBytes > tailBytes ? settings_.budgetBytes - tailBytes : 0;
+
+    for (uint32_t id : order_)
+    {
+        Entry& entry = entries_[id];
+        uint32_t mip = entry.tailMip;
+        if (frame_ - entry.lastUsedFrame <= settings_.keepFrames)
+        {
+            const uint32_t mipCount = uint32_t(entry.sizeFrom.size() - 1);
+            mip = (std::min)(entry.tailMip, ChooseMip(entry.width, entry.height, mipCount, entry.screenPixels, settings_.mipBias));
+        }
+
+        // 入らなければ入るところまで粗くする
+        const size_t tailSize = entry.sizeFrom[entry.tailMip];
+        while (mip < entry.tailMip && entry.sizeFrom[mip] - tailSize > remaining)
+        {
+            ++mip;
+        }
+        remaining -= entry.sizeFrom[mip] - tailSize;
+        entry.targetMip = mip;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 読み込みの終わり
+//     終わるまでに登録が解除されたり、予算が減って要らなくなったりしたら false
+// -----------------------------------------------------------------------------
+bool TextureResidency::finishLoad(uint32_t id, uint32_t mip)
+{
+    Entry& entry = entries_[id];
+    entry.loading = false;
+    --stats_.loadsInFlight;
+    if (!entry.active)
+    {
+        free_.push_back(id);
+        return false;
+    }
+    return mip >= entry.targetMip && mip < entry.residentMip;
+}
+
+
+void TextureResidency::completeLoad(uint32_t id, uint32_t mip)
+{
+    Entry& entry = entries_[id];
+    setResident(entry, mip);
+    ++stats_.loads;
+    stats_.bytesLoaded += entry.sizeFrom[mip];
+}
+
+
+// -----------------------------------------------------------------------------
+// 置いているバイト数を書き換える
+// -----------------------------------------------------------------------------
+void TextureResidency::setResident(Entry& entry, uint32_t mip)
+{
+    stats_.residentBytes -= entry.sizeFrom[entry.residentMip];
+    stats_.residentBytes += entry.sizeFrom[mip];
+    entry.residentMip = mip;
+}
+
+
+TextureResidency::Stats TextureResidency::getStats() const
+{
+    Stats stats = stats_;
+    stats.textureCount = order_.size();
+    return stats;
+}
+
+}
@@ -0,0 +1,268 @@
+﻿#include "pch.h"
+#include <UniDx/TextureStreamer.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <UniDx/Texture.h>
+#include <UniDx/MappedFile.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/AssetLoader.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+// マップしたメモリのページを先に読み込んでおく。GPU のリソースを作るメインスレッドで待たないように
+void TouchPages(const uint8_t* data, size_t size)
+{
+    constexpr size_t PageSize = 4096;
+    volatile uint8_t sink = 0;
+    for (size_t i = 0; i < size; i += PageSize)
+    {
+        sink = sink + data[i];
+    }
+    if (size > 0)
+    {
+        sink = sink + data[size - 1];
+    }
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 登録。粗いミップだけを作る
+// -----------------------------------------------------------------------------
+bool TextureStreamer::registerTexture(Texture* texture, std::shared_ptr<MappedFile> file, const TextureCache::Layout& layout)
+{
+    if (texture->streamIndex_ >= 0)
+    {
+        return true;
+    }
+
+    std::vector<size_t> mipBytes(layout.mipCount);
+    for (uint32_t mip = 0; mip < layout.mipCount; ++mip)
+    {
+        mipBytes[mip] = layout.getMipSize(mip);
+    }
+    const uint32_t id = residency_.add(layout.width, layout.height, std::move(mipBytes));
+
+    auto stream = std::make_shared<Stream>();
+    stream->texture = texture;
+    stream->file = std::move(file);
+    stream->layout = layout;
+    if (!createFromFile(*stream, residency_.getTailMip(id)))
+    {
+        residency_.remove(id);
+        return false;
+    }
+
+    if (streams_.size() <= id)
+    {
+        streams_.resize(id + 1);
+    }
+    streams_[id] = std::move(stream);
+    texture->streamIndex_ = int32_t(id);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 登録解除。読み込み中のものは終わったときに捨てる
+// -----------------------------------------------------------------------------
+void TextureStreamer::unregisterTexture(Texture* texture)
+{
+    const int32_t index = texture->streamIndex_;
+    if (index < 0)
+    {
+        return;
+    }
+
+    residency_.remove(uint32_t(index));
+    Stream& stream = *streams_[index];
+    stream.resource = nullptr;
+    stream.texture = nullptr;
+    streams_[index] = nullptr;
+    texture->streamIndex_ = -1;
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画で使う
+// -----------------------------------------------------------------------------
+void TextureStreamer::requestTexture(Texture* texture, float screenPixels)
+{
+    if (texture->streamIndex_ >= 0)
+    {
+        residency_.request(uint32_t(texture->streamIndex_), screenPixels);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 毎フレームの更新。粗くするものは evict、細かくするものは load が呼ばれる
+// -----------------------------------------------------------------------------
+void TextureStreamer::update()
+{
+    residency_.update(*this);
+}
+
+
+// -----------------------------------------------------------------------------
+// 予算からはみ出したものを、その場で粗くする
+// -----------------------------------------------------------------------------
+bool TextureStreamer::evict(uint32_t id, uint32_t mip)
+{
+    return shrink(*streams_[id], residency_.getResidentMip(id), mip);
+}
+
+
+// -----------------------------------------------------------------------------
+// マップしたファイルから作る。初期データはマップしたメモリをそのまま指す
+// -----------------------------------------------------------------------------
+bool TextureStreamer::createFromFile(Stream& stream, uint32_t mip)
+{
+    const TextureCache::Layout& layout = stream.layout;
+    const uint32_t levels = layout.mipCount - mip;
+
+    Texture2DDesc desc;
+    desc.width = layout.getMipWidth(mip);
+    desc.height = layout.getMipHeight(mip);
+    desc.mipLevels = levels;
+    desc.format = GpuFormat(layout.format);
+    desc.usage = GpuUsage::Immutable;
+    desc.bindFlags = GpuBindShaderResource;
+
+    std::vector<SubresourceData> data(levels);
+    for (uint32_t i = 0; i < levels; ++i)
+    {
+        data[i].data = stream.file->data() + layout.getMipOffset(mip + i);
+        data[i].rowPitch = layout.getRowPitch(mip + i);
+        data[i].byteSize = UINT(layout.getMipSize(mip + i));
+    }
+
+    ComPtr<ID3D11Texture2D> resource;
+    if (!getDevice().createTexture2D(desc, data.data(), resource.GetAddressOf()))
+    {
+        Debug::Log(L"ストリーミングするテクスチャを作れません");
+        return false;
+    }
+    return replace(stream, std::move(resource));
+}
+
+
+// -----------------------------------------------------------------------------
+// 今のリソースの粗い方のミップを GPU 上でコピーして作る
+// -----------------------------------------------------------------------------
+bool TextureStreamer::shrink(Stream& stream, uint32_t residentMip, uint32_t mip)
+{
+    const TextureCache::Layout& layout = stream.layout;
+    const uint32_t levels = layout.mipCount - mip;
+
+    Texture2DDesc desc;
+    desc.width = layout.getMipWidth(mip);
+    desc.height = layout.getMipHeight(mip);
+    desc.mipLevels = levels;
+    desc.format = GpuFormat(layout.format);
+    desc.usage = GpuUsage::Default;
+    desc.bindFlags = GpuBindShaderResource;
+
+    RenderDevice& device = getDevice();
+    ComPtr<ID3D11Texture2D> resource;
+    if (!device.createTexture2D(desc, nullptr, resource.GetAddressOf()))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < levels; ++i)
+    {
+        device.copySubresource(resource.Get(), i, stream.resource.Get(), mip + i - residentMip, UINT(layout.getMipSize(mip + i)));
+    }
+    return replace(stream, std::move(resource));
+}
+
+
+// -----------------------------------------------------------------------------
+// SRV を作って入れ替える
+// -----------------------------------------------------------------------------
+bool TextureStreamer::replace(Stream& stream, ComPtr<ID3D11Texture2D> resource)
+{
+    ShaderResourceViewDesc desc;
+    desc.format = GpuFormat(stream.layout.format);
+    desc.dimension = ShaderResourceViewDesc::Dimension::Texture2D;
+    desc.first = 0;
+    desc.count = UINT(-1);
+
+    ComPtr<ID3D11ShaderResourceView> srv;
+    if (!getDevice().createShaderResourceView(resource.Get(), desc, srv.GetAddressOf()))
+    {
+        return false;
+    }
+
+    stream.resource = std::move(resource);
+    stream.texture->m_srv = std::move(srv);
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 細かいミップの読み込みを始める
+//     ワーカーでマップしたページを読み込み、メインスレッドでリソースを作る
+//     終わるまでに登録が解除されたり、予算が減って要らなくなったりしたら何もしない
+// -----------------------------------------------------------------------------
+void TextureStreamer::load(uint32_t id, uint32_t mip)
+{
+    std::shared_ptr<Stream> stream = streams_[id];
+    const uint32_t residentMip = residency_.getResidentMip(id);
+
+    auto finish = [this, stream, id, mip]() -> size_t
+        {
+            if (!residency_.finishLoad(id, mip) || !createFromFile(*stream, mip))
+            {
+                return 0;
+            }
+            residency_.completeLoad(id, mip);
+            return stream->layout.getSizeFrom(mip);
+        };
+
+    AssetLoader* loader = AssetLoader::getInstance();
+    if (loader == nullptr)
+    {
+        finish();
+        return;
+    }
+
+    loader->enqueue([loader, stream, mip, residentMip, finish]()
+        {
+            const TextureCache::Layout& layout = stream->layout;
+            const size_t offset = layout.getMipOffset(mip);
+            TouchPages(stream->file->data() + offset, layout.getMipOffset(residentMip) - offset);
+            loader->enqueueMainThread(finish);
+        });
+}
+
+
+// -----------------------------------------------------------------------------
+// 状態
+// -----------------------------------------------------------------------------
+int32_t TextureStreamer::getResidentMip(const Texture* texture) const
+{
+    return texture->streamIndex_ >= 0 ? int32_t(residency_.getResidentMip(uint32_t(texture->streamIndex_))) : -1;
+}
+
+
+int32_t TextureStreamer::getTargetMip(const Texture* texture) const
+{
+    return texture->streamIndex_ >= 0 ? int32_t(residency_.getTargetMip(uint32_t(texture->streamIndex_))) : -1;
+}
+
+
+RenderDevice& TextureStreamer::getDevice() const
+{
+    return device_ != nullptr ? *device_ : D3DManager::getInstance()->GetRenderDevice();
+}
+
+}
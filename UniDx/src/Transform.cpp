@@ -1,4 +1,6 @@
 ﻿#include "pch.h"
+#include <UniDx/SceneManager.h>
+#include <UniDx/TransformHierarchy.h>
 
 
 namespace UniDx
@@ -10,32 +12,47 @@ Transform::~Transform()
     {
         if (child) child->transform->parent = nullptr;
     }
+    markStructureChanged();
+}
+
+
+// 親子関係の変更を TransformHierarchy に伝える
+void Transform::markStructureChanged()
+{
+    if (TransformHierarchy* hierarchy = TransformHierarchy::getInstance())
+    {
+        hierarchy->markStructureChanged();
+    }
 }
 
 
 // 親の変更
 GameObject* Transform::SetParent(Transform * newParent)
 {
-    // 親のTransformから自分を外す
-    if (parent == nullptr)
+    if (newParent == parent)
+    {
+        return gameObject;
+    }
+
+    // 自分の子孫を親にはできない
+    for (const Transform* t = newParent; t != nullptr; t = t->parent)
+    {
+        if (t == this)
+        {
+            Debug::Log(L"Transform::SetParent 子孫を親にすることはできません");
+            return gameObject;
+        }
+    }
+
+    // 親のTransform（ルートならシーン）から所有権ごと取り出す
+    unique_ptr<GameObject> gameObjectPtr = releaseFromParent();
+    if (gameObjectPtr == nullptr)
     {
         // 新規Transformに親を設定する場合はsmart_ptrを渡すstatic版を使ってください
         abort();
         return nullptr;
     }
-    auto& siblings = parent->children;
-
-    // 以前の親からGameObjectのスマートポインタを所有権ごと移動
-    auto it = std::find_if(
-        siblings.begin(), siblings.end(),
-        [this](const unique_ptr<GameObject>& ptr) { return ptr->transform == this; });
-    assert(it != siblings.end());
-
-    GameObject* gameObject_ptr = it->get();
-    assert(gameObject_ptr != nullptr);
-
-    // 元の親から削除
-    siblings.erase(it);
+    GameObject* gameObject_ptr = gameObjectPtr.get();
 
     // 新しい親を設定
     parent = newParent;
@@ -43,14 +60,56 @@ GameObject* Transform::SetParent(Transform * newParent)
     if (parent)
     {
         // 新しい親に自分を持つGameObjectを追加
-        parent->children.push_back(std::move(*it));
+        parent->children.push_back(std::move(gameObjectPtr));
     }
-    m_dirty = true;
+    else
+    {
+        // 親がなければシーンのルートに移す
+        SceneManager::getInstance()->GetActiveScene()->AddRootGameObject(std::move(gameObjectPtr));
+    }
+    markWorldDirty();
+    markStructureChanged();
+
+    // 親のアクティブ状態を反映
+    gameObject_ptr->updateActiveInHierarchy();
 
     return gameObject_ptr;
 }
 
 
+// 親のTransform（ルートならシーン）から自分のGameObjectを所有権ごと取り出す
+unique_ptr<GameObject> Transform::releaseFromParent()
+{
+    unique_ptr<GameObject> gameObjectPtr;
+    if (parent == nullptr)
+    {
+        gameObjectPtr = SceneManager::getInstance()->GetActiveScene()->RemoveRootGameObject(gameObject);
+    }
+    else
+    {
+        auto& siblings = parent->children;
+
+        // 以前の親からGameObjectのスマートポインタを所有権ごと移動
+        auto it = std::find_if(
+            siblings.begin(), siblings.end(),
+            [this](const unique_ptr<GameObject>& ptr) { return ptr->transform == this; });
+        assert(it != siblings.end());
+
+        gameObjectPtr = std::move(*it);
+
+        // 元の親から削除
+        siblings.erase(it);
+    }
+
+    if (gameObjectPtr != nullptr)
+    {
+        parent = nullptr;
+        markStructureChanged();
+    }
+    return gameObjectPtr;
+}
+
+
 void Transform::SetParent(unique_ptr<GameObject> gameObjectPtr, Transform* newParent)
 {
     // 親のTransformから自分を外す
@@ -63,7 +122,12 @@ void Transform::SetParent(unique_ptr<GameObject> gameObjectPtr, Transform* newPa
 
     // 新しい親を設定
     gameObjectPtr->transform->parent = newParent;
-    gameObjectPtr->transform->m_dirty = true;
+    gameObjectPtr->transform->markWorldDirty();
+    markStructureChanged();
+
+    // 親のアクティブ状態を反映
+    gameObjectPtr->updateActiveInHierarchy();
+
     if (newParent)
     {
         // 新しい親に自分を持つGameObjectを追加
@@ -82,32 +146,74 @@ Transform* Transform::GetChild(size_t index) const
 }
 
 
+// 自分と子孫のワールド行列を再計算が必要にする
+void Transform::markWorldDirty()
+{
+    // すでに立っていれば子孫にも立っているので、そこで止める
+    if (m_dirty)
+    {
+        return;
+    }
+    m_dirty = true;
+    for (auto& child : children)
+    {
+        if (child) child->transform->markWorldDirty();
+    }
+}
+
+
 // 行列を更新
 void Transform::updateMatrices() const
 {
+    // 自分が確定していれば祖先もすべて確定しているので、キャッシュをそのまま使う
+    if (!m_dirty)
+    {
+        return;
+    }
+
+    // 再計算が必要なのは、確定している祖先までの間だけ
     if (parent) {
         parent->updateMatrices();
     }
+    recomputeWorld();
+}
 
-    if (m_dirty)
-    {
-        m_localMatrix = Matrix::CreateScale(_localScale)
-            * Matrix::CreateFromQuaternion(_localRotation)
-            * Matrix::CreateTranslation(_localPosition);
-        if (parent) {
-            parent->updateMatrices();
-            m_worldMatrix = m_localMatrix * parent->m_worldMatrix;
-        }
-        else {
-            m_worldMatrix = m_localMatrix;
-        }
-        m_dirty = false;
 
-        // 親の行列が変わったので、子も変わるように
-        for (auto& c : children)
-        {
-            c->transform->m_dirty = true;
+// 親のワールド行列が確定している前提でワールド行列を再計算
+void Transform::recomputeWorld() const
+{
+    const Matrix& local = GetLocalMatrix();
+    m_worldMatrix = parent ? local * parent->m_worldMatrix : local;
+    updateWorldRotation();
+    m_worldPosition = m_worldMatrix.Translation();
+    m_dirty = false;
+    ++m_worldVersion;
+}
+
+
+// ワールド回転とスケールが一様かを更新する
+void Transform::updateWorldRotation() const
+{
+    // 一様で正のスケールは回転と入れ替えられるので、親までがそうなら回転を掛けるだけで済む
+    // 親までに一様でないか負のスケールがあると行列が歪むので、分解して近い回転を取り出す
+    const float sx = _localScale.x;
+    const bool uniform = sx > 0.0f &&
+        std::abs(_localScale.y - sx) <= sx * 1e-5f && std::abs(_localScale.z - sx) <= sx * 1e-5f;
+    if (parent == nullptr) {
+        m_worldRotation = _localRotation;
+        m_uniformScale = uniform;
+    }
+    else if (parent->m_uniformScale) {
+        m_worldRotation = _localRotation * parent->m_worldRotation;
+        m_uniformScale = uniform;
+    }
+    else {
+        Vector3 scale, translation;
+        Matrix world = m_worldMatrix;
+        if (!world.Decompose(scale, m_worldRotation, translation)) {
+            m_worldRotation = _localRotation * parent->m_worldRotation;
         }
+        m_uniformScale = false;
     }
 }
 
@@ -0,0 +1,233 @@
+﻿#include "pch.h"
+#include <UniDx/TransformBatch.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define UNIDX_TRANSFORM_BATCH_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define UNIDX_TARGET_AVX2
+#else
+#define UNIDX_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+// ローカル行列に親のワールド行列を掛ける（ローカル行列の第4列は 0,0,0,1）
+inline void multiplyParent(const float* l, const float* p, float* out)
+{
+    for (int r = 0; r < 3; ++r)
+    {
+        const float a = l[r * 4 + 0], b = l[r * 4 + 1], c = l[r * 4 + 2];
+        for (int k = 0; k < 4; ++k)
+        {
+            out[r * 4 + k] = a * p[k] + b * p[4 + k] + c * p[8 + k];
+        }
+    }
+    const float tx = l[12], ty = l[13], tz = l[14];
+    for (int k = 0; k < 4; ++k)
+    {
+        out[12 + k] = tx * p[k] + ty * p[4 + k] + tz * p[8 + k] + p[12 + k];
+    }
+}
+
+
+void composeScalar(const TransformBatchInput& in, size_t begin, size_t end, float* localOut, float* worldOut)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        const float p[3] = { in.px[i], in.py[i], in.pz[i] };
+        const float q[4] = { in.qx[i], in.qy[i], in.qz[i], in.qw[i] };
+        const float s[3] = { in.sx[i], in.sy[i], in.sz[i] };
+        float* local = localOut + i * 16;
+        float* world = worldOut + i * 16;
+
+        ComposeTRS(p, q, s, local);
+        if (in.parentWorld[i] != nullptr)
+        {
+            multiplyParent(local, in.parentWorld[i], world);
+        }
+        else
+        {
+            std::copy(local, local + 16, world);
+        }
+    }
+}
+
+
+#if defined(UNIDX_TRANSFORM_BATCH_AVX2)
+
+// 8個分の回転・スケールをSoAのまま計算し、行ごとに親行列を掛ける
+UNIDX_TARGET_AVX2
+void composeAvx2(const TransformBatchInput& in, size_t count, float* localOut, float* worldOut)
+{
+    alignas(32) float rs[9][8];
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 qx = _mm256_loadu_ps(in.qx + i);
+        const __m256 qy = _mm256_loadu_ps(in.qy + i);
+        const __m256 qz = _mm256_loadu_ps(in.qz + i);
+        const __m256 qw = _mm256_loadu_ps(in.qw + i);
+        const __m256 sx = _mm256_loadu_ps(in.sx + i);
+        const __m256 sy = _mm256_loadu_ps(in.sy + i);
+        const __m256 sz = _mm256_loadu_ps(in.sz + i);
+
+        const __m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+        const __m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+        const __m256 xw = _mm256_mul_ps(qx, qw), yw = _mm256_mul_ps(qy, qw), zw = _mm256_mul_ps(qz, qw);
+
+        const __m256 tsx = _mm256_mul_ps(two, sx);
+        const __m256 tsy = _mm256_mul_ps(two, sy);
+        const __m256 tsz = _mm256_mul_ps(two, sz);
+
+        _mm256_store_ps(rs[0], _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx));
+        _mm256_store_ps(rs[1], _mm256_mul_ps(_mm256_add_ps(xy, zw), tsx));
+        _mm256_store_ps(rs[2], _mm256_mul_ps(_mm256_sub_ps(xz, yw), tsx));
+        _mm256_store_ps(rs[3], _mm256_mul_ps(_mm256_sub_ps(xy, zw), tsy));
+        _mm256_store_ps(rs[4], _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy));
+        _mm256_store_ps(rs[5], _mm256_mul_ps(_mm256_add_ps(yz, xw), tsy));
+        _mm256_store_ps(rs[6], _mm256_mul_ps(_mm256_add_ps(xz, yw), tsz));
+        _mm256_store_ps(rs[7], _mm256_mul_ps(_mm256_sub_ps(yz, xw), tsz));
+        _mm256_store_ps(rs[8], _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz));
+
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            const size_t n = i + lane;
+            const float tx = in.px[n], ty = in.py[n], tz = in.pz[n];
+
+            // 2行ずつ [行0|行1] [行2|行3] の形で扱う
+            const __m256 a01 = _mm256_setr_ps(rs[0][lane], rs[0][lane], rs[0][lane], rs[0][lane], rs[3][lane], rs[3][lane], rs[3][lane], rs[3][lane]);
+            const __m256 b01 = _mm256_setr_ps(rs[1][lane], rs[1][lane], rs[1][lane], rs[1][lane], rs[4][lane], rs[4][lane], rs[4][lane], rs[4][lane]);
+            const __m256 c01 = _mm256_setr_ps(rs[2][lane], rs[2][lane], rs[2][lane], rs[2][lane], rs[5][lane], rs[5][lane], rs[5][lane], rs[5][lane]);
+            const __m256 a23 = _mm256_setr_ps(rs[6][lane], rs[6][lane], rs[6][lane], rs[6][lane], tx, tx, tx, tx);
+            const __m256 b23 = _mm256_setr_ps(rs[7][lane], rs[7][lane], rs[7][lane], rs[7][lane], ty, ty, ty, ty);
+            const __m256 c23 = _mm256_setr_ps(rs[8][lane], rs[8][lane], rs[8][lane], rs[8][lane], tz, tz, tz, tz);
+
+            float* local = localOut + n * 16;
+            float* world = worldOut + n * 16;
+
+            const __m256 l01 = _mm256_setr_ps(rs[0][lane], rs[1][lane], rs[2][lane], 0.0f, rs[3][lane], rs[4][lane], rs[5][lane], 0.0f);
+            const __m256 l23 = _mm256_setr_ps(rs[6][lane], rs[7][lane], rs[8][lane], 0.0f, tx, ty, tz, 1.0f);
+            _mm256_storeu_ps(local, l01);
+            _mm256_storeu_ps(local + 8, l23);
+
+            const float* parent = in.parentWorld[n];
+            if (parent == nullptr)
+            {
+                _mm256_storeu_ps(world, l01);
+                _mm256_storeu_ps(world + 8, l23);
+                continue;
+            }
+
+            const __m256 p01 = _mm256_loadu_ps(parent);
+            const __m256 p23 = _mm256_loadu_ps(parent + 8);
+            const __m256 p0 = _mm256_permute2f128_ps(p01, p01, 0x00);
+            const __m256 p1 = _mm256_permute2f128_ps(p01, p01, 0x11);
+            const __m256 p2 = _mm256_permute2f128_ps(p23, p23, 0x00);
+            const __m256 p3 = _mm256_permute2f128_ps(p23, p23, 0x11);
+
+            __m256 w01 = _mm256_mul_ps(a01, p0);
+            w01 = _mm256_fmadd_ps(b01, p1, w01);
+            w01 = _mm256_fmadd_ps(c01, p2, w01);
+
+            // 行3だけ平行移動の行を足す
+            __m256 w23 = _mm256_blend_ps(zero, p3, 0xF0);
+            w23 = _mm256_fmadd_ps(a23, p0, w23);
+            w23 = _mm256_fmadd_ps(b23, p1, w23);
+            w23 = _mm256_fmadd_ps(c23, p2, w23);
+
+            _mm256_storeu_ps(world, w01);
+            _mm256_storeu_ps(world + 8, w23);
+        }
+    }
+
+    // 端数はスカラーで
+    composeScalar(in, i, count, localOut, worldOut);
+}
+
+
+bool detectAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!(fma && osxsave && avx))
+    {
+        return false;
+    }
+    // OS が YMM レジスタを保存するか
+    if ((_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif
+
+}
+
+
+// -----------------------------------------------------------------------------
+// AVX2/FMA 版が使われるかどうか
+// -----------------------------------------------------------------------------
+bool IsTransformBatchAvx2Enabled()
+{
+#if defined(UNIDX_TRANSFORM_BATCH_AVX2)
+    static const bool enabled = detectAvx2();
+    return enabled;
+#else
+    return false;
+#endif
+}
+
+
+// -----------------------------------------------------------------------------
+// まとめてローカル行列とワールド行列を計算
+// -----------------------------------------------------------------------------
+void ComposeLocalToWorldBatch(const TransformBatchInput& in, size_t count, float* localOut, float* worldOut)
+{
+#if defined(UNIDX_TRANSFORM_BATCH_AVX2)
+    if (IsTransformBatchAvx2Enabled())
+    {
+        composeAvx2(in, count, localOut, worldOut);
+        return;
+    }
+#endif
+    composeScalar(in, 0, count, localOut, worldOut);
+}
+
+
+// -----------------------------------------------------------------------------
+// スカラー版
+// -----------------------------------------------------------------------------
+void ComposeLocalToWorldBatchScalar(const TransformBatchInput& in, size_t count, float* localOut, float* worldOut)
+{
+    composeScalar(in, 0, count, localOut, worldOut);
+}
+
+}
@@ -0,0 +1,232 @@
+﻿#include "pch.h"
+#include <UniDx/TransformHierarchy.h>
+
+#include <UniDx/Scene.h>
+#include <UniDx/JobSystem.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// シーン全体のワールド行列を更新
+// -----------------------------------------------------------------------------
+void TransformHierarchy::update(Scene* scene)
+{
+    if (scene == nullptr)
+    {
+        return;
+    }
+
+    // 親子関係が変わっていれば並び順を作り直す
+    if (scene != builtScene_ || structureChanged_)
+    {
+        rebuild(scene);
+    }
+
+    // 分割した部分木の祖先を先に確定させる
+    updateGroup(groups_[0]);
+
+    // 残りは独立した部分木なので並列に計算できる
+    if (groups_.size() > 1)
+    {
+        JobSystem::getInstance()->parallelFor(groups_.size() - 1, [this](size_t i)
+            {
+                updateGroup(groups_[i + 1]);
+            });
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// グループ内を深さ順にまとめて計算
+// -----------------------------------------------------------------------------
+void TransformHierarchy::updateGroup(Group& group)
+{
+    // 深さごとに更新が必要なものを集めてまとめて計算する
+    // 親は前の深さか、先に計算したグループで確定している
+    // 親が再計算されるときは子にも m_dirty が立っている
+    for (size_t level = 0; level + 1 < group.levelStart.size(); ++level)
+    {
+        group.batchNodes.clear();
+        for (size_t i = group.levelStart[level]; i < group.levelStart[level + 1]; ++i)
+        {
+            const Transform* t = nodes_[i];
+            if (t->m_dirty)
+            {
+                group.batchNodes.push_back(t);
+            }
+        }
+        if (group.batchNodes.empty())
+        {
+            continue;
+        }
+
+        const size_t count = group.batchNodes.size();
+        group.batch.resize(count);
+        for (size_t n = 0; n < count; ++n)
+        {
+            const Transform* t = group.batchNodes[n];
+            group.batch.set(n, &t->_localPosition.x, &t->_localRotation.x, &t->_localScale.x,
+                t->parent ? reinterpret_cast<const float*>(&t->parent->m_worldMatrix) : nullptr);
+        }
+        group.batch.compose(count);
+
+        // 結果を書き戻す
+        for (size_t n = 0; n < count; ++n)
+        {
+            const Transform* t = group.batchNodes[n];
+            t->m_localMatrix = *reinterpret_cast<const Matrix*>(&group.batch.local[n * 16]);
+            t->m_worldMatrix = *reinterpret_cast<const Matrix*>(&group.batch.world[n * 16]);
+            t->m_localDirty = false;
+            t->updateWorldRotation();
+            t->m_worldPosition = t->m_worldMatrix.Translation();
+            t->m_dirty = false;
+            ++t->m_worldVersion;
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 親子関係から並び順を作り直す
+// -----------------------------------------------------------------------------
+void TransformHierarchy::rebuild(Scene* scene)
+{
+    // まず幅優先順に並べる。子は親の処理中にまとめて追加されるので連続する
+    std::vector<Transform*> order;
+    std::vector<int32_t>    parent;
+    std::vector<uint32_t>   depth;
+    std::vector<uint32_t>   firstChild;
+    for (auto& go : scene->GetRootGameObjects())
+    {
+        order.push_back(go->transform);
+        parent.push_back(-1);
+        depth.push_back(0);
+    }
+    firstChild.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        firstChild[i] = uint32_t(order.size());
+        for (auto& child : order[i]->children)
+        {
+            order.push_back(child->transform);
+            parent.push_back(int32_t(i));
+            depth.push_back(depth[i] + 1);
+            firstChild.push_back(0);
+        }
+    }
+    const size_t total = order.size();
+
+    // 部分木のノード数（並列に振り分けるときのコスト）
+    std::vector<uint32_t> subtreeSize(total, 1);
+    for (size_t i = total; i-- > 0;)
+    {
+        if (parent[i] >= 0)
+        {
+            subtreeSize[parent[i]] += subtreeSize[i];
+        }
+    }
+    auto childEnd = [&](size_t i) { return firstChild[i] + (uint32_t)order[i]->children.size(); };
+
+    nodes_.clear();
+
+    // 並び順 list を深さの切れ目付きでグループに追加する
+    auto appendGroup = [&](Group& group, const std::vector<uint32_t>& list, const std::vector<uint32_t>& levelOf)
+        {
+            group.levelStart.clear();
+            for (size_t k = 0; k < list.size(); ++k)
+            {
+                if (k == 0 || levelOf[k] != levelOf[k - 1])
+                {
+                    group.levelStart.push_back(nodes_.size());
+                }
+                const uint32_t i = list[k];
+                nodes_.push_back(order[i]);
+            }
+            group.levelStart.push_back(nodes_.size());
+        };
+
+    const size_t threads = JobSystem::getInstance() ? JobSystem::getInstance()->getThreadCount() : 1;
+    if (!parallel_ || threads <= 1 || total < ParallelMinNodes)
+    {
+        // 全体を1つのグループで計算する
+        std::vector<uint32_t> list(total);
+        for (size_t i = 0; i < total; ++i)
+        {
+            list[i] = uint32_t(i);
+        }
+        groups_.resize(1);
+        appendGroup(groups_[0], list, depth);
+    }
+    else
+    {
+        // 1つの仕事の目安。これより大きい部分木は子に分ける
+        // 巨大なモデル1つが全体の待ち時間にならないよう、スレッド数より細かく切る
+        const size_t target = std::max<size_t>(64, total / (threads * 4));
+
+        std::vector<uint32_t> serial, serialDepth;
+        std::vector<uint32_t> units;
+        std::vector<uint32_t> queue;
+        for (size_t i = 0; i < total && parent[i] < 0; ++i)
+        {
+            queue.push_back(uint32_t(i));
+        }
+        for (size_t q = 0; q < queue.size(); ++q)
+        {
+            const uint32_t i = queue[q];
+            if (subtreeSize[i] > target)
+            {
+                // 自分は先に計算し、子をそれぞれ独立した仕事にする
+                serial.push_back(i);
+                serialDepth.push_back(depth[i]);
+                for (uint32_t c = firstChild[i]; c < childEnd(i); ++c)
+                {
+                    queue.push_back(c);
+                }
+            }
+            else
+            {
+                units.push_back(i);
+            }
+        }
+
+        // 大きい順に、いちばん空いているグループへ入れる
+        std::sort(units.begin(), units.end(), [&](uint32_t a, uint32_t b) { return subtreeSize[a] > subtreeSize[b]; });
+        const size_t bucketCount = std::min(threads, units.size());
+        std::vector<std::vector<uint32_t>> buckets(bucketCount);
+        std::vector<size_t> load(bucketCount, 0);
+        for (uint32_t u : units)
+        {
+            const size_t b = std::min_element(load.begin(), load.end()) - load.begin();
+            buckets[b].push_back(u);
+            load[b] += subtreeSize[u];
+        }
+
+        groups_.resize(1 + bucketCount);
+        appendGroup(groups_[0], serial, serialDepth);
+
+        // グループごとに、部分木の根からの深さ順に並べる
+        std::vector<uint32_t> list, relDepth;
+        for (size_t b = 0; b < bucketCount; ++b)
+        {
+            list = buckets[b];
+            relDepth.assign(list.size(), 0);
+            for (size_t k = 0; k < list.size(); ++k)
+            {
+                const uint32_t i = list[k];
+                for (uint32_t c = firstChild[i]; c < childEnd(i); ++c)
+                {
+                    list.push_back(c);
+                    relDepth.push_back(relDepth[k] + 1);
+                }
+            }
+            appendGroup(groups_[1 + b], list, relDepth);
+        }
+    }
+
+    builtScene_ = scene;
+    structureChanged_ = false;
+}
+
+}
@@ -0,0 +1,314 @@
+﻿#include "pch.h"
+#include <UniDx/VertexPacking.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+
+// 1つ分を dst + i * stride に書く
+template<typename T>
+inline void StoreAt(void* dst, size_t stride, size_t i, T value)
+{
+    std::memcpy(static_cast<uint8_t*>(dst) + i * stride, &value, sizeof(T));
+}
+
+
+// float ×4 を半精度 ×4 にする。PackHalf と同じ手順を整数演算で行う
+inline __m128i FloatToHalf4(__m128 value)
+{
+    const __m128i bits = _mm_castps_si128(value);
+    const __m128i sign = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000));
+    const __m128i absBits = _mm_and_si128(bits, _mm_set1_epi32(0x7fffffff));
+
+    // 正規化数：指数を付け替えて最近接偶数に丸める
+    const __m128i lsb = _mm_and_si128(_mm_srli_epi32(absBits, 13), _mm_set1_epi32(1));
+    const __m128i rounded = _mm_add_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(int(0xc8000fff))), lsb);
+    __m128i result = _mm_srli_epi32(rounded, 13);
+
+    // 非正規化数：2^24 倍して整数に丸める（MXCSR の既定は最近接偶数）
+    const __m128i denormal = _mm_cvtps_epi32(_mm_mul_ps(_mm_castsi128_ps(absBits), _mm_set1_ps(16777216.0f)));
+    const __m128i isDenormal = _mm_cmplt_epi32(absBits, _mm_set1_epi32(0x38800000));
+    result = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, result));
+
+    // 範囲外は無限大、NaN は NaN
+    const __m128i isOverflow = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x477fefff));
+    result = _mm_or_si128(_mm_and_si128(isOverflow, _mm_set1_epi32(0x7c00)), _mm_andnot_si128(isOverflow, result));
+    const __m128i isNaN = _mm_cmpgt_epi32(absBits, _mm_set1_epi32(0x7f800000));
+    result = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x7e00)), _mm_andnot_si128(isNaN, result));
+
+    return _mm_or_si128(result, sign);
+}
+
+
+// 0～65535 の int ×4 を uint16 ×4 にして下位64ビットに並べる（SSE2 には符号なしの pack がない）
+inline __m128i PackUInt16(__m128i value)
+{
+    const __m128i biased = _mm_sub_epi32(value, _mm_set1_epi32(0x8000));
+    const __m128i packed = _mm_packs_epi32(biased, biased);
+    return _mm_xor_si128(packed, _mm_set1_epi16(short(0x8000)));
+}
+
+
+// 八面体に展開した x, y を -1～1 で求める（4つずつ）
+inline void OctahedralEncode4(__m128 x, __m128 y, __m128 z, __m128& outX, __m128& outY)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000)));
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask));
+    l1 = _mm_max_ps(l1, _mm_set1_ps(1e-20f));
+    const __m128 px = _mm_div_ps(x, l1);
+    const __m128 py = _mm_div_ps(y, l1);
+
+    // 下半分は対角線で折り返す
+    const __m128 signX = _mm_or_ps(_mm_and_ps(px, signMask), one);
+    const __m128 signY = _mm_or_ps(_mm_and_ps(py, signMask), one);
+    const __m128 foldX = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(py, absMask)), signX);
+    const __m128 foldY = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(px, absMask)), signY);
+    const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+    outX = _mm_or_ps(_mm_and_ps(lower, foldX), _mm_andnot_ps(lower, px));
+    outY = _mm_or_ps(_mm_and_ps(lower, foldY), _mm_andnot_ps(lower, py));
+}
+
+
+// -1～1 を snorm16 の整数にする（4つずつ）
+inline __m128i ToSNorm16(__m128 value)
+{
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    return _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(32767.0f)));
+}
+
+}
+
+
+// -----------------------------------------------------------------------------
+// 半精度 float
+// -----------------------------------------------------------------------------
+uint16_t PackHalf(float value)
+{
+    return uint16_t(_mm_cvtsi128_si32(FloatToHalf4(_mm_set_ss(value))));
+}
+
+
+float UnpackHalf(uint16_t value)
+{
+    const uint32_t sign = uint32_t(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    const uint32_t mantissa = value & 0x3ff;
+
+    float result;
+    if (exponent == 0)
+    {
+        // 非正規化数
+        result = std::ldexp(float(mantissa), -24);
+    }
+    else if (exponent == 31)
+    {
+        result = mantissa == 0 ? INFINITY : NAN;
+    }
+    else
+    {
+        const uint32_t bits = ((exponent + 112) << 23) | (mantissa << 13);
+        std::memcpy(&result, &bits, sizeof(result));
+    }
+    return sign ? -result : result;
+}
+
+
+void PackHalf4(const Vector3& value, uint16_t* dst)
+{
+    const __m128i half = PackUInt16(FloatToHalf4(_mm_set_ps(1.0f, value.z, value.y, value.x)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), half);
+}
+
+
+// -----------------------------------------------------------------------------
+// 八面体の法線
+// -----------------------------------------------------------------------------
+uint32_t PackOctahedralNormal(const Vector3& normal)
+{
+    __m128 x, y;
+    OctahedralEncode4(_mm_set_ss(normal.x), _mm_set_ss(normal.y), _mm_set_ss(normal.z), x, y);
+    const uint32_t ix = uint32_t(_mm_cvtsi128_si32(ToSNorm16(x))) & 0xffff;
+    const uint32_t iy = uint32_t(_mm_cvtsi128_si32(ToSNorm16(y))) & 0xffff;
+    return ix | (iy << 16);
+}
+
+
+Vector3 UnpackOctahedralNormal(uint32_t packed)
+{
+    // シェーダーの DecodeNormal と同じ
+    const float ex = std::max(float(int16_t(packed & 0xffff)) / 32767.0f, -1.0f);
+    const float ey = std::max(float(int16_t(packed >> 16)) / 32767.0f, -1.0f);
+    Vector3 n(ex, ey, 1.0f - std::abs(ex) - std::abs(ey));
+    if (n.z < 0.0f)
+    {
+        n.x = (1.0f - std::abs(ey)) * (ex >= 0.0f ? 1.0f : -1.0f);
+        n.y = (1.0f - std::abs(ex)) * (ey >= 0.0f ? 1.0f : -1.0f);
+    }
+    n.Normalize();
+    return n;
+}
+
+
+// -----------------------------------------------------------------------------
+// unorm16 ×2 / unorm8 ×4
+// -----------------------------------------------------------------------------
+uint32_t PackUNorm16x2(const Vector2& value)
+{
+    const __m128 v = _mm_min_ps(_mm_max_ps(_mm_set_ps(0, 0, value.y, value.x), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    const __m128i packed = PackUInt16(_mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(65535.0f))));
+    return uint32_t(_mm_cvtsi128_si32(packed));
+}
+
+
+Vector2 UnpackUNorm16x2(uint32_t packed)
+{
+    return Vector2(float(packed & 0xffff) / 65535.0f, float(packed >> 16) / 65535.0f);
+}
+
+
+uint32_t PackUNorm8x4(const Color& value)
+{
+    const __m128 v = _mm_min_ps(_mm_max_ps(_mm_set_ps(value.w, value.z, value.y, value.x), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    const __m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+    const __m128i packed16 = _mm_packs_epi32(i, i);
+    return uint32_t(_mm_cvtsi128_si32(_mm_packus_epi16(packed16, packed16)));
+}
+
+
+Color UnpackUNorm8x4(uint32_t packed)
+{
+    return Color(
+        float(packed & 0xff) / 255.0f, float((packed >> 8) & 0xff) / 255.0f,
+        float((packed >> 16) & 0xff) / 255.0f, float(packed >> 24) / 255.0f);
+}
+
+
+// -----------------------------------------------------------------------------
+// まとめて詰める
+// -----------------------------------------------------------------------------
+void PackHalf4Stream(std::span<const Vector3> src, void* dst, size_t stride)
+{
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        const Vector3& p = src[i];
+        const __m128i half = PackUInt16(FloatToHalf4(_mm_set_ps(1.0f, p.z, p.y, p.x)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(static_cast<uint8_t*>(dst) + i * stride), half);
+    }
+}
+
+
+void PackOctahedralNormalStream(std::span<const Vector3> src, void* dst, size_t stride)
+{
+    // 4つずつ SoA にして詰める
+    const size_t count4 = src.size() & ~size_t(3);
+    alignas(16) uint32_t packed[4];
+    for (size_t i = 0; i < count4; i += 4)
+    {
+        const Vector3* n = &src[i];
+        __m128 x, y;
+        OctahedralEncode4(
+            _mm_set_ps(n[3].x, n[2].x, n[1].x, n[0].x),
+            _mm_set_ps(n[3].y, n[2].y, n[1].y, n[0].y),
+            _mm_set_ps(n[3].z, n[2].z, n[1].z, n[0].z), x, y);
+        const __m128i ix = _mm_and_si128(ToSNorm16(x), _mm_set1_epi32(0xffff));
+        const __m128i iy = _mm_slli_epi32(ToSNorm16(y), 16);
+        _mm_store_si128(reinterpret_cast<__m128i*>(packed), _mm_or_si128(ix, iy));
+        for (size_t k = 0; k < 4; ++k)
+        {
+            StoreAt(dst, stride, i + k, packed[k]);
+        }
+    }
+    for (size_t i = count4; i < src.size(); ++i)
+    {
+        StoreAt(dst, stride, i, PackOctahedralNormal(src[i]));
+    }
+}
+
+
+void PackUNorm16x2Stream(std::span<const Vector2> src, void* dst, size_t stride)
+{
+    // 2つずつ詰める
+    const size_t count2 = src.size() & ~size_t(1);
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    alignas(16) uint32_t packed[4];
+    for (size_t i = 0; i < count2; i += 2)
+    {
+        const Vector2* v = &src[i];
+        __m128 uv = _mm_set_ps(v[1].y, v[1].x, v[0].y, v[0].x);
+        uv = _mm_min_ps(_mm_max_ps(uv, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        _mm_store_si128(reinterpret_cast<__m128i*>(packed), PackUInt16(_mm_cvtps_epi32(_mm_mul_ps(uv, scale))));
+        StoreAt(dst, stride, i, packed[0]);
+        StoreAt(dst, stride, i + 1, packed[1]);
+    }
+    if (count2 < src.size())
+    {
+        StoreAt(dst, stride, count2, PackUNorm16x2(src[count2]));
+    }
+}
+
+
+void PackUNorm8x4Stream(std::span<const Color> src, void* dst, size_t stride)
+{
+    // 4つずつ変換して、まとめて8ビットに詰める
+    const size_t count4 = src.size() & ~size_t(3);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    alignas(16) uint32_t packed[4];
+    for (size_t i = 0; i < count4; i += 4)
+    {
+        __m128i c[4];
+        for (size_t k = 0; k < 4; ++k)
+        {
+            const Color& color = src[i + k];
+            const __m128 v = _mm_min_ps(_mm_max_ps(_mm_set_ps(color.w, color.z, color.y, color.x), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            c[k] = _mm_cvtps_epi32(_mm_mul_ps(v, scale));
+        }
+        const __m128i lo = _mm_packs_epi32(c[0], c[1]);
+        const __m128i hi = _mm_packs_epi32(c[2], c[3]);
+        _mm_store_si128(reinterpret_cast<__m128i*>(packed), _mm_packus_epi16(lo, hi));
+        for (size_t k = 0; k < 4; ++k)
+        {
+            StoreAt(dst, stride, i + k, packed[k]);
+        }
+    }
+    for (size_t i = count4; i < src.size(); ++i)
+    {
+        StoreAt(dst, stride, i, PackUNorm8x4(src[i]));
+    }
+}
+
+
+
+// -----------------------------------------------------------------------------
+// キャッシュを通さない書き込み
+// -----------------------------------------------------------------------------
+void StreamStore(void* dst, const void* src, size_t bytes)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    if ((reinterpret_cast<uintptr_t>(d) & 15) != 0)
+    {
+        std::memcpy(d, s, bytes);
+        return;
+    }
+
+    const size_t bytes16 = bytes & ~size_t(15);
+    for (size_t i = 0; i < bytes16; i += 16)
+    {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(d + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+    }
+    std::memcpy(d + bytes16, s + bytes16, bytes - bytes16);
+    _mm_sfence();
+}
+
+}
@@ -3,17 +3,42 @@
 // ----------------------------------------------------------
 cbuffer VSConstants : register(b0)
 {
-    float4x4 world;
-    float4x4 view;
+    float4x4 world;     // 描画ごとに更新する
+    float4 lodFade;     // x: LOD のクロスフェード
+};
+cbuffer CameraConstants : register(b1)
+{
+    float4x4 view;      // カメラごとに更新する
     float4x4 projection;
 };
+#ifdef UNIDX_SKINNING
+cbuffer SkinConstants : register(b2)
+{
+    float4 bones[128 * 3];  // ジョイントの行列を転置した3行ずつ（Skeleton::computeSkinPalette）
+};
+#endif
 
 // 頂点シェーダーへ入力するデータ
 struct VSInput
 {
     float3 pos : POSITION;
+#ifdef UNIDX_NORMAL_OCT
+    float2 nrm : NORMAL;        // 八面体に詰めた法線
+#else
     float3 nrm : NORMAL;
+#endif
     float2 uv : TEXUV;
+#ifdef UNIDX_SKINNING
+    uint4 joints : BLENDINDICES;    // スキンのジョイントの番号
+    float4 weights : BLENDWEIGHT;   // それぞれの重み
+#endif
+#ifdef UNIDX_INSTANCING
+    // インスタンスごとのワールド行列（C++ の Matrix の各行）
+    float4 world0 : INSTANCE_WORLD0;
+    float4 world1 : INSTANCE_WORLD1;
+    float4 world2 : INSTANCE_WORLD2;
+    float4 world3 : INSTANCE_WORLD3;
+#endif
 };
 
 // 頂点シェーダーから出力するデータ
@@ -22,24 +47,67 @@ struct PSInput
     float4 pos : SV_Position;   // 頂点の座標(射影座標系)
     float3 nrm : NORMAL;        // 法線
     float2 uv : TEXCOORD0;      // UV座標
+    nointerpolation float lodFade : LODFADE;   // LOD のクロスフェード
 };
 
 
+// 八面体に詰めた法線を戻す（C++ の UnpackOctahedralNormal と同じ）
+float3 DecodeNormal(float2 e)
+{
+    float3 n = float3(e, 1 - abs(e.x) - abs(e.y));
+    if (n.z < 0)
+    {
+        n.xy = (1 - abs(e.yx)) * (e.xy >= 0 ? 1 : -1);
+    }
+    return normalize(n);
+}
+float3 DecodeNormal(float3 n)
+{
+    return n;
+}
+
+
 // 頂点シェーダー
 PSInput VS(VSInput vin)
 {
     PSInput Out;
+#ifdef UNIDX_INSTANCING
+    float4x4 worldMatrix = transpose(float4x4(vin.world0, vin.world1, vin.world2, vin.world3));
+#else
+    float4x4 worldMatrix = world;
+#endif
     float4 p = float4(vin.pos.xyz, 1);
-    p = mul(world, p);
+    float3 n = DecodeNormal(vin.nrm);
+#ifdef UNIDX_SKINNING
+    // 4つのジョイントの行列を重みで混ぜてから、位置と法線を動かす
+    float4 r0 = 0, r1 = 0, r2 = 0;
+    [unroll]
+    for (int k = 0; k < 4; ++k)
+    {
+        uint b = vin.joints[k] * 3;
+        r0 += bones[b + 0] * vin.weights[k];
+        r1 += bones[b + 1] * vin.weights[k];
+        r2 += bones[b + 2] * vin.weights[k];
+    }
+    p = float4(dot(r0, p), dot(r1, p), dot(r2, p), 1);
+    n = float3(dot(r0.xyz, n), dot(r1.xyz, n), dot(r2.xyz, n));
+#endif
+    p = mul(worldMatrix, p);
     p = mul(view, p);
     p = mul(projection, p);
     Out.pos = p;
 
-    float3x3 world3x3 = (float3x3) world;
-    Out.nrm = mul(world3x3, vin.nrm);
+    float3x3 world3x3 = (float3x3) worldMatrix;
+    Out.nrm = mul(world3x3, n);
 
     Out.uv = vin.uv;
 
+#ifdef UNIDX_INSTANCING
+    Out.lodFade = 0;    // クロスフェード中のものはインスタンス描画されない
+#else
+    Out.lodFade = lodFade.x;
+#endif
+
     return Out;
 }
 
@@ -102,9 +170,26 @@ float4 EvaluateLight(in GPULight L, in float3 posW, in float3 nrmW)
 }
 
 
+// LOD のクロスフェード。4x4 のディザの値で、fade が正なら閾値以上、負なら閾値未満の画素だけ残す
+// 出ていく LOD と入ってくる LOD で残る画素が重ならない
+void ClipLODFade(float fade, float2 pixel)
+{
+    if (fade == 0)
+    {
+        return;
+    }
+    static const float bayer[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+    uint2 p = uint2(pixel) & 3;
+    float dither = (bayer[p.y * 4 + p.x] + 0.5) / 16;
+    clip(fade > 0 ? dither - fade : -fade - dither);
+}
+
+
 // ピクセルシェーダー
 float4 PS(PSInput In) : SV_Target0
 {
+    ClipLODFade(In.lodFade, In.pos.xy);
+
     // テクスチャから色を取得
     float4 albedo = texture0.Sample(sampler0, In.uv);
 
@@ -3,8 +3,11 @@
 // ----------------------------------------------------------
 cbuffer VSConstants : register(b0)
 {
-    float4x4 world;
-    float4x4 view;
+    float4x4 world;     // 描画ごとに更新する
+};
+cbuffer CameraConstants : register(b1)
+{
+    float4x4 view;      // カメラごとに更新する
     float4x4 projection;
 };
 
@@ -13,6 +16,13 @@ struct VSInput
 {
     float3 pos : POSITION;
     float3 nrm : NORMAL;
+#ifdef UNIDX_INSTANCING
+    // インスタンスごとのワールド行列（C++ の Matrix の各行）
+    float4 world0 : INSTANCE_WORLD0;
+    float4 world1 : INSTANCE_WORLD1;
+    float4 world2 : INSTANCE_WORLD2;
+    float4 world3 : INSTANCE_WORLD3;
+#endif
 };
 
 // 頂点シェーダーから出力するデータ
@@ -27,14 +37,19 @@ struct PSInput
 PSInput VS(VSInput vin)
 {
     PSInput Out;
+#ifdef UNIDX_INSTANCING
+    float4x4 worldMatrix = transpose(float4x4(vin.world0, vin.world1, vin.world2, vin.world3));
+#else
+    float4x4 worldMatrix = world;
+#endif
 
     float4 p = float4(vin.pos.xyz, 1);
-    p = mul(world, p);
+    p = mul(worldMatrix, p);
     p = mul(view, p);
     p = mul(projection, p);
     Out.pos = p;
 
-    float3x3 world3x3 = (float3x3) world;
+    float3x3 world3x3 = (float3x3) worldMatrix;
     Out.nrm = mul(world3x3, vin.nrm);
     return Out;
 }
@@ -4,10 +4,13 @@
 cbuffer ParentConstants : register(b0)
 {
     float4x4 world;     // 親ノードのワールド変換行列
+};
+cbuffer CameraConstants : register(b1)
+{
     float4x4 view;
     float4x4 projection;
 };
-cbuffer LocalConstants : register(b1)
+cbuffer LocalConstants : register(b2)
 {
     float4x4 local;     // 子ノードのローカル変換行列
 }
@@ -3,8 +3,11 @@
 // ----------------------------------------------------------
 cbuffer VSConstants : register(b0)
 {
-    float4x4 world;
-    float4x4 view;
+    float4x4 world;     // 描画ごとに更新する
+};
+cbuffer CameraConstants : register(b1)
+{
+    float4x4 view;      // カメラごとに更新する
     float4x4 projection;
 };
 
@@ -0,0 +1,261 @@
+﻿#include "AnimationBenchmark.h"
+
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <UniDx.h>
+#include <UniDx/Engine.h>
+#include <UniDx/GltfModel.h>
+#include <UniDx/Animator.h>
+#include <UniDx/AnimatorManager.h>
+#include <UniDx/AnimationPose.h>
+#include <UniDx/CompressedCurveClip.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr const wchar_t* model_ = L"Resource/ModularCharacterPBR.glb";
+constexpr size_t counts_[] = { 1, 100, 500, 1000 };
+constexpr int frames_ = 120;
+constexpr float frameTime_ = 1.0f / 60.0f;
+
+double milliseconds(Clock::duration d)
+{
+    return chrono::duration<double, milli>(d).count();
+}
+
+
+// すべてのノードを初期姿勢からX軸まわりに揺らす 2 秒のクリップ
+shared_ptr<const AnimationClip> makeSwingClip(const Skeleton& skeleton)
+{
+    constexpr int keys = 17;
+    constexpr float length = 2.0f;
+
+    const AnimationPose& rest = skeleton.getRestPose();
+    vector<AnimationClip::Track> tracks(skeleton.size());
+    for (size_t i = 0; i < skeleton.size(); ++i)
+    {
+        AnimationClip::Track& track = tracks[i];
+        track.node = int32_t(i);
+        track.path = AnimationClip::Track::Path::Rotation;
+        for (int k = 0; k < keys; ++k)
+        {
+            const float t = length * float(k) / float(keys - 1);
+            const float angle = 0.4f * sinf(XM_2PI * t / length + float(i));
+            const Quaternion q = Quaternion::CreateFromAxisAngle(Vector3::UnitX, angle) * rest.getRotation(i);
+            track.times.push_back(t);
+            track.values.insert(track.values.end(), { q.x, q.y, q.z, q.w });
+        }
+    }
+
+    auto clip = make_shared<AnimationClip>();
+    if (!clip->build("Swing", skeleton, tracks))
+    {
+        return nullptr;
+    }
+    return clip;
+}
+
+
+// AnimatorManager::update の1回あたりの時間（ms）。frames_ 回の平均
+double measureUpdate()
+{
+    AnimatorManager* manager = AnimatorManager::getInstance();
+    manager->update(frameTime_);   // 1回目はワーカーの起動などが入るので除く
+
+    const Clock::time_point start = Clock::now();
+    for (int f = 0; f < frames_; ++f)
+    {
+        manager->update(frameTime_);
+    }
+    return milliseconds(Clock::now() - start) / frames_;
+}
+
+
+// ポーズの混ぜ合わせ1回あたりの時間（ns）
+template<typename F>
+double measureBlend(F blend, const AnimationPose& a, const AnimationPose& b, AnimationPose& out)
+{
+    constexpr int repeat = 100000;
+    const Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; ++r)
+    {
+        blend(a.data(), b.data(), float(r % 100) * 0.01f, a.getStride(), out.data());
+    }
+    return chrono::duration<double, nano>(Clock::now() - start).count() / repeat;
+}
+
+
+// 0.1 秒おきにキーのある 10 秒のカーブを count 本。8本に1本は動かない
+vector<AnimationCurve> makeCurves(size_t count)
+{
+    constexpr float length = 10.0f;
+    constexpr int keys = 101;
+
+    mt19937 rng(1);
+    uniform_real_distribution<float> random(0.0f, 1.0f);
+    vector<AnimationCurve> curves;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float amplitude = random(rng) * 2.0f;
+        const float frequency = 0.5f + random(rng) * 3.0f;
+        const float phase = random(rng) * XM_2PI;
+        const bool still = i % 8 == 7;
+        vector<Keyframe> keyframes;
+        for (int k = 0; k < keys; ++k)
+        {
+            const float t = length * float(k) / float(keys - 1);
+            const float value = still ? 1.0f : amplitude * sinf(frequency * t + phase);
+            const float tangent = still ? 0.0f : amplitude * frequency * cosf(frequency * t + phase);
+            keyframes.emplace_back(t, value, tangent, tangent);
+        }
+        curves.emplace_back(keyframes);
+    }
+    return curves;
+}
+
+
+// times の順に全トラックを評価したときの、1秒あたりの評価の数（百万）
+template<typename F>
+double measureSamples(F sampleAll, const vector<float>& times, size_t trackCount)
+{
+    constexpr int repeat = 100;
+    const Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; ++r)
+    {
+        for (float t : times)
+        {
+            sampleAll(t);
+        }
+    }
+    const double seconds = chrono::duration<double>(Clock::now() - start).count();
+    return double(repeat) * double(times.size()) * double(trackCount) / seconds / 1e6;
+}
+
+
+// 個別の AnimationCurve と CompressedCurveClip を比べる
+void runCurveBenchmark(ostream& out)
+{
+    constexpr size_t trackCount = 64;
+    const vector<AnimationCurve> curves = makeCurves(trackCount);
+
+    size_t curveMemory = 0;
+    for (const AnimationCurve& curve : curves)
+    {
+        curveMemory += sizeof(AnimationCurve) + curve.GetKeys().size() * sizeof(Keyframe);
+    }
+
+    CompressedCurveClip clip;
+    const Clock::time_point buildStart = Clock::now();
+    if (!clip.build(curves))
+    {
+        out << "failed to build curve clip\n";
+        return;
+    }
+    const double buildTime = milliseconds(Clock::now() - buildStart);
+    float maxError = 0.0f;
+    for (size_t i = 0; i < trackCount; ++i)
+    {
+        maxError = max(maxError, clip.getMaxError(i));
+    }
+    out << "curves " << trackCount << " tracks: AnimationCurve " << curveMemory << " bytes, compressed " << clip.getMemorySize()
+        << " bytes, " << clip.getKeyCount() << " keys, build " << buildTime << " ms, max error " << maxError << "\n";
+
+    // 60fps の再生と、ばらばらの時刻
+    vector<float> sequential;
+    for (int f = 0; f <= 600; ++f)
+    {
+        sequential.push_back(float(f) * frameTime_);
+    }
+    vector<float> shuffled = sequential;
+    shuffle(shuffled.begin(), shuffled.end(), mt19937(2));
+
+    vector<float> values(trackCount);
+    auto sampleCurves = [&](float t)
+        {
+            for (size_t i = 0; i < trackCount; ++i)
+            {
+                values[i] = curves[i].Evaluate(t);
+            }
+        };
+    CompressedCurveSampler sampler(clip);
+    auto sampleClip = [&](float t) { sampler.sample(t, values); };
+
+    out << "curve samples (M/s), AnimationCurve, compressed\n";
+    out << "sequential, " << measureSamples(sampleCurves, sequential, trackCount) << ", " << measureSamples(sampleClip, sequential, trackCount) << "\n";
+    out << "random, " << measureSamples(sampleCurves, shuffled, trackCount) << ", " << measureSamples(sampleClip, shuffled, trackCount) << "\n";
+}
+
+}
+
+
+void RunAnimationBenchmark(const wstring& resultPath)
+{
+    Engine::create();
+    Engine::getInstance()->Initialize(nullptr);
+
+    ofstream out{ filesystem::path(resultPath) };
+
+    auto modelObj = make_unique<GameObject>(L"model", make_unique<GltfModel>());
+    GltfModel* model = modelObj->GetComponent<GltfModel>(true);
+    model->Load<VertexPNT>(model_);
+    const shared_ptr<const Skeleton> skeleton = model->getSkeleton();
+    if (skeleton == nullptr)
+    {
+        out << ToUtf8(model_) << " has no skin\n";
+        return;
+    }
+    const shared_ptr<const AnimationClip> clip = makeSwingClip(*skeleton);
+    if (clip == nullptr)
+    {
+        out << "failed to build clip\n";
+        return;
+    }
+    out << ToUtf8(model_) << ": " << skeleton->size() << " nodes, " << skeleton->skins.size() << " skins, clip "
+        << clip->getFrameCount() << " frames " << clip->getMemorySize() << " bytes\n";
+    out << "animators, parallel ms, serial ms, speedup\n";
+
+    AnimatorManager* manager = AnimatorManager::getInstance();
+    vector< unique_ptr<GameObject> > objects;
+    for (size_t count : counts_)
+    {
+        // 位相をずらして並べる。checkAwake で OnEnable が呼ばれ、AnimatorManager に登録される
+        while (objects.size() < count)
+        {
+            objects.push_back(make_unique<GameObject>(L"animator", make_unique<Animator>()));
+            Animator* animator = objects.back()->GetComponent<Animator>(true);
+            animator->setSkeleton(skeleton);
+            animator->addClip(clip);
+            animator->Play(clip);
+            animator->setTime(clip->getLength() * float(objects.size() % 97) / 97.0f);
+            animator->checkAwake();
+        }
+
+        manager->setParallel(true);
+        const double parallel = measureUpdate();
+        manager->setParallel(false);
+        const double serial = measureUpdate();
+        out << manager->getAnimatorCount() << ", " << parallel << ", " << serial << ", " << serial / parallel << "\n";
+    }
+    manager->setParallel(true);
+
+    // クロスフェード中のポーズの混ぜ合わせ
+    AnimationPose a = skeleton->getRestPose();
+    AnimationPose b;
+    clip->sample(0.5f, true, b);
+    AnimationPose blended = a;
+    const double simd = measureBlend(BlendPoseChannels, a, b, blended);
+    const double scalar = measureBlend(BlendPoseChannelsScalar, a, b, blended);
+    out << "blend " << skeleton->size() << " nodes: simd " << simd << " ns, scalar " << scalar << " ns\n";
+
+    runCurveBenchmark(out);
+}
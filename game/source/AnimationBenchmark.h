@@ -0,0 +1,14 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// スケルタルアニメーションの計算時間の計測
+//
+// 同梱のスキンのある .glb の Skeleton に作ったクリップを付けた Animator をたくさん並べ、
+// AnimatorManager::update 1回の時間を、複数のスレッドと1スレッドで比べて resultPath に書き出す。
+// ポーズの混ぜ合わせの SIMD 版とスカラー版の時間も比べる。
+// たくさんの AnimationCurve を CompressedCurveClip にまとめたときの、メモリと1秒あたりの評価の数も比べる。
+// --------------------
+void RunAnimationBenchmark(const std::wstring& resultPath);
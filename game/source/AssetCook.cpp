@@ -0,0 +1,53 @@
+﻿#include "AssetCook.h"
+
+#include <filesystem>
+
+#include <UniDx.h>
+#include <UniDx/GltfModel.h>
+#include <UniDx/MeshCache.h>
+#include <UniDx/Texture.h>
+#include <UniDx/TextureCache.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+void CookAssets(const wstring& directory)
+{
+    error_code ec;
+    for (const auto& entry : filesystem::recursive_directory_iterator(directory, ec))
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+        const wstring extension = entry.path().extension().wstring();
+        if (extension == L".png" || extension == L".jpg")
+        {
+            // 書き出し済みで元が変わっていなければそのまま
+            const wstring texturePath = entry.path().wstring();
+            if (!TextureCache::IsValid(TextureCache::GetCachePath(texturePath), texturePath) && !Texture::Cook(texturePath))
+            {
+                Debug::Log(L"書き出せません: " + texturePath);
+            }
+            continue;
+        }
+        if (extension != L".glb")
+        {
+            continue;
+        }
+        const wstring modelPath = entry.path().wstring();
+        const uint64_t layoutKey = MeshCache::LayoutKey<VertexPNT>();
+
+        // 書き出し済みで元が変わっていなければそのまま
+        MeshCache::File cached;
+        if (cached.open(MeshCache::GetCachePath(modelPath, layoutKey), modelPath, layoutKey, sizeof(VertexPNT)))
+        {
+            continue;
+        }
+        if (!GltfModel::Cook<VertexPNT>(modelPath))
+        {
+            Debug::Log(L"書き出せません: " + modelPath);
+        }
+    }
+}
@@ -0,0 +1,15 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// アセットの書き出し
+//
+// directory の下の .glb を、ゲームで使う頂点の形式（VertexPNT）で
+// エンジンの形式のファイル（MeshCache）に書き出す。元が変わっていないものは書き出さない。
+// 書き出したファイルは GltfModel::LoadCached が元の .glb の代わりに読む。
+// .png と .jpg は、ミップまで作ってブロック圧縮した DDS（TextureCache）に書き出す。
+// Texture は書き出した DDS があればデコードせずにそちらを読む。
+// --------------------
+void CookAssets(const std::wstring& directory);
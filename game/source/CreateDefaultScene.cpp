@@ -103,7 +103,7 @@ unique_ptr<Scene> CreateDefaultScene()
         make_unique<SphereCollider>(Vector3(0, 0.25f, 0))
     );
     auto model = playerObj->GetComponent<GltfModel>(true);
-    model->Load<VertexPNT>(
+    model->LoadCached<VertexPNT>(
         L"Resource/ModularCharacterPBR.glb",
         L"Resource/AlbedoShade.hlsl",
         L"Resource/Albedo.png");
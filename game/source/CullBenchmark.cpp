@@ -0,0 +1,120 @@
+﻿#include "CullBenchmark.h"
+
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include <UniDx/FrustumCulling.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr size_t count_ = 100000;
+constexpr int frames_ = 360;
+
+
+// カメラを原点に置き、Y軸まわりに yaw 回した向きのビュー×プロジェクション行列（行優先・行ベクトル）
+void makeViewProjection(float yaw, float* out)
+{
+    constexpr float fovY = 60.0f * 3.14159265f / 180.0f;
+    constexpr float aspect = 16.0f / 9.0f;
+    constexpr float nearZ = 0.1f;
+    constexpr float farZ = 1000.0f;
+
+    // ビューは Y軸まわりの -yaw の回転
+    const float c = cosf(yaw), s = sinf(yaw);
+    const float view[16] = {
+        c,    0.0f, s,    0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        -s,   0.0f, c,    0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+
+    // 左手系の透視投影。深度は 0～1
+    const float yScale = 1.0f / tanf(fovY * 0.5f);
+    const float xScale = yScale / aspect;
+    const float zRange = farZ / (farZ - nearZ);
+    const float projection[16] = {
+        xScale, 0.0f,   0.0f,             0.0f,
+        0.0f,   yScale, 0.0f,             0.0f,
+        0.0f,   0.0f,   zRange,           1.0f,
+        0.0f,   0.0f,   -nearZ * zRange,  0.0f,
+    };
+
+    for (int r = 0; r < 4; ++r)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            float v = 0.0f;
+            for (int k = 0; k < 4; ++k)
+            {
+                v += view[r * 4 + k] * projection[k * 4 + col];
+            }
+            out[r * 4 + col] = v;
+        }
+    }
+}
+
+
+// 1フレームあたりの時間（ms）と、全フレームで見えた数の合計
+template<typename F>
+double measure(F cull, const vector<FrustumPlanes>& planes, const BoundsArray& bounds, vector<uint32_t>& visible, size_t& visibleSum)
+{
+    visibleSum = 0;
+    const Clock::time_point start = Clock::now();
+    for (const FrustumPlanes& p : planes)
+    {
+        visibleSum += cull(p, bounds, visible.data());
+    }
+    return chrono::duration<double, milli>(Clock::now() - start).count() / planes.size();
+}
+
+}
+
+
+void RunCullBenchmark(const wstring& resultPath)
+{
+    ofstream out{ filesystem::path(resultPath) };
+
+    // 原点のまわり 1000 の立方体にばらまいた AABB
+    mt19937 rng(1);
+    uniform_real_distribution<float> position(-500.0f, 500.0f);
+    uniform_real_distribution<float> size(0.5f, 5.0f);
+    BoundsArray bounds;
+    bounds.resize(count_);
+    for (size_t i = 0; i < count_; ++i)
+    {
+        const float center[3] = { position(rng), position(rng), position(rng) };
+        const float extents[3] = { size(rng), size(rng), size(rng) };
+        bounds.set(i, center, extents);
+    }
+
+    // 1周する間のカメラの向き
+    vector<FrustumPlanes> planes(frames_);
+    for (int f = 0; f < frames_; ++f)
+    {
+        float viewProjection[16];
+        makeViewProjection(2.0f * 3.14159265f * float(f) / frames_, viewProjection);
+        planes[f] = ExtractFrustumPlanes(viewProjection);
+    }
+
+    vector<uint32_t> visible(count_);
+    size_t scalarVisible = 0, simdVisible = 0;
+    measure(CullBounds, planes, bounds, visible, simdVisible);     // 1回目はキャッシュを温めるだけ
+    const double scalar = measure(CullBoundsScalar, planes, bounds, visible, scalarVisible);
+    const double simd = measure(CullBounds, planes, bounds, visible, simdVisible);
+
+    out << "bounds " << count_ << ", frames " << frames_ << ", visible per frame " << simdVisible / frames_ << "\n";
+    out << "path, ms/frame\n";
+    out << "scalar, " << scalar << "\n";
+    out << "sse, " << simd << "\n";
+    out << "speedup " << scalar / simd << ", results " << (scalarVisible == simdVisible ? "match" : "differ") << "\n";
+}
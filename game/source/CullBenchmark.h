@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// 視錐台カリングの計測
+//
+// 10万個の AABB を、向きを変えながら回るカメラの視錐台で判定し、
+// SSE 版とスカラー版の1フレームあたりの時間と、見えた数が一致するかを resultPath に書き出す。
+// GPU もエンジンも使わない。
+// --------------------
+void RunCullBenchmark(const std::wstring& resultPath);
@@ -0,0 +1,130 @@
+﻿#include "LoadBenchmark.h"
+
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <UniDx.h>
+#include <UniDx/Engine.h>
+#include <UniDx/GltfModel.h>
+#include <UniDx/AssetLoader.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr const wchar_t* models_[] = {
+    L"Resource/ModularCharacter.glb",
+    L"Resource/ModularCharacterPBR.glb",
+    L"Resource/space_frigate_0.glb",
+};
+
+constexpr int repeat_ = 5;
+constexpr double frameTime_ = 1.0 / 60.0;
+
+double milliseconds(Clock::duration d)
+{
+    return chrono::duration<double, milli>(d).count();
+}
+
+
+// 非同期の読み込みが終わるまで、60fps のフレームを回すつもりで AssetLoader::update を呼ぶ
+// 戻り値は update 1回の最長の時間
+double pumpUntilDone(const vector< shared_ptr<AssetLoadHandle> >& handles, int& frames)
+{
+    AssetLoader* loader = AssetLoader::getInstance();
+    double maxUpdate = 0.0;
+    frames = 0;
+    while (any_of(handles.begin(), handles.end(), [](const auto& h) { return !h->isDone(); }))
+    {
+        const Clock::time_point start = Clock::now();
+        loader->update();
+        const Clock::time_point end = Clock::now();
+        maxUpdate = max(maxUpdate, milliseconds(end - start));
+        ++frames;
+        this_thread::sleep_until(start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(frameTime_)));
+    }
+    return maxUpdate;
+}
+
+}
+
+
+void RunLoadBenchmark(const wstring& resultPath)
+{
+    Engine::create();
+    Engine::getInstance()->Initialize(nullptr);
+
+    ofstream out{ filesystem::path(resultPath) };
+    out << "model, sync ms, mapped ms, cached ms, async total ms, async decode ms, async max update ms, frames\n";
+
+    vector< unique_ptr<GameObject> > keep;
+    double syncSum = 0.0;
+    for (const wchar_t* path : models_)
+    {
+        double syncBest = 1e30, mappedBest = 1e30, cachedBest = 1e30, totalBest = 1e30, decodeBest = 1e30, updateBest = 1e30;
+        int framesBest = 0;
+        for (int r = 0; r < repeat_; ++r)
+        {
+            // 同期。全部の時間メインスレッドが止まる
+            auto syncObj = make_unique<GameObject>(L"sync", make_unique<GltfModel>());
+            const Clock::time_point start = Clock::now();
+            syncObj->GetComponent<GltfModel>(true)->Load<VertexPNT>(path);
+            syncBest = min(syncBest, milliseconds(Clock::now() - start));
+
+            // 同期でファイルをマップして読む
+            auto mappedObj = make_unique<GameObject>(L"mapped", make_unique<GltfModel>());
+            GltfModel* mapped = mappedObj->GetComponent<GltfModel>(true);
+            mapped->loadMode = GltfLoadMode::Mapped;
+            const Clock::time_point mappedStart = Clock::now();
+            mapped->Load<VertexPNT>(path);
+            mappedBest = min(mappedBest, milliseconds(Clock::now() - mappedStart));
+
+            // 同期で書き出したファイルから読む。1回目で書き出すので、2回目から計る
+            auto cachedObj = make_unique<GameObject>(L"cached", make_unique<GltfModel>());
+            const Clock::time_point cachedStart = Clock::now();
+            cachedObj->GetComponent<GltfModel>(true)->LoadCached<VertexPNT>(path);
+            if (r > 0)
+            {
+                cachedBest = min(cachedBest, milliseconds(Clock::now() - cachedStart));
+            }
+
+            // 非同期。メインスレッドは update の間だけ使う
+            auto asyncObj = make_unique<GameObject>(L"async", make_unique<GltfModel>());
+            auto handle = asyncObj->GetComponent<GltfModel>(true)->LoadAsync<VertexPNT>(path);
+            int frames = 0;
+            const double maxUpdate = pumpUntilDone({ handle }, frames);
+            if (handle->getTotalTime() * 1000.0 < totalBest)
+            {
+                totalBest = handle->getTotalTime() * 1000.0;
+                framesBest = frames;
+            }
+            decodeBest = min(decodeBest, handle->getDecodeTime() * 1000.0);
+            updateBest = min(updateBest, maxUpdate);
+        }
+        syncSum += syncBest;
+
+        out << ToUtf8(path) << ", " << syncBest << ", " << mappedBest << ", " << cachedBest << ", " << totalBest << ", " << decodeBest << ", "
+            << updateBest << ", " << framesBest << "\n";
+    }
+
+    // 全部を同時に非同期で読み込む。ワーカーの数だけ並んで進む
+    vector< unique_ptr<GameObject> > objects;
+    vector< shared_ptr<AssetLoadHandle> > handles;
+    const Clock::time_point start = Clock::now();
+    for (const wchar_t* path : models_)
+    {
+        objects.push_back(make_unique<GameObject>(L"async", make_unique<GltfModel>()));
+        handles.push_back(objects.back()->GetComponent<GltfModel>(true)->LoadAsync<VertexPNT>(path));
+    }
+    int frames = 0;
+    const double maxUpdate = pumpUntilDone(handles, frames);
+    out << "all at once: sync sum " << syncSum << " ms, async " << milliseconds(Clock::now() - start)
+        << " ms, max update " << maxUpdate << " ms, frames " << frames << "\n";
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// glTF の読み込み時間の計測
+//
+// 同梱の .glb を、同期の Load（全部読み込む・マップする・書き出したファイルから読む）と
+// 非同期の LoadAsync でそれぞれ読み込み、メインスレッドが止まった時間と読み込み終わるまでの時間を resultPath に書き出す。
+// GPU を使わずに初期化したエンジンで動かすので、GPU のバッファ作成の時間は含まない。
+// --------------------
+void RunLoadBenchmark(const std::wstring& resultPath);
@@ -0,0 +1,1863 @@
+﻿#include "SelfTest.h"
+
+#include <fstream>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <stdexcept>
+#include <future>
+#include <array>
+#include <span>
+
+#include <UniDx.h>
+#include <UniDx/Scene.h>
+#include <UniDx/TransformHierarchy.h>
+#include <UniDx/TransformBatch.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/Behaviour.h>
+#include <UniDx/Prefab.h>
+#include <UniDx/SceneCommandBuffer.h>
+#include <UniDx/FrustumCulling.h>
+#include <UniDx/RenderQueue.h>
+#include <UniDx/RenderStateCache.h>
+#include <UniDx/RingAllocator.h>
+#include <UniDx/ParallelRecorder.h>
+#include <UniDx/NullRenderDevice.h>
+#include <UniDx/Time.h>
+#include <UniDx/HeadlessEngine.h>
+#include <UniDx/Camera.h>
+#include <UniDx/Renderer.h>
+#include <UniDx/LODGroup.h>
+#include <UniDx/RendererManager.h>
+#include <UniDx/MeshSimplifier.h>
+#include <UniDx/MeshOptimizer.h>
+#include <UniDx/VertexPacking.h>
+#include <UniDx/Mesh.h>
+#include <UniDx/Shader.h>
+#include <UniDx/AssetLoader.h>
+#include <UniDx/StridedView.h>
+#include <UniDx/MappedFile.h>
+#include <UniDx/MeshCache.h>
+#include <UniDx/AssetCache.h>
+#include <UniDx/ShaderCache.h>
+#include <UniDx/TextureCompression.h>
+#include <UniDx/TextureResidency.h>
+#include <UniDx/Skeleton.h>
+#include <UniDx/AnimationClip.h>
+#include <UniDx/AnimationPose.h>
+#include <UniDx/AnimationCurve.h>
+#include <UniDx/CompressedCurveClip.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+namespace {
+
+// 項目ごとの結果を書き出し、失敗を数える
+class Report
+{
+public:
+    explicit Report(ostream& out) : out_(out) {}
+
+    void check(const string& name, bool ok, const string& detail = string())
+    {
+        out_ << (ok ? "ok     " : "FAILED ") << name;
+        if (!detail.empty())
+        {
+            out_ << " (" << detail << ")";
+        }
+        out_ << "\n";
+        if (!ok)
+        {
+            ++failed_;
+        }
+    }
+
+    int getFailed() const { return failed_; }
+
+private:
+    ostream& out_;
+    int failed_ = 0;
+};
+
+
+// ローカルの姿勢から、親から順に行列を掛けて求めたワールド行列
+Matrix expectedWorld(const GameObject* gameObject)
+{
+    Matrix world = Matrix::Identity;
+    for (const Transform* t = gameObject->transform; t != nullptr; t = t->parent)
+    {
+        const Vector3 scale = t->localScale;
+        const Quaternion rotation = t->localRotation;
+        const Vector3 position = t->localPosition;
+        world = world * Matrix::CreateScale(scale) * Matrix::CreateFromQuaternion(rotation) * Matrix::CreateTranslation(position);
+    }
+    return world;
+}
+
+
+// Transform のワールド座標と向きが、行列を親から順に掛けたものと一致するか
+bool matchesExpectedWorld(GameObject* gameObject)
+{
+    const Matrix world = expectedWorld(gameObject);
+    const Vector3 position = gameObject->transform->position;
+    const Quaternion rotation = gameObject->transform->rotation;
+    Vector3 forward = Vector3::TransformNormal(Vector3::UnitZ, world);
+    forward.Normalize();
+    return Vector3::Distance(position, world.Translation()) < 1e-4f &&
+        Vector3::Distance(Vector3::Transform(Vector3::UnitZ, rotation), forward) < 1e-4f;
+}
+
+
+// TransformHierarchy でまとめて確定させたワールド座標が、親から順に行列を掛けたものと一致するか
+// 途中の親を動かしたり付け替えたりしたとき、変わったところだけ計算し直すか
+void testTransformHierarchy(Report& report)
+{
+    auto rootObject = make_unique<GameObject>(L"Root");
+    GameObject* root = rootObject.get();
+    Scene scene(std::move(rootObject));
+
+    auto middleObject = make_unique<GameObject>(L"Middle");
+    GameObject* middle = middleObject.get();
+    Transform::SetParent(std::move(middleObject), root->transform);
+    auto leafObject = make_unique<GameObject>(L"Leaf");
+    GameObject* leaf = leafObject.get();
+    Transform::SetParent(std::move(leafObject), middle->transform);
+    auto siblingObject = make_unique<GameObject>(L"Sibling");
+    GameObject* sibling = siblingObject.get();
+    Transform::SetParent(std::move(siblingObject), root->transform);
+
+    root->transform->localPosition = Vector3(1, 0, 0);
+    middle->transform->localPosition = Vector3(0, 2, 0);
+    middle->transform->localRotation = Quaternion::CreateFromAxisAngle(Vector3::UnitY, 0.5f);
+    middle->transform->localScale = Vector3(2, 2, 2);
+    leaf->transform->localPosition = Vector3(0, 0, 3);
+    leaf->transform->localRotation = Quaternion::CreateFromAxisAngle(Vector3::UnitX, 0.25f);
+    sibling->transform->localPosition = Vector3(0, 0, -1);
+
+    TransformHierarchy hierarchy;
+    hierarchy.update(&scene);
+    report.check("TransformHierarchy orders every transform", hierarchy.size() == 4);
+    report.check("TransformHierarchy resolves world poses through the parents",
+        matchesExpectedWorld(leaf) && matchesExpectedWorld(sibling));
+
+    // 途中の親だけを動かす。別の部分木は計算し直さない
+    const uint32_t siblingVersion = sibling->transform->getWorldVersion();
+    middle->transform->localRotation = Quaternion::CreateFromAxisAngle(Vector3::UnitX, 1.0f);
+    hierarchy.update(&scene);
+    report.check("TransformHierarchy recomputes children of a moved parent", matchesExpectedWorld(leaf));
+    report.check("TransformHierarchy keeps untouched subtrees cached", sibling->transform->getWorldVersion() == siblingVersion);
+
+    // 更新の前に読んでも、動かしたルートが反映されている
+    root->transform->localPosition = Vector3(-4, 1, 2);
+    report.check("Transform reads an up-to-date pose before the hierarchy update",
+        matchesExpectedWorld(leaf) && matchesExpectedWorld(sibling));
+    hierarchy.update(&scene);
+
+    leaf->transform->SetParent(sibling->transform);
+    hierarchy.update(&scene);
+    report.check("TransformHierarchy follows a reparented transform", hierarchy.size() == 4 && matchesExpectedWorld(leaf));
+}
+
+
+// まとめて計算した行列が、スカラー版と、SimpleMath で1つずつ掛けた行列と一致するか
+void testTransformBatch(Report& report)
+{
+    mt19937 random(27);
+    uniform_real_distribution<float> value(-2.0f, 2.0f);
+    uniform_real_distribution<float> scale(0.5f, 2.0f);
+    auto randomRotation = [&]()
+        {
+            Vector3 axis(value(random), value(random), value(random));
+            axis.Normalize();
+            return Quaternion::CreateFromAxisAngle(axis, value(random));
+        };
+
+    vector<Matrix> parents(4);
+    for (auto& parent : parents)
+    {
+        parent = Matrix::CreateScale(scale(random)) * Matrix::CreateFromQuaternion(randomRotation()) *
+            Matrix::CreateTranslation(Vector3(value(random), value(random), value(random)));
+    }
+
+    // 8 個ずつ計算した残りも通るよう、8 の倍数にしない
+    const size_t count = 37;
+    TransformBatchBuffer batch;
+    batch.resize(count);
+    vector<Matrix> expected(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Vector3 p(value(random), value(random), value(random));
+        const Quaternion q = randomRotation();
+        const Vector3 s(scale(random), scale(random), scale(random));
+        const Matrix* parent = i % 5 == 0 ? nullptr : &parents[i % parents.size()];
+        batch.set(i, &p.x, &q.x, &s.x, parent ? &parent->_11 : nullptr);
+        expected[i] = Matrix::CreateScale(s) * Matrix::CreateFromQuaternion(q) * Matrix::CreateTranslation(p);
+        if (parent)
+        {
+            expected[i] = expected[i] * *parent;
+        }
+    }
+    batch.compose(count);
+
+    vector<float> local(count * 16), world(count * 16);
+    ComposeLocalToWorldBatchScalar(batch.input(), count, local.data(), world.data());
+
+    float batchError = 0.0f, expectedError = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t k = 0; k < 16; ++k)
+        {
+            batchError = max(batchError, fabs(batch.local[i * 16 + k] - local[i * 16 + k]));
+            batchError = max(batchError, fabs(batch.world[i * 16 + k] - world[i * 16 + k]));
+            expectedError = max(expectedError, fabs(world[i * 16 + k] - (&expected[i]._11)[k]));
+        }
+    }
+
+    ostringstream detail;
+    detail << (IsTransformBatchAvx2Enabled() ? "AVX2" : "scalar") << ", max error " << batchError;
+    report.check("TransformBatch matches the scalar path", batchError < 1e-4f, detail.str());
+    detail.str("");
+    detail << "max error " << expectedError;
+    report.check("TransformBatch scalar path matches SimpleMath", expectedError < 1e-4f, detail.str());
+}
+
+
+// 部分木ごとに並列に計算したワールド行列が、1スレッドで計算したものと一致するか
+// 大きいモデルは子ごとに分けて、スレッドの数だけのグループに振り分けるか
+void testTransformHierarchyParallel(Report& report)
+{
+    JobSystem jobs(3);
+    JobSystem::setThreadInstance(&jobs);
+    const size_t threads = jobs.getThreadCount();
+    {
+        mt19937 random(28);
+        uniform_real_distribution<float> value(-1.0f, 1.0f);
+        vector<Transform*> transforms;
+        auto makeObject = [&](const wchar_t* name)
+            {
+                auto gameObject = make_unique<GameObject>(name);
+                gameObject->transform->localPosition = Vector3(value(random), value(random), value(random));
+                gameObject->transform->localRotation = Quaternion::CreateFromYawPitchRoll(value(random), value(random), value(random));
+                transforms.push_back(gameObject->transform);
+                return gameObject;
+            };
+
+        // 1つで半分以上を占めるモデルと、細長い鎖と、子の多いルート
+        auto model = makeObject(L"Model");
+        for (int i = 0; i < 40; ++i)
+        {
+            auto bone = makeObject(L"Bone");
+            for (int j = 0; j < 15; ++j)
+            {
+                Transform::SetParent(makeObject(L"Leaf"), bone->transform);
+            }
+            Transform::SetParent(std::move(bone), model->transform);
+        }
+        auto chain = makeObject(L"Chain");
+        Transform* tip = chain->transform;
+        for (int i = 0; i < 20; ++i)
+        {
+            auto link = makeObject(L"Link");
+            Transform* next = link->transform;
+            Transform::SetParent(std::move(link), tip);
+            tip = next;
+        }
+        auto crowd = makeObject(L"Crowd");
+        for (int i = 0; i < 100; ++i)
+        {
+            Transform::SetParent(makeObject(L"Member"), crowd->transform);
+        }
+        Scene scene(std::move(model), std::move(chain), std::move(crowd));
+
+        TransformHierarchy hierarchy;
+        hierarchy.update(&scene);
+        const size_t groups = hierarchy.getParallelGroupCount();
+        vector<Matrix> parallelWorld;
+        for (Transform* t : transforms)
+        {
+            parallelWorld.push_back(t->getLocalToWorldMatrix());
+        }
+
+        // 同じ姿勢をもう一度設定して、1スレッドで計算し直す
+        hierarchy.setParallel(false);
+        for (Transform* t : transforms)
+        {
+            const Vector3 position = t->localPosition;
+            t->localPosition = position;
+        }
+        hierarchy.update(&scene);
+
+        float error = 0.0f;
+        for (size_t i = 0; i < transforms.size(); ++i)
+        {
+            const Matrix& serial = transforms[i]->getLocalToWorldMatrix();
+            for (size_t k = 0; k < 16; ++k)
+            {
+                error = max(error, fabs((&serial._11)[k] - (&parallelWorld[i]._11)[k]));
+            }
+        }
+
+        ostringstream detail;
+        detail << groups << " groups on " << threads << " threads, max error " << error;
+        report.check("TransformHierarchy parallel update matches the serial update",
+            hierarchy.size() == transforms.size() && error < 1e-4f, detail.str());
+        report.check("TransformHierarchy splits a large scene over the threads",
+            threads == 1 ? groups == 0 : groups == threads);
+        report.check("TransformHierarchy serial mode uses one group", hierarchy.getParallelGroupCount() == 0);
+    }
+    JobSystem::setThreadInstance(nullptr);
+}
+
+
+// OnDisable が呼ばれた順に id を積む Behaviour
+class DisableRecorder : public Behaviour
+{
+public:
+    DisableRecorder(vector<int>* order, int id) : order_(order), id_(id) {}
+
+protected:
+    virtual void OnDisable() override { order_->push_back(id_); }
+
+private:
+    vector<int>* order_;
+    int id_;
+};
+
+
+// Prefab から取り出すと有効になり、返すと無効になって、同じオブジェクトが使い回されるか
+void testPrefabPool(Report& report)
+{
+    SceneCommandBuffer::create();
+    {
+        Scene scene;
+        vector<int> disabled;
+        Prefab prefab(L"Pooled", [&disabled]()
+            {
+                auto gameObject = make_unique<GameObject>(L"Pooled");
+                gameObject->AddComponent<DisableRecorder>(&disabled, 0);
+                return gameObject;
+            });
+        prefab.Prewarm(3);
+        SceneCommandBuffer::getInstance()->apply(&scene);
+        report.check("Prefab prewarms inactive objects", prefab.CountAll() == 3 && prefab.CountInactive() == 3);
+
+        GameObject* first = prefab.Instantiate(Vector3(1, 2, 3), Quaternion::Identity);
+        const Vector3 position = first->transform->position;
+        report.check("Prefab instantiates an active object where asked",
+            first->activeInHierarchy() && prefab.CountActive() == 1 && position == Vector3(1, 2, 3));
+
+        prefab.Release(first);
+        prefab.Release(first);
+        report.check("Prefab deactivates a released object once",
+            !first->activeInHierarchy() && disabled.size() == 1 && prefab.CountInactive() == 3);
+
+        GameObject* again = prefab.Instantiate(Vector3::Zero, Quaternion::Identity);
+        report.check("Prefab reuses released objects", again == first && prefab.CountAll() == 3);
+    }
+    // SceneCommandBuffer::destroy は GameObject を壊す命令なので、基底の destroy で消す
+    Singleton<SceneCommandBuffer>::destroy();
+}
+
+
+// SceneCommandBuffer の破棄が記録した順に行われ、プールに返す親の子も破棄され、
+// シーンと一緒に消えたものが時刻待ちの破棄に残らないか
+void testSceneDestroy(Report& report)
+{
+    SceneCommandBuffer::create();
+    SceneCommandBuffer* commands = SceneCommandBuffer::getInstance();
+    size_t delayedBeforeTeardown = 0;
+    {
+        Scene scene;
+        vector<int> order;
+        vector<GameObject*> objects;
+        for (int i = 0; i < 5; ++i)
+        {
+            auto gameObject = make_unique<GameObject>(L"Object");
+            gameObject->AddComponent<DisableRecorder>(&order, i);
+            objects.push_back(commands->spawn(std::move(gameObject)));
+        }
+        commands->apply(&scene);
+
+        commands->destroy(objects[4]);
+        commands->destroy(objects[1]);
+        commands->destroy(objects[4]);
+        commands->destroy(objects[3]);
+        commands->apply(&scene);
+        report.check("SceneCommandBuffer destroys in recorded order", order == vector<int>{ 4, 1, 3 });
+
+        Prefab prefab(L"Pooled", []() { return make_unique<GameObject>(L"Pooled"); });
+        GameObject* pooled = prefab.Instantiate(Vector3::Zero, Quaternion::Identity);
+        commands->apply(&scene);
+        GameObject* child = commands->spawn(make_unique<GameObject>(L"Child"), pooled->transform);
+        commands->apply(&scene);
+        commands->destroy(pooled);
+        commands->destroy(child);
+        commands->apply(&scene);
+        report.check("SceneCommandBuffer destroys children of objects returned to a pool",
+            pooled->transform->childCount() == 0 && prefab.CountInactive() == 1);
+
+        commands->destroy(objects[0], 10.0f);
+        commands->apply(&scene);
+        delayedBeforeTeardown = commands->getDelayedCount();
+    }
+    report.check("SceneCommandBuffer drops delayed destroys of objects freed with the scene",
+        delayedBeforeTeardown == 1 && commands->getDelayedCount() == 0);
+    Singleton<SceneCommandBuffer>::destroy();
+}
+
+
+// プールのルートがシーンと一緒に先に消えても、Prefab が空になって作り直せるか
+void testPrefabOutlivesScene(Report& report)
+{
+    SceneCommandBuffer::create();
+    SceneCommandBuffer* commands = SceneCommandBuffer::getInstance();
+    Prefab prefab(L"Pooled", []() { return make_unique<GameObject>(L"Pooled"); });
+
+    size_t beforeTeardown = 0;
+    {
+        Scene scene;
+        prefab.Prewarm(4);
+        prefab.Instantiate(Vector3::Zero, Quaternion::Identity);
+        commands->apply(&scene);
+        beforeTeardown = prefab.CountAll();
+    }
+    const size_t afterTeardown = prefab.CountAll() + prefab.CountInactive();
+
+    size_t afterReuse = 0;
+    {
+        Scene scene;
+        prefab.Instantiate(Vector3::Zero, Quaternion::Identity);
+        commands->apply(&scene);
+        afterReuse = prefab.CountAll();
+    }
+    report.check("Prefab empties its pool when the scene frees the pool root",
+        beforeTeardown == 4 && afterTeardown == 0);
+    report.check("Prefab recreates its pool root after the scene is torn down",
+        afterReuse == 1 && prefab.CountActive() == 0);
+    Singleton<SceneCommandBuffer>::destroy();
+}
+
+
+// 視錐台の中、外、境界をまたぐ箱を正しく振り分けるか
+// SIMD 版がスカラー版と同じ箱を同じ順で残すか
+void testFrustumCulling(Report& report)
+{
+    // 原点から +Z を向くカメラ。視野 90 度、near 1、far 100
+    const Matrix viewProjection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, 1.0f, 100.0f);
+    const FrustumPlanes planes = ExtractFrustumPlanes(&viewProjection._11);
+
+    struct Box { Vector3 center; Vector3 extents; bool visible; };
+    const Box boxes[] = {
+        { Vector3(0, 0, 10), Vector3(1, 1, 1), true },      // 正面
+        { Vector3(0, 0, -10), Vector3(1, 1, 1), false },    // 後ろ
+        { Vector3(50, 0, 10), Vector3(1, 1, 1), false },    // 右の外
+        { Vector3(11, 0, 10), Vector3(2, 2, 2), true },     // 右の面をまたぐ
+        { Vector3(0, 0, 150), Vector3(1, 1, 1), false },    // far より奥
+        { Vector3(0, 0, 99.5f), Vector3(1, 1, 1), true },   // far をまたぐ
+        { Vector3(0, 0, 0.5f), Vector3(0.2f, 0.2f, 0.2f), false },  // near より手前
+        { Vector3(0, -40, 20), Vector3(5, 5, 5), false },   // 下の外
+    };
+    BoundsArray bounds;
+    bounds.resize(std::size(boxes));
+    vector<uint32_t> expected;
+    for (size_t i = 0; i < std::size(boxes); ++i)
+    {
+        bounds.set(i, &boxes[i].center.x, &boxes[i].extents.x);
+        if (boxes[i].visible)
+        {
+            expected.push_back(uint32_t(i));
+        }
+    }
+    vector<uint32_t> visible(bounds.size());
+    visible.resize(CullBounds(planes, bounds, visible.data()));
+    report.check("CullBounds keeps boxes inside or crossing the frustum", visible == expected);
+
+    // 数を 4 の倍数にせず、残りの処理も通す
+    mt19937 random(31);
+    uniform_real_distribution<float> position(-120.0f, 120.0f);
+    uniform_real_distribution<float> size(0.1f, 10.0f);
+    bounds.resize(1003);
+    for (size_t i = 0; i < bounds.size(); ++i)
+    {
+        const Vector3 center(position(random), position(random), position(random));
+        const Vector3 extents(size(random), size(random), size(random));
+        bounds.set(i, &center.x, &extents.x);
+    }
+    vector<uint32_t> simd(bounds.size()), scalar(bounds.size());
+    simd.resize(CullBounds(planes, bounds, simd.data()));
+    scalar.resize(CullBoundsScalar(planes, bounds, scalar.data()));
+
+    ostringstream detail;
+    detail << simd.size() << " of " << bounds.size() << " visible";
+    report.check("CullBounds matches the scalar path", simd == scalar && !simd.empty(), detail.str());
+
+    // 消した箇所に末尾が詰められる
+    const float lastX = bounds.cx.back();
+    bounds.removeSwapBack(0);
+    report.check("BoundsArray removes by swapping in the last entry", bounds.size() == 1002 && bounds.cx[0] == lastX);
+}
+
+
+// 不透明は手前から、半透明は奥から並び、同じキーは追加順のまま残るか
+// 同じ値の再設定を状態キャッシュが省略するか
+void testRenderQueue(Report& report)
+{
+    int shader, material, mesh, otherMesh;
+    RenderQueue queue;
+    queue.add(RenderQueue::MakeKey(RenderQueue::Transparent, &shader, &material, &mesh, 0.2f), 0);
+    queue.add(RenderQueue::MakeKey(RenderQueue::Transparent, &shader, &material, &mesh, 0.8f), 1);
+    queue.add(RenderQueue::MakeKey(RenderQueue::Geometry, &shader, &material, &mesh, 0.8f), 2);
+    queue.add(RenderQueue::MakeKey(RenderQueue::Geometry, &shader, &material, &mesh, 0.2f), 3);
+    queue.add(RenderQueue::MakeKey(RenderQueue::Background, &shader, &material, &otherMesh, 0.5f), 4);
+    queue.sort();
+    vector<uint32_t> order;
+    for (const auto& item : queue.getItems())
+    {
+        order.push_back(item.index);
+    }
+    report.check("RenderQueue draws opaque front to back and transparent back to front",
+        order == vector<uint32_t>{ 4, 3, 2, 1, 0 });
+    report.check("RenderQueue state bits ignore the depth",
+        RenderQueue::StateBits(RenderQueue::MakeKey(RenderQueue::Geometry, &shader, &material, &mesh, 0.1f)) ==
+        RenderQueue::StateBits(RenderQueue::MakeKey(RenderQueue::Geometry, &shader, &material, &mesh, 0.9f)));
+
+    // 基数ソートになる数で、重複したキーを std::stable_sort と比べる
+    mt19937 random(32);
+    uniform_int_distribution<uint64_t> key(0, 15);
+    queue.clear();
+    vector<RenderQueue::Item> expected;
+    for (uint32_t i = 0; i < 300; ++i)
+    {
+        const uint64_t k = key(random) << 60 | key(random) << 20 | key(random);
+        queue.add(k, i);
+        expected.push_back({ k, i });
+    }
+    queue.sort();
+    stable_sort(expected.begin(), expected.end(),
+        [](const RenderQueue::Item& a, const RenderQueue::Item& b) { return a.key < b.key; });
+    report.check("RenderQueue radix sort is stable", equal(expected.begin(), expected.end(),
+        queue.getItems().begin(), queue.getItems().end(),
+        [](const RenderQueue::Item& a, const RenderQueue::Item& b) { return a.key == b.key && a.index == b.index; }));
+
+    // 設定先がないときは数えるだけ
+    RenderStateCache cache;
+    ID3D11PixelShader* first = reinterpret_cast<ID3D11PixelShader*>(uintptr_t(0x100));
+    ID3D11PixelShader* second = reinterpret_cast<ID3D11PixelShader*>(uintptr_t(0x200));
+    cache.setPixelShader(first);
+    cache.setPixelShader(first);
+    cache.setPixelShader(second);
+    cache.drawIndexed(3);
+    cache.beginFrame();
+    const auto& stats = cache.getLastFrameStats();
+    report.check("RenderStateCache skips a repeated state",
+        stats.stateChanges == 2 && stats.skipped == 1 && stats.drawCalls == 1);
+}
+
+
+// 頂点とインスタンスのスロットを別々に覚え、インスタンス描画を1回の描画として数えるか
+void testInstancedDrawStats(Report& report)
+{
+    RenderStateCache cache;
+    ID3D11Buffer* vertices = reinterpret_cast<ID3D11Buffer*>(uintptr_t(0x100));
+    ID3D11Buffer* instances = reinterpret_cast<ID3D11Buffer*>(uintptr_t(0x200));
+    cache.setVertexBuffer(0, vertices, 32, 0);
+    cache.setVertexBuffer(1, instances, 64, 0);
+    cache.drawIndexedInstanced(36, 50, 0);
+
+    // 同じメッシュの続き。インスタンスの位置だけが進む
+    cache.setVertexBuffer(0, vertices, 32, 0);
+    cache.setVertexBuffer(1, instances, 64, 0);
+    cache.drawInstanced(36, 20, 50);
+    cache.beginFrame();
+
+    const auto& stats = cache.getLastFrameStats();
+    report.check("RenderStateCache keeps the vertex and instance slots apart",
+        stats.stateChanges == 2 && stats.skipped == 2);
+    report.check("RenderStateCache counts an instanced draw as one call",
+        stats.drawCalls == 2 && stats.instances == 70);
+}
+
+
+// 捨てるまでのあいだに、同じ領域へ二度書き込まない割り当てになっているか
+// GPU がまだ読むかもしれない領域への上書きを、書き込み済みの印で見つける
+void testRingAllocator(Report& report)
+{
+    RingAllocator ring(4096, 256);
+    vector<bool> written(ring.getCapacity(), false);
+    mt19937 random(34);
+    uniform_int_distribution<uint32_t> size(1, 1000);
+
+    bool overwritten = false, aligned = true, discardedFirst = true;
+    for (int frame = 0; frame < 20; ++frame)
+    {
+        ring.beginFrame();
+        for (int draw = 0; draw < 10; ++draw)
+        {
+            RingAllocator::Allocation allocation;
+            if (!ring.allocate(size(random), allocation))
+            {
+                continue;
+            }
+            if (draw == 0 && !allocation.discard)
+            {
+                discardedFirst = false;
+            }
+            if (allocation.discard)
+            {
+                fill(written.begin(), written.end(), false);
+            }
+            aligned = aligned && allocation.offset % 256 == 0 && allocation.size % 256 == 0;
+            for (uint32_t i = allocation.offset; i < allocation.offset + allocation.size; ++i)
+            {
+                overwritten = overwritten || written[i];
+                written[i] = true;
+            }
+        }
+    }
+    report.check("RingAllocator never overwrites a region before discarding", !overwritten);
+    report.check("RingAllocator hands out aligned blocks", aligned);
+    report.check("RingAllocator discards at the start of each frame", discardedFirst);
+
+    RingAllocator::Allocation allocation;
+    report.check("RingAllocator rejects a block larger than the buffer",
+        !ring.allocate(5000, allocation) && !ring.allocate(0, allocation));
+}
+
+
+// 並列に記録したコマンドが、1スレッドで記録したときと同じ順で実行されるか
+void testParallelRecorder(Report& report)
+{
+    JobSystem jobs(3);
+    JobSystem::setThreadInstance(&jobs);
+
+    ParallelRecorder recorder;
+    for (size_t slots : { 1, 4, 8 })
+    {
+        for (size_t minItems : { 1, 16, 256 })
+        {
+            for (size_t count : { 0, 1, 255, 256, 1000, 10007 })
+            {
+                NullRecordingBackend backend(slots);
+                recorder.setMinItemsPerSlot(minItems);
+                const size_t parts = recorder.record(backend, count, [&](size_t slot, size_t begin, size_t end)
+                    {
+                        for (size_t i = begin; i < end; ++i)
+                        {
+                            // 区間ごとに進み方をずらして、終わる順をばらばらにする
+                            if ((i + slot) % 64 == 0)
+                            {
+                                this_thread::yield();
+                            }
+                            backend.record(slot, uint32_t(i));
+                        }
+                    });
+
+                const vector<uint32_t>& executed = backend.getExecuted();
+                bool inOrder = executed.size() == count;
+                for (size_t i = 0; inOrder && i < count; ++i)
+                {
+                    inOrder = executed[i] == i;
+                }
+                const bool partsOk = count == 0 ? parts == 0 :
+                    parts >= 1 && parts <= slots && parts <= jobs.getThreadCount() && backend.getExecutedListCount() == parts;
+
+                ostringstream name;
+                name << "ParallelRecorder slots " << slots << " min " << minItems << " count " << count;
+                ostringstream detail;
+                detail << parts << " parts";
+                report.check(name.str(), inOrder && partsOk, detail.str());
+            }
+        }
+    }
+
+    JobSystem::setThreadInstance(nullptr);
+}
+
+
+// GPU なしのデバイスが、状態キャッシュを通した呼び出しと転送量を数えるか
+void testNullRenderDevice(Report& report)
+{
+    NullRenderDevice device;
+    RenderStateCache cache;
+    cache.setDevice(&device);
+
+    // 初期データ付きの作成と、開いて書き込んだ分が転送量になる
+    const vector<uint8_t> data(256, 1);
+    BufferDesc desc;
+    desc.byteWidth = uint32_t(data.size());
+    ID3D11Buffer* buffer = reinterpret_cast<ID3D11Buffer*>(uintptr_t(0x100));
+    const bool created = device.createBuffer(desc, data.data(), &buffer);
+    void* mapped = device.mapBuffer(buffer, 128, true);
+    if (mapped)
+    {
+        memset(mapped, 0, 128);
+    }
+    device.unmapBuffer(buffer, 128);
+    report.check("NullRenderDevice creates null resources and counts uploads",
+        created && buffer == nullptr && mapped != nullptr &&
+        device.getStats().resourcesCreated == 1 && device.getStats().bytesUploaded == 384);
+
+    // 同じシェーダーの再設定はデバイスまで届かない
+    ID3D11PixelShader* shader = reinterpret_cast<ID3D11PixelShader*>(uintptr_t(0x200));
+    cache.setPixelShader(shader);
+    cache.setPixelShader(shader);
+    cache.drawIndexedInstanced(36, 10, 0);
+    cache.drawIndexed(6);
+    const auto& stats = device.getStats();
+    report.check("NullRenderDevice receives only the changed states", stats.stateChanges == 1);
+    report.check("NullRenderDevice counts draws, instances and vertices",
+        stats.drawCalls == 2 && stats.instances == 11 && stats.vertices == 366);
+
+    device.resetStats();
+    report.check("NullRenderDevice resets its stats", device.getStats().drawCalls == 0);
+}
+
+
+// JobSystem のワーカーで、呼び出し元と同じ時刻と JobSystem が見えるか
+// HeadlessEngine はワーカーの始めに自分の Clock を設定するので、ジョブの中の Time::time もそのエンジンの時刻になる
+void testJobSystemWorkerInit(Report& report)
+{
+    Time::Clock clock;
+    clock.time = 12.5f;
+    Time::setThreadClock(&clock);
+    {
+        JobSystem jobs(3, [&clock]() { Time::setThreadClock(&clock); });
+
+        const size_t count = 256;
+        vector<float> times(count, 0.0f);
+        vector<JobSystem*> instances(count, nullptr);
+        jobs.parallelFor(count, [&](size_t i)
+            {
+                if (i % 16 == 0)
+                {
+                    this_thread::yield();
+                }
+                times[i] = Time::time;
+                instances[i] = JobSystem::getCurrentThreadIndex() == 0 ? &jobs : JobSystem::getInstance();
+            });
+
+        const bool timeOk = all_of(times.begin(), times.end(), [](float t) { return t == 12.5f; });
+        const bool instanceOk = all_of(instances.begin(), instances.end(), [&jobs](JobSystem* j) { return j == &jobs; });
+        report.check("JobSystem workers see the caller's clock", timeOk);
+        report.check("JobSystem workers see their JobSystem", instanceOk);
+    }
+    Time::setThreadClock(nullptr);
+}
+
+
+// HeadlessEngine のワーカーから SceneCommandBuffer に記録できるか
+// コマンドバッファは JobSystem より先に作るので、記録先がワーカーの分もあるかを確かめる
+void testHeadlessWorkerCommands(Report& report)
+{
+    HeadlessEngine::Settings settings;
+    settings.workerCount = 3;
+    HeadlessEngine engine(settings);
+    engine.Initialize();
+    {
+        Scene scene;
+        const size_t count = 256;
+        atomic<size_t> fromWorkers = 0;
+        JobSystem::getInstance()->parallelFor(count, [&fromWorkers](size_t i)
+            {
+                if (i % 16 == 0)
+                {
+                    this_thread::yield();
+                }
+                if (JobSystem::getCurrentThreadIndex() != 0)
+                {
+                    fromWorkers.fetch_add(1, memory_order_relaxed);
+                }
+                SceneCommandBuffer::getInstance()->spawn(make_unique<GameObject>(L"Spawned"));
+            });
+        SceneCommandBuffer::getInstance()->apply(&scene);
+
+        report.check("HeadlessEngine creates its worker threads", JobSystem::getInstance()->getThreadCount() == 4);
+        report.check("SceneCommandBuffer applies commands recorded on headless workers",
+            scene.GetRootGameObjects().size() == count,
+            to_string(fromWorkers.load()) + " of " + to_string(count) + " on workers");
+    }
+}
+
+
+// 大きさ 1 の箱の境界だけを持つ Renderer
+class BoxRenderer : public Renderer
+{
+public:
+    virtual bool getLocalBounds(Bounds& bounds) const override
+    {
+        bounds = Bounds(Vector3::Zero, Vector3(0.5f, 0.5f, 0.5f));
+        return true;
+    }
+};
+
+
+// LODGroup が先に境界を計算し直しても、動かした Renderer がカリングで正しく残るか
+void testLODGroupCulling(Report& report)
+{
+    HeadlessEngine::Settings settings;
+    HeadlessEngine engine(settings);
+    engine.Initialize();
+    {
+        Scene scene;
+        auto cameraObject = make_unique<GameObject>(L"Camera");
+        Camera* camera = cameraObject->AddComponent<Camera>();
+
+        auto object = make_unique<GameObject>(L"LOD");
+        Renderer* renderer = object->AddComponent<BoxRenderer>();
+        LOD lod;
+        lod.screenRelativeTransitionHeight = 0.001f;
+        lod.renderers.push_back(renderer);
+        object->AddComponent<LODGroup>()->SetLODs({ lod });
+        Transform* transform = object->transform;
+        transform->position = Vector3(0, 0, 10);
+
+        SceneCommandBuffer::getInstance()->spawn(std::move(cameraObject));
+        SceneCommandBuffer::getInstance()->spawn(std::move(object));
+        SceneCommandBuffer::getInstance()->apply(&scene);
+
+        // カメラは原点から +Z を向いている。前、後ろ、また前に動かす
+        RendererManager* renderers = RendererManager::getInstance();
+        renderers->render(*camera);
+        const size_t inFront = renderers->getVisibleCount();
+        transform->position = Vector3(0, 0, -10);
+        renderers->render(*camera);
+        const size_t behind = renderers->getVisibleCount();
+        transform->position = Vector3(2, 0, 20);
+        renderers->render(*camera);
+        const size_t movedBack = renderers->getVisibleCount();
+
+        report.check("LODGroup renderer survives culling in front of the camera", inFront == 1);
+        report.check("LODGroup renderer is culled after moving behind the camera", behind == 0);
+        report.check("LODGroup renderer survives culling after moving back in front", movedBack == 1);
+    }
+}
+
+
+// 平らな格子を簡略化して、縁を残したまま、裏返らずに三角形が減るか
+void testMeshSimplifier(Report& report)
+{
+    // 20x20 マスの格子。表は +Y
+    const uint32_t cells = 20, side = cells + 1;
+    vector<Vector3> positions;
+    vector<uint32_t> indices;
+    for (uint32_t z = 0; z < side; ++z)
+    {
+        for (uint32_t x = 0; x < side; ++x)
+        {
+            positions.push_back(Vector3(float(x), 0.0f, float(z)));
+        }
+    }
+    for (uint32_t z = 0; z < cells; ++z)
+    {
+        for (uint32_t x = 0; x < cells; ++x)
+        {
+            const uint32_t i = z * side + x;
+            indices.insert(indices.end(), { i, i + side, i + 1, i + 1, i + side, i + side + 1 });
+        }
+    }
+    SubMeshData source;
+    source.topology = PrimitiveTopology::TriangleList;
+    source.positions = positions;
+    source.indices = indices;
+
+    MeshSimplifier::Settings settings;
+    settings.targetRatio = 0.25f;
+    auto simplified = MeshSimplifier::Simplify(source, settings);
+    const size_t before = indices.size() / 3;
+    const size_t after = simplified ? simplified->indices.size() / 3 : 0;
+    report.check("MeshSimplifier reduces a flat grid toward the target",
+        after > 0 && after <= before / 3, to_string(before) + " -> " + to_string(after));
+
+    // 縁の頂点は動かさないので、四隅と縁の上の頂点が残る
+    size_t borderVertices = 0;
+    bool facesUp = simplified != nullptr;
+    if (simplified)
+    {
+        for (const Vector3& p : simplified->positions)
+        {
+            if (p.x == 0.0f || p.z == 0.0f || p.x == float(cells) || p.z == float(cells)) ++borderVertices;
+        }
+        const auto& out = simplified->indices;
+        for (size_t i = 0; i + 2 < out.size(); i += 3)
+        {
+            const Vector3& a = simplified->positions[out[i]];
+            const Vector3& b = simplified->positions[out[i + 1]];
+            const Vector3& c = simplified->positions[out[i + 2]];
+            facesUp = facesUp && (b - a).Cross(c - a).y > 0.0f;
+        }
+    }
+    report.check("MeshSimplifier keeps locked border vertices", borderVertices == cells * 4);
+    report.check("MeshSimplifier does not flip triangles", facesUp);
+
+    const float ratios[] = { 0.5f, 0.25f };
+    auto chain = MeshSimplifier::BuildLODChain(source, ratios);
+    report.check("MeshSimplifier builds a shrinking LOD chain",
+        chain.size() == 2 && chain[0]->indices.size() < indices.size() && chain[1]->indices.size() < chain[0]->indices.size());
+
+    source.topology = PrimitiveTopology::LineList;
+    report.check("MeshSimplifier rejects non-triangle lists", MeshSimplifier::Simplify(source, settings) == nullptr);
+}
+
+
+// 位置から向きを含めて三角形を表す値。頂点の並べ替えに左右されない
+vector<array<float, 9>> trianglesByPosition(const OwnedSubMesh& mesh)
+{
+    vector<array<float, 9>> triangles;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        array<Vector3, 3> p = { mesh.positions[mesh.indices[i]], mesh.positions[mesh.indices[i + 1]], mesh.positions[mesh.indices[i + 2]] };
+        auto less = [](const Vector3& a, const Vector3& b) { return a.x != b.x ? a.x < b.x : a.z < b.z; };
+        rotate(p.begin(), min_element(p.begin(), p.end(), less), p.end());
+        triangles.push_back({ p[0].x, p[0].y, p[0].z, p[1].x, p[1].y, p[1].z, p[2].x, p[2].y, p[2].z });
+    }
+    sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+
+// 三角形ごとに頂点を持つ格子を溶接し、並べ替えた後も同じ三角形を描き、頂点キャッシュの効率が上がるか
+void testMeshOptimizer(Report& report)
+{
+    const uint32_t cells = 30, side = cells + 1;
+    OwnedSubMesh mesh;
+    mesh.topology = PrimitiveTopology::TriangleList;
+    mesh.resizePositions(cells * cells * 6);
+    auto& positions = const_cast<vector<Vector3>&>(mesh.mutablePositions());
+    size_t v = 0;
+    for (uint32_t z = 0; z < cells; ++z)
+    {
+        for (uint32_t x = 0; x < cells; ++x)
+        {
+            const Vector3 p00(float(x), 0, float(z)), p10(float(x + 1), 0, float(z));
+            const Vector3 p01(float(x), 0, float(z + 1)), p11(float(x + 1), 0, float(z + 1));
+            for (const Vector3& p : { p00, p01, p10, p10, p01, p11 })
+            {
+                positions[v++] = p;
+            }
+        }
+    }
+    const size_t welded = MeshOptimizer::WeldVertices(mesh);
+    report.check("MeshOptimizer welds identical vertices",
+        welded == side * side && mesh.positions.size() == welded && mesh.indices.size() == cells * cells * 6);
+
+    // 三角形の順番をばらばらにしてから最適化する
+    auto& indices = const_cast<vector<uint32_t>&>(mesh.mutableIndices());
+    vector<array<uint32_t, 3>> shuffled(indices.size() / 3);
+    memcpy(shuffled.data(), indices.data(), indices.size() * sizeof(uint32_t));
+    shuffle(shuffled.begin(), shuffled.end(), mt19937(39));
+    memcpy(indices.data(), shuffled.data(), indices.size() * sizeof(uint32_t));
+    const auto before = trianglesByPosition(mesh);
+
+    MeshOptimizer::Stats stats;
+    const bool optimized = MeshOptimizer::Optimize(mesh, &stats);
+    report.check("MeshOptimizer keeps every triangle and its winding", optimized && trianglesByPosition(mesh) == before);
+    report.check("MeshOptimizer lowers the ACMR", stats.acmrAfter < stats.acmrBefore && stats.acmrAfter < 1.0f,
+        to_string(stats.acmrBefore) + " -> " + to_string(stats.acmrAfter));
+
+    // 頂点は最初に使う順に並んでいる
+    uint32_t next = 0;
+    bool firstUseOrder = true;
+    for (uint32_t i : mesh.indices)
+    {
+        if (i == next) ++next;
+        else if (i > next) firstUseOrder = false;
+    }
+    report.check("MeshOptimizer orders vertices by first use", firstUseOrder && next == mesh.positions.size());
+}
+
+
+// 詰めた頂点の属性を戻したときの誤差が、形式の精度に収まるか。まとめて詰めたものが1つずつ詰めたものと同じか
+void testVertexPacking(Report& report)
+{
+    mt19937 rng(1);
+    normal_distribution<float> gaussian;
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const size_t count = 10000;
+
+    // 半精度。正規化数は相対誤差 2^-11 まで。NaN 以外の全ての値は戻すと同じビットになる
+    double halfError = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float value = (unit(rng) - 0.5f) * 2000.0f;
+        if (fabsf(value) < 1.0e-3f) continue;
+        halfError = max(halfError, fabs(double(UnpackHalf(PackHalf(value))) - value) / fabs(value));
+    }
+    bool halfRoundTrip = true;
+    for (uint32_t h = 0; h < 0x10000; ++h)
+    {
+        const bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0;
+        if (!nan && PackHalf(UnpackHalf(uint16_t(h))) != h) halfRoundTrip = false;
+    }
+    const bool halfRange = isinf(UnpackHalf(PackHalf(70000.0f))) && UnpackHalf(PackHalf(65504.0f)) == 65504.0f;
+    ostringstream halfDetail;
+    halfDetail << "max relative error " << halfError;
+    report.check("PackHalf relative error within 2^-11", halfError <= 1.0 / 2048.0, halfDetail.str());
+    report.check("PackHalf round-trips every half", halfRoundTrip);
+    report.check("PackHalf overflows to infinity", halfRange);
+
+    // 八面体の法線。16ビットの格子なので角度の誤差は 1e-4 ラジアンより小さい
+    vector<Vector3> normals(count);
+    double normalError = 0.0;
+    for (Vector3& n : normals)
+    {
+        n = Vector3(gaussian(rng), gaussian(rng), gaussian(rng));
+        n.Normalize();
+        const Vector3 u = UnpackOctahedralNormal(PackOctahedralNormal(n));
+        const double cx = double(n.y) * u.z - double(n.z) * u.y;
+        const double cy = double(n.z) * u.x - double(n.x) * u.z;
+        const double cz = double(n.x) * u.y - double(n.y) * u.x;
+        const double dot = double(n.x) * u.x + double(n.y) * u.y + double(n.z) * u.z;
+        normalError = max(normalError, atan2(sqrt(cx * cx + cy * cy + cz * cz), dot));
+    }
+    ostringstream normalDetail;
+    normalDetail << "max angle " << normalError << " rad";
+    report.check("PackOctahedralNormal angle error below 1e-4 rad", normalError < 1.0e-4, normalDetail.str());
+
+    // unorm は段の半分まで。範囲の外は切り詰める
+    vector<Vector2> uvs(count);
+    vector<Color> colors(count);
+    double uvError = 0.0, colorError = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uvs[i] = Vector2(unit(rng), unit(rng));
+        colors[i] = Color(unit(rng), unit(rng), unit(rng), unit(rng));
+        const Vector2 uv = UnpackUNorm16x2(PackUNorm16x2(uvs[i]));
+        const Color c = UnpackUNorm8x4(PackUNorm8x4(colors[i]));
+        uvError = max({ uvError, fabs(double(uv.x) - uvs[i].x), fabs(double(uv.y) - uvs[i].y) });
+        colorError = max({ colorError, fabs(double(c.R()) - colors[i].R()), fabs(double(c.G()) - colors[i].G()),
+            fabs(double(c.B()) - colors[i].B()), fabs(double(c.A()) - colors[i].A()) });
+    }
+    const Vector2 clamped = UnpackUNorm16x2(PackUNorm16x2(Vector2(-0.5f, 1.5f)));
+    ostringstream unormDetail;
+    unormDetail << "uv " << uvError << ", color " << colorError;
+    report.check("PackUNorm error within half a step",
+        uvError <= 0.5 / 65535.0 + 1.0e-7 && colorError <= 0.5 / 255.0 + 1.0e-7, unormDetail.str());
+    report.check("PackUNorm16x2 clamps to 0..1", clamped.x == 0.0f && clamped.y == 1.0f);
+
+    // まとめて詰めたものは1つずつ詰めたものと同じビットになる。stride は属性より大きくしておく
+    const size_t stride = 24;
+    vector<uint8_t> stream(count * stride);
+    vector<Vector3> positions(count);
+    for (Vector3& p : positions)
+    {
+        p = Vector3(gaussian(rng) * 100.0f, gaussian(rng), gaussian(rng) * 1.0e-3f);
+    }
+    auto sameAsScalar = [&](auto pack, size_t bytes, auto scalar)
+        {
+            pack(stream.data());
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint8_t expected[8];
+                scalar(i, expected);
+                if (memcmp(stream.data() + i * stride, expected, bytes) != 0) return false;
+            }
+            return true;
+        };
+    const bool half4 = sameAsScalar([&](void* dst) { PackHalf4Stream(positions, dst, stride); }, 8,
+        [&](size_t i, uint8_t* out) { uint16_t h[4]; PackHalf4(positions[i], h); memcpy(out, h, 8); });
+    const bool octahedral = sameAsScalar([&](void* dst) { PackOctahedralNormalStream(normals, dst, stride); }, 4,
+        [&](size_t i, uint8_t* out) { const uint32_t v = PackOctahedralNormal(normals[i]); memcpy(out, &v, 4); });
+    const bool unorm16 = sameAsScalar([&](void* dst) { PackUNorm16x2Stream(uvs, dst, stride); }, 4,
+        [&](size_t i, uint8_t* out) { const uint32_t v = PackUNorm16x2(uvs[i]); memcpy(out, &v, 4); });
+    const bool unorm8 = sameAsScalar([&](void* dst) { PackUNorm8x4Stream(colors, dst, stride); }, 4,
+        [&](size_t i, uint8_t* out) { const uint32_t v = PackUNorm8x4(colors[i]); memcpy(out, &v, 4); });
+    report.check("Pack streams match scalar packing", half4 && octahedral && unorm16 && unorm8);
+}
+
+
+// 1回で並べて書いた頂点が、属性ごとに setX で書いたものと同じバイト列になるか
+void testVertexInterleave(Report& report)
+{
+    // まとめて書く 64 個の区切りをまたぎ、余りも出る数
+    const size_t count = 150;
+    mt19937 random(41);
+    uniform_real_distribution<float> value(-1.0f, 1.0f);
+    OwnedSubMesh mesh;
+    mesh.resizePositions(count);
+    mesh.resizeNormals(count);
+    mesh.resizeUV(count);
+    auto& positions = const_cast<vector<Vector3>&>(mesh.mutablePositions());
+    auto& normals = const_cast<vector<Vector3>&>(mesh.mutableNormals());
+    auto& uv = const_cast<vector<Vector2>&>(mesh.mutableUV());
+    for (size_t i = 0; i < count; ++i)
+    {
+        positions[i] = Vector3(value(random), value(random), value(random));
+        normals[i] = Vector3(value(random), value(random), value(random));
+        uv[i] = Vector2(value(random), value(random));
+    }
+
+    vector<VertexPNT> expected(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        expected[i].setPosition(positions[i]);
+        expected[i].setNormal(normals[i]);
+        expected[i].setUV(uv[i]);
+    }
+    vector<VertexPNT> interleaved(count);
+    mesh.copyTo(span<VertexPNT>(interleaved));
+    report.check("SubMesh interleaves vertices like the setters",
+        memcmp(interleaved.data(), expected.data(), count * sizeof(VertexPNT)) == 0);
+
+    // 元にない属性は 0 で埋める
+    vector<VertexPNC> colored(count);
+    mesh.copyTo(span<VertexPNC>(colored));
+    report.check("SubMesh fills a missing attribute with zero",
+        all_of(colored.begin(), colored.end(), [](const VertexPNC& v) { return v.color == Color(0, 0, 0, 0); }) &&
+        colored[count - 1].position == positions[count - 1]);
+
+    // そろっていない書き込み先と、16 バイトの倍数でない大きさ
+    vector<uint8_t> source(1000), aligned(1024 + 16), unaligned(1024 + 16);
+    for (uint8_t& b : source) b = uint8_t(random());
+    uint8_t* alignedDst = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(aligned.data()) + 15) & ~uintptr_t(15));
+    StreamStore(alignedDst, source.data(), 999);
+    StreamStore(unaligned.data() + 3, source.data(), 999);
+    report.check("StreamStore copies aligned and unaligned ranges",
+        memcmp(alignedDst, source.data(), 999) == 0 && memcmp(unaligned.data() + 3, source.data(), 999) == 0);
+}
+
+
+// メインスレッドの手順が予算の範囲で積んだ順に進み、ワーカーから積んだ手順もメインスレッドで動くか
+void testAssetLoader(Report& report)
+{
+    AssetLoader loader(2);
+    AssetLoader::Budget budget;
+    budget.bytesPerFrame = 100;
+    budget.secondsPerFrame = 10.0;
+    loader.setBudget(budget);
+
+    // 1つ 60 バイトなので、1フレームに2つずつ進む
+    vector<int> order;
+    for (int i = 0; i < 5; ++i)
+    {
+        loader.enqueueMainThread([&order, i]() { order.push_back(i); return size_t(60); });
+    }
+    loader.update();
+    const size_t firstFrame = order.size();
+    loader.update();
+    loader.update();
+    report.check("AssetLoader runs main-thread steps within the byte budget",
+        firstFrame == 2 && order == vector<int>{ 0, 1, 2, 3, 4 } && loader.getFrameCount() == 3);
+
+    // 予算を超える手順でも、1フレームに1つは進む
+    loader.enqueueMainThread([]() { return size_t(1000); });
+    loader.enqueueMainThread([]() { return size_t(1000); });
+    loader.update();
+    report.check("AssetLoader runs at least one step per frame", loader.getPendingCount() == 1);
+    loader.update();
+
+    // ワーカーでデコードし、作成の手順をメインスレッドに積む
+    const thread::id mainThread = this_thread::get_id();
+    thread::id decodeThread, uploadThread;
+    loader.enqueue([&]()
+        {
+            decodeThread = this_thread::get_id();
+            loader.enqueueMainThread([&]() { uploadThread = this_thread::get_id(); return size_t(0); });
+        });
+    loader.finishAll();
+    report.check("AssetLoader decodes on a worker and uploads on the main thread",
+        decodeThread != mainThread && uploadThread == mainThread && loader.getPendingCount() == 0);
+
+    // 取り消した読み込みは作成に進まず、後から完了にもならない
+    AssetLoadHandle handle;
+    handle.cancel();
+    const bool uploads = handle.beginUpload();
+    handle.finish(AssetLoadHandle::State::Completed);
+    report.check("AssetLoadHandle stays cancelled",
+        !uploads && handle.isCancelled() && handle.getFuture().get() == false);
+}
+
+
+// 交互に並んだ属性の1つを、そろっていない位置からでもコピーせずに読めるか
+// マップしたファイルの中身が、書いたバイト列と同じか
+void testStridedViewAndMappedFile(Report& report)
+{
+    // 位置と UV が交互に並んだ 20 バイトの頂点を、1バイトずらして置く
+    const size_t count = 7, stride = 20;
+    vector<uint8_t> buffer(1 + count * stride);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float f = float(i);
+        const Vector3 position(f, f * 2, f * 3);
+        const Vector2 uv(f * 0.5f, 1.0f - f * 0.5f);
+        memcpy(&buffer[1 + i * stride], &position, sizeof(position));
+        memcpy(&buffer[1 + i * stride + 12], &uv, sizeof(uv));
+    }
+    StridedView<Vector2> uvs(&buffer[1 + 12], count, stride);
+    vector<Vector2> copied(count);
+    uvs.copyTo(copied);
+    report.check("StridedView reads an unaligned interleaved attribute",
+        !uvs.isContiguous() && uvs[3] == Vector2(1.5f, -0.5f) && copied[6] == Vector2(3.0f, -2.0f));
+
+    vector<Vector3> packed = { Vector3(1, 2, 3), Vector3(4, 5, 6) };
+    StridedView<Vector3> positions(packed.data(), packed.size(), sizeof(Vector3));
+    report.check("StridedView exposes packed data as a span",
+        positions.isContiguous() && positions.asSpan().data() == packed.data() && positions.asSpan()[1] == packed[1]);
+
+    const filesystem::path path = filesystem::temp_directory_path() / "UniDxSelfTestMapped.bin";
+    ofstream(path, ios::binary).write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    MappedFile file;
+    const bool opened = file.open(path.wstring());
+    report.check("MappedFile maps the bytes of a file",
+        opened && file.size() == buffer.size() && memcmp(file.data(), buffer.data(), buffer.size()) == 0);
+    file.close();
+
+    error_code ec;
+    filesystem::remove(path, ec);
+    report.check("MappedFile fails on a missing file", !file.open(path.wstring()) && !file.isOpen());
+}
+
+
+// 書き出しの確認に使う、位置と UV だけの頂点
+struct CacheTestVertex
+{
+    Vector3 position;
+    Vector2 uv0;
+
+    static const array<D3D11_INPUT_ELEMENT_DESC, 2> layout;
+};
+const array<D3D11_INPUT_ELEMENT_DESC, 2> CacheTestVertex::layout =
+{
+    D3D11_INPUT_ELEMENT_DESC{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    D3D11_INPUT_ELEMENT_DESC{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+
+// 書き出したメッシュをマップして、頂点・インデックス・ノードがそのまま読めるか
+// 頂点の形式か元のファイルの内容が変わったら使わないか
+void testMeshCache(Report& report)
+{
+    const filesystem::path directory = filesystem::temp_directory_path() / "UniDxSelfTestMeshCache";
+    error_code ec;
+    filesystem::remove_all(directory, ec);
+    filesystem::create_directories(directory, ec);
+    const filesystem::path source = directory / "model.glb";
+    ofstream(source, ios::binary) << "glTF source";
+
+    auto sub = make_shared<OwnedSubMesh>();
+    sub->topology = PrimitiveTopology::TriangleList;
+    sub->resizePositions(3);
+    sub->resizeUV(3);
+    sub->resizeIndices(3);
+    auto& positions = const_cast<vector<Vector3>&>(sub->mutablePositions());
+    auto& uv = const_cast<vector<Vector2>&>(sub->mutableUV());
+    auto& indices = const_cast<vector<uint32_t>&>(sub->mutableIndices());
+    positions = { Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(0, 1, 0) };
+    uv = { Vector2(0, 0), Vector2(1, 0), Vector2(0, 1) };
+    indices = { 0, 2, 1 };
+    const shared_ptr<SubMesh> submesh[] = { sub };
+
+    MeshCache::Node nodes[2];
+    nodes[0].name = "Root";
+    nodes[1].name = "Body";
+    nodes[1].parent = 0;
+    nodes[1].subMesh = 0;
+    nodes[1].position = Vector3(0, 1, 0);
+
+    const uint64_t layoutKey = MeshCache::LayoutKey<CacheTestVertex>();
+    const wstring cachePath = MeshCache::GetCachePath(source.wstring(), layoutKey);
+    const bool written = MeshCache::Write<CacheTestVertex>(cachePath, source.wstring(), submesh, nodes);
+
+    MeshCache::File file;
+    bool opened = written && file.open(cachePath, source.wstring(), layoutKey, sizeof(CacheTestVertex));
+    bool matches = opened && file.subMeshes().size() == 1 && file.nodes().size() == 2;
+    if (matches)
+    {
+        const MeshCache::SubMeshEntry& e = file.subMeshes()[0];
+        const auto* vertices = static_cast<const CacheTestVertex*>(file.at(e.vertexOffset));
+        const auto* cachedIndices = static_cast<const uint32_t*>(file.at(e.indexOffset));
+        matches = e.vertexCount == 3 && e.indexCount == 3 && e.vertexOffset % MeshCache::PageSize == 0 &&
+            vertices[1].position == positions[1] && vertices[2].uv0 == uv[2] &&
+            memcmp(cachedIndices, indices.data(), indices.size() * sizeof(uint32_t)) == 0 &&
+            file.name(file.nodes()[1]) == "Body" && file.nodes()[1].parent == 0 && file.nodes()[1].subMesh == 0;
+    }
+    report.check("MeshCache maps the vertices, indices and nodes it wrote", matches);
+
+    MeshCache::File other;
+    report.check("MeshCache rejects another vertex layout",
+        !other.open(cachePath, source.wstring(), layoutKey + 1, sizeof(CacheTestVertex)));
+
+    // 更新時刻だけ変わったときは、内容を確かめて使う
+    filesystem::last_write_time(source, filesystem::last_write_time(source, ec) + chrono::hours(1), ec);
+    report.check("MeshCache accepts a touched but unchanged source",
+        other.open(cachePath, source.wstring(), layoutKey, sizeof(CacheTestVertex)));
+
+    ofstream(source, ios::binary) << "glTF source, edited";
+    MeshCache::File edited;
+    report.check("MeshCache rejects an edited source",
+        !edited.open(cachePath, source.wstring(), layoutKey, sizeof(CacheTestVertex)));
+
+    file = MeshCache::File();
+    other = MeshCache::File();
+    filesystem::remove_all(directory, ec);
+}
+
+
+// AssetCache の読み込みが例外を投げたとき、待っているスレッドにも同じ例外が届き、次はまた読み込むか
+void testAssetCacheException(Report& report)
+{
+    AssetCache cache;
+    bool threw = false;
+    try
+    {
+        cache.get<int>(L"Failing", 0, []() -> shared_ptr<int> { throw runtime_error("load"); });
+    }
+    catch (const runtime_error&)
+    {
+        threw = true;
+    }
+    const shared_ptr<int> retried = cache.get<int>(L"Failing", 0, []() { return make_shared<int>(7); });
+    report.check("AssetCache rethrows a load that threw", threw);
+    report.check("AssetCache loads again after a load threw", retried != nullptr && *retried == 7);
+
+    // 読み込んでいる間に別のスレッドが同じものを待ち始めてから投げる
+    atomic<bool> started = false;
+    thread loader([&cache, &started]()
+        {
+            try
+            {
+                cache.get<int>(L"Waited", 0, [&cache, &started]() -> shared_ptr<int>
+                    {
+                        started = true;
+                        while (cache.getStats().waits == 0)
+                        {
+                            this_thread::yield();
+                        }
+                        throw runtime_error("load");
+                    });
+            }
+            catch (const runtime_error&)
+            {
+            }
+        });
+    while (!started)
+    {
+        this_thread::yield();
+    }
+    string waiterError = "none";
+    try
+    {
+        cache.get<int>(L"Waited", 0, []() { return make_shared<int>(1); });
+    }
+    catch (const runtime_error&)
+    {
+        waiterError = "runtime_error";
+    }
+    catch (const future_error&)
+    {
+        waiterError = "future_error";
+    }
+    loader.join();
+    report.check("AssetCache passes a load's exception to waiting threads", waiterError == "runtime_error", waiterError);
+}
+
+
+// シェーダーのキャッシュのキーが、コンパイルの結果を変えるものが変わったときだけ変わるか
+// #include したファイルが変わったら、ディスクのバイトコードを使わないか
+void testShaderCacheKey(Report& report)
+{
+    const ShaderCache::Define ab[] = { { "A", "1" }, { "B", "2" } };
+    const ShaderCache::Define ba[] = { { "B", "2" }, { "A", "1" } };
+    const ShaderCache::Define abValue[] = { { "A", "1" }, { "B", "3" } };
+    const ShaderCache::Define ac[] = { { "A", "1" }, { "C", "2" } };
+    const uint64_t key = ShaderCache::MakeKey(1, "VS", "vs_5_0", ab);
+    report.check("ShaderCache key ignores define order", key == ShaderCache::MakeKey(1, "VS", "vs_5_0", ba));
+    report.check("ShaderCache key changes with the source",
+        key != ShaderCache::MakeKey(2, "VS", "vs_5_0", ab));
+    report.check("ShaderCache key changes with entry point and profile",
+        key != ShaderCache::MakeKey(1, "PS", "vs_5_0", ab) && key != ShaderCache::MakeKey(1, "VS", "vs_4_0", ab) &&
+        ShaderCache::MakeKey(1, "VSv", "s_5_0", ab) != key);
+    report.check("ShaderCache key changes with define names and values",
+        key != ShaderCache::MakeKey(1, "VS", "vs_5_0", abValue) && key != ShaderCache::MakeKey(1, "VS", "vs_5_0", ac) &&
+        key != ShaderCache::MakeKey(1, "VS", "vs_5_0", span<const ShaderCache::Define>(ab, 1)));
+
+    // 一時ディレクトリに書き、覚えているものを捨ててからディスクを読ませる
+    const filesystem::path directory = filesystem::temp_directory_path() / "UniDxSelfTestShaderCache";
+    error_code ec;
+    filesystem::remove_all(directory, ec);
+    filesystem::create_directories(directory, ec);
+    const filesystem::path include = directory / "common.hlsli";
+    auto writeInclude = [&include](const string& text)
+        {
+            ofstream(include, ios::binary) << text;
+        };
+    writeInclude("float4 tint;");
+
+    ShaderCache cache;
+    cache.setDirectory(directory.wstring());
+    const string text = "float4 tint;";
+    const ShaderCache::Dependency dependency{ include.wstring(), ShaderCache::HashContent(text.data(), text.size()) };
+    const uint8_t bytecode[] = { 0x44, 0x58, 0x42, 0x43, 1, 2, 3, 4 };
+    cache.store(key, span(&dependency, 1), bytecode, sizeof(bytecode));
+
+    cache.clear();
+    cache.resetStats();
+    auto fromDisk = cache.find(key);
+    const bool diskHit = fromDisk != nullptr && fromDisk->size() == sizeof(bytecode) &&
+        memcmp(fromDisk->data(), bytecode, sizeof(bytecode)) == 0 && cache.getStats().diskHits == 1;
+    report.check("ShaderCache reads unchanged bytecode from disk", diskHit);
+
+    cache.clear();
+    const bool otherMiss = cache.find(ShaderCache::MakeKey(1, "VS", "vs_5_0", abValue)) == nullptr;
+    report.check("ShaderCache misses a different key", otherMiss);
+
+    writeInclude("float4 tint; float4 fog;");
+    cache.clear();
+    cache.resetStats();
+    const bool invalidated = cache.find(key) == nullptr && cache.getStats().misses == 1;
+    report.check("ShaderCache ignores bytecode whose include changed", invalidated);
+
+    filesystem::remove(include, ec);
+    cache.clear();
+    report.check("ShaderCache ignores bytecode whose include is gone", cache.find(key) == nullptr);
+
+    filesystem::remove_all(directory, ec);
+}
+
+
+// BC1 / BC3 に圧縮して戻したときの誤差が、形式で避けられない分に収まるか
+void testBCEncode(Report& report)
+{
+    mt19937 rng(1);
+    auto byte = [&rng]() { return uint8_t(rng() & 0xFF); };
+    // a と b の channel の最大の差
+    auto maxError = [](const uint8_t* a, const uint8_t* b, int first, int last)
+        {
+            int error = 0;
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = first; c < last; ++c)
+                {
+                    error = max(error, abs(int(a[i * 4 + c]) - int(b[i * 4 + c])));
+                }
+            }
+            return error;
+        };
+    const int blocks = 1000;
+
+    // 1色のブロックは RGB565 の段の半分（r, b は 4、g は 2）まで
+    bool solidOk = true;
+    for (int n = 0; n < blocks; ++n)
+    {
+        uint8_t rgba[64], block[8], decoded[64];
+        const uint8_t color[4] = { byte(), byte(), byte(), 255 };
+        for (int i = 0; i < 16; ++i) memcpy(rgba + i * 4, color, 4);
+        EncodeBC1Block(rgba, block);
+        DecodeBC1Block(block, decoded);
+        solidOk = solidOk && maxError(rgba, decoded, 0, 1) <= 4 && maxError(rgba, decoded, 1, 2) <= 2 && maxError(rgba, decoded, 2, 3) <= 4;
+    }
+    report.check("BC1 solid blocks within RGB565 rounding", solidOk);
+
+    // 2色だけのブロックは、2色をそのまま端点にできるので同じく段の半分まで
+    int twoColorError = 0;
+    for (int n = 0; n < blocks; ++n)
+    {
+        uint8_t rgba[64], block[8], decoded[64];
+        const uint8_t colors[2][4] = { { byte(), byte(), byte(), 255 }, { byte(), byte(), byte(), 255 } };
+        for (int i = 0; i < 16; ++i) memcpy(rgba + i * 4, colors[(rng() >> 7) & 1], 4);
+        EncodeBC1Block(rgba, block);
+        DecodeBC1Block(block, decoded);
+        twoColorError = max(twoColorError, maxError(rgba, decoded, 0, 3));
+    }
+    report.check("BC1 two-color blocks within RGB565 rounding", twoColorError <= 4, "max error " + to_string(twoColorError));
+
+    // 直線のグラデーションは 4 色に分けるので、幅の 1/10 ほどと丸めの分まで
+    bool gradientOk = true;
+    double gradientWorst = 0.0;
+    for (int n = 0; n < blocks; ++n)
+    {
+        uint8_t rgba[64], block[8], decoded[64];
+        const uint8_t from[3] = { byte(), byte(), byte() };
+        const uint8_t to[3] = { byte(), byte(), byte() };
+        int range = 0;
+        for (int c = 0; c < 3; ++c) range = max(range, abs(int(to[c]) - int(from[c])));
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 3; ++c) rgba[i * 4 + c] = uint8_t(lround(from[c] + (to[c] - from[c]) * (i / 15.0)));
+            rgba[i * 4 + 3] = 255;
+        }
+        EncodeBC1Block(rgba, block);
+        DecodeBC1Block(block, decoded);
+        double sum = 0.0;
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 3; ++c) sum += pow(double(rgba[i * 4 + c]) - decoded[i * 4 + c], 2.0);
+        }
+        const double rmse = sqrt(sum / 48.0);
+        gradientWorst = max(gradientWorst, rmse);
+        gradientOk = gradientOk && rmse <= range / 10.0 + 4.0;
+    }
+    ostringstream gradientDetail;
+    gradientDetail << "worst rmse " << gradientWorst;
+    report.check("BC1 gradient blocks within the 4-color palette error", gradientOk, gradientDetail.str());
+
+    // BC3 のアルファは 8 段なので、段の半分（幅の 1/14）と丸めの分まで。色の部分は BC1 と同じ
+    bool alphaOk = true, colorSame = true;
+    for (int n = 0; n < blocks; ++n)
+    {
+        uint8_t rgba[64], block[16], colorBlock[8], decoded[64];
+        const int from = byte(), to = byte();
+        for (int i = 0; i < 16; ++i)
+        {
+            rgba[i * 4 + 0] = byte(); rgba[i * 4 + 1] = byte(); rgba[i * 4 + 2] = byte();
+            rgba[i * 4 + 3] = uint8_t(lround(from + (to - from) * (i / 15.0)));
+        }
+        EncodeBC3Block(rgba, block);
+        DecodeBC3Block(block, decoded);
+        EncodeBC1Block(rgba, colorBlock);
+        alphaOk = alphaOk && maxError(rgba, decoded, 3, 4) <= abs(to - from) / 14 + 1;
+        colorSame = colorSame && memcmp(block + 8, colorBlock, 8) == 0;
+    }
+    report.check("BC3 alpha gradients within half an alpha step", alphaOk);
+    report.check("BC3 color half matches BC1", colorSame);
+
+    // 4 の倍数でない画像は端の画素を繰り返すので、1色の画像はどのブロックも1色のまま
+    const uint32_t width = 6, height = 5;
+    vector<uint8_t> image(width * height * 4);
+    for (size_t i = 0; i < image.size(); i += 4)
+    {
+        image[i] = 200; image[i + 1] = 100; image[i + 2] = 50; image[i + 3] = 255;
+    }
+    vector<uint8_t> compressed(GetCompressedSize(width, height, 8));
+    CompressBC1(image.data(), width, height, width * 4, compressed.data());
+    bool edgeOk = compressed.size() == 4 * 8;
+    for (size_t b = 0; edgeOk && b < compressed.size(); b += 8)
+    {
+        uint8_t decoded[64];
+        DecodeBC1Block(compressed.data() + b, decoded);
+        edgeOk = maxError(image.data(), decoded, 0, 3) <= 4;
+    }
+    report.check("CompressBC1 pads partial edge blocks", edgeOk);
+}
+
+
+// 頼まれた evict と load を順に覚えておく Uploader
+class RecordingUploader : public TextureResidency::Uploader
+{
+public:
+    vector<pair<uint32_t, uint32_t>> evicts;
+    vector<pair<uint32_t, uint32_t>> loads;
+
+    virtual bool evict(uint32_t id, uint32_t mip) override { evicts.push_back({ id, mip }); return true; }
+    virtual void load(uint32_t id, uint32_t mip) override { loads.push_back({ id, mip }); }
+
+    // 頼まれた読み込みをすべて終わらせる
+    void finishAll(TextureResidency& residency)
+    {
+        for (auto [id, mip] : loads)
+        {
+            if (residency.finishLoad(id, mip))
+            {
+                residency.completeLoad(id, mip);
+            }
+        }
+        loads.clear();
+    }
+};
+
+
+// 予算を超えないようにミップを割り当て、最近使われた・画面で大きいものを優先し、はみ出したものを粗くするか
+void testTextureResidency(Report& report)
+{
+    // 1024×1024 の BC1 のミップごとのバイト数
+    const uint32_t size = 1024;
+    vector<size_t> mipBytes;
+    for (uint32_t w = size; ; w /= 2)
+    {
+        mipBytes.push_back(size_t((w + 3) / 4) * ((w + 3) / 4) * 8);
+        if (w == 1) break;
+    }
+    auto sizeFrom = [&mipBytes](uint32_t mip)
+        {
+            size_t bytes = 0;
+            for (size_t i = mip; i < mipBytes.size(); ++i) bytes += mipBytes[i];
+            return bytes;
+        };
+
+    TextureResidency residency;
+    TextureResidency::Settings& settings = residency.getSettings();
+    settings.tailSize = 64;
+    settings.maxLoadsInFlight = 8;
+    settings.keepFrames = 2;
+    const uint32_t a = residency.add(size, size, mipBytes);
+    const uint32_t b = residency.add(size, size, mipBytes);
+    const uint32_t c = residency.add(size, size, mipBytes);
+    const uint32_t tail = residency.getTailMip(a);
+    const size_t tailBytes = sizeFrom(tail);
+
+    // 全部置ける分と、1段粗いものを1つ置ける分だけの予算
+    settings.budgetBytes = 3 * tailBytes + (sizeFrom(0) - tailBytes) + (sizeFrom(1) - tailBytes);
+    report.check("TextureResidency starts with only the tail mips",
+        tail == 4 && residency.getResidentMip(a) == tail && residency.getStats().residentBytes == 3 * tailBytes);
+
+    // 同じフレームなら画面で大きい順。入らないものは粗いミップのまま
+    RecordingUploader uploader;
+    residency.request(a, 256.0f);
+    residency.request(b, 1024.0f);
+    residency.request(c, 512.0f);
+    residency.update(uploader);
+    const bool priorityOrder = uploader.loads == vector<pair<uint32_t, uint32_t>>{ { b, 0 }, { c, 1 } };
+    report.check("TextureResidency loads the largest on screen first", priorityOrder);
+    report.check("TextureResidency leaves what does not fit at the tail",
+        residency.getTargetMip(a) == tail && residency.getTargetMip(b) == 0 && residency.getTargetMip(c) == 1);
+    uploader.finishAll(residency);
+    report.check("TextureResidency fills the budget exactly", residency.getStats().residentBytes == settings.budgetBytes);
+
+    // 次のフレームで a だけを大きく使うと、最近使われたものとして先に入り、ほかは粗くなる
+    residency.request(a, 1024.0f);
+    residency.update(uploader);
+    const bool evicted = uploader.evicts == vector<pair<uint32_t, uint32_t>>{ { b, 1 }, { c, tail } };
+    report.check("TextureResidency evicts older textures to make room", evicted && uploader.loads == vector<pair<uint32_t, uint32_t>>{ { a, 0 } });
+    report.check("TextureResidency stays within budget after eviction", residency.getStats().residentBytes <= settings.budgetBytes);
+    uploader.finishAll(residency);
+    report.check("TextureResidency stays within budget after loading", residency.getStats().residentBytes <= settings.budgetBytes);
+
+    // keepFrames より長く使われないものは、予算が余っていても粗いミップに戻す
+    uploader.evicts.clear();
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        residency.request(a, 1024.0f);
+        residency.update(uploader);
+    }
+    report.check("TextureResidency drops unused textures to the tail",
+        uploader.evicts == vector<pair<uint32_t, uint32_t>>{ { b, tail } } && residency.getResidentMip(a) == 0);
+
+    // 読み込み中に要らなくなったもの、登録を解除したものは使わない。解除した番号は読み込みが終わるまで使わない
+    residency.request(b, 1024.0f);
+    settings.budgetBytes = 3 * tailBytes + (sizeFrom(0) - tailBytes) * 2;
+    residency.update(uploader);
+    const bool startedB = uploader.loads.size() == 1 && uploader.loads[0].first == b;
+    settings.budgetBytes = 3 * tailBytes + (sizeFrom(0) - tailBytes);
+    residency.request(a, 1024.0f);
+    residency.update(uploader);
+    const bool staleDropped = residency.finishLoad(b, 0) == false && residency.getResidentMip(b) == tail;
+    uploader.loads.clear();
+
+    residency.request(c, 2048.0f);
+    residency.update(uploader);
+    residency.remove(c);
+    const uint32_t whileLoading = residency.add(size, size, mipBytes);
+    const bool removedDropped = residency.finishLoad(c, uploader.loads.empty() ? 0 : uploader.loads[0].second) == false;
+    const uint32_t afterLoad = residency.add(size, size, mipBytes);
+    report.check("TextureResidency drops loads that are no longer wanted",
+        startedB && staleDropped && removedDropped && !uploader.loads.empty());
+    report.check("TextureResidency keeps a removed id until its load finishes", whileLoading != c && afterLoad == c);
+}
+
+
+// 親をたどったモデル空間の行列と、初期姿勢のスキンの行列が合っているか
+// 一定の間隔に並べ直したクリップから、キーの間の姿勢と繰り返しが取り出せるか
+void testAnimationClip(Report& report)
+{
+    Skeleton skeleton;
+    skeleton.addNode("Root", -1, 0, Vector3::Zero, Quaternion::Identity, Vector3::One);
+    skeleton.addNode("Arm", 0, 1, Vector3(0, 1, 0), Quaternion::Identity, Vector3::One);
+
+    vector<Matrix> model(skeleton.size());
+    skeleton.computeModelMatrices(skeleton.getRestPose(), model.data());
+    const Quaternion quarter = Quaternion::CreateFromAxisAngle(Vector3::UnitZ, DirectX::XM_PIDIV2);
+    AnimationPose turned = skeleton.getRestPose();
+    turned.set(0, Vector3::Zero, quarter, Vector3::One);
+    vector<Matrix> turnedModel(skeleton.size());
+    skeleton.computeModelMatrices(turned, turnedModel.data());
+    report.check("Skeleton composes model matrices through the parents",
+        Vector3::Distance(model[1].Translation(), Vector3(0, 1, 0)) < 1e-5f &&
+        Vector3::Distance(turnedModel[1].Translation(), Vector3(-1, 0, 0)) < 1e-5f);
+
+    // 初期姿勢の逆行列をバインドにすると、スキンの行列は単位行列になる
+    Skin skin;
+    skin.joints = { 0, 1 };
+    skin.inverseBindMatrices = { model[0].Invert(), model[1].Invert() };
+    skeleton.skins.push_back(skin);
+    Vector4 palette[2 * Skeleton::PaletteRowsPerJoint];
+    const size_t joints = skeleton.computeSkinPalette(0, model.data(), palette);
+    bool identity = joints == 2;
+    for (size_t i = 0; i < size(palette); ++i)
+    {
+        const size_t row = i % Skeleton::PaletteRowsPerJoint;
+        const Vector4 expected(row == 0 ? 1.0f : 0.0f, row == 1 ? 1.0f : 0.0f, row == 2 ? 1.0f : 0.0f, 0.0f);
+        identity = identity && Vector4::Distance(palette[i], expected) < 1e-5f;
+    }
+    report.check("Skeleton rest pose gives an identity skin palette", identity);
+
+    // ルートが1秒で 90 度回るクリップ
+    AnimationClip::Track track;
+    track.node = 0;
+    track.path = AnimationClip::Track::Path::Rotation;
+    track.times = { 0.0f, 1.0f };
+    track.values = { 0, 0, 0, 1, quarter.x, quarter.y, quarter.z, quarter.w };
+    AnimationClip clip;
+    const bool built = clip.build("Turn", skeleton, span(&track, 1));
+    AnimationPose pose;
+    clip.sample(0.5f, false, pose);
+    const Quaternion eighth = Quaternion::CreateFromAxisAngle(Vector3::UnitZ, DirectX::XM_PIDIV4);
+    report.check("AnimationClip resamples the keys at a fixed rate",
+        built && clip.getFrameCount() == 31 && fabs(clip.getLength() - 1.0f) < 1e-6f);
+    report.check("AnimationClip samples between keys and keeps other nodes at rest",
+        fabs(pose.getRotation(0).Dot(eighth)) > 0.99999f && Vector3::Distance(pose.getPosition(1), Vector3(0, 1, 0)) < 1e-6f);
+
+    AnimationPose looped, early;
+    clip.sample(1.25f, true, looped);
+    clip.sample(0.25f, false, early);
+    clip.sample(5.0f, false, pose);
+    report.check("AnimationClip loops or holds the last pose",
+        fabs(looped.getRotation(0).Dot(early.getRotation(0))) > 0.99999f &&
+        fabs(pose.getRotation(0).Dot(quarter)) > 0.99999f);
+
+    // SIMD 版とスカラー版の混ぜ方が同じか。ノードの数は4の倍数にしない
+    mt19937 random(49);
+    uniform_real_distribution<float> value(-1.0f, 1.0f);
+    AnimationPose a, b, simd, scalar;
+    for (AnimationPose* p : { &a, &b, &simd, &scalar })
+    {
+        p->resize(7);
+    }
+    for (size_t i = 0; i < 7; ++i)
+    {
+        Quaternion qa(value(random), value(random), value(random), value(random));
+        Quaternion qb(value(random), value(random), value(random), value(random));
+        qa.Normalize();
+        qb.Normalize();
+        a.set(i, Vector3(value(random), value(random), value(random)), qa, Vector3(1, 2, 3));
+        b.set(i, Vector3(value(random), value(random), value(random)), qb, Vector3(3, 2, 1));
+    }
+    BlendPoseChannels(a.data(), b.data(), 0.3f, a.getStride(), simd.data());
+    BlendPoseChannelsScalar(a.data(), b.data(), 0.3f, a.getStride(), scalar.data());
+    float error = 0.0f;
+    for (size_t i = 0; i < a.getStride() * AnimationPose::ChannelCount; ++i)
+    {
+        error = max(error, fabs(simd.data()[i] - scalar.data()[i]));
+    }
+    report.check("BlendPoseChannels matches the scalar path", error < 1e-5f, "max error " + to_string(error));
+}
+
+
+// 定数のリングが 1 フレームで使った分を数え、足りなかったときだけ上限まで広げるか
+void testRingGrowth(Report& report)
+{
+    RingAllocator ring(1024, 256);
+    RingAllocator::Allocation allocation;
+    ring.beginFrame();
+    for (int i = 0; i < 6; ++i)
+    {
+        ring.allocate(200, allocation);
+    }
+    report.check("RingAllocator counts bytes used in the frame", ring.getFrameUsed() == 6 * 256,
+        to_string(ring.getFrameUsed()));
+    report.check("RingAllocator wraps mid-frame when full", ring.getDiscardCount() == 2 && ring.getUsed() == 512);
+    ring.beginFrame();
+    report.check("RingAllocator frame usage restarts at beginFrame", ring.getFrameUsed() == 0);
+
+    report.check("Ring keeps its capacity when the frame fits",
+        RingAllocator::GetGrownCapacity(1024, 1024, 4096) == 1024);
+    report.check("Ring doubles until the frame fits",
+        RingAllocator::GetGrownCapacity(1024, 1536, 4096) == 2048 &&
+        RingAllocator::GetGrownCapacity(1024, 3000, 4096) == 4096);
+    report.check("Ring growth stops at the maximum",
+        RingAllocator::GetGrownCapacity(1024, 100000, 4096) == 4096 &&
+        RingAllocator::GetGrownCapacity(4096, 100000, 4096) == 4096);
+}
+
+
+// 圧縮したカーブがフレームの時刻で許容誤差に収まり、まっすぐな区間のキーを捨てるか
+// まとめて評価した値が1本ずつ評価した値と同じか。時刻を戻したときも合っているか
+void testCompressedCurveClip(Report& report)
+{
+    // 4本で1つのグループにならない 6 本。最後のグループはまっすぐなカーブと一定のカーブ
+    vector<AnimationCurve> curves(6);
+    for (size_t c = 0; c < 4; ++c)
+    {
+        for (int k = 0; k <= 20; ++k)
+        {
+            const float t = float(k) * 0.1f;
+            curves[c].AddKey(Keyframe(t, sin(t * float(c + 1)) * 2.0f));
+        }
+    }
+    curves[4].AddKey(Keyframe(0.0f, 0.0f, 0.5f, 0.5f));
+    curves[4].AddKey(Keyframe(2.0f, 1.0f, 0.5f, 0.5f));
+    curves[5].AddKey(Keyframe(0.0f, 3.0f));
+    curves[5].AddKey(Keyframe(2.0f, 3.0f));
+
+    CompressedCurveClip clip;
+    const bool built = clip.build(curves);
+    report.check("CompressedCurveClip groups the tracks in fours",
+        built && clip.getTrackCount() == 6 && clip.getGroupCount() == 2);
+
+    float frameError = 0.0f;
+    const size_t frames = size_t(lround((clip.getEndTime() - clip.getStartTime()) * clip.getSampleRate())) + 1;
+    for (size_t track = 0; track < curves.size(); ++track)
+    {
+        for (size_t f = 0; f < frames; ++f)
+        {
+            const float time = clip.getStartTime() + float(f) / clip.getSampleRate();
+            frameError = max(frameError, fabs(clip.evaluate(track, time) - curves[track].Evaluate(time)));
+        }
+    }
+    report.check("CompressedCurveClip stays within the error bound at frames",
+        frameError <= CompressedCurveClip::DefaultMaxError * 1.01f, "max error " + to_string(frameError));
+    report.check("CompressedCurveClip drops keys on straight segments",
+        clip.getKeyCount() < frames + 3, to_string(clip.getKeyCount()) + " keys for " + to_string(frames) + " frames");
+
+    // 進めてから戻す
+    CompressedCurveSampler sampler(clip);
+    vector<float> values(clip.getTrackCount());
+    bool same = true;
+    for (float time : { 0.0f, 0.016f, 0.4f, 1.3f, 1.31f, 2.0f, 0.2f, 0.9f, 5.0f, -1.0f })
+    {
+        sampler.sample(time, values);
+        for (size_t track = 0; track < values.size(); ++track)
+        {
+            same = same && values[track] == clip.evaluate(track, time);
+        }
+    }
+    report.check("CompressedCurveSampler matches evaluate forward and backward", same);
+}
+
+}
+
+
+bool RunSelfTest(const wstring& resultPath)
+{
+    ofstream out{ filesystem::path(resultPath) };
+    Report report(out);
+
+    testTransformHierarchy(report);
+    testTransformBatch(report);
+    testTransformHierarchyParallel(report);
+    testPrefabPool(report);
+    testSceneDestroy(report);
+    testPrefabOutlivesScene(report);
+    testFrustumCulling(report);
+    testRenderQueue(report);
+    testInstancedDrawStats(report);
+    testRingAllocator(report);
+    testParallelRecorder(report);
+    testNullRenderDevice(report);
+    testJobSystemWorkerInit(report);
+    testHeadlessWorkerCommands(report);
+    testLODGroupCulling(report);
+    testMeshSimplifier(report);
+    testMeshOptimizer(report);
+    testVertexPacking(report);
+    testVertexInterleave(report);
+    testAssetLoader(report);
+    testStridedViewAndMappedFile(report);
+    testMeshCache(report);
+    testAssetCacheException(report);
+    testShaderCacheKey(report);
+    testBCEncode(report);
+    testTextureResidency(report);
+    testAnimationClip(report);
+    testRingGrowth(report);
+    testCompressedCurveClip(report);
+
+    out << (report.getFailed() == 0 ? "all passed\n" : "some checks failed\n");
+    return report.getFailed() == 0;
+}
@@ -0,0 +1,12 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// エンジンの CPU で動く部分の自己診断
+//
+// GPU を使わずに確かめられる処理を決まった入力で動かし、期待どおりになるかを項目ごとに resultPath に書き出す。
+// 1つでも失敗すれば false を返す。
+// --------------------
+bool RunSelfTest(const std::wstring& resultPath);
@@ -0,0 +1,145 @@
+﻿#include "SimplifyBenchmark.h"
+
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <cmath>
+
+#include <UniDx/MeshSimplifier.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr int gridSize_ = 256;      // 格子の1辺の分割数
+constexpr int sphereRings_ = 256;   // 球の緯度方向の分割数
+constexpr int repeat_ = 3;          // 1つの割合で簡略化する回数。一番速い回を使う
+
+
+// 高さを波打たせた gridSize_ x gridSize_ の格子。縁は開いている
+void makeWave(OwnedSubMeshData& mesh)
+{
+    const int n = gridSize_ + 1;
+    mesh.topology = PrimitiveTopology::TriangleList;
+    mesh.resizePositions(size_t(n) * n);
+    auto& positions = const_cast<vector<Vector3>&>(mesh.mutablePositions());
+    for (int z = 0; z < n; ++z)
+    {
+        for (int x = 0; x < n; ++x)
+        {
+            const float fx = float(x) / gridSize_;
+            const float fz = float(z) / gridSize_;
+            positions[size_t(z) * n + x] = Vector3(fx, 0.05f * sinf(fx * 12.0f) * cosf(fz * 9.0f), fz);
+        }
+    }
+
+    mesh.resizeIndices(size_t(gridSize_) * gridSize_ * 6);
+    auto& indices = const_cast<vector<uint32_t>&>(mesh.mutableIndices());
+    size_t k = 0;
+    for (int z = 0; z < gridSize_; ++z)
+    {
+        for (int x = 0; x < gridSize_; ++x)
+        {
+            const uint32_t i = uint32_t(z * n + x);
+            indices[k++] = i; indices[k++] = i + n; indices[k++] = i + 1;
+            indices[k++] = i + 1; indices[k++] = i + n; indices[k++] = i + n + 1;
+        }
+    }
+}
+
+
+// 経線の継ぎ目で頂点を分けた、UV つきの球
+void makeSphere(OwnedSubMeshData& mesh)
+{
+    const int rings = sphereRings_;
+    const int segments = sphereRings_ * 2;
+    const int columns = segments + 1;
+    mesh.topology = PrimitiveTopology::TriangleList;
+    mesh.resizePositions(size_t(rings + 1) * columns);
+    mesh.resizeUV(size_t(rings + 1) * columns);
+    auto& positions = const_cast<vector<Vector3>&>(mesh.mutablePositions());
+    auto& uv = const_cast<vector<Vector2>&>(mesh.mutableUV());
+    for (int r = 0; r <= rings; ++r)
+    {
+        const float theta = 3.14159265f * float(r) / rings;
+        for (int s = 0; s <= segments; ++s)
+        {
+            const float phi = 2.0f * 3.14159265f * float(s) / segments;
+            const size_t i = size_t(r) * columns + s;
+            positions[i] = Vector3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            uv[i] = Vector2(float(s) / segments, float(r) / rings);
+        }
+    }
+
+    mesh.resizeIndices(size_t(rings) * segments * 6);
+    auto& indices = const_cast<vector<uint32_t>&>(mesh.mutableIndices());
+    size_t k = 0;
+    for (int r = 0; r < rings; ++r)
+    {
+        for (int s = 0; s < segments; ++s)
+        {
+            const uint32_t i = uint32_t(r * columns + s);
+            indices[k++] = i; indices[k++] = i + 1; indices[k++] = i + columns;
+            indices[k++] = i + 1; indices[k++] = i + columns + 1; indices[k++] = i + columns;
+        }
+    }
+}
+
+
+// source を ratio に減らして、一番速い回の秒数と、残った三角形の数と誤差を返す
+double measure(const SubMeshData& source, float ratio, size_t& triangles, float& error)
+{
+    MeshSimplifier::Settings settings;
+    settings.targetRatio = ratio;
+    settings.maxError = 1.0f;   // 割合まで減らしきる
+
+    double best = 0.0;
+    for (int i = 0; i < repeat_; ++i)
+    {
+        const Clock::time_point start = Clock::now();
+        auto result = MeshSimplifier::Simplify(source, settings, &error);
+        const double seconds = chrono::duration<double>(Clock::now() - start).count();
+        triangles = result != nullptr ? result->indices.size() / 3 : 0;
+        if (i == 0 || seconds < best)
+        {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+}
+
+
+void RunSimplifyBenchmark(const wstring& resultPath)
+{
+    ofstream out{ filesystem::path(resultPath) };
+
+    OwnedSubMeshData wave, sphere;
+    makeWave(wave);
+    makeSphere(sphere);
+
+    const struct { const char* name; const SubMeshData* mesh; } meshes[] = {
+        { "wave", &wave },
+        { "sphere", &sphere },
+    };
+    const float ratios[] = { 0.5f, 0.25f, 0.1f };
+
+    out << "mesh, triangles, ratio, result triangles, error, ms, Mtris/s\n";
+    for (const auto& m : meshes)
+    {
+        const size_t source = m.mesh->indices.size() / 3;
+        for (float ratio : ratios)
+        {
+            size_t triangles = 0;
+            float error = 0.0f;
+            const double seconds = measure(*m.mesh, ratio, triangles, error);
+            out << m.name << ", " << source << ", " << ratio << ", " << triangles << ", " << error << ", "
+                << seconds * 1000.0 << ", " << double(source) / seconds / 1.0e6 << "\n";
+        }
+    }
+}
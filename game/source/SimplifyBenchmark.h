@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// メッシュの簡略化の計測
+//
+// 格子を波打たせた面と細かく分けた球を MeshSimplifier で 1/2・1/4・1/10 に減らし、
+// 元の三角形を1秒あたりにいくつ処理できたかと、残った三角形の数と誤差を resultPath に書き出す。
+// GPU もエンジンも使わない。
+// --------------------
+void RunSimplifyBenchmark(const std::wstring& resultPath);
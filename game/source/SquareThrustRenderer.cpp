@@ -20,15 +20,15 @@ constexpr Vector2 uvs[] = {
 
 
 
-void SquareThrustRenderer::OnEnable()
+void SquareThrustRenderer::Awake()
 {
-    MeshRenderer::OnEnable();
+    MeshRenderer::Awake();
 
-    // メッシュの初期化
+    // メッシュの初期化。プールで使い回して OnEnable が何度呼ばれても1回だけ作る
     auto submesh = std::make_unique<UniDx::SubMesh>();
     submesh->positions = std::span<const Vector3>(positions, std::size(positions));
     submesh->uv = std::span<const Vector2>(uvs, std::size(uvs));
-    submesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    submesh->topology = UniDx::PrimitiveTopology::TriangleList;
     submesh->createBuffer<UniDx::VertexPT>();
 
     mesh.submesh.push_back(std::move(submesh));
@@ -19,6 +19,6 @@ public:
     }
 
 protected:
-    virtual void OnEnable() override;
+    virtual void Awake() override;
 };
 
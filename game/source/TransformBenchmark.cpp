@@ -0,0 +1,102 @@
+﻿#include "TransformBenchmark.h"
+
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+#include <UniDx/TransformBatch.h>
+
+using namespace std;
+using namespace UniDx;
+
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr size_t count_ = 100000;
+constexpr size_t parentCount_ = 1000;   // 親にする行列の数。最初の parentCount_ 個はルート
+constexpr int repeat_ = 20;
+
+
+// ランダムな姿勢を count_ 個詰める
+void fill(TransformBatchBuffer& buffer, vector<float>& parents)
+{
+    mt19937 rng(1);
+    uniform_real_distribution<float> position(-100.0f, 100.0f);
+    uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    // 親は単位行列を少し動かしたもの
+    parents.assign(parentCount_ * 16, 0.0f);
+    for (size_t i = 0; i < parentCount_; ++i)
+    {
+        const float p[3] = { position(rng), position(rng), position(rng) };
+        const float q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        const float s[3] = { 1.0f, 1.0f, 1.0f };
+        ComposeTRS(p, q, s, &parents[i * 16]);
+    }
+
+    buffer.resize(count_);
+    for (size_t i = 0; i < count_; ++i)
+    {
+        const float p[3] = { position(rng), position(rng), position(rng) };
+        float q[4] = { unit(rng), unit(rng), unit(rng), unit(rng) };
+        const float len = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (float& c : q)
+        {
+            c /= len;
+        }
+        const float s[3] = { scale(rng), scale(rng), scale(rng) };
+        buffer.set(i, p, q, s, i < parentCount_ ? nullptr : &parents[(i % parentCount_) * 16]);
+    }
+}
+
+
+// 1マイクロ秒あたりの Transform の数。repeat_ 回のうち一番速いもの
+template<typename F>
+double measure(F compose)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat_; ++r)
+    {
+        const Clock::time_point start = Clock::now();
+        compose();
+        best = min(best, chrono::duration<double, micro>(Clock::now() - start).count());
+    }
+    return double(count_) / best;
+}
+
+}
+
+
+void RunTransformBenchmark(const wstring& resultPath)
+{
+    ofstream out{ filesystem::path(resultPath) };
+
+    TransformBatchBuffer buffer;
+    vector<float> parents;
+    fill(buffer, parents);
+    const TransformBatchInput input = buffer.input();
+
+    vector<float> scalarLocal(count_ * 16), scalarWorld(count_ * 16);
+    const double scalar = measure([&]() { ComposeLocalToWorldBatchScalar(input, count_, scalarLocal.data(), scalarWorld.data()); });
+    const double batch = measure([&]() { ComposeLocalToWorldBatch(input, count_, buffer.local.data(), buffer.world.data()); });
+
+    // 2つの結果の差
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < count_ * 16; ++i)
+    {
+        maxDiff = max(maxDiff, fabsf(buffer.world[i] - scalarWorld[i]));
+        maxDiff = max(maxDiff, fabsf(buffer.local[i] - scalarLocal[i]));
+    }
+
+    out << "transforms " << count_ << ", avx2 " << (IsTransformBatchAvx2Enabled() ? "enabled" : "disabled") << "\n";
+    out << "path, transforms/us\n";
+    out << "scalar, " << scalar << "\n";
+    out << "batch, " << batch << "\n";
+    out << "speedup " << batch / scalar << ", max diff " << maxDiff << "\n";
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include <string>
+
+
+// --------------------
+// Transform の行列計算の計測
+//
+// 10万個の位置・回転・スケールと親の行列から、ローカル行列とワールド行列をまとめて計算し、
+// スカラー版と AVX2/FMA 版の1マイクロ秒あたりの Transform の数と、結果の差を resultPath に書き出す。
+// GPU もエンジンも使わない。
+// --------------------
+void RunTransformBenchmark(const std::wstring& resultPath);
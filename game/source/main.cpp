@@ -4,8 +4,19 @@
 #include "../framework.h"
 #include "main.h"
 
+#include <atomic>
+
 #include <UniDx.h>
 #include <UniDx/Engine.h>
+#include <UniDx/HeadlessServer.h>
+
+#include "LoadBenchmark.h"
+#include "AnimationBenchmark.h"
+#include "TransformBenchmark.h"
+#include "CullBenchmark.h"
+#include "SimplifyBenchmark.h"
+#include "AssetCook.h"
+#include "SelfTest.h"
 
 #define MAX_LOADSTRING 100
 
@@ -24,13 +35,103 @@ BOOL                InitInstance(HINSTANCE, int);
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    About(HWND, UINT, WPARAM, LPARAM);
 
+// -server で動かしているサーバー。コンソールの Ctrl+C や閉じるボタンで止める
+static std::atomic<HeadlessServer*> g_server = nullptr;
+
+static BOOL WINAPI ServerConsoleHandler(DWORD)
+{
+    if (HeadlessServer* server = g_server.load())
+    {
+        server->requestStop();
+    }
+    return TRUE;
+}
+
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_opt_ HINSTANCE hPrevInstance,
                      _In_ LPWSTR    lpCmdLine,
                      _In_ int       nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+    // -server N [T] のときはウィンドウを作らず、N 個のシーンをサーバーとして動かす
+    // T を指定すると、それぞれ T 回更新したら終わる。
+    // 指定しなければ、起動したコンソールで Ctrl+C を押すか、コンソールを閉じるまで続ける
+    if (wcsncmp(lpCmdLine, L"-server", 7) == 0)
+    {
+        wchar_t* rest = nullptr;
+        const long count = wcstol(lpCmdLine + 7, &rest, 10);
+        const long long ticks = wcstoll(rest, nullptr, 10);
+
+        HeadlessEngine::Settings settings;
+        settings.maxTicks = ticks > 0 ? uint64_t(ticks) : 0;
+
+        HeadlessServer server;
+        server.start(count > 0 ? size_t(count) : 1, settings);
+        g_server = &server;
+        const bool console = AttachConsole(ATTACH_PARENT_PROCESS) != FALSE;
+        if (console)
+        {
+            SetConsoleCtrlHandler(ServerConsoleHandler, TRUE);
+        }
+        server.join();
+        if (console)
+        {
+            SetConsoleCtrlHandler(ServerConsoleHandler, FALSE);
+            FreeConsole();
+        }
+        g_server = nullptr;
+        return 0;
+    }
+
+    // -loadbench のときはウィンドウを作らず、glTF の読み込み時間を計測して LoadBenchmark.txt に書き出す
+    if (wcsncmp(lpCmdLine, L"-loadbench", 10) == 0)
+    {
+        RunLoadBenchmark(L"LoadBenchmark.txt");
+        return 0;
+    }
+
+    // -animbench のときはウィンドウを作らず、スケルタルアニメーションの計算時間を計測して AnimationBenchmark.txt に書き出す
+    if (wcsncmp(lpCmdLine, L"-animbench", 10) == 0)
+    {
+        RunAnimationBenchmark(L"AnimationBenchmark.txt");
+        return 0;
+    }
+
+    // -transformbench のときはウィンドウを作らず、Transform の行列計算の速さを計測して TransformBenchmark.txt に書き出す
+    if (wcsncmp(lpCmdLine, L"-transformbench", 15) == 0)
+    {
+        RunTransformBenchmark(L"TransformBenchmark.txt");
+        return 0;
+    }
+
+    // -cullbench のときはウィンドウを作らず、視錐台カリングの速さを計測して CullBenchmark.txt に書き出す
+    if (wcsncmp(lpCmdLine, L"-cullbench", 10) == 0)
+    {
+        RunCullBenchmark(L"CullBenchmark.txt");
+        return 0;
+    }
+
+    // -simplifybench のときはウィンドウを作らず、メッシュの簡略化の速さを計測して SimplifyBenchmark.txt に書き出す
+    if (wcsncmp(lpCmdLine, L"-simplifybench", 14) == 0)
+    {
+        RunSimplifyBenchmark(L"SimplifyBenchmark.txt");
+        return 0;
+    }
+
+    // -cook のときはウィンドウを作らず、Resource の .glb をエンジンの形式に書き出す
+    if (wcsncmp(lpCmdLine, L"-cook", 5) == 0)
+    {
+        CookAssets(L"Resource");
+        return 0;
+    }
+
+    // -selftest のときはウィンドウを作らず、CPU で動く部分の自己診断の結果を SelfTest.txt に書き出す
+    // 失敗があれば終了コードを 1 にする
+    if (wcsncmp(lpCmdLine, L"-selftest", 9) == 0)
+    {
+        return RunSelfTest(L"SelfTest.txt") ? 0 : 1;
+    }
 
     // グローバル文字列を初期化する
     LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);